@@ -27,26 +27,44 @@ ALN_RES_MERGE="$TMP_PATH/aln_0"
 while [ "$STEP" -lt "$STEPS" ]; do
     SENS_PARAM=SENSE_${STEP}
     eval SENS="\$$SENS_PARAM"
-    # call prefilter module
-    if notExists "$TMP_PATH/pref_$STEP.dbtype"; then
-        # shellcheck disable=SC2086
-        $RUNNER "$MMSEQS" prefilter "$INPUT" "$TARGET" "$TMP_PATH/pref_$STEP" $PREFILTER_PAR -s "$SENS" \
-            || fail "Prefilter died"
-    fi
-
-    # call alignment module
-    if [ "$STEPS" -eq 1 ]; then
-        if notExists "$3.dbtype"; then
-            # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$3" $ALIGNMENT_PAR  \
-                || fail "Alignment died"
+    if [ -n "$STREAM_PREFILTER" ]; then
+        # call prefilter and alignment in one module without writing the prefilter result
+        if [ "$STEPS" -eq 1 ]; then
+            if notExists "$3.dbtype"; then
+                # shellcheck disable=SC2086
+                $RUNNER "$MMSEQS" prefilteralign "$INPUT" "$TARGET" "$3" $PREFILTERALIGN_PAR -s "$SENS" \
+                    || fail "Prefilteralign died"
+            fi
+            break
+        else
+            if notExists "$TMP_PATH/aln_$STEP.dbtype"; then
+                # shellcheck disable=SC2086
+                $RUNNER "$MMSEQS" prefilteralign "$INPUT" "$TARGET" "$TMP_PATH/aln_$STEP" $PREFILTERALIGN_PAR -s "$SENS" \
+                    || fail "Prefilteralign died"
+            fi
         fi
-        break
     else
-        if notExists "$TMP_PATH/aln_$STEP.dbtype"; then
+        # call prefilter module
+        if notExists "$TMP_PATH/pref_$STEP.dbtype"; then
             # shellcheck disable=SC2086
-            $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$TMP_PATH/aln_$STEP" $ALIGNMENT_PAR  \
-                || fail "Alignment died"
+            $RUNNER "$MMSEQS" prefilter "$INPUT" "$TARGET" "$TMP_PATH/pref_$STEP" $PREFILTER_PAR -s "$SENS" \
+                || fail "Prefilter died"
+        fi
+
+        # call alignment module
+        if [ "$STEPS" -eq 1 ]; then
+            if notExists "$3.dbtype"; then
+                # shellcheck disable=SC2086
+                $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$3" $ALIGNMENT_PAR  \
+                    || fail "Alignment died"
+            fi
+            break
+        else
+            if notExists "$TMP_PATH/aln_$STEP.dbtype"; then
+                # shellcheck disable=SC2086
+                $RUNNER "$MMSEQS" "${ALIGN_MODULE}" "$INPUT" "$TARGET${ALIGNMENT_DB_EXT}" "$TMP_PATH/pref_$STEP" "$TMP_PATH/aln_$STEP" $ALIGNMENT_PAR  \
+                    || fail "Alignment died"
+            fi
         fi
     fi
 
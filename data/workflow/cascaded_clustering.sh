@@ -145,12 +145,18 @@ if [ -n "$REASSIGN" ]; then
     # try to find best matching centroid sequences for prev. wrong assigned sequences
     if notExists "${TMP_PATH}/seq_wrong_assigned_pref.dbtype"; then
         # combine seq dbs
-        MAXOFFSET=$(awk '($2+$3) > max{max=$2+$3}END{print max}' "${TMP_PATH}/seq_seeds.index")
+        # the entries of the second part start after the data file of the first one,
+        # the index lengths of compressed entries are their uncompressed lengths
+        MAXOFFSET=$(wc -c < "${TMP_PATH}/seq_seeds" | tr -d ' ')
         awk -v OFFSET="${MAXOFFSET}" 'FNR==NR{print $0; next}{print $1"\t"$2+OFFSET"\t"$3}' "${TMP_PATH}/seq_seeds.index" \
              "${TMP_PATH}/seq_wrong_assigned.index" > "${TMP_PATH}/seq_seeds.merged.index"
         ln -s "$(abspath "${TMP_PATH}/seq_seeds")" "${TMP_PATH}/seq_seeds.merged.0"
         ln -s "$(abspath "${TMP_PATH}/seq_wrong_assigned")" "${TMP_PATH}/seq_seeds.merged.1"
         cp "${TMP_PATH}/seq_seeds.dbtype" "${TMP_PATH}/seq_seeds.merged.dbtype"
+        # both parts are copied from the source and share its compression dictionary
+        if [ -f "${TMP_PATH}/seq_seeds.zdict" ]; then
+            ln -s "$(abspath "${TMP_PATH}/seq_seeds.zdict")" "${TMP_PATH}/seq_seeds.merged.zdict"
+        fi
         # shellcheck disable=SC2086
         $RUNNER "$MMSEQS" prefilter "${TMP_PATH}/seq_wrong_assigned" "${TMP_PATH}/seq_seeds.merged" "${TMP_PATH}/seq_wrong_assigned_pref" ${PREFILTER_REASSIGN_PAR} \
                  || fail "Prefilter reassign died"
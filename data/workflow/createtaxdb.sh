@@ -1,5 +1,10 @@
 #!/bin/sh -e
 
+fail() {
+    echo "Error: $1"
+    exit 1
+}
+
 notExists() {
 	  [ ! -f "$1" ]
 }
@@ -49,6 +54,12 @@ cp -f "${NCBITAXINFO}/names.dmp"     "${TAXDBNAME}_names.dmp"
 cp -f "${NCBITAXINFO}/nodes.dmp"     "${TAXDBNAME}_nodes.dmp"
 cp -f "${NCBITAXINFO}/merged.dmp"    "${TAXDBNAME}_merged.dmp"
 cp -f "${NCBITAXINFO}/delnodes.dmp"  "${TAXDBNAME}_delnodes.dmp"
+# binary mapping, it is memory mapped instead of parsing the text mapping
+"$MMSEQS" createbintaxmapping "${TAXDBNAME}_mapping" "${TAXDBNAME}_mapping.bin" \
+    || fail "createbintaxmapping died"
+# binary taxonomy with the precomputed LCA structure, it is memory mapped instead of parsing the .dmp files
+"$MMSEQS" createbintaxonomy "${TAXDBNAME}_names.dmp" "${TAXDBNAME}_nodes.dmp" "${TAXDBNAME}_merged.dmp" "${TAXDBNAME}_taxonomy" \
+    || fail "createbintaxonomy died"
 echo "Database created"
 
 if [ -n "$REMOVE_TMP" ]; then
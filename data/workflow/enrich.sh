@@ -57,9 +57,9 @@ while [ "${STEP}" -lt "${NUM_IT}" ]; do
             # shellcheck disable=SC2086
             "${MMSEQS}" subtractdbs "${TMP_PATH}/pref_${STEP}" "${TMP_PATH}/aln_0" "${TMP_PATH}/pref_next_${STEP}" ${SUBSTRACT_PAR} \
                 || fail "subtractdbs died"
-            mv -f "${TMP_PATH}/pref_next_${STEP}" "${TMP_PATH}/pref_${STEP}"
-            mv -f "${TMP_PATH}/pref_next_${STEP}.index" "${TMP_PATH}/pref_${STEP}.index"
-            mv -f "${TMP_PATH}/pref_next_${STEP}.dbtype" "${TMP_PATH}/pref_${STEP}.dbtype"
+            # shellcheck disable=SC2086
+            "${MMSEQS}" mvdb "${TMP_PATH}/pref_next_${STEP}" "${TMP_PATH}/pref_${STEP}" ${VERBOSITY_PAR} \
+                || fail "mvdb died"
             touch "${TMP_PATH}/pref_${STEP}.hasnext"
         fi
     fi
@@ -80,9 +80,9 @@ while [ "${STEP}" -lt "${NUM_IT}" ]; do
         # shellcheck disable=SC2086
         "${MMSEQS}" expandaln "${INPUT}" "${PROFTARGETSEQ}" "${TMP_PATH}/aln_${STEP}" "${PROFRESULT}" "${TMP_PATH}/aln_exp_${STEP}" ${TMP} \
             || fail "expandaln died"
-        mv -f "${TMP_PATH}/aln_exp_${STEP}" "${TMP_PATH}/aln_${STEP}"
-        mv -f "${TMP_PATH}/aln_exp_${STEP}.index" "${TMP_PATH}/aln_${STEP}.index"
-        mv -f "${TMP_PATH}/aln_exp_${STEP}.dbtype" "${TMP_PATH}/aln_${STEP}.dbtype"
+        # shellcheck disable=SC2086
+        "${MMSEQS}" mvdb "${TMP_PATH}/aln_exp_${STEP}" "${TMP_PATH}/aln_${STEP}" ${VERBOSITY_PAR} \
+            || fail "mvdb died"
         touch "${TMP_PATH}/aln_exp_${STEP}.hasexpand"
     fi
 
@@ -91,9 +91,9 @@ while [ "${STEP}" -lt "${NUM_IT}" ]; do
             # shellcheck disable=SC2086
             "${MMSEQS}" mergedbs "${INPUT}" "${TMP_PATH}/aln_new" "${TMP_PATH}/aln_0" "${TMP_PATH}/aln_${STEP}" ${VERBOSITY_PAR} \
                 || fail "mergedbs died"
-            mv -f "${TMP_PATH}/aln_new" "${TMP_PATH}/aln_0"
-            mv -f "${TMP_PATH}/aln_new.index" "${TMP_PATH}/aln_0.index"
-            mv -f "${TMP_PATH}/aln_new.dbtype" "${TMP_PATH}/aln_0.dbtype"
+            # shellcheck disable=SC2086
+            "${MMSEQS}" mvdb "${TMP_PATH}/aln_new" "${TMP_PATH}/aln_0" ${VERBOSITY_PAR} \
+                || fail "mvdb died"
             touch "${TMP_PATH}/aln_${STEP}.hasmerge"
         fi
     fi
@@ -113,27 +113,38 @@ while [ "${STEP}" -lt "${NUM_IT}" ]; do
 	STEP="$((STEP+1))"
 done
 
-mv -f "${TMP_PATH}/aln_0" "${RESULT}"
-mv -f "${TMP_PATH}/aln_0.index" "${RESULT}.index"
-mv -f "${TMP_PATH}/aln_0.dbtype" "${RESULT}.dbtype"
+# shellcheck disable=SC2086
+"${MMSEQS}" mvdb "${TMP_PATH}/aln_0" "${RESULT}" ${VERBOSITY_PAR} \
+    || fail "mvdb died"
 
 if [ -n "$REMOVE_TMP" ]; then
     STEP=0
     while [ "${STEP}" -lt "${NUM_IT}" ]; do
-        rm -f "${TMP_PATH}/pref_${STEP}" "${TMP_PATH}/pref_${STEP}.index" "${TMP_PATH}/pref_${STEP}.dbtype"
-        rm -f "${TMP_PATH}/aln_${STEP}" "${TMP_PATH}/aln_${STEP}.index" "${TMP_PATH}/aln_${STEP}.dbtype"
-        rm -f "${TMP_PATH}/profile_${STEP}" "${TMP_PATH}/profile_${STEP}.index" "${TMP_PATH}/profile_${STEP}.dbtype"
-        rm -f "${TMP_PATH}/profile_${STEP}_h" "${TMP_PATH}/profile_${STEP}_h.index" "${TMP_PATH}/profile_${STEP}_h.dbtype"
-        rm -f "${TMP_PATH}/profile_${STEP}_consensus" "${TMP_PATH}/profile_${STEP}_consensus.index" "${TMP_PATH}/profile_${STEP}_consensus.dbtype"
-        rm -f "${TMP_PATH}/profile_${STEP}_consensus_h" "${TMP_PATH}/profile_${STEP}_consensus_h.index" "${TMP_PATH}/profile_${STEP}_consensus_h.dbtype"
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/pref_${STEP}" ${VERBOSITY_PAR}
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/aln_${STEP}" ${VERBOSITY_PAR}
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/profile_${STEP}" ${VERBOSITY_PAR}
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/profile_${STEP}_h" ${VERBOSITY_PAR}
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/profile_${STEP}_consensus" ${VERBOSITY_PAR}
+        # shellcheck disable=SC2086
+        "${MMSEQS}" rmdb "${TMP_PATH}/profile_${STEP}_consensus_h" ${VERBOSITY_PAR}
         rm -f "${TMP_PATH}/aln_${STEP}.hasmerge" "${TMP_PATH}/aln_exp_${STEP}.hasexpand" "${TMP_PATH}/pref_${STEP}.hasnext"
         STEP="$((STEP+1))"
     done
-    rm -f "${TMP_PATH}/prof_slice" "${TMP_PATH}/prof_slice.index" "${TMP_PATH}/prof_slice.dbtype"
-    rm -f "${TMP_PATH}/prof_slice_h" "${TMP_PATH}/prof_slice_h.index"
-    rm -f "${TMP_PATH}/prof_slice_consensus" "${TMP_PATH}/prof_slice_consensus.index" "${TMP_PATH}/prof_slice_consensus.dbtype"
-    rm -f "${TMP_PATH}/prof_slice_consensus_h" "${TMP_PATH}/prof_slice_consensus_h.index" "${TMP_PATH}/prof_slice_consensus_h.dbtype"
-    rm -f "${TMP_PATH}/search_slice" "${TMP_PATH}/search_slice.index" "${TMP_PATH}/search_slice.dbtype"
+    # shellcheck disable=SC2086
+    "${MMSEQS}" rmdb "${TMP_PATH}/prof_slice" ${VERBOSITY_PAR}
+    # shellcheck disable=SC2086
+    "${MMSEQS}" rmdb "${TMP_PATH}/prof_slice_h" ${VERBOSITY_PAR}
+    # shellcheck disable=SC2086
+    "${MMSEQS}" rmdb "${TMP_PATH}/prof_slice_consensus" ${VERBOSITY_PAR}
+    # shellcheck disable=SC2086
+    "${MMSEQS}" rmdb "${TMP_PATH}/prof_slice_consensus_h" ${VERBOSITY_PAR}
+    # shellcheck disable=SC2086
+    "${MMSEQS}" rmdb "${TMP_PATH}/search_slice" ${VERBOSITY_PAR}
     rm -f "${TMP_PATH}/enrich.sh"
 fi
 
@@ -47,6 +47,9 @@ if notExists "${PROFILEDB}.dbtype"; then
     # symlink the profile DB that can be reduced at every iteration the search
     ln -s "${TARGET}" "${PROFILEDB}"
     ln -s "${TARGET}.dbtype" "${PROFILEDB}.dbtype"
+    if [ -f "${TARGET}.zdict" ]; then
+        ln -s "${TARGET}.zdict" "${PROFILEDB}.zdict"
+    fi
     cp -f "${TARGET}.index" "${PROFILEDB}.index"
 
     echo "${AVAIL_DISK}" > "${PROFILEDB}.meta"
@@ -29,6 +29,13 @@ abspath() {
     fi
 }
 
+# compressed databases need the dictionary next to their linked data
+linkDictionary() {
+    if [ -f "$1.zdict" ]; then
+        ln -sf "$1.zdict" "$2.zdict"
+    fi
+}
+
 joinAndReplace() {
     INPUT="$1"
     OUTPUT="$2"
@@ -102,8 +109,10 @@ if [ -n "${RECOVER_DELETED}" ] && [ -s "${TMP_PATH}/removedSeqs" ]; then
 
     if notExists "${TMP_PATH}/NEWDB.withOld.dbtype"; then
         (
-            ln -sf "${OLDDB}" "${TMP}/OLDDB.removedDb"
-            ln -sf "${OLDDB}_h" "${TMP}/OLDDB.removedDb_h"
+            ln -sf "${OLDDB}" "${TMP_PATH}/OLDDB.removedDb"
+            ln -sf "${OLDDB}_h" "${TMP_PATH}/OLDDB.removedDb_h"
+            linkDictionary "${OLDDB}" "${TMP_PATH}/OLDDB.removedDb"
+            linkDictionary "${OLDDB}_h" "${TMP_PATH}/OLDDB.removedDb_h"
             joinAndReplace "${OLDDB}.index" "${TMP_PATH}/OLDDB.removedDb.index" "${TMP_PATH}/OLDDB.removedMapping" "1.2 2.2 2.3"
             joinAndReplace "${OLDDB}_h.index" "${TMP_PATH}/OLDDB.removedDb_h.index" "${TMP_PATH}/OLDDB.removedMapping" "1.2 2.2 2.3"
             joinAndReplace "${OLDDB}.lookup" "${TMP_PATH}/OLDDB.removedDb.lookup" "${TMP_PATH}/OLDDB.removedMapping" "1.2 2.2"
@@ -159,6 +168,8 @@ fi
 ln -sf "${NEWDB}" "${NEWMAPDB}"
 ln -sf "${NEWDB}_h" "${NEWMAPDB}_h"
 ln -sf "${NEWDB}.dbtype" "${NEWMAPDB}.dbtype"
+linkDictionary "${NEWDB}" "${NEWMAPDB}"
+linkDictionary "${NEWDB}_h" "${NEWMAPDB}_h"
 NEWDB="${NEWMAPDB}"
 
 if [ -n "$REMOVE_TMP" ]; then
@@ -225,6 +236,7 @@ else
     if notExists "${TMP_PATH}/updatedClust"; then
         ln -sf "$OLDCLUST" "${TMP_PATH}/updatedClust" \
             || fail "Mv Oldclust to update died"
+        linkDictionary "$OLDCLUST" "${TMP_PATH}/updatedClust"
     fi
     if notExists "${TMP_PATH}/updatedClust.index"; then
         ln -sf "$OLDCLUST.index" "${TMP_PATH}/updatedClust.index" \
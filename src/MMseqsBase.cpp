@@ -367,6 +367,24 @@ std::vector<Command> baseCommands = {
                 "<i:sequenceDB> <tmpDir>",
                 CITATION_MMSEQS2, {{"sequenceDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                                            {"tmpDir", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::directory }}},
+        {"createbintaxmapping",  createbintaxmapping,  &par.onlyverbosity,        COMMAND_TAXONOMY | COMMAND_EXPERT,
+                "Create a memory mappable taxonomy mapping",
+                "# Used by createtaxdb, the taxonomy modules read sequenceDB_mapping.bin instead of parsing sequenceDB_mapping\n"
+                "mmseqs createbintaxmapping sequenceDB_mapping sequenceDB_mapping.bin\n",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:mappingFile> <o:mappingFile>",
+                CITATION_MMSEQS2, {{"mappingFile", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::flatfile },
+                                          {"mappingFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile }}},
+        {"createbintaxonomy",    createbintaxonomy,    &par.onlyverbosity,        COMMAND_TAXONOMY | COMMAND_EXPERT,
+                "Create a memory mappable taxonomy with a precomputed LCA structure",
+                "# Used by createtaxdb, the DB opens the taxonomy from sequenceDB_taxonomy instead of parsing the .dmp files\n"
+                "mmseqs createbintaxonomy names.dmp nodes.dmp merged.dmp sequenceDB_taxonomy\n",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:names.dmp> <i:nodes.dmp> <i:merged.dmp> <o:taxonomyFile>",
+                CITATION_MMSEQS2, {{"names.dmp", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::flatfile },
+                                          {"nodes.dmp", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::flatfile },
+                                          {"merged.dmp", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::flatfile },
+                                          {"taxonomyFile", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::flatfile }}},
         {"addtaxonomy",          addtaxonomy,          &par.addtaxonomy,          COMMAND_TAXONOMY | COMMAND_EXPERT,
                 "Add taxonomic labels to result DB",
                 NULL,
@@ -543,6 +561,14 @@ std::vector<Command> baseCommands = {
                                                            {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
                                                            {"resultDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::resultDb },
                                                            {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
+        {"prefilteralign",       prefilteralign,       &par.prefilteralign,       COMMAND_ALIGNMENT,
+                "Prefilter and gapped local alignment without writing the prefilter result",
+                NULL,
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:queryDB> <i:targetDB> <o:alignmentDB>",
+                CITATION_MMSEQS2, {{"queryDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"targetDB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::sequenceDb },
+                                                           {"alignmentDB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::alignmentDb }}},
         {"alignall",             alignall,             &par.alignall,             COMMAND_ALIGNMENT,
                 "Within-result all-vs-all gapped local alignment",
                 NULL,
@@ -634,6 +660,17 @@ std::vector<Command> baseCommands = {
                 "<i:srcDB> <o:dstDB>",
                 CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, NULL },
                                           {"DB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
+        {"convertindex",         convertindex,         &par.convertindex,         COMMAND_STORAGE,
+                "Convert a DB index between the text and the binary format",
+                "# Memory map the index of a large sequence DB instead of parsing it\n"
+                "mmseqs convertindex sequenceDB sequenceDB --binary-index 1\n"
+                "mmseqs convertindex sequenceDB_h sequenceDB_h --binary-index 1\n\n"
+                "# Restore the text index for tools that read the .index file directly\n"
+                "mmseqs convertindex sequenceDB sequenceDB --binary-index 0\n",
+                "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
+                "<i:DB> <o:DB>",
+                CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
+                                          {"DB", DbType::ACCESS_MODE_OUTPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
         {"touchdb",              touchdb,              &par.onlythreads,          COMMAND_STORAGE,
                 "Preload DB into memory (page cache)",
                 NULL,
@@ -701,7 +738,7 @@ std::vector<Command> baseCommands = {
                 "Martin Steinegger <martin.steinegger@mpibpc.mpg.de>",
                 "<i:DB>",
                 CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb }}},
-        {"apply",                apply,                &par.threadsandcompression,
+        {"apply",                apply,                &par.apply,
 #ifdef __CYGWIN__
                 COMMAND_HIDDEN,
 #else
@@ -713,7 +750,9 @@ std::vector<Command> baseCommands = {
                 "# Build MSAs with Clustal-Omega\n"
                 "mmseqs apply unalignedDB msaDB -- clustalo -i - -o stdout --threads=1\n\n"
                 "# Count lines in each DB entry inefficiently (result2stats is way faster)\n"
-                "mmseqs apply DB wcDB -- awk '{ counter++; } END { print counter; }'\n",
+                "mmseqs apply DB wcDB -- awk '{ counter++; } END { print counter; }'\n\n"
+                "# Start awk only once per thread, entries and results are terminated by \\0\n"
+                "mmseqs apply DB wcDB --apply-mode 1 -- awk 'BEGIN { RS = ORS = \"\\0\" } { print gsub(/\\n/, \"\"); fflush(); }'\n",
                 "Milot Mirdita <milot@mirdita.de>",
                 "<i:DB> <o:DB> -- program [args...]",
                 CITATION_MMSEQS2, {{"DB", DbType::ACCESS_MODE_INPUT, DbType::NEED_DATA, &DbValidator::allDb },
@@ -29,7 +29,7 @@ Alignment::Alignment(const std::string &querySeqDB,
         alnLenThr(par.alnLenThr), includeIdentity(par.includeIdentity), addBacktrace(par.addBacktrace), realign(par.realign), scoreBias(par.scoreBias),
         threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed), outDB(outDB), outDBIndex(outDBIndex),
         maxSeqLen(par.maxSeqLen), compBiasCorrection(par.compBiasCorrection), altAlignment(par.altAlignment), qdbr(NULL), qDbrIdx(NULL),
-        tdbr(NULL), tDbrIdx(NULL) {
+        tdbr(NULL), tDbrIdx(NULL), targetStore(NULL) {
 
 
     unsigned int alignmentMode = par.alignmentMode;
@@ -124,9 +124,21 @@ Alignment::Alignment(const std::string &querySeqDB,
     Debug(Debug::INFO) << "Query database size: "  << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
     Debug(Debug::INFO) << "Target database size: " << tdbr->getSize() << " type: " << Parameters::getDbTypeName(targetSeqType) << "\n";
 
-    prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
-    prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
-    reversePrefilterResult = (Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES));
+    // without a prefilter database the hits are streamed to run(queue, ...)
+    prefdbr = NULL;
+    reversePrefilterResult = false;
+    binaryPrefilterResult = false;
+    if (prefDB.empty() == false) {
+        prefdbr = new DBReader<unsigned int>(prefDB.c_str(), prefDBIndex.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_BINARY);
+        prefdbr->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+        reversePrefilterResult = (Parameters::isEqualDbtype(prefdbr->getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES));
+        binaryPrefilterResult = prefdbr->isBinary();
+    }
+
+    // the encoded targets share the memory with the sequence and prefilter data
+    size_t usedMemory = tdbr->getTotalDataSize() + (sameQTDB ? 0 : qdbr->getTotalDataSize())
+                        + ((prefdbr != NULL) ? prefdbr->getTotalDataSize() : 0);
+    targetStore = new TargetSequenceStore(tdbr, targetSeqType, par.targetSeqCache ? TargetSequenceStore::getMemoryBudget(usedMemory) : 0);
 
     if (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) {
         m = new NucleotideMatrix(par.scoringMatrixFile.nucleotides, 1.0, scoreBias);
@@ -198,6 +210,7 @@ unsigned int Alignment::initSWMode(unsigned int alignmentMode, float covThr, flo
 }
 
 Alignment::~Alignment() {
+    delete targetStore;
     if (realign == true) {
         delete realign_m;
     }
@@ -219,8 +232,10 @@ Alignment::~Alignment() {
         }
     }
 
-    prefdbr->close();
-    delete prefdbr;
+    if (prefdbr != NULL) {
+        prefdbr->close();
+        delete prefdbr;
+    }
 }
 
 void Alignment::run(const unsigned int mpiRank, const unsigned int mpiNumProc,
@@ -278,209 +293,297 @@ void Alignment::run(const std::string &outDB, const std::string &outDBIndex,
     for (size_t i = 0; i < iterations; i++) {
         size_t start = dbFrom + (i * flushSize);
         size_t bucketSize = std::min(dbSize - (i * flushSize), flushSize);
-        Debug::Progress progress(bucketSize);
+        alignQueries(dbw, evaluer, NULL, start, bucketSize, maxAlnNum, maxRejected, wrappedScoring, alignmentsNum, totalPassedNum);
+        prefdbr->remapData();
+    }
 
-#pragma omp parallel num_threads(threads)
-        {
-            unsigned int thread_idx = 0;
-#ifdef OPENMP
-            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
-#endif
-            std::string alnResultsOutString;
-            alnResultsOutString.reserve(1024*1024);
-            char buffer[1024+32768];
-            Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
-            Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
-            Matcher matcher(querySeqType,
-                                (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ? maxSeqLen : std::max(tdbr->getMaxSeqLen(), qdbr->getMaxSeqLen()),
-                                 m, &evaluer, compBiasCorrection, gapOpen, gapExtend, zdrop);
-            Matcher *realigner = NULL;
-            if (realign ==  true && wrappedScoring == false) {
-                realigner = new Matcher(querySeqType,
-                                       (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ? maxSeqLen : std::max(tdbr->getMaxSeqLen(), qdbr->getMaxSeqLen()),
-                                       realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend, zdrop);
-            }
+    dbw.close(merge);
 
-            std::vector<Matcher::result_t> swResults;
-            swResults.reserve(300);
-            std::vector<Matcher::result_t> swRealignResults;
-            swRealignResults.reserve(300);
-            std::vector<hit_t> shortResults;
-            shortResults.reserve(300);
+    printStatistics(alignmentsNum, totalPassedNum, dbSize);
+}
 
-#pragma omp for schedule(dynamic, 5) reduction(+: alignmentsNum, totalPassedNum)
-            for (size_t id = start; id < (start + bucketSize); id++) {
-                progress.updateProgress();
+void Alignment::run(BoundedQueue<PrefilterQueryResult> &queue, const unsigned int maxAlnNum, const unsigned int maxRejected, bool wrappedScoring) {
+    size_t alignmentsNum = 0;
+    size_t totalPassedNum = 0;
+    DBWriter dbw(outDB.c_str(), outDBIndex.c_str(), threads, compressed, Parameters::DBTYPE_ALIGNMENT_RES);
+    dbw.open();
 
-                // get the prefiltering list
-                char *data = prefdbr->getData(id, thread_idx);
-                unsigned int queryDbKey = prefdbr->getDbKey(id);
-                size_t queryLen = -1, origQueryLen = -1;
-                std::string queryToWrap;
-                // only load query data if data != \0
-                if(*data != '\0'){
-                    size_t qId = qdbr->getId(queryDbKey);
-                    char *querySeqData = qdbr->getData(qId, thread_idx);
-                    if (querySeqData == NULL) {
-                        Debug(Debug::ERROR) << "Query sequence " << queryDbKey
-                                            << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    queryLen = qdbr->getSeqLen(qId);
-                    origQueryLen = queryLen;
-                    if (wrappedScoring) {
-                        queryToWrap = std::string(querySeqData,queryLen);
-                        queryToWrap = queryToWrap + queryToWrap;
-                        querySeqData = (char*)(queryToWrap).c_str();
-                        queryLen = origQueryLen*2;
-                    }
+    EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), this->m, gapOpen, gapExtend);
+    size_t queryCount = alignQueries(dbw, evaluer, &queue, 0, 0, maxAlnNum, maxRejected, wrappedScoring, alignmentsNum, totalPassedNum);
 
-                    qSeq.mapSequence(qId, queryDbKey, querySeqData, queryLen);
-                    matcher.initQuery(&qSeq);
-                }
+    dbw.close();
 
-                // parse the prefiltering list and calculate a Smith-Waterman alignment for each sequence in the list
-                size_t passedNum = 0;
-                unsigned int rejected = 0;
-                while (*data != '\0' && passedNum < maxAlnNum && rejected < maxRejected) {
-                    // DB key of the db sequence
-                    char dbKeyBuffer[255 + 1];
-                    const char* words[10];
-                    Util::parseKey(data, dbKeyBuffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
-
-                    size_t elements = Util::getWordsOfLine(data, words, 10);
-                    short diagonal = 0;
-                    bool isReverse = false;
-                    // Prefilter result (need to make this better)
-                    if(elements == 3){
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        isReverse = reversePrefilterResult && (hit.prefScore < 0);
-                        diagonal = static_cast<short>(hit.diagonal);
-                    }
-                    size_t dbId = tdbr->getId(dbKey);
-                    char *dbSeqData = tdbr->getData(dbId, thread_idx);
+    if (queryCount > 0) {
+        printStatistics(alignmentsNum, totalPassedNum, queryCount);
+    }
+}
 
-                    if (dbSeqData == NULL) {
-                        Debug(Debug::ERROR) << "Sequence " << dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                        EXIT(EXIT_FAILURE);
-                    }
-                    dbSeq.mapSequence(dbId, dbKey, dbSeqData, tdbr->getSeqLen(dbId));
-                    // check if the sequences could pass the coverage threshold
-                    if(Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
-                        rejected++;
-                        data = Util::skipLine(data);
-                        continue;
-                    }
-                    const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
+void Alignment::printStatistics(size_t alignmentsNum, size_t totalPassedNum, size_t querySize) {
+    Debug(Debug::INFO) << "\n" << alignmentsNum << " alignments calculated.\n";
+    Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds ("
+                       << ((float) totalPassedNum / (float) alignmentsNum) << " of overall calculated).\n";
 
-                    // calculate Smith-Waterman alignment
-                    Matcher::result_t res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
-                    alignmentsNum++;
+    size_t hits = totalPassedNum / querySize;
+    size_t hits_rest = totalPassedNum % querySize;
+    float hits_f = ((float) hits) + ((float) hits_rest) / (float) querySize;
+    Debug(Debug::INFO) << hits_f << " hits per query sequence.\n";
+}
 
-                    //set coverage and seqid if identity
-                    if (isIdentity) {
-                        res.qcov = 1.0f;
-                        res.dbcov = 1.0f;
-                        res.seqId = 1.0f;
-                    }
-                    if(checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr)){
-
-                        swResults.emplace_back(res);
-                        passedNum++;
-                        totalPassedNum++;
-                        rejected = 0;
-                    }else{
-                        rejected++;
-                    }
+void Alignment::readPrefilterList(size_t id, unsigned int thread_idx, std::vector<hit_t> &hits) {
+    if (binaryPrefilterResult) {
+        QueryMatcher::readPrefilterHits(*prefdbr, id, thread_idx, hits);
+        return;
+    }
+
+    char *data = prefdbr->getData(id, thread_idx);
+    while (*data != '\0') {
+        // DB key of the db sequence
+        char dbKeyBuffer[255 + 1];
+        const char* words[10];
+        Util::parseKey(data, dbKeyBuffer);
+        hit_t hit;
+        hit.seqId = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+        hit.prefScore = 0;
+        hit.diagonal = 0;
+
+        size_t elements = Util::getWordsOfLine(data, words, 10);
+        // Prefilter result (need to make this better)
+        if(elements == 3){
+            hit = QueryMatcher::parsePrefilterHit(data);
+        }
+        hits.push_back(hit);
+        data = Util::skipLine(data);
+    }
+}
 
-                    data = Util::skipLine(data);
+size_t Alignment::alignQueries(DBWriter &dbw, EvalueComputation &evaluer, BoundedQueue<PrefilterQueryResult> *queue,
+                               const size_t start, const size_t size,
+                               const unsigned int maxAlnNum, const unsigned int maxRejected, bool wrappedScoring,
+                               size_t &alignmentsNum, size_t &totalPassedNum) {
+    // queries are either taken from the queue or from the prefilter database entries [start, start + size)
+    size_t nextId = start;
+    size_t queryCount = 0;
+    size_t localAlignmentsNum = 0;
+    size_t localPassedNum = 0;
+    Debug::Progress progress(size);
+
+#pragma omp parallel num_threads(threads) reduction(+: localAlignmentsNum, localPassedNum, queryCount)
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+        std::string alnResultsOutString;
+        alnResultsOutString.reserve(1024*1024);
+        char buffer[1024+32768];
+        Sequence qSeq(maxSeqLen, querySeqType, m, 0, false, compBiasCorrection);
+        Sequence dbSeq(maxSeqLen, targetSeqType, m, 0, false, compBiasCorrection);
+        Matcher matcher(querySeqType,
+                            (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ? maxSeqLen : std::max(tdbr->getMaxSeqLen(), qdbr->getMaxSeqLen()),
+                             m, &evaluer, compBiasCorrection, gapOpen, gapExtend, zdrop);
+        Matcher *realigner = NULL;
+        if (realign ==  true && wrappedScoring == false) {
+            realigner = new Matcher(querySeqType,
+                                   (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_NUCLEOTIDES)) ? maxSeqLen : std::max(tdbr->getMaxSeqLen(), qdbr->getMaxSeqLen()),
+                                   realign_m, &evaluer, compBiasCorrection, gapOpen, gapExtend, zdrop);
+        }
+
+        std::vector<Matcher::result_t> swResults;
+        swResults.reserve(300);
+        std::vector<Matcher::result_t> swRealignResults;
+        swRealignResults.reserve(300);
+        std::vector<hit_t> shortResults;
+        shortResults.reserve(300);
+        std::vector<hit_t> hits;
+        hits.reserve(300);
+        PrefilterQueryResult queueResult;
+
+        while (true) {
+            // get the prefiltering list
+            unsigned int queryDbKey;
+            if (queue != NULL) {
+                if (queue->pop(queueResult) == false) {
+                    break;
                 }
-                if(altAlignment > 0 && realign == false && wrappedScoring == false){
-                    computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, evalThr, swMode, thread_idx);
+                queryDbKey = queueResult.queryKey;
+                hits.swap(queueResult.hits);
+            } else {
+                size_t id = __sync_fetch_and_add(&nextId, 1);
+                if (id >= start + size) {
+                    break;
                 }
-
-                if(wrappedScoring && shortResults.size() > 1)
-                    std::sort(shortResults.begin(), shortResults.end(), hit_t::compareHitsByScoreAndId);
-
-                // write the results
-                if(swResults.size() > 1)
-                    std::sort(swResults.begin(), swResults.end(), Matcher::compareHits);
-                if (realign == true) {
-                    realigner->initQuery(&qSeq);
-                    for (size_t result = 0; result < swResults.size(); result++) {
-                        size_t dbId = tdbr->getId(swResults[result].dbKey);
-                        char *dbSeqData = tdbr->getData(dbId, thread_idx);
-                        if (dbSeqData == NULL) {
-                            Debug(Debug::ERROR) << "Sequence " << swResults[result].dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
-                            EXIT(EXIT_FAILURE);
-                        }
-                        dbSeq.mapSequence(static_cast<size_t>(-1), swResults[result].dbKey, dbSeqData,
-                                          tdbr->getSeqLen(dbId));
-                        const bool isIdentity = (queryDbKey == swResults[result].dbKey && (includeIdentity || sameQTDB)) ? true : false;
-                        Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, covMode, covThr, FLT_MAX,
-                                                                       Matcher::SCORE_COV_SEQID, seqIdMode, isIdentity);
-                        const bool covOK = Util::hasCoverage(realignCov, covMode, res.qcov, res.dbcov);
-                        if(covOK == true|| isIdentity){
-                            swResults[result].backtrace  = res.backtrace;
-                            swResults[result].qStartPos  = res.qStartPos;
-                            swResults[result].qEndPos    = res.qEndPos;
-                            swResults[result].dbStartPos = res.dbStartPos;
-                            swResults[result].dbEndPos   = res.dbEndPos;
-                            swResults[result].alnLength  = res.alnLength;
-                            swResults[result].seqId      = res.seqId;
-                            swResults[result].qcov       = res.qcov;
-                            swResults[result].dbcov      = res.dbcov;
-                            swRealignResults.push_back(swResults[result]);
-                        }
-                    }
-                    swResults = swRealignResults;
-                    if(altAlignment > 0){
-                        computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, FLT_MAX, Matcher::SCORE_COV_SEQID, thread_idx);
-                    }
+                progress.updateProgress();
+                queryDbKey = prefdbr->getDbKey(id);
+                readPrefilterList(id, thread_idx, hits);
+            }
+            queryCount++;
+
+            size_t queryLen = -1, origQueryLen = -1;
+            std::string queryToWrap;
+            // only load query data if there are hits
+            if(hits.empty() == false){
+                size_t qId = qdbr->getId(queryDbKey);
+                char *querySeqData = qdbr->getData(qId, thread_idx);
+                if (querySeqData == NULL) {
+                    Debug(Debug::ERROR) << "Query sequence " << queryDbKey
+                                        << " is required in the prefiltering, but is not contained in the query sequence database.\nPlease check your database.\n";
+                    EXIT(EXIT_FAILURE);
                 }
-
-                // put the contents of the swResults list into a result DB
-                for (size_t result = 0; result < swResults.size(); result++) {
-                    size_t len = Matcher::resultToBuffer(buffer, swResults[result], addBacktrace);
-                    alnResultsOutString.append(buffer, len);
+                queryLen = qdbr->getSeqLen(qId);
+                origQueryLen = queryLen;
+                if (wrappedScoring) {
+                    queryToWrap = std::string(querySeqData,queryLen);
+                    queryToWrap = queryToWrap + queryToWrap;
+                    querySeqData = (char*)(queryToWrap).c_str();
+                    queryLen = origQueryLen*2;
                 }
 
-                for (size_t result = 0; result < shortResults.size(); result++) {
-                    size_t len = snprintf(buffer, 100, "%u\t%d\t%d\n", shortResults[result].seqId, shortResults[result].prefScore,
-                                          shortResults[result].diagonal);
-                    alnResultsOutString.append(buffer, len);
+                qSeq.mapSequence(qId, queryDbKey, querySeqData, queryLen);
+                matcher.initQuery(&qSeq);
+            }
+
+            // short queries and long candidate lists are scored with the inter-sequence kernel first
+            const bool alignBatch = hits.empty() == false && wrappedScoring == false && matcher.canAlignBatch()
+                                    && (queryLen <= static_cast<size_t>(Matcher::BATCH_MAX_QUERY_LENGTH) || hits.size() >= Matcher::BATCH_MIN_CANDIDATES);
+            size_t batchStart = 0;
+            size_t batchEnd = 0;
+
+            // calculate a Smith-Waterman alignment for each sequence in the prefiltering list
+            size_t passedNum = 0;
+            unsigned int rejected = 0;
+            for (size_t hitIdx = 0; hitIdx < hits.size() && passedNum < maxAlnNum && rejected < maxRejected; hitIdx++) {
+                const unsigned int dbKey = hits[hitIdx].seqId;
+                const bool isReverse = reversePrefilterResult && (hits[hitIdx].prefScore < 0);
+                const short diagonal = static_cast<short>(hits[hitIdx].diagonal);
+                if (alignBatch && hitIdx >= batchEnd) {
+                    batchStart = hitIdx;
+                    batchEnd = std::min(hits.size(), hitIdx + Matcher::BATCH_TARGETS);
+                    queueBatchTargets(hits, batchStart, batchEnd, queryDbKey, origQueryLen, dbSeq, matcher, thread_idx);
                 }
+                size_t dbId = targetStore->getId(dbKey);
+                if (targetStore->mapSequence(dbId, dbKey, dbSeq, thread_idx) == false) {
+                    Debug(Debug::ERROR) << "Sequence " << dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                // check if the sequences could pass the coverage threshold
+                if(Util::canBeCovered(canCovThr, covMode, static_cast<float>(origQueryLen), static_cast<float>(dbSeq.L)) == false) {
+                    rejected++;
+                    continue;
+                }
+                const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB)) ? true : false;
+
+                // calculate Smith-Waterman alignment
+                Matcher::result_t res;
+                if (alignBatch && isIdentity == false) {
+                    res = matcher.getBatchSWResult(hitIdx - batchStart, &dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode);
+                } else {
+                    res = matcher.getSWResult(&dbSeq, static_cast<int>(diagonal), isReverse, covMode, covThr, evalThr, swMode, seqIdMode, isIdentity, wrappedScoring);
+                }
+                localAlignmentsNum++;
 
-                dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), queryDbKey, thread_idx);
-                alnResultsOutString.clear();
-                swResults.clear();
-                swRealignResults.clear();
-                shortResults.clear();
+                //set coverage and seqid if identity
+                if (isIdentity) {
+                    res.qcov = 1.0f;
+                    res.dbcov = 1.0f;
+                    res.seqId = 1.0f;
+                }
+                if(checkCriteria(res, isIdentity, evalThr, seqIdThr, alnLenThr, covMode, covThr)){
+
+                    swResults.emplace_back(std::move(res));
+                    passedNum++;
+                    localPassedNum++;
+                    rejected = 0;
+                }else{
+                    rejected++;
+                }
             }
+            if(altAlignment > 0 && realign == false && wrappedScoring == false){
+                computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, evalThr, swMode, thread_idx);
+            }
+
+            if(wrappedScoring && shortResults.size() > 1)
+                std::sort(shortResults.begin(), shortResults.end(), hit_t::compareHitsByScoreAndId);
+
+            // write the results
+            if(swResults.size() > 1)
+                std::sort(swResults.begin(), swResults.end(), Matcher::compareHits);
             if (realign == true) {
-                delete realigner;
+                realigner->initQuery(&qSeq);
+                for (size_t result = 0; result < swResults.size(); result++) {
+                    size_t dbId = targetStore->getId(swResults[result].dbKey);
+                    if (targetStore->mapSequence(dbId, swResults[result].dbKey, dbSeq, thread_idx) == false) {
+                        Debug(Debug::ERROR) << "Sequence " << swResults[result].dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
+                        EXIT(EXIT_FAILURE);
+                    }
+                    const bool isIdentity = (queryDbKey == swResults[result].dbKey && (includeIdentity || sameQTDB)) ? true : false;
+                    Matcher::result_t res = realigner->getSWResult(&dbSeq, INT_MAX, false, covMode, covThr, FLT_MAX,
+                                                                   Matcher::SCORE_COV_SEQID, seqIdMode, isIdentity);
+                    const bool covOK = Util::hasCoverage(realignCov, covMode, res.qcov, res.dbcov);
+                    if(covOK == true|| isIdentity){
+                        swResults[result].backtrace.swap(res.backtrace);
+                        swResults[result].qStartPos  = res.qStartPos;
+                        swResults[result].qEndPos    = res.qEndPos;
+                        swResults[result].dbStartPos = res.dbStartPos;
+                        swResults[result].dbEndPos   = res.dbEndPos;
+                        swResults[result].alnLength  = res.alnLength;
+                        swResults[result].seqId      = res.seqId;
+                        swResults[result].qcov       = res.qcov;
+                        swResults[result].dbcov      = res.dbcov;
+                        swRealignResults.emplace_back(std::move(swResults[result]));
+                    }
+                }
+                swResults.swap(swRealignResults);
+                if(altAlignment > 0){
+                    computeAlternativeAlignment(queryDbKey, dbSeq, swResults, matcher, FLT_MAX, Matcher::SCORE_COV_SEQID, thread_idx);
+                }
             }
-#pragma omp barrier
-            if (thread_idx == 0) {
-                prefdbr->remapData();
+
+            // put the contents of the swResults list into a result DB
+            for (size_t result = 0; result < swResults.size(); result++) {
+                size_t len = Matcher::resultToBuffer(buffer, swResults[result], addBacktrace);
+                alnResultsOutString.append(buffer, len);
             }
-#pragma omp barrier
-        }
 
+            for (size_t result = 0; result < shortResults.size(); result++) {
+                size_t len = snprintf(buffer, 100, "%u\t%d\t%d\n", shortResults[result].seqId, shortResults[result].prefScore,
+                                      shortResults[result].diagonal);
+                alnResultsOutString.append(buffer, len);
+            }
 
+            dbw.writeData(alnResultsOutString.c_str(), alnResultsOutString.length(), queryDbKey, thread_idx);
+            alnResultsOutString.clear();
+            swResults.clear();
+            swRealignResults.clear();
+            shortResults.clear();
+            hits.clear();
+        }
+        if (realign == true) {
+            delete realigner;
+        }
     }
 
-    dbw.close(merge);
-
-    Debug(Debug::INFO) << "\n" << alignmentsNum << " alignments calculated.\n";
-    Debug(Debug::INFO) << totalPassedNum << " sequence pairs passed the thresholds ("
-                       << ((float) totalPassedNum / (float) alignmentsNum) << " of overall calculated).\n";
+    alignmentsNum += localAlignmentsNum;
+    totalPassedNum += localPassedNum;
+    return queryCount;
+}
 
-    size_t hits = totalPassedNum / dbSize;
-    size_t hits_rest = totalPassedNum % dbSize;
-    float hits_f = ((float) hits) + ((float) hits_rest) / (float) dbSize;
-    Debug(Debug::INFO) << hits_f << " hits per query sequence.\n";
+void Alignment::queueBatchTargets(const std::vector<hit_t> &hits, size_t start, size_t end, unsigned int queryDbKey,
+                                  size_t queryLen, Sequence &dbSeq, Matcher &matcher, unsigned int thread_idx) {
+    matcher.clearBatch();
+    for (size_t hitIdx = start; hitIdx < end; hitIdx++) {
+        const unsigned int dbKey = hits[hitIdx].seqId;
+        const size_t dbId = targetStore->getId(dbKey);
+        const bool isIdentity = (queryDbKey == dbKey && (includeIdentity || sameQTDB));
+        // targets that are not aligned in the hit loop get an empty placeholder
+        if (dbId == UINT_MAX || isIdentity
+            || Util::canBeCovered(canCovThr, covMode, static_cast<float>(queryLen), static_cast<float>(targetStore->getSeqLen(dbId))) == false
+            || targetStore->mapSequence(dbId, dbKey, dbSeq, thread_idx) == false) {
+            matcher.addBatchTarget(NULL);
+            continue;
+        }
+        matcher.addBatchTarget(&dbSeq);
+    }
+    matcher.alignBatch();
 }
 
 size_t Alignment::estimateHDDMemoryConsumption(int dbSize, int maxSeqs) {
@@ -521,14 +624,12 @@ void Alignment::computeAlternativeAlignment(unsigned int queryDbKey, Sequence &d
         if (isIdentity == true) {
             continue;
         }
-        size_t dbId = tdbr->getId(swResults[i].dbKey);
-        char *dbSeqData = tdbr->getData(dbId, thread_idx);
-        if (dbSeqData == NULL) {
+        size_t dbId = targetStore->getId(swResults[i].dbKey);
+        if (targetStore->mapSequence(dbId, swResults[i].dbKey, dbSeq, thread_idx) == false) {
             Debug(Debug::ERROR) << "Sequence " << swResults[i].dbKey <<" is required in the prefiltering, but is not contained in the target sequence database!\nPlease check your database.\n";
             EXIT(EXIT_FAILURE);
         }
 
-        dbSeq.mapSequence(dbId, swResults[i].dbKey, dbSeqData, tdbr->getSeqLen(dbId));
         for (int pos = swResults[i].dbStartPos; pos < swResults[i].dbEndPos; ++pos) {
             dbSeq.numSequence[pos] = xIndex;
         }
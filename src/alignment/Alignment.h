@@ -10,6 +10,11 @@
 #include "Sequence.h"
 #include "SequenceLookup.h"
 #include "Matcher.h"
+#include "QueryMatcher.h"
+#include "BoundedQueue.h"
+#include "TargetSequenceStore.h"
+
+class DBWriter;
 
 class Alignment {
 
@@ -35,6 +40,10 @@ public:
              const size_t dbFrom, const size_t dbSize,
              const unsigned int maxAlnNum, const unsigned int maxRejected, bool merge, bool wrappedScoring=false);
 
+    //Align the hits streamed from the prefilter until the queue is closed
+    void run(BoundedQueue<PrefilterQueryResult> &queue,
+             const unsigned int maxAlnNum, const unsigned int maxRejected, bool wrappedScoring=false);
+
     static bool checkCriteria(Matcher::result_t &res, bool isIdentity, double evalThr, double seqIdThr, int alnLenThr, int covMode, float covThr);
 
     static unsigned int initSWMode(unsigned int alignmentMode, float covThr, float seqIdThr);
@@ -108,13 +117,31 @@ private:
 
     DBReader<unsigned int> *tdbr;
     IndexReader * tDbrIdx;
+    // the same targets are mapped for many queries
+    TargetSequenceStore *targetStore;
 
     DBReader<unsigned int> *prefdbr;
 
     bool reversePrefilterResult;
+    bool binaryPrefilterResult;
 
     static size_t estimateHDDMemoryConsumption(int dbSize, int maxSeqs);
 
+    // aligns the queries from the queue or, if queue is NULL, the prefilter entries [start, start + size)
+    // returns the number of processed queries
+    size_t alignQueries(DBWriter &dbw, EvalueComputation &evaluer, BoundedQueue<PrefilterQueryResult> *queue,
+                        const size_t start, const size_t size,
+                        const unsigned int maxAlnNum, const unsigned int maxRejected, bool wrappedScoring,
+                        size_t &alignmentsNum, size_t &totalPassedNum);
+
+    void readPrefilterList(size_t id, unsigned int thread_idx, std::vector<hit_t> &hits);
+
+    // scores the hits [start, end) with the inter-sequence kernel of the matcher, dbSeq is overwritten
+    void queueBatchTargets(const std::vector<hit_t> &hits, size_t start, size_t end, unsigned int queryDbKey,
+                           size_t queryLen, Sequence &dbSeq, Matcher &matcher, unsigned int thread_idx);
+
+    static void printStatistics(size_t alignmentsNum, size_t totalPassedNum, size_t querySize);
+
     void computeAlternativeAlignment(unsigned int queryDbKey, Sequence &dbSeq,
                                      std::vector<Matcher::result_t> &vector, Matcher &matcher,
                                      float evalThr, int swMode, int thread_idx);
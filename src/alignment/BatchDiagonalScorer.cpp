@@ -0,0 +1,338 @@
+#include "BatchDiagonalScorer.h"
+#include "MathUtil.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <limits>
+
+BatchDiagonalScorer::BatchDiagonalScorer(const char **fastMatrix, int rescoreMode, int seqIdMode, float seqIdThr)
+        : fastMatrix(fastMatrix), rescoreMode(rescoreMode), seqIdMode(seqIdMode), seqIdThr(seqIdThr),
+          useProfile(false), bias(0), maxResidue(LAST_UPPER_CASE), profileLow(NULL), profileHigh(NULL),
+          residues(NULL), laneResidues(NULL), profileCapacity(0) {
+    // the profile has a column for each of the letters 0x40 - 0x5F, lower case letters use the column of their
+    // upper case letter if they always score the same
+    int minScore = 0;
+    int maxScore = 0;
+    bool foldLowerCase = true;
+    for (int i = 0; i <= LAST_LOWER_CASE; i++) {
+        for (int j = FIRST_UPPER_CASE; j <= LAST_LOWER_CASE; j++) {
+            minScore = std::min(minScore, static_cast<int>(fastMatrix[i][j]));
+            maxScore = std::max(maxScore, static_cast<int>(fastMatrix[i][j]));
+            if (j > LAST_UPPER_CASE && fastMatrix[i][j] != fastMatrix[i][j - 0x20]) {
+                foldLowerCase = false;
+            }
+        }
+    }
+    if (foldLowerCase) {
+        maxResidue = LAST_LOWER_CASE;
+    }
+    // the padding scores -bias, it has to be negative to keep finished lanes from growing
+    useProfile = minScore < 0 && maxScore - minScore <= UCHAR_MAX;
+    bias = static_cast<uint16_t>(-minScore);
+}
+
+BatchDiagonalScorer::~BatchDiagonalScorer() {
+    free(laneResidues);
+    free(residues);
+    free(profileHigh);
+    free(profileLow);
+}
+
+void BatchDiagonalScorer::addTarget(const char *querySeq, unsigned int querySeqLen, const char *dbSeq, unsigned int dbSeqLen,
+                                    unsigned short diagonal, bool earlyExit, bool copyTarget) {
+    target_t target;
+    target.querySeq = querySeq;
+    target.dbSeq = dbSeq;
+    target.dataOffset = SIZE_MAX;
+    target.querySeqLen = querySeqLen;
+    target.dbSeqLen = dbSeqLen;
+    target.diagonal = diagonal;
+    target.earlyExit = earlyExit;
+    if (copyTarget) {
+        target.dataOffset = targetData.size();
+        targetData.insert(targetData.end(), dbSeq, dbSeq + dbSeqLen);
+    }
+    targets.emplace_back(target);
+}
+
+// same as DistanceCalculator::computeInverseHammingDistance, but gives up after more than maxMismatches mismatches
+static unsigned int inverseHammingDistance(const char *seq1, const char *seq2, unsigned int length, unsigned int maxMismatches) {
+    unsigned int ids = 0;
+    const unsigned int simdBlock = length / (VECSIZE_INT * 4);
+    const simd_int *simdSeq1 = (const simd_int *) seq1;
+    const simd_int *simdSeq2 = (const simd_int *) seq2;
+    for (unsigned int pos = 0; pos < simdBlock; pos++) {
+        simd_int seqComparision = simdi8_eq(simdi_loadu(simdSeq1 + pos), simdi_loadu(simdSeq2 + pos));
+        ids += MathUtil::popCount(simdi8_movemask(seqComparision));
+        if ((pos + 1) * (VECSIZE_INT * 4) - ids > maxMismatches) {
+            return ids;
+        }
+    }
+    for (unsigned int pos = simdBlock * (VECSIZE_INT * 4); pos < length; pos++) {
+        ids += (seq1[pos] == seq2[pos]);
+    }
+    return ids;
+}
+
+// smallest number of identities that passes --min-seq-id in rescorediagonal, diagonalLen + 1 if there is none
+unsigned int BatchDiagonalScorer::minIdentities(unsigned int querySeqLen, unsigned int dbSeqLen, unsigned int diagonalLen) const {
+    unsigned int low = 0;
+    unsigned int high = diagonalLen + 1;
+    while (low < high) {
+        const unsigned int mid = low + (high - low) / 2;
+        const double seqId = Util::computeSeqId(seqIdMode, mid, querySeqLen, dbSeqLen, diagonalLen);
+        if (seqId >= (seqIdThr - std::numeric_limits<float>::epsilon())) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+void BatchDiagonalScorer::setResult(const diagonal_t &diagonal, unsigned int score) {
+    // DistanceCalculator::computeUngappedAlignment only keeps diagonals with a positive score
+    if (score == 0) {
+        return;
+    }
+    DistanceCalculator::LocalAlignment &result = results[diagonal.idx];
+    result.score = score;
+    result.diagonalLen = diagonal.length;
+    result.distToDiagonal = abs(diagonal.diagonal);
+    result.diagonal = diagonal.diagonal;
+}
+
+void BatchDiagonalScorer::score() {
+    results.assign(targets.size(), DistanceCalculator::LocalAlignment());
+    diagonals.clear();
+    for (size_t i = 0; i < targets.size(); i++) {
+        const target_t &target = targets[i];
+        const char *dbSeq = (target.dataOffset == SIZE_MAX) ? target.dbSeq : targetData.data() + target.dataOffset;
+
+        // same diagonals as DistanceCalculator::computeUngappedAlignment, only sequences longer than 32768
+        // can have more than one of them
+        unsigned int validDiagonals = 0;
+        int realDiagonal = 0;
+        for (unsigned int devisions = 1; devisions <= 1 + target.dbSeqLen / 32768; devisions++) {
+            const int candidate = -static_cast<int>(devisions) * 65536 + target.diagonal;
+            if (static_cast<unsigned int>(-candidate) < target.dbSeqLen) {
+                validDiagonals++;
+                realDiagonal = candidate;
+            }
+        }
+        for (unsigned int devisions = 0; devisions <= target.querySeqLen / 65536; devisions++) {
+            const int candidate = static_cast<int>(devisions) * 65536 + target.diagonal;
+            if (static_cast<unsigned int>(candidate) < target.querySeqLen) {
+                validDiagonals++;
+                realDiagonal = candidate;
+            }
+        }
+        if (validDiagonals == 0) {
+            continue;
+        }
+        if (validDiagonals > 1) {
+            results[i] = DistanceCalculator::computeUngappedAlignment(target.querySeq, target.querySeqLen, dbSeq, target.dbSeqLen,
+                                                                      target.diagonal, fastMatrix, rescoreMode);
+            continue;
+        }
+
+        diagonal_t diagonal;
+        diagonal.querySeq = target.querySeq;
+        diagonal.querySeqLen = target.querySeqLen;
+        diagonal.diagonal = realDiagonal;
+        diagonal.idx = i;
+        const unsigned int distToDiagonal = abs(realDiagonal);
+        if (realDiagonal >= 0) {
+            diagonal.queryStart = distToDiagonal;
+            diagonal.dbSeq = dbSeq;
+            diagonal.length = std::min(target.dbSeqLen, target.querySeqLen - distToDiagonal);
+        } else {
+            diagonal.queryStart = 0;
+            diagonal.dbSeq = dbSeq + distToDiagonal;
+            diagonal.length = std::min(target.dbSeqLen - distToDiagonal, target.querySeqLen);
+        }
+
+        if (rescoreMode == Parameters::RESCORE_MODE_HAMMING) {
+            unsigned int maxMismatches = UINT_MAX;
+            if (target.earlyExit) {
+                const unsigned int minIds = minIdentities(target.querySeqLen, target.dbSeqLen, diagonal.length);
+                if (minIds > diagonal.length) {
+                    continue;
+                }
+                maxMismatches = diagonal.length - minIds;
+            }
+            setResult(diagonal, inverseHammingDistance(diagonal.querySeq + diagonal.queryStart, diagonal.dbSeq,
+                                                       diagonal.length, maxMismatches));
+        } else {
+            // the targets are scattered over the database, their first cache lines are loaded while the
+            // remaining diagonals are resolved
+            __builtin_prefetch(diagonal.dbSeq);
+            __builtin_prefetch(diagonal.dbSeq + 64);
+            diagonals.emplace_back(diagonal);
+        }
+    }
+
+    // the reverse complemented query of nucleotide searches needs its own profile
+    std::sort(diagonals.begin(), diagonals.end(), diagonal_t::compareByQueryAndLength);
+    size_t queryStart = 0;
+    while (queryStart < diagonals.size()) {
+        size_t queryEnd = queryStart + 1;
+        while (queryEnd < diagonals.size() && diagonals[queryEnd].querySeq == diagonals[queryStart].querySeq) {
+            queryEnd++;
+        }
+        size_t i = queryStart;
+        if (useProfile && queryEnd - queryStart >= MIN_PROFILE_DIAGONALS) {
+            initProfile(diagonals[queryStart].querySeq, diagonals[queryStart].querySeqLen);
+            for (; i + MIN_PROFILE_DIAGONALS <= queryEnd; i += LANES) {
+                scoreSubstitution(diagonals.data() + i, static_cast<unsigned int>(std::min(static_cast<size_t>(LANES), queryEnd - i)));
+            }
+        }
+        for (; i < queryEnd; i++) {
+            const diagonal_t &diagonal = diagonals[i];
+            setResult(diagonal, DistanceCalculator::computeSubstitutionDistance(diagonal.querySeq + diagonal.queryStart, diagonal.dbSeq,
+                                                                                diagonal.length, fastMatrix, false));
+        }
+        queryStart = queryEnd;
+    }
+}
+
+void BatchDiagonalScorer::initProfile(const char *querySeq, unsigned int querySeqLen) {
+    if (querySeqLen > profileCapacity) {
+        free(laneResidues);
+        free(residues);
+        free(profileHigh);
+        free(profileLow);
+        profileCapacity = querySeqLen;
+        profileLow = (simd_int *) mem_align(ALIGN_INT, profileCapacity * sizeof(simd_int));
+        profileHigh = (simd_int *) mem_align(ALIGN_INT, profileCapacity * sizeof(simd_int));
+        // the transposition works on blocks of 16 query positions
+        residues = (unsigned char *) mem_align(ALIGN_INT, (profileCapacity + 16) * LANES);
+        laneResidues = (unsigned char *) mem_align(ALIGN_INT, (profileCapacity + 16) * LANES);
+    }
+    const __m128i vBias = _mm_set1_epi8(static_cast<char>(bias));
+    for (unsigned int i = 0; i < querySeqLen; i++) {
+        const char *scores = fastMatrix[static_cast<int>(querySeq[i])] + FIRST_UPPER_CASE;
+        const __m128i low = _mm_add_epi8(_mm_loadu_si128((const __m128i *) scores), vBias);
+        const __m128i high = _mm_add_epi8(_mm_loadu_si128((const __m128i *) (scores + 16)), vBias);
+        for (size_t offset = 0; offset < sizeof(simd_int); offset += 16) {
+            _mm_store_si128((__m128i *) ((char *) (profileLow + i) + offset), low);
+            _mm_store_si128((__m128i *) ((char *) (profileHigh + i) + offset), high);
+        }
+    }
+}
+
+// transposes the 16 x 16 bytes of rows in place, afterwards rows[i] holds the i-th byte of every row
+static inline void transpose16x16(__m128i *rows) {
+    __m128i tmp[16];
+    for (int i = 0; i < 16; i += 2) {
+        tmp[i] = _mm_unpacklo_epi8(rows[i], rows[i + 1]);
+        tmp[i + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 1]);
+    }
+    for (int i = 0; i < 16; i += 4) {
+        rows[i] = _mm_unpacklo_epi16(tmp[i], tmp[i + 2]);
+        rows[i + 1] = _mm_unpackhi_epi16(tmp[i], tmp[i + 2]);
+        rows[i + 2] = _mm_unpacklo_epi16(tmp[i + 1], tmp[i + 3]);
+        rows[i + 3] = _mm_unpackhi_epi16(tmp[i + 1], tmp[i + 3]);
+    }
+    for (int i = 0; i < 16; i += 8) {
+        for (int j = 0; j < 4; j++) {
+            tmp[i + 2 * j] = _mm_unpacklo_epi32(rows[i + j], rows[i + j + 4]);
+            tmp[i + 2 * j + 1] = _mm_unpackhi_epi32(rows[i + j], rows[i + j + 4]);
+        }
+    }
+    for (int j = 0; j < 8; j++) {
+        rows[2 * j] = _mm_unpacklo_epi64(tmp[j], tmp[j + 8]);
+        rows[2 * j + 1] = _mm_unpackhi_epi64(tmp[j], tmp[j + 8]);
+    }
+}
+
+// local maximum of the substitution scores along the diagonals like DistanceCalculator::computeSubstitutionDistance
+// the lanes of a vector hold the target residues aligned to the same query position
+void BatchDiagonalScorer::scoreSubstitution(const diagonal_t *batch, unsigned int count) {
+    unsigned int first = UINT_MAX;
+    unsigned int last = 0;
+    for (unsigned int lane = 0; lane < count; lane++) {
+        first = std::min(first, batch[lane].queryStart);
+        last = std::max(last, batch[lane].queryStart + batch[lane].length);
+    }
+    const size_t stride = ((last - first) + 15) & ~static_cast<size_t>(15);
+
+    // the diagonal of every lane is copied into its own row, the rows are then transposed in blocks of 16 x 16
+    bool isValid[LANES];
+    const unsigned int usedLanes = (count + 15) & ~15u;
+    memset(laneResidues, PADDING_RESIDUE, stride * usedLanes);
+    for (unsigned int lane = 0; lane < count; lane++) {
+        const diagonal_t &diagonal = batch[lane];
+        const unsigned char *dbSeq = (const unsigned char *) diagonal.dbSeq;
+        // letters outside of the profile columns are scored by the scalar fallback
+        unsigned char invalid = 0;
+        for (unsigned int pos = 0; pos < diagonal.length; pos++) {
+            invalid |= (dbSeq[pos] < FIRST_UPPER_CASE) | (dbSeq[pos] > maxResidue);
+        }
+        isValid[lane] = (invalid == 0);
+        if (isValid[lane]) {
+            memcpy(laneResidues + lane * stride + (diagonal.queryStart - first), dbSeq, diagonal.length);
+        }
+    }
+    const __m128i vPadding = _mm_set1_epi8(static_cast<char>(PADDING_RESIDUE));
+    for (size_t block = 0; block < stride; block += 16) {
+        for (unsigned int laneBlock = usedLanes; laneBlock < LANES; laneBlock += 16) {
+            for (unsigned int pos = 0; pos < 16; pos++) {
+                _mm_store_si128((__m128i *) (residues + (block + pos) * LANES + laneBlock), vPadding);
+            }
+        }
+        for (unsigned int laneBlock = 0; laneBlock < usedLanes; laneBlock += 16) {
+            __m128i rows[16];
+            for (unsigned int lane = 0; lane < 16; lane++) {
+                rows[lane] = _mm_load_si128((const __m128i *) (laneResidues + (laneBlock + lane) * stride + block));
+            }
+            transpose16x16(rows);
+            for (unsigned int pos = 0; pos < 16; pos++) {
+                _mm_store_si128((__m128i *) (residues + (block + pos) * LANES + laneBlock), rows[pos]);
+            }
+        }
+    }
+
+    // letters are reduced to their 5 lower bits, 0-15 index the low table, 16-31 the high table,
+    // the shuffle returns 0 if the index has the top bit set, so that padding scores -bias
+    const simd_int vLetterMask = simdi8_set((char) 0x9F);
+    const simd_int vIndexOffset = simdi8_set(0x70);
+    const simd_int vHighFlip = simdi8_set(0x10);
+    const simd_int vLowByte = simdi16_set(0x00FF);
+    const simd_int vBias = simdi16_set(bias);
+    const simd_int vZero = simdi_setzero();
+    // lanes of even and odd bytes are scored in separate 16 bit vectors
+    simd_int vEven = vZero;
+    simd_int vOdd = vZero;
+    simd_int vMaxEven = vZero;
+    simd_int vMaxOdd = vZero;
+    // lanes that did not start yet stay at 0, finished lanes can only decrease
+    for (unsigned int i = first; i < last; i++) {
+        const simd_int vLetters = simdi_and(simdi_load((simd_int *) (residues + static_cast<size_t>(i - first) * LANES)), vLetterMask);
+        const simd_int vLowIndex = simdui8_adds(vLetters, vIndexOffset);
+        const simd_int vHighIndex = simdui8_adds(simdi_xor(vLetters, vHighFlip), vIndexOffset);
+        const simd_int vScore = simdi_or(simdi8_shuffle(simdi_load(profileLow + i), vLowIndex),
+                                         simdi8_shuffle(simdi_load(profileHigh + i), vHighIndex));
+        vEven = simdui16_subs(simdi16_adds(vEven, simdi_and(vScore, vLowByte)), vBias);
+        vOdd = simdui16_subs(simdi16_adds(vOdd, simdi16_srli(vScore, 8)), vBias);
+        vMaxEven = simdi16_max(vMaxEven, vEven);
+        vMaxOdd = simdi16_max(vMaxOdd, vOdd);
+    }
+
+    uint16_t __attribute__((aligned(ALIGN_INT))) maxEven[LANES / 2];
+    uint16_t __attribute__((aligned(ALIGN_INT))) maxOdd[LANES / 2];
+    simdi_store((simd_int *) maxEven, vMaxEven);
+    simdi_store((simd_int *) maxOdd, vMaxOdd);
+    for (unsigned int lane = 0; lane < count; lane++) {
+        const diagonal_t &diagonal = batch[lane];
+        unsigned int score = (lane & 1) ? maxOdd[lane / 2] : maxEven[lane / 2];
+        // the score might have saturated, recompute it without limit
+        if (isValid[lane] == false || score >= SHRT_MAX - UCHAR_MAX) {
+            score = DistanceCalculator::computeSubstitutionDistance(diagonal.querySeq + diagonal.queryStart, diagonal.dbSeq,
+                                                                    diagonal.length, fastMatrix, false);
+        }
+        setResult(diagonal, score);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef BATCH_DIAGONAL_SCORER_H
+#define BATCH_DIAGONAL_SCORER_H
+
+//
+// Rescores the prefilter diagonals of one query against all of its targets at once (rescorediagonal).
+// Substitution scores (RESCORE_MODE_SUBSTITUTION) are computed for VECSIZE_INT * 4 diagonals at once,
+// every lane of a vector holds the diagonal of a different target. All lanes advance along the query, so the
+// scores are looked up with byte shuffles from a query profile like in InterSequenceSmithWaterman, the local
+// maximum is tracked in 16 bit. The profile is indexed by the ASCII letters of the targets, they only have to be
+// transposed into the lanes. The diagonals are sorted by length, so that the lanes finish at about the same time.
+// Hamming distances (RESCORE_MODE_HAMMING) are computed per diagonal and stop as soon as the diagonal
+// can not reach the sequence identity threshold anymore.
+// Otherwise the results are the same as the ones of DistanceCalculator::computeUngappedAlignment.
+//
+
+#include <vector>
+
+#include "simd.h"
+#include "DistanceCalculator.h"
+
+class BatchDiagonalScorer {
+public:
+    // number of diagonals scored per vector
+    static const unsigned int LANES = VECSIZE_INT * 4;
+
+    // fastMatrix is the ASCII matrix of SubstitutionMatrix::createAsciiSubMat
+    BatchDiagonalScorer(const char **fastMatrix, int rescoreMode, int seqIdMode, float seqIdThr);
+    ~BatchDiagonalScorer();
+
+    static bool isSupported(int rescoreMode) {
+        return rescoreMode == Parameters::RESCORE_MODE_HAMMING || rescoreMode == Parameters::RESCORE_MODE_SUBSTITUTION;
+    }
+
+    // querySeq has to stay valid until score is called, dbSeq too unless copyTarget is set
+    // (e.g. if it was decompressed into a reused buffer)
+    // with earlyExit, the score of Hamming distances that can not reach the sequence identity threshold is
+    // only a lower bound of their identities, the seqIdMode identity computed from it misses the threshold as well
+    void addTarget(const char *querySeq, unsigned int querySeqLen, const char *dbSeq, unsigned int dbSeqLen,
+                   unsigned short diagonal, bool earlyExit, bool copyTarget);
+
+    size_t getTargetCount() const {
+        return targets.size();
+    }
+
+    void clearTargets() {
+        targets.clear();
+        targetData.clear();
+        results.clear();
+    }
+
+    // scores all added targets
+    void score();
+
+    const DistanceCalculator::LocalAlignment &getResult(size_t idx) const {
+        return results[idx];
+    }
+
+private:
+    // scores are looked up with two byte shuffles from the 32 columns of the letters 0x40 - 0x5F
+    static const unsigned char FIRST_UPPER_CASE = 0x40;
+    static const unsigned char LAST_UPPER_CASE = 0x5F;
+    // last letter of SubstitutionMatrix::createAsciiSubMat
+    static const unsigned char LAST_LOWER_CASE = 'z';
+    static const unsigned char PADDING_RESIDUE = 0xFF;
+    // fewer diagonals of a query are not worth building the query profile
+    static const unsigned int MIN_PROFILE_DIAGONALS = LANES / 2;
+
+    struct target_t {
+        const char *querySeq;
+        const char *dbSeq;
+        // offset of the copied target in targetData, SIZE_MAX if it was not copied
+        size_t dataOffset;
+        unsigned int querySeqLen;
+        unsigned int dbSeqLen;
+        unsigned short diagonal;
+        bool earlyExit;
+    };
+
+    // resolved diagonal of a target
+    struct diagonal_t {
+        const char *querySeq;
+        const char *dbSeq;
+        unsigned int querySeqLen;
+        unsigned int queryStart;
+        unsigned int length;
+        int diagonal;
+        size_t idx;
+
+        static bool compareByQueryAndLength(const diagonal_t &first, const diagonal_t &second) {
+            if (first.querySeq != second.querySeq) {
+                return first.querySeq < second.querySeq;
+            }
+            if (first.length != second.length) {
+                return first.length > second.length;
+            }
+            return first.idx < second.idx;
+        }
+    };
+
+    const char **fastMatrix;
+    int rescoreMode;
+    int seqIdMode;
+    float seqIdThr;
+
+    // substitution scores + bias, vectors are only used if all scores fit into a byte
+    bool useProfile;
+    uint16_t bias;
+    // targets with letters outside of FIRST_UPPER_CASE - maxResidue are scored without vectors
+    unsigned char maxResidue;
+
+    // per query position the biased scores of the letters 0x40-0x4F and 0x50-0x5F,
+    // replicated in every 16 byte lane of the vector
+    simd_int *profileLow;
+    simd_int *profileHigh;
+    // per query position the target letters of all lanes
+    unsigned char *residues;
+    // per lane the target letters of all query positions
+    unsigned char *laneResidues;
+    unsigned int profileCapacity;
+
+    std::vector<target_t> targets;
+    std::vector<char> targetData;
+    std::vector<diagonal_t> diagonals;
+    std::vector<DistanceCalculator::LocalAlignment> results;
+
+    unsigned int minIdentities(unsigned int querySeqLen, unsigned int dbSeqLen, unsigned int diagonalLen) const;
+    void initProfile(const char *querySeq, unsigned int querySeqLen);
+    void scoreSubstitution(const diagonal_t *batch, unsigned int count);
+    void setResult(const diagonal_t &diagonal, unsigned int score);
+};
+
+#endif
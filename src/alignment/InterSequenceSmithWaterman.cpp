@@ -0,0 +1,204 @@
+#include "InterSequenceSmithWaterman.h"
+#include "Parameters.h"
+#include "Util.h"
+
+#include <climits>
+
+InterSequenceSmithWaterman::InterSequenceSmithWaterman(size_t maxSequenceLength, int alphabetSize)
+        : alphabetSize(alphabetSize), maxSequenceLength(maxSequenceLength), queryLength(0), bias(0) {
+    profileLow  = (simd_int *) mem_align(ALIGN_INT, (maxSequenceLength + 1) * sizeof(simd_int));
+    profileHigh = (simd_int *) mem_align(ALIGN_INT, (maxSequenceLength + 1) * sizeof(simd_int));
+    vH = (simd_int *) mem_align(ALIGN_INT, (maxSequenceLength + 1) * sizeof(simd_int));
+    vE = (simd_int *) mem_align(ALIGN_INT, (maxSequenceLength + 1) * sizeof(simd_int));
+}
+
+InterSequenceSmithWaterman::~InterSequenceSmithWaterman() {
+    free(vE);
+    free(vH);
+    free(profileHigh);
+    free(profileLow);
+}
+
+bool InterSequenceSmithWaterman::isSupported(int querySeqType, int alphabetSize) {
+    return alphabetSize <= MAX_ALPHABET_SIZE
+           && (Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_AMINO_ACIDS)
+               || Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_HMM_PROFILE));
+}
+
+bool InterSequenceSmithWaterman::initQuery(const Sequence *q, const int8_t *mat, const int8_t *compositionBias) {
+    if (isSupported(q->getSequenceType(), alphabetSize) == false || static_cast<size_t>(q->L) > maxSequenceLength) {
+        return false;
+    }
+    const bool isProfile = Parameters::isEqualDbtype(q->getSequenceType(), Parameters::DBTYPE_HMM_PROFILE);
+    queryLength = q->L;
+
+    // same scores as the query profile of SmithWaterman::createQueryProfile
+    int minScore = 0;
+    int maxScore = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int32_t i = 0; i < queryLength; i++) {
+            unsigned char row[MAX_ALPHABET_SIZE];
+            for (int a = 0; a < MAX_ALPHABET_SIZE; a++) {
+                int score = 0;
+                if (a >= alphabetSize) {
+                    score = 0;
+                } else if (isProfile) {
+                    // the neutral state 'X' scores 0
+                    score = (static_cast<size_t>(a) < Sequence::PROFILE_AA_SIZE) ? mat[a * queryLength + i] : 0;
+                } else {
+                    score = mat[a * alphabetSize + q->numSequence[i]] + compositionBias[i];
+                }
+                if (pass == 0) {
+                    minScore = std::min(minScore, score);
+                    maxScore = std::max(maxScore, score);
+                } else {
+                    row[a] = static_cast<unsigned char>(score + bias);
+                }
+            }
+            if (pass == 0) {
+                continue;
+            }
+            unsigned char *low = (unsigned char *) (profileLow + i);
+            unsigned char *high = (unsigned char *) (profileHigh + i);
+            for (size_t offset = 0; offset < sizeof(simd_int); offset += 16) {
+                memcpy(low + offset, row, 16);
+                memcpy(high + offset, row + 16, 16);
+            }
+        }
+        if (pass == 0) {
+            if (maxScore - minScore > UCHAR_MAX) {
+                return false;
+            }
+            bias = static_cast<uint8_t>(-minScore);
+        }
+    }
+    return true;
+}
+
+void InterSequenceSmithWaterman::addTarget(const unsigned char *dbSequence, int32_t dbLength) {
+    targetOffsets.push_back(targetData.size());
+    targetLengths.push_back(dbLength);
+    targetData.insert(targetData.end(), dbSequence, dbSequence + dbLength);
+}
+
+void InterSequenceSmithWaterman::align(uint8_t gapOpen, uint8_t gapExtend) {
+    const size_t targetCount = targetOffsets.size();
+    results.resize(targetCount);
+
+    const simd_int vZero = simdi_setzero();
+    const simd_int vGapO = simdi8_set(gapOpen);
+    const simd_int vGapE = simdi8_set(gapExtend);
+    const simd_int vBias = simdi8_set(bias);
+    const simd_int vLowOffset = simdi8_set(0x70);
+    const simd_int vHighFlip = simdi8_set((char) 0x80);
+    simd_int vBest = vZero;
+
+    // per lane state, lanes without target have lane == -1
+    int64_t laneTarget[LANES];
+    int32_t lanePos[LANES];
+    int32_t laneEnd[LANES];
+    int32_t laneDbEndPos[LANES];
+    unsigned char __attribute__((aligned(ALIGN_INT))) residues[LANES];
+    unsigned char __attribute__((aligned(ALIGN_INT))) resetMask[LANES];
+    unsigned char __attribute__((aligned(ALIGN_INT))) best[LANES];
+    for (size_t lane = 0; lane < LANES; lane++) {
+        laneTarget[lane] = -1;
+        lanePos[lane] = 0;
+        laneEnd[lane] = 0;
+        laneDbEndPos[lane] = -1;
+        residues[lane] = 0;
+    }
+    memset(vH, 0, queryLength * sizeof(simd_int));
+    memset(vE, 0, queryLength * sizeof(simd_int));
+
+    size_t nextTarget = 0;
+    while (true) {
+        // finish lanes that reached the end of their target and refill them
+        bool reset = false;
+        bool active = false;
+        simdi_store((simd_int *) best, vBest);
+        for (size_t lane = 0; lane < LANES; lane++) {
+            resetMask[lane] = 0;
+            if (laneTarget[lane] != -1 && lanePos[lane] < laneEnd[lane]) {
+                active = true;
+                continue;
+            }
+            if (laneTarget[lane] != -1) {
+                result_t &result = results[laneTarget[lane]];
+                result.overflow = (best[lane] + bias) >= UCHAR_MAX;
+                result.score = best[lane];
+                result.dbEndPos = laneDbEndPos[lane];
+                laneTarget[lane] = -1;
+            }
+            while (nextTarget < targetCount && targetLengths[nextTarget] == 0) {
+                results[nextTarget].overflow = false;
+                results[nextTarget].score = 0;
+                results[nextTarget].dbEndPos = -1;
+                nextTarget++;
+            }
+            if (nextTarget < targetCount) {
+                laneTarget[lane] = nextTarget;
+                lanePos[lane] = 0;
+                laneEnd[lane] = targetLengths[nextTarget];
+                laneDbEndPos[lane] = -1;
+                resetMask[lane] = 0xFF;
+                reset = true;
+                active = true;
+                nextTarget++;
+            }
+        }
+        if (active == false) {
+            break;
+        }
+        if (reset) {
+            // refilled lanes start with an empty DP matrix
+            const simd_int vReset = simdi_load((simd_int *) resetMask);
+            for (int32_t i = 0; i < queryLength; i++) {
+                simdi_store(vH + i, simdi_andnot(vReset, simdi_load(vH + i)));
+                simdi_store(vE + i, simdi_andnot(vReset, simdi_load(vE + i)));
+            }
+            vBest = simdi_andnot(vReset, vBest);
+        }
+
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if (laneTarget[lane] != -1) {
+                residues[lane] = targetData[targetOffsets[laneTarget[lane]] + lanePos[lane]];
+            }
+        }
+        // residues 0-15 index the low table, 16-31 the high table, the shuffle returns 0 if the index has the top bit set
+        const simd_int vResidues = simdi_load((simd_int *) residues);
+        const simd_int vLowIndex = simdui8_adds(vResidues, vLowOffset);
+        const simd_int vHighIndex = simdi_xor(vLowIndex, vHighFlip);
+
+        simd_int vF = vZero;
+        simd_int vHDiag = vZero;
+        simd_int vMaxColumn = vZero;
+        for (int32_t i = 0; i < queryLength; i++) {
+            const simd_int vScore = simdi_or(simdi8_shuffle(simdi_load(profileLow + i), vLowIndex),
+                                             simdi8_shuffle(simdi_load(profileHigh + i), vHighIndex));
+            simd_int h = simdui8_subs(simdui8_adds(vHDiag, vScore), vBias);
+            simd_int e = simdi_load(vE + i);
+            h = simdui8_max(h, e);
+            h = simdui8_max(h, vF);
+            vMaxColumn = simdui8_max(vMaxColumn, h);
+            vHDiag = simdi_load(vH + i);
+            simdi_store(vH + i, h);
+
+            h = simdui8_subs(h, vGapO);
+            e = simdui8_max(simdui8_subs(e, vGapE), h);
+            simdi_store(vE + i, e);
+            vF = simdui8_max(simdui8_subs(vF, vGapE), h);
+        }
+
+        // the end position is the first target position that reaches the best score, like in sw_sse2_byte
+        const simd_int vNewBest = simdui8_max(vBest, vMaxColumn);
+        unsigned int improved = ~static_cast<unsigned int>(simdi8_movemask(simdi8_eq(vNewBest, vBest)));
+        vBest = vNewBest;
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if ((improved >> lane) & 1) {
+                laneDbEndPos[lane] = lanePos[lane];
+            }
+            lanePos[lane]++;
+        }
+    }
+}
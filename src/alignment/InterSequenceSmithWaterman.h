@@ -0,0 +1,84 @@
+#ifndef INTER_SEQUENCE_SMITH_WATERMAN_H
+#define INTER_SEQUENCE_SMITH_WATERMAN_H
+
+//
+// Inter-sequence Smith-Waterman: aligns one query against VECSIZE_INT * 4 targets at once,
+// every 8 bit lane of a vector holds a different target (Rognes 2011, SWIPE).
+// Lanes are refilled with the next target as soon as their target is finished.
+// Only the score and the target end position are computed. The scores are the full Gotoh scores and
+// therefore never below the striped SmithWaterman score, they can be used to reject targets before the
+// striped alignment. Overflowing lanes have to fall back to the striped SmithWaterman.
+//
+
+#include <vector>
+
+#include "simd.h"
+#include "Sequence.h"
+
+class InterSequenceSmithWaterman {
+public:
+    // number of targets aligned per vector
+    static const unsigned int LANES = VECSIZE_INT * 4;
+    // substitution scores are looked up with two byte shuffles, the alphabet has to fit into 32 letters
+    static const int MAX_ALPHABET_SIZE = 32;
+
+    struct result_t {
+        int32_t score;
+        // 0-based end position on the target, -1 if nothing could be aligned
+        int32_t dbEndPos;
+        // score + bias did not fit into 8 bit, score and dbEndPos are invalid
+        bool overflow;
+    };
+
+    InterSequenceSmithWaterman(size_t maxSequenceLength, int alphabetSize);
+    ~InterSequenceSmithWaterman();
+
+    // compositionBias has to be the rounded per position bias of SmithWaterman::ssw_init, mat is the
+    // alphabetSize * alphabetSize substitution matrix or the profile of HMM profile queries
+    // returns false if the query can not be aligned with this kernel
+    bool initQuery(const Sequence *q, const int8_t *mat, const int8_t *compositionBias);
+
+    // the target sequence is copied, length 0 targets are skipped
+    void addTarget(const unsigned char *dbSequence, int32_t dbLength);
+
+    size_t getTargetCount() const {
+        return targetOffsets.size();
+    }
+
+    void clearTargets() {
+        targetOffsets.clear();
+        targetLengths.clear();
+        targetData.clear();
+        results.clear();
+    }
+
+    // aligns all added targets, gapOpen is the cost of the first gap position like in SmithWaterman::ssw_align
+    void align(uint8_t gapOpen, uint8_t gapExtend);
+
+    const result_t &getResult(size_t idx) const {
+        return results[idx];
+    }
+
+    static bool isSupported(int querySeqType, int alphabetSize);
+
+private:
+    int alphabetSize;
+    size_t maxSequenceLength;
+
+    int32_t queryLength;
+    uint8_t bias;
+
+    // per query position the biased scores of target letters 0-15 and 16-31,
+    // replicated in every 16 byte lane of the vector
+    simd_int *profileLow;
+    simd_int *profileHigh;
+    simd_int *vH;
+    simd_int *vE;
+
+    std::vector<size_t> targetOffsets;
+    std::vector<int32_t> targetLengths;
+    std::vector<unsigned char> targetData;
+    std::vector<result_t> results;
+};
+
+#endif
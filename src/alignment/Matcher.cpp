@@ -8,7 +8,7 @@
 
 Matcher::Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m, EvalueComputation * evaluer,
                  bool aaBiasCorrection, int gapOpen, int gapExtend, int zdrop)
-                 : gapOpen(gapOpen), gapExtend(gapExtend), m(m), evaluer(evaluer), tinySubMat(NULL) {
+                 : gapOpen(gapOpen), gapExtend(gapExtend), batchAligner(NULL), batchQuery(false), m(m), evaluer(evaluer), tinySubMat(NULL), profileCache(NULL) {
     if(Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_PROFILE_STATE_PROFILE) == false ) {
         setSubstitutionMatrix(m);
     }
@@ -19,6 +19,9 @@ Matcher::Matcher(int querySeqType, int maxSeqLen, BaseMatrix *m, EvalueComputati
     } else {
         nuclaligner = NULL;
         aligner = new SmithWaterman(maxSeqLen, m->alphabetSize, aaBiasCorrection);
+        if (InterSequenceSmithWaterman::isSupported(querySeqType, m->alphabetSize)) {
+            batchAligner = new InterSequenceSmithWaterman(maxSeqLen, m->alphabetSize);
+        }
     }
     //std::cout << "lambda=" << lambdaLog2 << " logKLog2=" << logKLog2 << std::endl;
 }
@@ -40,6 +43,9 @@ Matcher::~Matcher(){
     if(nuclaligner != NULL){
         delete nuclaligner;
     }
+    if(batchAligner != NULL){
+        delete batchAligner;
+    }
     if(tinySubMat != NULL){
         delete [] tinySubMat;
         tinySubMat = NULL;
@@ -50,13 +56,38 @@ void Matcher::initQuery(Sequence* query){
     currentQuery = query;
     if(Parameters::isEqualDbtype(query->getSequenceType(), Parameters::DBTYPE_NUCLEOTIDES)){
         nuclaligner->initQuery(query);
-    }else if(Parameters::isEqualDbtype(query->getSeqType(), Parameters::DBTYPE_HMM_PROFILE) || Parameters::isEqualDbtype(query->getSeqType(), Parameters::DBTYPE_PROFILE_STATE_PROFILE)){
-        aligner->ssw_init(query, query->getAlignmentProfile(), this->m, 2);
     }else{
-        aligner->ssw_init(query, this->tinySubMat, this->m, 2);
+        const bool isProfile = Parameters::isEqualDbtype(query->getSeqType(), Parameters::DBTYPE_HMM_PROFILE)
+                               || Parameters::isEqualDbtype(query->getSeqType(), Parameters::DBTYPE_PROFILE_STATE_PROFILE);
+        const int8_t *mat = isProfile ? query->getAlignmentProfile() : this->tinySubMat;
+        if (profileCache == NULL || profileCache->load(query, this->m, aligner) == false) {
+            aligner->ssw_init(query, mat, this->m, 2);
+            if (profileCache != NULL) {
+                profileCache->store(query, this->m, aligner);
+            }
+        }
+        if(batchAligner != NULL){
+            batchQuery = batchAligner->initQuery(query, mat, aligner->getCompositionBias());
+        }
     }
 }
 
+Matcher::result_t Matcher::getBatchSWResult(size_t batchIdx, Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode,
+                                            const float covThr, const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode){
+    const InterSequenceSmithWaterman::result_t &batchResult = batchAligner->getResult(batchIdx);
+    if(batchResult.overflow == false){
+        // the striped alignment can not score higher than the inter-sequence kernel
+        // so the target would fail the e-value threshold anyway
+        const double evalue = evaluer->computeEvalue(batchResult.score, currentQuery->L);
+        if(evalue > evalThr){
+            const int bitScore = static_cast<int>(evaluer->computeBitScore(batchResult.score)+0.5);
+            return result_t(dbSeq->getDbKey(), bitScore, 0.0f, 0.0f, 0.0f, evalue, 0, 0, 0, currentQuery->L,
+                            0, batchResult.dbEndPos, dbSeq->L, std::string());
+        }
+    }
+    return getSWResult(dbSeq, diagonal, isReverse, covMode, covThr, evalThr, alignmentMode, seqIdMode, false);
+}
+
 
 Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr,
                                        const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentity,
@@ -95,38 +126,32 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool
         if(alignmentMode == Matcher::SCORE_COV_SEQID){
             if(isIdentity==false){
                 if(alignment.cigar){
+                    size_t backtraceLength = 0;
+                    for (int32_t c = 0; c < alignment.cigarLen; ++c) {
+                        backtraceLength += SmithWaterman::cigar_int_to_len(alignment.cigar[c]);
+                    }
+                    backtrace.reserve(backtraceLength);
                     int32_t targetPos = alignment.dbStartPos1, queryPos = alignment.qStartPos1;
                     for (int32_t c = 0; c < alignment.cigarLen; ++c) {
                         char letter = SmithWaterman::cigar_int_to_op(alignment.cigar[c]);
                         uint32_t length = SmithWaterman::cigar_int_to_len(alignment.cigar[c]);
-                        backtrace.reserve(length);
-
-                        for (uint32_t i = 0; i < length; ++i){
-                            if (letter == 'M') {
-                                if (dbSeq->numSequence[targetPos] == currentQuery->numSequence[queryPos]){
-                                    aaIds++;
-                                }
-                                ++queryPos;
-                                ++targetPos;
-                                backtrace.append("M");
-                            } else {
-                                if (letter == 'I') {
-                                    ++queryPos;
-                                    backtrace.append("I");
-                                }
-                                else{
-                                    ++targetPos;
-                                    backtrace.append("D");
-                                }
+                        backtrace.append(length, letter);
+                        if (letter == 'M') {
+                            for (uint32_t i = 0; i < length; ++i) {
+                                aaIds += (dbSeq->numSequence[targetPos + i] == currentQuery->numSequence[queryPos + i]);
                             }
+                            queryPos += length;
+                            targetPos += length;
+                        } else if (letter == 'I') {
+                            queryPos += length;
+                        } else {
+                            targetPos += length;
                         }
                     }
                 }
             } else {
-                for (int32_t c = 0; c < origQueryLen; ++c) {
-                    aaIds++;
-                    backtrace.append("M");
-                }
+                aaIds += origQueryLen;
+                backtrace.append(origQueryLen, 'M');
             }
         }
 
@@ -178,9 +203,9 @@ Matcher::result_t Matcher::getSWResult(Sequence* dbSeq, const int diagonal, bool
 
     result_t result;
     if(isReverse){
-        result = result_t(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, origQueryLen, dbEndPos, dbStartPos, dbSeq->L, backtrace);
+        result = result_t(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, origQueryLen, dbEndPos, dbStartPos, dbSeq->L, std::move(backtrace));
     }else{
-        result = result_t(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, origQueryLen, dbStartPos, dbEndPos, dbSeq->L, backtrace);
+        result = result_t(dbSeq->getDbKey(), bitScore, qcov, dbcov, seqId, evalue, alnLength, qStartPos, qEndPos, origQueryLen, dbStartPos, dbEndPos, dbSeq->L, std::move(backtrace));
     }
 
 
@@ -212,39 +237,53 @@ float Matcher::estimateSeqIdByScorePerCol(uint16_t score, unsigned int qLen, uns
 
 
 std::string Matcher::compressAlignment(const std::string& bt) {
-    std::string ret;
+    // every run needs at most 11 characters
+    std::string ret(11 * (bt.size() + 1), '\0');
+    ret.resize(compressAlignment(bt, &ret[0]));
+    return ret;
+}
+
+size_t Matcher::compressAlignment(const std::string& bt, char *buffer) {
+    char *tmpBuff = buffer;
     char state = 'M';
-    size_t counter = 0;
+    uint32_t counter = 0;
     for(size_t i = 0; i < bt.size(); i++){
         if(bt[i] != state){
-            ret.append(std::to_string(counter));
-            ret.push_back(state);
+            tmpBuff = Itoa::u32toa_sse2(counter, tmpBuff);
+            *(tmpBuff-1) = state;
             state = bt[i];
             counter = 1;
         }else{
             counter++;
         }
     }
-    ret.append(std::to_string(counter));
-    ret.push_back(state);
-    return ret;
+    tmpBuff = Itoa::u32toa_sse2(counter, tmpBuff);
+    *(tmpBuff-1) = state;
+    return tmpBuff - buffer;
 }
 
 std::string Matcher::uncompressAlignment(const std::string &cbt) {
     std::string bt;
+    uncompressAlignment(cbt.c_str(), cbt.size(), bt);
+    return bt;
+}
+
+void Matcher::uncompressAlignment(const char *cbt, size_t length, std::string &bt) {
+    // a state without count repeats the previous count
     size_t count = 0;
-    for(size_t i = 0; i < cbt.size(); i++) {
-        sscanf(cbt.c_str() + i, "%zu", &count);
-        for(size_t j = i; j < cbt.size(); j++ ){
-            if(isdigit(cbt[j]) == false){
-                char state = cbt[j];
-                bt.append(count, state);
-                i = j;
+    for(size_t i = 0; i < length; i++) {
+        if (isdigit(cbt[i])) {
+            count = 0;
+            while (i < length && isdigit(cbt[i])) {
+                count = count * 10 + (cbt[i] - '0');
+                i++;
+            }
+            if (i == length) {
                 break;
             }
         }
+        bt.append(count, cbt[i]);
     }
-    return bt;
 }
 
 Matcher::result_t Matcher::parseAlignmentRecord(const char *data, bool readCompressed) {
@@ -283,15 +322,14 @@ Matcher::result_t Matcher::parseAlignmentRecord(const char *data, bool readCompr
 
     } else {
         size_t len = entry[11] - entry[10];
+        Matcher::result_t result(targetId, score, qCov, dbCov, seqId, eval,
+                                 alnLength, qStart, qEnd, qLen, dbStart, dbEnd, dbLen, std::string());
         if (readCompressed) {
-            return Matcher::result_t(targetId, score, qCov, dbCov, seqId, eval,
-                                     alnLength, qStart, qEnd, qLen, dbStart, dbEnd,
-                                     dbLen, std::string(entry[10], len));
+            result.backtrace.assign(entry[10], len);
         } else {
-            return Matcher::result_t(targetId, score, qCov, dbCov, seqId, eval,
-                                     alnLength, qStart, qEnd, qLen, dbStart, dbEnd,
-                                     dbLen, uncompressAlignment(std::string(entry[10], len)));
+            uncompressAlignment(entry[10], len, result.backtrace);
         }
+        return result;
     }
 }
 
@@ -321,12 +359,10 @@ size_t Matcher::resultToBuffer(char * buff1, const result_t &result, bool addBac
         tmpBuff = Itoa::i32toa_sse2(result.dbLen, tmpBuff);
         if(compress){
             *(tmpBuff-1) = '\t';
-            std::string compressedCigar = Matcher::compressAlignment(result.backtrace);
-            tmpBuff = strncpy(tmpBuff, compressedCigar.c_str(), compressedCigar.length());
-            tmpBuff+= compressedCigar.length()+1;
+            tmpBuff += Matcher::compressAlignment(result.backtrace, tmpBuff) + 1;
         }else{
             *(tmpBuff-1) = '\t';
-            tmpBuff = strncpy(tmpBuff, result.backtrace.c_str(), result.backtrace.length());
+            memcpy(tmpBuff, result.backtrace.c_str(), result.backtrace.length());
             tmpBuff+= result.backtrace.length()+1;
         }
     }else{
@@ -9,14 +9,17 @@
 
 #include <cfloat>
 #include <algorithm>
+#include <utility>
 #include <vector>
 #include "itoa.h"
 
 #include "Sequence.h"
 #include "BaseMatrix.h"
 #include "StripedSmithWaterman.h"
+#include "InterSequenceSmithWaterman.h"
 #include "EvalueComputation.h"
 #include "BandedNucleotideAligner.h"
+#include "QueryProfileCache.h"
 
 class Matcher{
 
@@ -57,7 +60,7 @@ public:
                                           dbcov(dbcov), seqId(seqId), eval(eval), alnLength(alnLength),
                                           qStartPos(qStartPos), qEndPos(qEndPos), qLen(qLen),
                                           dbStartPos(dbStartPos), dbEndPos(dbEndPos), dbLen(dbLen),
-                                          backtrace(backtrace) {};
+                                          backtrace(std::move(backtrace)) {};
         
         result_t(){};
 
@@ -75,11 +78,12 @@ public:
             res.dbEndPos = qend;
             res.dbLen = qLen;
             if (hasBacktrace) {
+                char *bt = &res.backtrace[0];
                 for (size_t j = 0; j < res.backtrace.size(); j++) {
-                    if (res.backtrace.at(j) == 'I') {
-                        res.backtrace.at(j) = 'D';
-                    } else if (res.backtrace.at(j) == 'D') {
-                        res.backtrace.at(j) = 'I';
+                    if (bt[j] == 'I') {
+                        bt[j] = 'D';
+                    } else if (bt[j] == 'D') {
+                        bt[j] = 'I';
                     }
                 }
             }
@@ -123,6 +127,40 @@ public:
     result_t getSWResult(Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr, const double evalThr,
                          unsigned int alignmentMode, unsigned int seqIdMode, bool isIdentical, bool wrappedScoring=false);
 
+    // Targets queued with addBatchTarget are scored at once by alignBatch with the inter-sequence kernel.
+    // getBatchSWResult rejects targets whose score can not reach evalThr and computes the
+    // striped alignment (end, start positions and traceback) only for the remaining targets.
+    static const size_t BATCH_TARGETS = 4 * InterSequenceSmithWaterman::LANES;
+    // the inter-sequence kernel is used for short queries or long candidate lists
+    static const int BATCH_MAX_QUERY_LENGTH = 256;
+    static const size_t BATCH_MIN_CANDIDATES = 2 * BATCH_TARGETS;
+
+    // true if the current query can be aligned with the inter-sequence kernel
+    bool canAlignBatch() const {
+        return batchQuery;
+    }
+
+    // a NULL dbSeq queues an empty placeholder target
+    void addBatchTarget(const Sequence *dbSeq) {
+        if (dbSeq == NULL) {
+            batchAligner->addTarget(NULL, 0);
+        } else {
+            batchAligner->addTarget(dbSeq->numSequence, dbSeq->L);
+        }
+    }
+
+    void alignBatch() {
+        batchAligner->align(gapOpen, gapExtend);
+    }
+
+    void clearBatch() {
+        batchAligner->clearTargets();
+    }
+
+    // result of the batchIdx-th queued target, dbSeq has to be the same target
+    result_t getBatchSWResult(size_t batchIdx, Sequence* dbSeq, const int diagonal, bool isReverse, const int covMode, const float covThr,
+                              const double evalThr, unsigned int alignmentMode, unsigned int seqIdMode);
+
     // need for sorting the results
     static bool compareHits(const result_t &first, const result_t &second) {
         if (first.eval != second.eval) {
@@ -175,6 +213,11 @@ public:
     // map new query into memory (create queryProfile, ...)
     void initQuery(Sequence* query);
 
+    // initQuery restores the query profile from cache if the query was seen before, cache is shared by all threads
+    void setQueryProfileCache(QueryProfileCache *cache) {
+        profileCache = cache;
+    }
+
     static result_t parseAlignmentRecord(const char *data, bool readCompressed=false);
 
     static void readAlignmentResults(std::vector<result_t> &result, char *data, bool readCompressed = false);
@@ -183,8 +226,14 @@ public:
 
     static std::string compressAlignment(const std::string &bt);
 
+    // writes the compressed backtrace to buffer without terminating it, returns the written length
+    static size_t compressAlignment(const std::string &bt, char *buffer);
+
     static std::string uncompressAlignment(const std::string &cbt);
 
+    // appends the uncompressed backtrace to bt
+    static void uncompressAlignment(const char *cbt, size_t length, std::string &bt);
+
 
     static size_t resultToBuffer(char * buffer, const result_t &result, bool addBacktrace, bool compress  = true);
 
@@ -205,12 +254,17 @@ private:
     SmithWaterman * aligner;
     // aligner for nucl
     BandedNucleotideAligner * nuclaligner;
+    // inter-sequence aligner, NULL if the query type is not supported
+    InterSequenceSmithWaterman * batchAligner;
+    bool batchQuery;
     // substitution matrix
     BaseMatrix* m;
     // evalue
     EvalueComputation * evaluer;
     // byte version of substitution matrix
     int8_t * tinySubMat;
+    // shared query profiles, NULL if every query profile is built
+    QueryProfileCache * profileCache;
     // set substituion matrix
     void setSubstitutionMatrix(BaseMatrix *m);
 
@@ -0,0 +1,76 @@
+#include "QueryProfileCache.h"
+#include "Sequence.h"
+#include "StripedSmithWaterman.h"
+#include "Debug.h"
+
+const size_t QueryProfileCache::DEFAULT_MEMORY;
+
+QueryProfileCache::QueryProfileCache(size_t maxMemory)
+        : maxMemory(maxMemory), usedMemory(0), hits(0), misses(0), evictions(0) {}
+
+bool QueryProfileCache::load(Sequence *query, const BaseMatrix *matrix, SmithWaterman *aligner) {
+    Key key;
+    key.dbKey = query->getDbKey();
+    key.matrix = matrix;
+    key.aaBiasCorrection = aligner->getAaBiasCorrection();
+    bool found = false;
+#pragma omp critical(QueryProfileCache)
+    {
+        std::map<Key, std::list<Entry>::iterator>::iterator it = index.find(key);
+        if (it != index.end() && it->second->queryLength == query->L) {
+            entries.splice(entries.begin(), entries, it->second);
+            aligner->loadProfile(it->second->profile.data());
+            found = true;
+            hits++;
+        } else {
+            misses++;
+        }
+    }
+    return found;
+}
+
+void QueryProfileCache::store(Sequence *query, const BaseMatrix *matrix, const SmithWaterman *aligner) {
+    const size_t size = aligner->getProfileSize();
+    if (size > maxMemory) {
+        return;
+    }
+    Entry entry;
+    entry.key.dbKey = query->getDbKey();
+    entry.key.matrix = matrix;
+    entry.key.aaBiasCorrection = aligner->getAaBiasCorrection();
+    entry.queryLength = query->L;
+    entry.profile.resize(size);
+    aligner->saveProfile(entry.profile.data());
+
+#pragma omp critical(QueryProfileCache)
+    {
+        // another thread might have stored the same query in the meantime
+        std::map<Key, std::list<Entry>::iterator>::iterator it = index.find(entry.key);
+        if (it != index.end()) {
+            usedMemory -= it->second->profile.size();
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        while (usedMemory + size > maxMemory && entries.empty() == false) {
+            usedMemory -= entries.back().profile.size();
+            index.erase(entries.back().key);
+            entries.pop_back();
+            evictions++;
+        }
+        entries.push_front(Entry());
+        entries.front().key = entry.key;
+        entries.front().queryLength = entry.queryLength;
+        entries.front().profile.swap(entry.profile);
+        index[entry.key] = entries.begin();
+        usedMemory += size;
+    }
+}
+
+void QueryProfileCache::printStatistics() const {
+    const size_t lookups = hits + misses;
+    if (lookups == 0) {
+        return;
+    }
+    Debug(Debug::INFO) << "Query profile cache: " << hits << " hits, " << misses << " misses (hit rate "
+                       << static_cast<int>(100.0 * hits / lookups + 0.5) << "%), " << evictions << " evictions\n";
+}
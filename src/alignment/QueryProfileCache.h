@@ -0,0 +1,65 @@
+#ifndef MMSEQS_QUERYPROFILECACHE_H
+#define MMSEQS_QUERYPROFILECACHE_H
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <vector>
+
+class BaseMatrix;
+class Sequence;
+class SmithWaterman;
+
+// Query profiles built by SmithWaterman::ssw_init, shared by the Matchers of all threads.
+// Tools that see the same query more than once (e.g. a sequence in several result sets) restore the profile
+// instead of building it again. Profiles are keyed by query key, matrix and composition bias correction, so a cache
+// must only be used for queries of one database. The least recently used profiles are dropped above maxMemory.
+class QueryProfileCache {
+public:
+    QueryProfileCache(size_t maxMemory = DEFAULT_MEMORY);
+
+    // restores the profile of query into aligner, returns false if it is not cached
+    bool load(Sequence *query, const BaseMatrix *matrix, SmithWaterman *aligner);
+    // adds the profile aligner built for query
+    void store(Sequence *query, const BaseMatrix *matrix, const SmithWaterman *aligner);
+
+    // writes the hit rate to the log if the cache was used
+    void printStatistics() const;
+
+    static const size_t DEFAULT_MEMORY = 256 * 1024 * 1024;
+
+private:
+    struct Key {
+        unsigned int dbKey;
+        const BaseMatrix *matrix;
+        bool aaBiasCorrection;
+
+        bool operator<(const Key &other) const {
+            if (dbKey != other.dbKey) {
+                return dbKey < other.dbKey;
+            }
+            if (matrix != other.matrix) {
+                return matrix < other.matrix;
+            }
+            return aaBiasCorrection < other.aaBiasCorrection;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        int queryLength;
+        std::vector<char> profile;
+    };
+
+    // most recently used entry first
+    std::list<Entry> entries;
+    std::map<Key, std::list<Entry>::iterator> index;
+    size_t maxMemory;
+    size_t usedMemory;
+
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+};
+
+#endif
@@ -30,21 +30,38 @@
 #include "SubstitutionMatrix.h"
 #include "Debug.h"
 
+#include <algorithm>
 #include <iostream>
 
+// binaries built for less than AVX2 carry AVX2 versions of the striped kernels, compiled with target
+// attributes, and use them if the CPU supports AVX2
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(AVX2) && !defined(NEON) && !defined(WASM) && !defined(__ALTIVEC__)
+#define SW_DISPATCH
+#include "CpuInfo.h"
+#include <immintrin.h>
+#endif
+
 SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCorrection) {
 	maxSequenceLength += 1;
 	this->aaBiasCorrection = aaBiasCorrection;
-	const int segSize = (maxSequenceLength+7)/8;
-	vHStore = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHLoad  = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vE      = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
-	vHmax   = (simd_int*) mem_align(ALIGN_INT, segSize * sizeof(simd_int));
+	useAVX2 = false;
+#ifdef SW_DISPATCH
+	CpuInfo info;
+	useAVX2 = info.HW_AVX2 && info.OS_AVX;
+#endif
+	byteLanes = useAVX2 ? 32 : VECSIZE_INT * 4;
+	const size_t alignment = useAVX2 ? 32 : ALIGN_INT;
+	// size in bytes, large enough for the word profile (byteLanes / 2 residues per vector)
+	const size_t segSize = ((maxSequenceLength+7)/8) * byteLanes;
+	vHStore = (simd_int*) mem_align(alignment, segSize);
+	vHLoad  = (simd_int*) mem_align(alignment, segSize);
+	vE      = (simd_int*) mem_align(alignment, segSize);
+	vHmax   = (simd_int*) mem_align(alignment, segSize);
 	profile = new s_profile();
-	profile->profile_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_rev_byte = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
-	profile->profile_rev_word = (simd_int*)mem_align(ALIGN_INT, aaSize * segSize * sizeof(simd_int));
+	profile->profile_byte = (simd_int*)mem_align(alignment, aaSize * segSize);
+	profile->profile_word = (simd_int*)mem_align(alignment, aaSize * segSize);
+	profile->profile_rev_byte = (simd_int*)mem_align(alignment, aaSize * segSize);
+	profile->profile_rev_word = (simd_int*)mem_align(alignment, aaSize * segSize);
 	profile->query_rev_sequence = new int8_t[maxSequenceLength];
 	profile->query_sequence     = new int8_t[maxSequenceLength];
 	profile->composition_bias   = new int8_t[maxSequenceLength];
@@ -54,9 +71,9 @@ SmithWaterman::SmithWaterman(size_t maxSequenceLength, int aaSize, bool aaBiasCo
 	profile->mat_rev            = new int8_t[maxSequenceLength * aaSize * 2];
 	profile->mat                = new int8_t[maxSequenceLength * aaSize * 2];
 	tmp_composition_bias   = new float[maxSequenceLength];
-	/* array to record the largest score of each reference position */
-	maxColumn = new uint8_t[maxSequenceLength*sizeof(uint16_t)];
-	memset(maxColumn, 0, maxSequenceLength*sizeof(uint16_t));
+	/* array to record the largest score of each reference position, wide enough for the 32 bit scores of sw_scalar_int */
+	maxColumn = new uint8_t[maxSequenceLength*sizeof(uint32_t)];
+	memset(maxColumn, 0, maxSequenceLength*sizeof(uint32_t));
 
 	memset(profile->query_sequence, 0, maxSequenceLength * sizeof(int8_t));
 	memset(profile->query_rev_sequence, 0, maxSequenceLength * sizeof(int8_t));
@@ -89,11 +106,13 @@ SmithWaterman::~SmithWaterman(){
 
 
 /* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
-template <typename T, size_t Elements, const unsigned int type>
+template <typename T, const unsigned int type>
 void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
 									   const int32_t query_length, const int32_t aaSize, uint8_t bias,
 									   const int32_t offset, const int32_t entryLength) {
 
+	// the striping depends on the vector width of the kernel picked at runtime
+	const int32_t Elements = byteLanes / sizeof(T);
 	const int32_t segLen = (query_length+Elements-1)/Elements;
 	T* t = (T*)profile;
 
@@ -103,7 +122,7 @@ void SmithWaterman::createQueryProfile(simd_int *profile, const int8_t *query_se
 		for (int32_t i = 0; i < segLen; i ++) {
 			int32_t  j = i;
 //			printf("(");
-			for (size_t segNum = 0; LIKELY(segNum < Elements) ; segNum ++) {
+			for (int32_t segNum = 0; LIKELY(segNum < Elements) ; segNum ++) {
 				// if will be optmized out by compiler
 				if(type == SUBSTITUTIONMATRIX) {     // substitution score for query_seq constrained by nt
 					// query_sequence starts from 1 to n
@@ -150,26 +169,49 @@ s_align SmithWaterman::ssw_align (
 	//	fprintf(stderr, "When maskLen < 15, the function ssw_align doesn't return 2nd best alignment information.\n");
 	//}
 
+    const bool isProfile = Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_HMM_PROFILE)
+                         || Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_PROFILE_STATE_PROFILE);
     std::pair<alignment_end, alignment_end> bests;
     std::pair<alignment_end, alignment_end> bests_reverse;
+    std::vector<int32_t> profileInt;
     // Find the alignment scores and ending positions
-	if (profile->profile_byte) {
-		bests = sw_sse2_byte(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_byte, -1, profile->bias, maskLen);
-
-		if (profile->profile_word && bests.first.score == 255) {
-			bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
+    // A kernel stops as soon as the next column could overflow its scores and the wider kernel continues from there,
+    // the score can increase by at most the largest profile entry per column.
+    striped_state state;
+    state.column = 0;
+	if (profile->score_size == 3) {
+		word = 2;
+	} else if (profile->profile_byte) {
+		// without word profile the byte kernel runs until it saturates
+		const int32_t escalate = profile->profile_word ? 255 - profile->byte_max : INT_MAX;
+		bests = sw_sse2_byte(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_byte, -1, profile->bias, maskLen,
+		                     escalate, &state);
+
+		if (state.column != db_length) {
+			bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen,
+			                     SHRT_MAX - profile->word_max, &state);
 			word = 1;
 		} else if (bests.first.score == 255) {
 			fprintf(stderr, "Please set 2 to the score_size parameter of the function ssw_init, otherwise the alignment results will be incorrect.\n");
 			EXIT(EXIT_FAILURE);
 		}
 	}else if (profile->profile_word) {
-		bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen);
+		bests = sw_sse2_word(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profile->profile_word, -1, maskLen,
+		                     SHRT_MAX - profile->word_max, &state);
 		word = 1;
 	}else {
 		fprintf(stderr, "Please call the function ssw_init before ssw_align.\n");
 		EXIT(EXIT_FAILURE);
 	}
+	if (word == 2 || (word == 1 && state.column != db_length)) {
+		if (isProfile) {
+			createLinearProfile<PROFILE>(profileInt, profile->query_sequence, NULL, profile->mat, query_length, profile->alphabetSize, 1, query_length);
+		} else {
+			createLinearProfile<SUBSTITUTIONMATRIX>(profileInt, profile->query_sequence, profile->composition_bias, profile->mat, query_length, profile->alphabetSize, 0, 0);
+		}
+		bests = sw_scalar_int(db_sequence, 0, db_length, query_length, gap_open, gap_extend, profileInt.data(), -1, maskLen, &state);
+		word = 2;
+	}
 	r.score1 = bests.first.score;
 	r.dbEndPos1 = bests.first.ref;
 	r.qEndPos1 = bests.first.read;
@@ -182,8 +224,6 @@ s_align SmithWaterman::ssw_align (
 		r.ref_end2 = -1;
 	}
 
-    const bool isProfile = Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_HMM_PROFILE)
-                         || Parameters::isEqualDbtype(profile->sequence_type, Parameters::DBTYPE_PROFILE_STATE_PROFILE);
     // no residue could be aligned
     if (r.dbEndPos1 == -1) {
         return r;
@@ -202,25 +242,35 @@ s_align SmithWaterman::ssw_align (
 	// Find the beginning position of the best alignment.
 	if (word == 0) {
 		if (isProfile) {
-			createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
+			createQueryProfile<int8_t, PROFILE>(profile->profile_rev_byte, profile->query_rev_sequence, NULL, profile->mat_rev,
 																 r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, profile->query_length);
 		} else {
-			createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_rev_byte, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
+			createQueryProfile<int8_t, SUBSTITUTIONMATRIX>(profile->profile_rev_byte, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
 																			r.qEndPos1 + 1, profile->alphabetSize, profile->bias, queryOffset, 0);
 		}
 		bests_reverse = sw_sse2_byte(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_byte,
-									 r.score1, profile->bias, maskLen);
-	} else {
+									 r.score1, profile->bias, maskLen, INT_MAX, NULL);
+	} else if (word == 1) {
 		if (isProfile) {
-			createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_rev_word, profile->query_rev_sequence, NULL, profile->mat_rev,
+			createQueryProfile<int16_t, PROFILE>(profile->profile_rev_word, profile->query_rev_sequence, NULL, profile->mat_rev,
 																  r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, profile->query_length);
 
 		} else {
-			createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_rev_word, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
+			createQueryProfile<int16_t, SUBSTITUTIONMATRIX>(profile->profile_rev_word, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
 																			 r.qEndPos1 + 1, profile->alphabetSize, 0, queryOffset, 0);
 		}
 		bests_reverse = sw_sse2_word(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profile->profile_rev_word,
-									 r.score1, maskLen);
+									 r.score1, maskLen, INT_MAX, NULL);
+	} else {
+		if (isProfile) {
+			createLinearProfile<PROFILE>(profileInt, profile->query_rev_sequence, NULL, profile->mat_rev,
+										 r.qEndPos1 + 1, profile->alphabetSize, queryOffset, profile->query_length);
+		} else {
+			createLinearProfile<SUBSTITUTIONMATRIX>(profileInt, profile->query_rev_sequence, profile->composition_bias_rev, profile->mat,
+													r.qEndPos1 + 1, profile->alphabetSize, queryOffset, 0);
+		}
+		bests_reverse = sw_scalar_int(db_sequence, 1, r.dbEndPos1 + 1, r.qEndPos1 + 1, gap_open, gap_extend, profileInt.data(),
+									  r.score1, maskLen, NULL);
 	}
 	if(bests_reverse.first.score != r.score1){
 		fprintf(stderr, "Score of forward/backward SW differ. This should not happen.\n");
@@ -298,6 +348,285 @@ uint32_t SmithWaterman::cigar_int_to_len (uint32_t cigar_int)
 	return res;
 }
 
+#ifdef SW_DISPATCH
+// AVX2 versions of sw_sse2_byte, sw_sse2_word and ungapped_alignment, see there for comments.
+// They only run the dynamic programming, the tracing of the end positions is shared with the default kernels.
+template <unsigned int N>
+__attribute__((target("avx2")))
+static inline __m256i shiftLeftAVX2(__m256i a) {
+	__m256i mask = _mm256_permute2x128_si256(a, a, _MM_SHUFFLE(0,0,3,0));
+	return _mm256_alignr_epi8(a, mask, 16 - N);
+}
+
+__attribute__((target("avx2")))
+static inline uint8_t hmax8AVX2(__m256i v) {
+	const __m128i m = _mm_max_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	const __m128i tmp1 = _mm_subs_epu8(_mm_set1_epi8((char)255), m);
+	const __m128i tmp2 = _mm_min_epu8(tmp1, _mm_srli_epi16(tmp1, 8));
+	const __m128i tmp3 = _mm_minpos_epu16(tmp2);
+	return (uint8_t)(255 - _mm_cvtsi128_si32(tmp3));
+}
+
+__attribute__((target("avx2")))
+static inline uint16_t hmax16AVX2(__m256i v) {
+	const __m128i m = _mm_max_epu16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	const __m128i tmp1 = _mm_subs_epu16(_mm_set1_epi16((short)65535), m);
+	const __m128i tmp3 = _mm_minpos_epu16(tmp1);
+	return (uint16_t)(65535 - _mm_cvtsi128_si32(tmp3));
+}
+
+__attribute__((target("avx2")))
+static uint8_t swByteAVX2(const unsigned char *db_sequence, int8_t ref_dir, int32_t db_length, int32_t segLen,
+                          const uint8_t gap_open, const uint8_t gap_extend, const void *query_profile_byte,
+                          uint8_t terminate, uint8_t bias, void *hStore, void *hLoad, void *eBuffer, void *hMax,
+                          uint8_t *maxColumn, int32_t *end_db, int32_t escalate, int32_t *resume) {
+	const __m256i vZero = _mm256_setzero_si256();
+	const __m256i vGapO = _mm256_set1_epi8(gap_open);
+	const __m256i vGapE = _mm256_set1_epi8(gap_extend);
+	const __m256i vBias = _mm256_set1_epi8(bias);
+	const __m256i *profile = (const __m256i *) query_profile_byte;
+	__m256i *pvHStore = (__m256i *) hStore;
+	__m256i *pvHLoad = (__m256i *) hLoad;
+	__m256i *pvE = (__m256i *) eBuffer;
+	__m256i *pvHmax = (__m256i *) hMax;
+
+	uint8_t max = 0;
+	__m256i vMaxScore = vZero;
+	__m256i vMaxMark = vZero;
+	__m256i vTemp;
+	int32_t begin = 0, end = db_length, step = 1;
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+	for (int32_t i = begin; LIKELY(i != end); i += step) {
+		__m256i e, vF = vZero, vMaxColumn = vZero;
+		__m256i vH = _mm256_load_si256(pvHStore + segLen - 1);
+		vH = shiftLeftAVX2<1>(vH);
+		const __m256i *vP = profile + db_sequence[i] * segLen;
+
+		__m256i *pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		int32_t j;
+		for (j = 0; LIKELY(j < segLen); ++j) {
+			vH = _mm256_adds_epu8(vH, _mm256_load_si256(vP + j));
+			vH = _mm256_subs_epu8(vH, vBias);
+			e = _mm256_load_si256(pvE + j);
+			vH = _mm256_max_epu8(vH, e);
+			vH = _mm256_max_epu8(vH, vF);
+			vMaxColumn = _mm256_max_epu8(vMaxColumn, vH);
+			_mm256_store_si256(pvHStore + j, vH);
+
+			vH = _mm256_subs_epu8(vH, vGapO);
+			e = _mm256_subs_epu8(e, vGapE);
+			e = _mm256_max_epu8(e, vH);
+			_mm256_store_si256(pvE + j, e);
+
+			vF = _mm256_subs_epu8(vF, vGapE);
+			vF = _mm256_max_epu8(vF, vH);
+
+			vH = _mm256_load_si256(pvHLoad + j);
+		}
+
+		j = 0;
+		vH = _mm256_load_si256(pvHStore + j);
+		vF = shiftLeftAVX2<1>(vF);
+		vTemp = _mm256_subs_epu8(vH, vGapO);
+		vTemp = _mm256_subs_epu8(vF, vTemp);
+		vTemp = _mm256_cmpeq_epi8(vTemp, vZero);
+		uint32_t cmp = _mm256_movemask_epi8(vTemp);
+		while (cmp != 0xffffffff) {
+			vH = _mm256_max_epu8(vH, vF);
+			vMaxColumn = _mm256_max_epu8(vMaxColumn, vH);
+			_mm256_store_si256(pvHStore + j, vH);
+			vF = _mm256_subs_epu8(vF, vGapE);
+			j++;
+			if (j >= segLen) {
+				j = 0;
+				vF = shiftLeftAVX2<1>(vF);
+			}
+			vH = _mm256_load_si256(pvHStore + j);
+
+			vTemp = _mm256_subs_epu8(vH, vGapO);
+			vTemp = _mm256_subs_epu8(vF, vTemp);
+			vTemp = _mm256_cmpeq_epi8(vTemp, vZero);
+			cmp = _mm256_movemask_epi8(vTemp);
+		}
+
+		vMaxScore = _mm256_max_epu8(vMaxScore, vMaxColumn);
+		vTemp = _mm256_cmpeq_epi8(vMaxMark, vMaxScore);
+		cmp = _mm256_movemask_epi8(vTemp);
+		if (cmp != 0xffffffff) {
+			vMaxMark = vMaxScore;
+			const uint8_t temp = hmax8AVX2(vMaxScore);
+			if (LIKELY(temp > max)) {
+				max = temp;
+				if (max + bias >= 255) break;	//overflow
+				*end_db = i;
+				for (j = 0; LIKELY(j < segLen); ++j) _mm256_store_si256(pvHmax + j, _mm256_load_si256(pvHStore + j));
+			}
+		}
+
+		maxColumn[i] = hmax8AVX2(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+		if (maxColumn[i] >= escalate) {
+			*resume = i + step;
+			if (pvHStore != (__m256i *) hStore) memcpy(hStore, pvHStore, segLen * sizeof(__m256i));
+			break;
+		}
+	}
+	return max;
+}
+
+__attribute__((target("avx2")))
+static uint16_t swWordAVX2(const unsigned char *db_sequence, int8_t ref_dir, int32_t db_length, int32_t segLen,
+                           const uint8_t gap_open, const uint8_t gap_extend, const void *query_profile_word,
+                           uint16_t terminate, void *hStore, void *hLoad, void *eBuffer, void *hMax,
+                           uint16_t *maxColumn, int32_t *end_ref, int32_t begin, uint16_t max, int32_t escalate, int32_t *resume) {
+	const int32_t SIMD_SIZE = 16;
+	const __m256i vZero = _mm256_setzero_si256();
+	const __m256i vGapO = _mm256_set1_epi16(gap_open);
+	const __m256i vGapE = _mm256_set1_epi16(gap_extend);
+	const __m256i *profile = (const __m256i *) query_profile_word;
+	__m256i *pvHStore = (__m256i *) hStore;
+	__m256i *pvHLoad = (__m256i *) hLoad;
+	__m256i *pvE = (__m256i *) eBuffer;
+	__m256i *pvHmax = (__m256i *) hMax;
+
+	__m256i vMaxScore = _mm256_set1_epi16(max);
+	__m256i vMaxMark = vMaxScore;
+	int32_t end = db_length, step = 1;
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+	for (int32_t i = begin; LIKELY(i != end); i += step) {
+		__m256i e, vF = vZero, vMaxColumn = vZero;
+		__m256i vH = _mm256_load_si256(pvHStore + segLen - 1);
+		vH = shiftLeftAVX2<2>(vH);
+		const __m256i *vP = profile + db_sequence[i] * segLen;
+
+		__m256i *pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		int32_t j;
+		for (j = 0; LIKELY(j < segLen); j++) {
+			vH = _mm256_adds_epi16(vH, _mm256_load_si256(vP + j));
+			e = _mm256_load_si256(pvE + j);
+			vH = _mm256_max_epi16(vH, e);
+			vH = _mm256_max_epi16(vH, vF);
+			vMaxColumn = _mm256_max_epi16(vMaxColumn, vH);
+			_mm256_store_si256(pvHStore + j, vH);
+
+			vH = _mm256_subs_epu16(vH, vGapO);
+			e = _mm256_subs_epu16(e, vGapE);
+			e = _mm256_max_epi16(e, vH);
+			_mm256_store_si256(pvE + j, e);
+
+			vF = _mm256_subs_epu16(vF, vGapE);
+			vF = _mm256_max_epi16(vF, vH);
+
+			vH = _mm256_load_si256(pvHLoad + j);
+		}
+
+		for (int32_t k = 0; LIKELY(k < SIMD_SIZE); ++k) {
+			vF = shiftLeftAVX2<2>(vF);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = _mm256_load_si256(pvHStore + j);
+				vH = _mm256_max_epi16(vH, vF);
+				vMaxColumn = _mm256_max_epi16(vMaxColumn, vH);
+				_mm256_store_si256(pvHStore + j, vH);
+				vH = _mm256_subs_epu16(vH, vGapO);
+				vF = _mm256_subs_epu16(vF, vGapE);
+				if (UNLIKELY(!_mm256_movemask_epi8(_mm256_cmpgt_epi16(vF, vH)))) goto end;
+			}
+		}
+
+		end:
+		vMaxScore = _mm256_max_epi16(vMaxScore, vMaxColumn);
+		const uint32_t cmp = _mm256_movemask_epi8(_mm256_cmpeq_epi16(vMaxMark, vMaxScore));
+		if (cmp != 0xffffffff) {
+			vMaxMark = vMaxScore;
+			const uint16_t temp = hmax16AVX2(vMaxScore);
+			if (LIKELY(temp > max)) {
+				max = temp;
+				*end_ref = i;
+				for (j = 0; LIKELY(j < segLen); ++j) _mm256_store_si256(pvHmax + j, _mm256_load_si256(pvHStore + j));
+			}
+		}
+
+		maxColumn[i] = hmax16AVX2(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+		if (maxColumn[i] >= escalate) {
+			*resume = i + step;
+			if (pvHStore != (__m256i *) hStore) memcpy(hStore, pvHStore, segLen * sizeof(__m256i));
+			break;
+		}
+	}
+	return max;
+}
+
+__attribute__((target("avx2")))
+static int ungappedAVX2(const unsigned char *db_sequence, int32_t db_length, int32_t query_length,
+                        const void *query_profile_byte, uint8_t bias, void *hStore, void *hLoad) {
+	const int32_t W = (query_length + 31) / 32;
+	const __m256i *profile = (const __m256i *) query_profile_byte;
+	const __m256i Soffset = _mm256_set1_epi8(bias);
+	__m256i Smax = _mm256_setzero_si256();
+	__m256i *s_curr = (__m256i *) hStore;
+	__m256i *s_prev = (__m256i *) hLoad;
+	memset(s_curr, 0, W * sizeof(__m256i));
+	memset(s_prev, 0, W * sizeof(__m256i));
+
+	for (int32_t j = 0; j < db_length; ++j) {
+		const __m256i *qji = profile + db_sequence[j] * W;
+		__m256i S = _mm256_load_si256(s_curr + W - 1);
+		S = shiftLeftAVX2<1>(S);
+		__m256i *p = s_prev;
+		s_prev = s_curr;
+		s_curr = p;
+		for (int32_t i = 0; i < W; ++i) {
+			S = _mm256_adds_epu8(S, _mm256_load_si256(qji + i));
+			S = _mm256_subs_epu8(S, Soffset);
+			_mm256_store_si256(s_curr + i, S);
+			Smax = _mm256_max_epu8(Smax, S);
+			S = _mm256_load_si256(s_prev + i);
+		}
+	}
+	return hmax8AVX2(Smax);
+}
+#endif
+
+/* Rearrange the scores of one striped column with inElements lanes of type S into a column with outElements
+   lanes of the wider type T. Positions past the query end are set to 0, outElements 1 gives a linear column. */
+template <typename S, typename T>
+static void widenStripedColumn(const void *in, void *out, int32_t query_length, int32_t inElements, int32_t outElements) {
+	const int32_t inSegLen = (query_length + inElements - 1) / inElements;
+	const int32_t outSegLen = (query_length + outElements - 1) / outElements;
+	const S *s = (const S *) in;
+	T *t = (T *) out;
+	memset(out, 0, outSegLen * outElements * sizeof(T));
+	for (int32_t q = 0; q < query_length; ++q) {
+		t[(q % outSegLen) * outElements + q / outSegLen] = s[(q % inSegLen) * inElements + q / inSegLen];
+	}
+}
+
+/* Widen the column maxima in place, from the back so that no entry is overwritten before it is read. */
+template <typename S, typename T>
+static void widenMaxColumn(uint8_t *maxColumn, int32_t db_length) {
+	const S *s = (const S *) maxColumn;
+	T *t = (T *) maxColumn;
+	for (int32_t i = db_length - 1; i >= 0; --i) {
+		const T value = s[i];
+		t[i] = value;
+	}
+}
+
 std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWaterman::sw_sse2_byte (const unsigned char* db_sequence,
 														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
 														   int32_t db_length,
@@ -310,176 +639,203 @@ std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWater
                                                          alignment beginning point. If this score
                                                          is set to 0, it will not be used */
 														   uint8_t bias,  /* Shift 0 point to a positive value. */
-														   int32_t maskLen) {
+														   int32_t maskLen,
+														   int32_t escalate,
+														   striped_state *state) {
 #define max16(m, vm) ((m) = simdi8_hmax((vm)));
 
 	uint8_t max = 0;		                     /* the max alignment score */
 	int32_t end_query = query_length - 1;
 	int32_t end_db = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
-	const int SIMD_SIZE = VECSIZE_INT * 4;
+	const int SIMD_SIZE = byteLanes;
 	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
 	/* array to record the largest score of each reference position */
 	memset(this->maxColumn, 0, db_length * sizeof(uint8_t));
 	uint8_t * maxColumn = (uint8_t *) this->maxColumn;
 
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
 	simd_int* pvHStore = vHStore;
 	simd_int* pvHLoad = vHLoad;
 	simd_int* pvE = vE;
 	simd_int* pvHmax = vHmax;
-	memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0,segLen*sizeof(simd_int));
-	memset(pvE,0,segLen*sizeof(simd_int));
-	memset(pvHmax,0,segLen*sizeof(simd_int));
-
-	int32_t i, j;
-	/* 16 byte insertion begin vector */
-	simd_int vGapO = simdi8_set(gap_open);
-
-	/* 16 byte insertion extension vector */
-	simd_int vGapE = simdi8_set(gap_extend);
-
-	/* 16 byte bias vector */
-	simd_int vBias = simdi8_set(bias);
-
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
-	//	int32_t distance = query_length * 2 / 3;
-	//	int32_t distance = query_length / 2;
-	//	int32_t distance = query_length;
-
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-	for (i = begin; LIKELY(i != end); i += step) {
-		simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
-                                                    Any errors to vH values will be corrected in the Lazy_F loop.
-                                                    */
-		//		max16(maxColumn[i], vMaxColumn);
-		//		fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
-
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
-		const simd_int* vP = query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-		//	int8_t* t;
-		//	int32_t ti;
-		//        fprintf(stderr, "i: %d of %d:\t ", i,segLen);
-		//for (t = (int8_t*)vP, ti = 0; ti < segLen; ++ti) fprintf(stderr, "%d\t", *t++);
-		//fprintf(stderr, "\n");
-
-		/* Swap the 2 H buffers. */
-		simd_int* pv = pvHLoad;
-		pvHLoad = pvHStore;
-		pvHStore = pv;
-
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); ++j) {
-			vH = simdui8_adds(vH, simdi_load(vP + j));
-			vH = simdui8_subs(vH, vBias); /* vH will be always > 0 */
-			//	max16(maxColumn[i], vH);
-			//	fprintf(stderr, "H[%d]: %d\n", i, maxColumn[i]);
+	memset(pvHStore,0,segLen*SIMD_SIZE);
+	memset(pvHLoad,0,segLen*SIMD_SIZE);
+	memset(pvE,0,segLen*SIMD_SIZE);
+	memset(pvHmax,0,segLen*SIMD_SIZE);
+
+	int32_t i, j, edge;
+	int32_t resume = db_length;
+#ifdef SW_DISPATCH
+	if (useAVX2) {
+		max = swByteAVX2(db_sequence, ref_dir, db_length, segLen, gap_open, gap_extend, query_profile_byte, terminate, bias,
+		                 pvHStore, pvHLoad, pvE, pvHmax, maxColumn, &end_db, escalate, &resume);
+	} else
+#endif
+	{
+		/* Define 16 byte 0 vector. */
+		simd_int vZero = simdi32_set(0);
+
+		/* 16 byte insertion begin vector */
+		simd_int vGapO = simdi8_set(gap_open);
+
+		/* 16 byte insertion extension vector */
+		simd_int vGapE = simdi8_set(gap_extend);
+
+		/* 16 byte bias vector */
+		simd_int vBias = simdi8_set(bias);
+
+		simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+		simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
+		simd_int vTemp;
+		int32_t begin = 0, end = db_length, step = 1;
+		//	int32_t distance = query_length * 2 / 3;
+		//	int32_t distance = query_length / 2;
+		//	int32_t distance = query_length;
+
+		/* outer loop to process the reference sequence */
+		if (ref_dir == 1) {
+			begin = db_length - 1;
+			end = -1;
+			step = -1;
+		}
+		for (i = begin; LIKELY(i != end); i += step) {
+			simd_int e, vF = vZero, vMaxColumn = vZero; /* Initialize F value to 0.
+	                                                    Any errors to vH values will be corrected in the Lazy_F loop.
+	                                                    */
+			//		max16(maxColumn[i], vMaxColumn);
+			//		fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
+
+			simd_int vH = pvHStore[segLen - 1];
+			vH = simdi8_shiftl (vH, 1); /* Shift the 128-bit value in vH left by 1 byte. */
+			const simd_int* vP = query_profile_byte + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
 			//	int8_t* t;
 			//	int32_t ti;
-			//for (t = (int8_t*)&vH, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
+			//        fprintf(stderr, "i: %d of %d:\t ", i,segLen);
+			//for (t = (int8_t*)vP, ti = 0; ti < segLen; ++ti) fprintf(stderr, "%d\t", *t++);
+			//fprintf(stderr, "\n");
 
-			/* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-			vH = simdui8_max(vH, e);
-			vH = simdui8_max(vH, vF);
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
+			/* Swap the 2 H buffers. */
+			simd_int* pv = pvHLoad;
+			pvHLoad = pvHStore;
+			pvHStore = pv;
 
-			//	max16(maxColumn[i], vMaxColumn);
-			//	fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
-			//	for (t = (int8_t*)&vMaxColumn, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
+			/* inner loop to process the query sequence */
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = simdui8_adds(vH, simdi_load(vP + j));
+				vH = simdui8_subs(vH, vBias); /* vH will be always > 0 */
+				//	max16(maxColumn[i], vH);
+				//	fprintf(stderr, "H[%d]: %d\n", i, maxColumn[i]);
+				//	int8_t* t;
+				//	int32_t ti;
+				//for (t = (int8_t*)&vH, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
+
+				/* Get max from vH, vE and vF. */
+				e = simdi_load(pvE + j);
+				vH = simdui8_max(vH, e);
+				vH = simdui8_max(vH, vF);
+				vMaxColumn = simdui8_max(vMaxColumn, vH);
+
+				//	max16(maxColumn[i], vMaxColumn);
+				//	fprintf(stderr, "middle[%d]: %d\n", i, maxColumn[i]);
+				//	for (t = (int8_t*)&vMaxColumn, ti = 0; ti < 16; ++ti) fprintf(stderr, "%d\t", *t++);
+
+				/* Save vH values. */
+				simdi_store(pvHStore + j, vH);
 
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
+				/* Update vE value. */
+				vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+				e = simdui8_subs(e, vGapE);
+				e = simdui8_max(e, vH);
+				simdi_store(pvE + j, e);
 
-			/* Update vE value. */
-			vH = simdui8_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-			e = simdui8_subs(e, vGapE);
-			e = simdui8_max(e, vH);
-			simdi_store(pvE + j, e);
+				/* Update vF value. */
+				vF = simdui8_subs(vF, vGapE);
+				vF = simdui8_max(vF, vH);
 
-			/* Update vF value. */
-			vF = simdui8_subs(vF, vGapE);
-			vF = simdui8_max(vF, vH);
+				/* Load the next vH. */
+				vH = simdi_load(pvHLoad + j);
+			}
 
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-		}
+			/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+			/* reset pointers to the start of the saved data */
+			j = 0;
+			vH = simdi_load (pvHStore + j);
 
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		/* reset pointers to the start of the saved data */
-		j = 0;
-		vH = simdi_load (pvHStore + j);
-
-		/*  the computed vF value is for the given column.  since */
-		/*  we are at the end, we need to shift the vF value over */
-		/*  to the next column. */
-		vF = simdi8_shiftl (vF, 1);
-		vTemp = simdui8_subs (vH, vGapO);
-		vTemp = simdui8_subs (vF, vTemp);
-		vTemp = simdi8_eq (vTemp, vZero);
-		uint32_t cmp = simdi8_movemask (vTemp);
+			/*  the computed vF value is for the given column.  since */
+			/*  we are at the end, we need to shift the vF value over */
+			/*  to the next column. */
+			vF = simdi8_shiftl (vF, 1);
+			vTemp = simdui8_subs (vH, vGapO);
+			vTemp = simdui8_subs (vF, vTemp);
+			vTemp = simdi8_eq (vTemp, vZero);
+			uint32_t cmp = simdi8_movemask (vTemp);
 #ifdef AVX2
-		while (cmp != 0xffffffff)
+			while (cmp != 0xffffffff)
 #else
-		while (cmp != 0xffff)
+			while (cmp != 0xffff)
 #endif
-		{
-			vH = simdui8_max (vH, vF);
-			vMaxColumn = simdui8_max(vMaxColumn, vH);
-			simdi_store (pvHStore + j, vH);
-			vF = simdui8_subs (vF, vGapE);
-			j++;
-			if (j >= segLen)
 			{
-				j = 0;
-				vF = simdi8_shiftl (vF, 1);
-			}
-			vH = simdi_load (pvHStore + j);
+				vH = simdui8_max (vH, vF);
+				vMaxColumn = simdui8_max(vMaxColumn, vH);
+				simdi_store (pvHStore + j, vH);
+				vF = simdui8_subs (vF, vGapE);
+				j++;
+				if (j >= segLen)
+				{
+					j = 0;
+					vF = simdi8_shiftl (vF, 1);
+				}
+				vH = simdi_load (pvHStore + j);
 
-			vTemp = simdui8_subs (vH, vGapO);
-			vTemp = simdui8_subs (vF, vTemp);
-			vTemp = simdi8_eq (vTemp, vZero);
-			cmp  = simdi8_movemask (vTemp);
-		}
+				vTemp = simdui8_subs (vH, vGapO);
+				vTemp = simdui8_subs (vF, vTemp);
+				vTemp = simdi8_eq (vTemp, vZero);
+				cmp  = simdi8_movemask (vTemp);
+			}
 
-		vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
-		vTemp = simdi8_eq(vMaxMark, vMaxScore);
-		cmp = simdi8_movemask(vTemp);
+			vMaxScore = simdui8_max(vMaxScore, vMaxColumn);
+			vTemp = simdi8_eq(vMaxMark, vMaxScore);
+			cmp = simdi8_movemask(vTemp);
 #ifdef AVX2
-		if (cmp != 0xffffffff)
+			if (cmp != 0xffffffff)
 #else
-		if (cmp != 0xffff)
+			if (cmp != 0xffff)
 #endif
-		{
-			uint8_t temp;
-			vMaxMark = vMaxScore;
-			max16(temp, vMaxScore);
-			vMaxScore = vMaxMark;
-
-			if (LIKELY(temp > max)) {
-				max = temp;
-				if (max + bias >= 255) break;	//overflow
-				end_db = i;
+			{
+				uint8_t temp;
+				vMaxMark = vMaxScore;
+				max16(temp, vMaxScore);
+				vMaxScore = vMaxMark;
+
+				if (LIKELY(temp > max)) {
+					max = temp;
+					if (max + bias >= 255) break;	//overflow
+					end_db = i;
+
+					/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
+					for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+				}
+			}
 
-				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			/* Record the max score of current column. */
+			max16(maxColumn[i], vMaxColumn);
+			//		fprintf(stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
+			if (maxColumn[i] == terminate) break;
+			/* The next column could saturate, continue with the word kernel. */
+			if (maxColumn[i] >= escalate) {
+				resume = i + step;
+				if (pvHStore != vHStore) memcpy(vHStore, pvHStore, segLen * SIMD_SIZE);
+				break;
 			}
 		}
+	}
 
-		/* Record the max score of current column. */
-		max16(maxColumn[i], vMaxColumn);
-		//		fprintf(stderr, "maxColumn[%d]: %d\n", i, maxColumn[i]);
-		if (maxColumn[i] == terminate) break;
+	if (state != NULL) {
+		state->column = resume;
+		state->max = max;
+		state->end_db = end_db;
+	}
+	if (resume != db_length) {
+		return std::make_pair(alignment_end(), alignment_end());
 	}
 
 	/* Trace the alignment ending position on read. */
@@ -534,130 +890,173 @@ std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWater
 														   const uint8_t gap_extend, /* will be used as - */
 														   const simd_int*query_profile_word,
 														   uint16_t terminate,
-														   int32_t maskLen) {
+														   int32_t maskLen,
+														   int32_t escalate,
+														   striped_state *state) {
 
 #define max8(m, vm) ((m) = simdi16_hmax((vm)));
 
 	uint16_t max = 0;		                     /* the max alignment score */
 	int32_t end_read = query_length - 1;
 	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
-	const unsigned int SIMD_SIZE = VECSIZE_INT * 2;
+	const unsigned int SIMD_SIZE = byteLanes / 2;
 	int32_t segLen = (query_length + SIMD_SIZE-1) / SIMD_SIZE; /* number of segment */
 	/* array to record the alignment read ending position of the largest score of each reference position */
-	memset(this->maxColumn, 0, db_length * sizeof(uint16_t));
 	uint16_t * maxColumn = (uint16_t *) this->maxColumn;
 
-	/* Define 16 byte 0 vector. */
-	simd_int vZero = simdi32_set(0);
+	int32_t begin = 0;
+	if (state != NULL && state->column > 0) {
+		/* Continue the byte kernel, its scores are exact since it stopped before any saturation. */
+		begin = state->column;
+		max = state->max;
+		end_ref = state->end_db;
+		widenStripedColumn<uint8_t, int16_t>(vHStore, vHLoad, query_length, byteLanes, SIMD_SIZE);
+		std::swap(vHStore, vHLoad);
+		widenStripedColumn<uint8_t, int16_t>(vE, vHLoad, query_length, byteLanes, SIMD_SIZE);
+		std::swap(vE, vHLoad);
+		widenStripedColumn<uint8_t, int16_t>(vHmax, vHLoad, query_length, byteLanes, SIMD_SIZE);
+		std::swap(vHmax, vHLoad);
+		widenMaxColumn<uint8_t, uint16_t>(this->maxColumn, db_length);
+	} else {
+		memset(this->maxColumn, 0, db_length * sizeof(uint16_t));
+		memset(vHStore,0,segLen*byteLanes);
+		memset(vE,0,     segLen*byteLanes);
+		memset(vHmax,0,  segLen*byteLanes);
+	}
+	memset(vHLoad,0, segLen*byteLanes);
+
 	simd_int* pvHStore = vHStore;
 	simd_int* pvHLoad = vHLoad;
 	simd_int* pvE = vE;
 	simd_int* pvHmax = vHmax;
-	memset(pvHStore,0,segLen*sizeof(simd_int));
-	memset(pvHLoad,0, segLen*sizeof(simd_int));
-	memset(pvE,0,     segLen*sizeof(simd_int));
-	memset(pvHmax,0,  segLen*sizeof(simd_int));
 
-	int32_t i, j, k;
-	/* 16 byte insertion begin vector */
-	simd_int vGapO = simdi16_set(gap_open);
+	int32_t i, j, edge;
+	int32_t resume = db_length;
+#ifdef SW_DISPATCH
+	if (useAVX2) {
+		max = swWordAVX2(db_sequence, ref_dir, db_length, segLen, gap_open, gap_extend, query_profile_word, terminate,
+		                 pvHStore, pvHLoad, pvE, pvHmax, maxColumn, &end_ref, begin, max, escalate, &resume);
+	} else
+#endif
+	{
+		/* Define 16 byte 0 vector. */
+		simd_int vZero = simdi32_set(0);
 
-	/* 16 byte insertion extension vector */
-	simd_int vGapE = simdi16_set(gap_extend);
+		/* 16 byte insertion begin vector */
+		simd_int vGapO = simdi16_set(gap_open);
 
-	simd_int vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
-	simd_int vMaxMark = vZero; /* Trace the highest score till the previous column. */
-	simd_int vTemp;
-	int32_t edge, begin = 0, end = db_length, step = 1;
+		/* 16 byte insertion extension vector */
+		simd_int vGapE = simdi16_set(gap_extend);
 
-	/* outer loop to process the reference sequence */
-	if (ref_dir == 1) {
-		begin = db_length - 1;
-		end = -1;
-		step = -1;
-	}
-	for (i = begin; LIKELY(i != end); i += step) {
-		simd_int e, vF = vZero; /* Initialize F value to 0.
-                                Any errors to vH values will be corrected in the Lazy_F loop.
-                                */
-		simd_int vH = pvHStore[segLen - 1];
-		vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
+		simd_int vMaxScore = simdi16_set(max); /* Trace the highest score of the whole SW matrix. */
+		simd_int vMaxMark = vMaxScore; /* Trace the highest score till the previous column. */
+		simd_int vTemp;
+		int32_t k, end = db_length, step = 1;
 
-		/* Swap the 2 H buffers. */
-		simd_int* pv = pvHLoad;
+		/* outer loop to process the reference sequence */
+		if (ref_dir == 1) {
+			begin = db_length - 1;
+			end = -1;
+			step = -1;
+		}
+		for (i = begin; LIKELY(i != end); i += step) {
+			simd_int e, vF = vZero; /* Initialize F value to 0.
+	                                Any errors to vH values will be corrected in the Lazy_F loop.
+	                                */
+			simd_int vH = pvHStore[segLen - 1];
+			vH = simdi8_shiftl (vH, 2); /* Shift the 128-bit value in vH left by 2 byte. */
 
-		simd_int vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
+			/* Swap the 2 H buffers. */
+			simd_int* pv = pvHLoad;
 
-		const simd_int* vP = query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
-		pvHLoad = pvHStore;
-		pvHStore = pv;
+			simd_int vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
 
-		/* inner loop to process the query sequence */
-		for (j = 0; LIKELY(j < segLen); j ++) {
-			vH = simdi16_adds(vH, simdi_load(vP + j));
+			const simd_int* vP = query_profile_word + db_sequence[i] * segLen; /* Right part of the query_profile_byte */
+			pvHLoad = pvHStore;
+			pvHStore = pv;
 
-			/* Get max from vH, vE and vF. */
-			e = simdi_load(pvE + j);
-			vH = simdi16_max(vH, e);
-			vH = simdi16_max(vH, vF);
-			vMaxColumn = simdi16_max(vMaxColumn, vH);
+			/* inner loop to process the query sequence */
+			for (j = 0; LIKELY(j < segLen); j ++) {
+				vH = simdi16_adds(vH, simdi_load(vP + j));
 
-			/* Save vH values. */
-			simdi_store(pvHStore + j, vH);
+				/* Get max from vH, vE and vF. */
+				e = simdi_load(pvE + j);
+				vH = simdi16_max(vH, e);
+				vH = simdi16_max(vH, vF);
+				vMaxColumn = simdi16_max(vMaxColumn, vH);
 
-			/* Update vE value. */
-			vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
-			e = simdui16_subs(e, vGapE);
-			e = simdi16_max(e, vH);
-			simdi_store(pvE + j, e);
+				/* Save vH values. */
+				simdi_store(pvHStore + j, vH);
 
-			/* Update vF value. */
-			vF = simdui16_subs(vF, vGapE);
-			vF = simdi16_max(vF, vH);
+				/* Update vE value. */
+				vH = simdui16_subs(vH, vGapO); /* saturation arithmetic, result >= 0 */
+				e = simdui16_subs(e, vGapE);
+				e = simdi16_max(e, vH);
+				simdi_store(pvE + j, e);
 
-			/* Load the next vH. */
-			vH = simdi_load(pvHLoad + j);
-		}
-
-		/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
-		for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
-			vF = simdi8_shiftl (vF, 2);
-			for (j = 0; LIKELY(j < segLen); ++j) {
-				vH = simdi_load(pvHStore + j);
-				vH = simdi16_max(vH, vF);
-				vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
-				simdi_store(pvHStore + j, vH);
-				vH = simdui16_subs(vH, vGapO);
+				/* Update vF value. */
 				vF = simdui16_subs(vF, vGapE);
-				if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
+				vF = simdi16_max(vF, vH);
+
+				/* Load the next vH. */
+				vH = simdi_load(pvHLoad + j);
 			}
-		}
 
-		end:
-		vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
-		vTemp = simdi16_eq(vMaxMark, vMaxScore);
-		int32_t cmp = simdi8_movemask(vTemp);
+			/* Lazy_F loop: has been revised to disallow adjecent insertion and then deletion, so don't update E(i, j), learn from SWPS3 */
+			for (k = 0; LIKELY(k < (int32_t) SIMD_SIZE); ++k) {
+				vF = simdi8_shiftl (vF, 2);
+				for (j = 0; LIKELY(j < segLen); ++j) {
+					vH = simdi_load(pvHStore + j);
+					vH = simdi16_max(vH, vF);
+					vMaxColumn = simdi16_max(vMaxColumn, vH); //newly added line
+					simdi_store(pvHStore + j, vH);
+					vH = simdui16_subs(vH, vGapO);
+					vF = simdui16_subs(vF, vGapE);
+					if (UNLIKELY(! simdi8_movemask(simdi16_gt(vF, vH)))) goto end;
+				}
+			}
+
+			end:
+			vMaxScore = simdi16_max(vMaxScore, vMaxColumn);
+			vTemp = simdi16_eq(vMaxMark, vMaxScore);
+			int32_t cmp = simdi8_movemask(vTemp);
 #ifdef AVX2
-		if (cmp != (int32_t)0xffffffff)
+			if (cmp != (int32_t)0xffffffff)
 #else
-		if (cmp != 0xffff)
+			if (cmp != 0xffff)
 #endif
-		{
-			uint16_t temp;
-			vMaxMark = vMaxScore;
-			max8(temp, vMaxScore);
-			vMaxScore = vMaxMark;
+			{
+				uint16_t temp;
+				vMaxMark = vMaxScore;
+				max8(temp, vMaxScore);
+				vMaxScore = vMaxMark;
+
+				if (LIKELY(temp > max)) {
+					max = temp;
+					end_ref = i;
+					for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+				}
+			}
 
-			if (LIKELY(temp > max)) {
-				max = temp;
-				end_ref = i;
-				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			/* Record the max score of current column. */
+			max8(maxColumn[i], vMaxColumn);
+			if (maxColumn[i] == terminate) break;
+			/* The next column could saturate, continue with 32 bit scores. */
+			if (maxColumn[i] >= escalate) {
+				resume = i + step;
+				if (pvHStore != vHStore) memcpy(vHStore, pvHStore, segLen * byteLanes);
+				break;
 			}
 		}
+	}
 
-		/* Record the max score of current column. */
-		max8(maxColumn[i], vMaxColumn);
-		if (maxColumn[i] == terminate) break;
+	if (state != NULL) {
+		state->column = resume;
+		state->max = max;
+		state->end_db = end_ref;
+	}
+	if (resume != db_length) {
+		return std::make_pair(alignment_end(), alignment_end());
 	}
 
 	/* Trace the alignment ending position on read. */
@@ -701,12 +1100,140 @@ std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWater
 #undef max8
 }
 
+std::pair<SmithWaterman::alignment_end, SmithWaterman::alignment_end> SmithWaterman::sw_scalar_int (const unsigned char* db_sequence,
+														   int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+														   int32_t db_length,
+														   int32_t query_length,
+														   const uint8_t gap_open,
+														   const uint8_t gap_extend,
+														   const int32_t *query_profile,
+														   uint32_t terminate,
+														   int32_t maskLen,
+														   striped_state *state) {
+	uint32_t max = 0;
+	int32_t end_read = query_length - 1;
+	int32_t end_ref = 0;
+	uint32_t *maxColumn = (uint32_t *) this->maxColumn;
+	std::vector<int32_t> vH(query_length, 0);
+	std::vector<int32_t> vE(query_length, 0);
+	/* segment length of the striped word layout of the query */
+	const int32_t segLen = (query_length + byteLanes / 2 - 1) / (byteLanes / 2);
+
+	int32_t i, begin = 0, end = db_length, step = 1;
+	if (state != NULL && state->column > 0) {
+		/* Continue the word kernel, its scores are exact since it stopped before any saturation. */
+		const int32_t wordElements = byteLanes / 2;
+		begin = state->column;
+		max = state->max;
+		end_ref = state->end_db;
+		widenStripedColumn<int16_t, int32_t>(this->vHStore, vH.data(), query_length, wordElements, 1);
+		widenStripedColumn<int16_t, int32_t>(this->vE, vE.data(), query_length, wordElements, 1);
+		std::vector<int32_t> vHmax(query_length);
+		widenStripedColumn<int16_t, int32_t>(this->vHmax, vHmax.data(), query_length, wordElements, 1);
+		for (int32_t j = 0; j < query_length; ++j) {
+			if ((uint32_t) vHmax[j] == max) {
+				end_read = j;
+				break;
+			}
+		}
+		widenMaxColumn<uint16_t, uint32_t>(this->maxColumn, db_length);
+	} else {
+		memset(maxColumn, 0, db_length * sizeof(uint32_t));
+	}
+	if (ref_dir == 1) {
+		begin = db_length - 1;
+		end = -1;
+		step = -1;
+	}
+
+	for (i = begin; LIKELY(i != end); i += step) {
+		const int32_t *p = query_profile + db_sequence[i] * query_length;
+		/* f is the complete F, segmentF only the part from the current segment like vF before the lazy F loop */
+		int32_t diagonal = 0, f = 0, segmentF = 0, columnMax = 0;
+		for (int32_t j = 0, s = 0; LIKELY(j < query_length); ++j, ++s) {
+			if (s == segLen) {
+				s = 0;
+				segmentF = 0;
+			}
+			int32_t h = diagonal + p[j];
+			diagonal = vH[j];
+			const int32_t e = vE[j];
+			h = std::max(h, e);
+			h = std::max(h, segmentF);
+			vH[j] = std::max(h, f);
+			columnMax = std::max(columnMax, vH[j]);
+
+			/* the lazy F loop does not update E */
+			const int32_t hGap = std::max(h - gap_open, 0);
+			vE[j] = std::max(std::max(e - gap_extend, 0), hGap);
+			segmentF = std::max(std::max(segmentF - gap_extend, 0), hGap);
+			f = std::max(std::max(f - gap_extend, 0), hGap);
+		}
+
+		if ((uint32_t) columnMax > max) {
+			max = columnMax;
+			end_ref = i;
+			for (int32_t j = 0; j < query_length; ++j) {
+				if (vH[j] == columnMax) {
+					end_read = j;
+					break;
+				}
+			}
+		}
+		maxColumn[i] = columnMax;
+		if (maxColumn[i] == terminate) break;
+	}
+
+	alignment_end best0;
+	best0.score = max;
+	best0.ref = end_ref;
+	best0.read = end_read;
+
+	alignment_end best1;
+	best1.score = 0;
+	best1.ref = 0;
+	best1.read = 0;
+
+	int32_t edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > best1.score) {
+			best1.score = maxColumn[i];
+			best1.ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > db_length ? db_length : (end_ref + maskLen);
+	for (i = edge; i < db_length; i ++) {
+		if (maxColumn[i] > best1.score) {
+			best1.score = maxColumn[i];
+			best1.ref = i;
+		}
+	}
+
+	return std::make_pair(best0, best1);
+}
+
+template <const unsigned int type>
+void SmithWaterman::createLinearProfile(std::vector<int32_t> &profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat,
+										const int32_t query_length, const int32_t aaSize, const int32_t offset, const int32_t entryLength) {
+	const int32_t elements = byteLanes / sizeof(int32_t);
+	const int32_t stripedSize = (query_length + elements - 1) / elements * elements;
+	std::vector<int32_t> striped(aaSize * stripedSize);
+	createQueryProfile<int32_t, type>((simd_int *) striped.data(), query_sequence, composition_bias, mat, query_length, aaSize, 0, offset, entryLength);
+	profile.resize(aaSize * query_length);
+	for (int32_t nt = 0; nt < aaSize; ++nt) {
+		widenStripedColumn<int32_t, int32_t>(striped.data() + nt * stripedSize, profile.data() + nt * query_length, query_length, elements, 1);
+	}
+}
+
 void SmithWaterman::ssw_init(const Sequence* q,
 							 const int8_t* mat,
 							 const BaseMatrix *m,
 							 const int8_t score_size) {
 
 	profile->bias = 0;
+	profile->byte_max = 0;
+	profile->word_max = 0;
+	profile->score_size = score_size;
 	profile->sequence_type = q->getSequenceType();
     const int32_t alphabetSize = m->alphabetSize;
 	int32_t compositionBias = 0;
@@ -751,14 +1278,17 @@ void SmithWaterman::ssw_init(const Sequence* q,
 		bias = abs(bias) + abs(compositionBias);
 		profile->bias = bias;
 		if (isProfile) {
-			createQueryProfile<int8_t, VECSIZE_INT * 4, PROFILE>(profile->profile_byte, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, bias, 1, q->L);
+			createQueryProfile<int8_t, PROFILE>(profile->profile_byte, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, bias, 1, q->L);
 		} else {
-			createQueryProfile<int8_t, VECSIZE_INT * 4, SUBSTITUTIONMATRIX>(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0);
+			createQueryProfile<int8_t, SUBSTITUTIONMATRIX>(profile->profile_byte, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, bias, 0, 0);
 		}
+		const uint8_t *entry = (const uint8_t *) profile->profile_byte;
+		const size_t entries = (size_t) alphabetSize * ((q->L + byteLanes - 1) / byteLanes) * byteLanes;
+		profile->byte_max = *std::max_element(entry, entry + entries);
 	}
 	if (score_size == 1 || score_size == 2) {
 		if (isProfile) {
-			createQueryProfile<int16_t, VECSIZE_INT * 2, PROFILE>(profile->profile_word, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, 0, 1, q->L);
+			createQueryProfile<int16_t, PROFILE>(profile->profile_word, profile->query_sequence, NULL, profile->mat, q->L, alphabetSize, 0, 1, q->L);
 			for (int32_t i = 0; i< alphabetSize; i++) {
 				profile->profile_word_linear[i] = &profile_word_linear_data[i*q->L];
 				for (int j = 0; j < q->L; j++) {
@@ -767,7 +1297,7 @@ void SmithWaterman::ssw_init(const Sequence* q,
 				}
 			}
 		}else{
-			createQueryProfile<int16_t, VECSIZE_INT * 2, SUBSTITUTIONMATRIX>(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0);
+			createQueryProfile<int16_t, SUBSTITUTIONMATRIX>(profile->profile_word, profile->query_sequence, profile->composition_bias, profile->mat, q->L, alphabetSize, 0, 0, 0);
 			for(int32_t i = 0; i< alphabetSize; i++) {
 				profile->profile_word_linear[i] = &profile_word_linear_data[i*q->L];
 				for (int j = 0; j < q->L; j++) {
@@ -775,6 +1305,10 @@ void SmithWaterman::ssw_init(const Sequence* q,
 				}
 			}
 		}
+		const int16_t *entry = (const int16_t *) profile->profile_word;
+		const int32_t wordElements = byteLanes / 2;
+		const size_t entries = (size_t) alphabetSize * ((q->L + wordElements - 1) / wordElements) * wordElements;
+		profile->word_max = *std::max_element(entry, entry + entries);
 
 
 	}
@@ -792,6 +1326,97 @@ void SmithWaterman::ssw_init(const Sequence* q,
 	profile->query_length = q->L;
 	profile->alphabetSize = alphabetSize;
 }
+
+struct ProfileHeader {
+	int32_t query_length;
+	int32_t sequence_type;
+	int32_t alphabetSize;
+	uint8_t bias;
+	uint8_t byte_max;
+	int16_t word_max;
+};
+
+// sizes in bytes of the arrays of the query profile, in the order they are saved
+static void getProfileArraySizes(const ProfileHeader &header, int32_t byteLanes, size_t sizes[9]) {
+	const size_t L = header.query_length;
+	const size_t alphabetSize = header.alphabetSize;
+	const bool isProfile = Parameters::isEqualDbtype(header.sequence_type, Parameters::DBTYPE_HMM_PROFILE)
+	                     || Parameters::isEqualDbtype(header.sequence_type, Parameters::DBTYPE_PROFILE_STATE_PROFILE);
+	const size_t wordElements = byteLanes / 2;
+	sizes[0] = L; // query_sequence
+	sizes[1] = L; // query_rev_sequence
+	sizes[2] = L; // composition_bias
+	sizes[3] = L; // composition_bias_rev
+	sizes[4] = isProfile ? L * alphabetSize : alphabetSize * alphabetSize; // mat
+	sizes[5] = isProfile ? L * alphabetSize : 0; // mat_rev
+	sizes[6] = alphabetSize * ((L + byteLanes - 1) / byteLanes) * byteLanes; // profile_byte
+	sizes[7] = alphabetSize * ((L + wordElements - 1) / wordElements) * byteLanes; // profile_word
+	sizes[8] = alphabetSize * L * sizeof(short); // profile_word_linear
+}
+
+size_t SmithWaterman::getProfileSize() const {
+	ProfileHeader header;
+	header.query_length = profile->query_length;
+	header.sequence_type = profile->sequence_type;
+	header.alphabetSize = profile->alphabetSize;
+	size_t sizes[9];
+	getProfileArraySizes(header, byteLanes, sizes);
+	size_t size = sizeof(ProfileHeader);
+	for (size_t i = 0; i < 9; ++i) {
+		size += sizes[i];
+	}
+	return size;
+}
+
+void SmithWaterman::saveProfile(char *buffer) const {
+	ProfileHeader header;
+	header.query_length = profile->query_length;
+	header.sequence_type = profile->sequence_type;
+	header.alphabetSize = profile->alphabetSize;
+	header.bias = profile->bias;
+	header.byte_max = profile->byte_max;
+	header.word_max = profile->word_max;
+	memcpy(buffer, &header, sizeof(ProfileHeader));
+	buffer += sizeof(ProfileHeader);
+
+	size_t sizes[9];
+	getProfileArraySizes(header, byteLanes, sizes);
+	const void *arrays[9] = {
+		profile->query_sequence, profile->query_rev_sequence, profile->composition_bias, profile->composition_bias_rev,
+		profile->mat, profile->mat_rev, profile->profile_byte, profile->profile_word, profile_word_linear_data
+	};
+	for (size_t i = 0; i < 9; ++i) {
+		memcpy(buffer, arrays[i], sizes[i]);
+		buffer += sizes[i];
+	}
+}
+
+void SmithWaterman::loadProfile(const char *buffer) {
+	ProfileHeader header;
+	memcpy(&header, buffer, sizeof(ProfileHeader));
+	buffer += sizeof(ProfileHeader);
+	profile->query_length = header.query_length;
+	profile->sequence_type = header.sequence_type;
+	profile->alphabetSize = header.alphabetSize;
+	profile->bias = header.bias;
+	profile->byte_max = header.byte_max;
+	profile->word_max = header.word_max;
+	profile->score_size = 2;
+
+	size_t sizes[9];
+	getProfileArraySizes(header, byteLanes, sizes);
+	void *arrays[9] = {
+		profile->query_sequence, profile->query_rev_sequence, profile->composition_bias, profile->composition_bias_rev,
+		profile->mat, profile->mat_rev, profile->profile_byte, profile->profile_word, profile_word_linear_data
+	};
+	for (size_t i = 0; i < 9; ++i) {
+		memcpy(arrays[i], buffer, sizes[i]);
+		buffer += sizes[i];
+	}
+	for (int32_t i = 0; i < header.alphabetSize; i++) {
+		profile->profile_word_linear[i] = &profile_word_linear_data[i * header.query_length];
+	}
+}
 template <const unsigned int type>
 SmithWaterman::cigar * SmithWaterman::banded_sw(const unsigned char *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias,
 												int32_t db_length, int32_t query_length, int32_t queryStart,
@@ -1108,6 +1733,11 @@ s_align SmithWaterman::scoreIdentical(unsigned char *dbSeq, int L, EvalueComputa
 }
 
 int SmithWaterman::ungapped_alignment(const unsigned char *db_sequence, int32_t db_length) {
+#ifdef SW_DISPATCH
+	if (useAVX2) {
+		return ungappedAVX2(db_sequence, db_length, profile->query_length, profile->profile_byte, profile->bias, vHStore, vHLoad);
+	}
+#endif
 #define SWAP(tmp, arg1, arg2) tmp = arg1; arg1 = arg2; arg2 = tmp;
 
 	int i; // position in query bands (0,..,W-1)
@@ -35,6 +35,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 #if !defined(__APPLE__) && !defined(__llvm__)
 #include <malloc.h>
@@ -158,7 +159,8 @@ public:
    @param	mat	pointer to the substitution matrix; mat needs to be corresponding to the read sequence
    @param	n	the square root of the number of elements in mat (mat has n*n elements)
    @param	score_size	estimated Smith-Waterman score; if your estimated best alignment score is surely < 255 please set 0; if
-   your estimated best alignment score >= 255, please set 1; if you don't know, please set 2
+   your estimated best alignment score >= 255, please set 1; if you don't know, please set 2;
+   3 computes all scores with the 32 bit kernel, e.g. to check the results of the 8 and 16 bit kernels
    @return	pointer to the query profile structure
    @note	example for parameter read and mat:
    If the query sequence is: ACGTATC, the sequence that read points to can be: 1234142
@@ -182,6 +184,22 @@ public:
 
     s_align scoreIdentical(unsigned char *dbSeq, int L, EvalueComputation * evaluer, int alignmentMode);
 
+    // rounded composition bias per position of the query set by ssw_init
+    const int8_t *getCompositionBias() const {
+        return profile->composition_bias;
+    }
+
+    bool getAaBiasCorrection() const {
+        return aaBiasCorrection;
+    }
+
+    // size of the query profile built by the last ssw_init with score_size 2
+    size_t getProfileSize() const;
+    // saveProfile copies the query profile into buffer, loadProfile restores it instead of calling ssw_init again
+    // for the same query, matrix and bias correction
+    void saveProfile(char *buffer) const;
+    void loadProfile(const char *buffer);
+
     static void seq_reverse(int8_t * reverse, const int8_t* seq, int32_t end)	/* end is 0-based alignment ending position */
     {
         int32_t start = 0;
@@ -223,6 +241,10 @@ private:
         int32_t sequence_type;
         int32_t alphabetSize;
         uint8_t bias;
+        // largest entries of the byte (including bias) and word profiles, bound the score increase per column
+        uint8_t byte_max;
+        int16_t word_max;
+        int8_t score_size;
         short ** profile_word_linear;
     };
     simd_int* vHStore;
@@ -232,11 +254,20 @@ private:
     uint8_t * maxColumn;
 
     typedef struct {
-        uint16_t score;
+        uint32_t score;
         int32_t ref;	 //0-based position
         int32_t read;    //alignment ending position on read, 0-based
     } alignment_end;
 
+    /* The forward kernels stop after the first column whose scores could overflow their score type in the next column.
+     The next wider kernel continues from the kept state: vHStore holds the scores of the last computed column,
+     vE the gap scores for the next column, vHmax the column of the best score and maxColumn the column maxima. */
+    typedef struct {
+        int32_t column;	// next column to compute, db_length if the kernel finished
+        uint32_t max;
+        int32_t end_db;
+    } striped_state;
+
 
     typedef struct {
         uint32_t* seq;
@@ -262,7 +293,9 @@ private:
                                                      alignment beginning point. If this score
                                                      is set to 0, it will not be used */
                                  uint8_t bias,  /* Shift 0 point to a positive value. */
-                                 int32_t maskLen);
+                                 int32_t maskLen,
+                                 int32_t escalate, /* stop once a column maximum reaches this score */
+                                 striped_state *state);
 
     std::pair<alignment_end, alignment_end> sw_sse2_word (const unsigned char* db_sequence,
                                  int8_t ref_dir,	// 0: forward ref; 1: reverse ref
@@ -272,7 +305,28 @@ private:
                                  const uint8_t gap_extend, /* will be used as - */
                                  const simd_int*query_profile_byte,
                                  uint16_t terminate,
-                                 int32_t maskLen);
+                                 int32_t maskLen,
+                                 int32_t escalate,
+                                 striped_state *state);	/* continues the byte kernel if state->column > 0 */
+
+    /* Scalar Smith-Waterman with 32 bit scores for alignments whose scores do not fit into 16 bit.
+     It continues the word kernel if state->column > 0. query_profile is linear, query_length scores per residue.
+     It follows the recurrence of the word kernel: E and the F within a stripe segment are computed before
+     the lazy F loop adds F from the previous segment, so both directions of ssw_align agree on the score. */
+    std::pair<alignment_end, alignment_end> sw_scalar_int (const unsigned char* db_sequence,
+                                 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+                                 int32_t db_length,
+                                 int32_t query_length,
+                                 const uint8_t gap_open,
+                                 const uint8_t gap_extend,
+                                 const int32_t *query_profile,
+                                 uint32_t terminate,
+                                 int32_t maskLen,
+                                 striped_state *state);
+
+    // linear 32 bit query profile for sw_scalar_int, arguments as createQueryProfile
+    template <const unsigned int type>
+    void createLinearProfile(std::vector<int32_t> &profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat, const int32_t query_length, const int32_t aaSize, const int32_t offset, const int32_t entryLength);
 
     template <const unsigned int type>
     SmithWaterman::cigar *banded_sw(const unsigned char *db_sequence, const int8_t *query_sequence, const int8_t * compositionBias, int32_t db_length, int32_t query_length, int32_t queryStart, int32_t score, const uint32_t gap_open, const uint32_t gap_extend, int32_t band_width, const int8_t *mat, int32_t n);
@@ -290,11 +344,15 @@ private:
     const static unsigned int SUBSTITUTIONMATRIX = 1;
     const static unsigned int PROFILE = 2;
 
-    template <typename T, size_t Elements, const unsigned int type>
+    template <typename T, const unsigned int type>
     void createQueryProfile(simd_int *profile, const int8_t *query_sequence, const int8_t * composition_bias, const int8_t *mat, const int32_t query_length, const int32_t aaSize, uint8_t bias, const int32_t offset, const int32_t entryLength);
 
     float *tmp_composition_bias;
     short * profile_word_linear_data;
     bool aaBiasCorrection;
+    // the striped kernels use AVX2 if the binary was built for a smaller instruction set but the CPU supports it
+    bool useAVX2;
+    // number of 8 bit lanes of the striped kernels
+    int32_t byteLanes;
 };
 #endif /* SMITH_WATERMAN_SSE2_H */
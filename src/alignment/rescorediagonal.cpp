@@ -1,4 +1,5 @@
 #include "DistanceCalculator.h"
+#include "BatchDiagonalScorer.h"
 #include "Util.h"
 #include "Parameters.h"
 #include "Matcher.h"
@@ -11,6 +12,7 @@
 #include "QueryMatcher.h"
 #include "NucleotideMatrix.h"
 #include "IndexReader.h"
+#include "TargetSequenceStore.h"
 
 #ifdef OPENMP
 #include <omp.h>
@@ -55,6 +57,8 @@ int doRescorediagonal(Parameters &par,
     int querySeqType = 0;
     tdbr = tDbrIdx->sequenceReader;
     int targetSeqType = tDbrIdx->getDbtype();
+    // diagonals are scored on the ASCII sequences, only the key lookup is needed
+    TargetSequenceStore targetStore(tdbr, targetSeqType, 0);
     bool sameQTDB = (par.db2.compare(par.db1) == 0);
     if (sameQTDB == true) {
         qDbrIdx = tDbrIdx;
@@ -103,6 +107,8 @@ int doRescorediagonal(Parameters &par,
         scorePerColThr = parsePrecisionLib(libraryString, par.seqIdThr, par.covThr, 0.99);
     }
     bool reversePrefilterResult = (Parameters::isEqualDbtype(resultReader.getDbtype(), Parameters::DBTYPE_PREFILTER_REV_RES));
+    // short results are written in the same format as the input prefilter result
+    bool binaryPrefilterResult = resultReader.isBinary();
     EvalueComputation evaluer(tdbr->getAminoAcidDBSize(), subMat);
 
     size_t totalMemory = Util::getTotalSystemMemory();
@@ -111,6 +117,8 @@ int doRescorediagonal(Parameters &par,
         flushSize = resultReader.getSize();
     }
     size_t iterations = static_cast<int>(ceil(static_cast<double>(dbSize) / static_cast<double>(flushSize)));
+    // all diagonals of a query are scored at once, wrapped scoring stays per target
+    const bool batchScoring = BatchDiagonalScorer::isSupported(par.rescoreMode) && par.wrappedScoring == false;
 
     for (size_t i = 0; i < iterations; i++) {
         size_t start = dbFrom + (i * flushSize);
@@ -132,23 +140,26 @@ int doRescorediagonal(Parameters &par,
             alnResults.reserve(300);
             std::vector<hit_t> shortResults;
             shortResults.reserve(300);
+            std::vector<hit_t> results;
+            results.reserve(300);
             char *queryRevSeq = NULL;
             int queryRevSeqLen = par.maxSeqLen + 1;
             if (reversePrefilterResult == true) {
                 queryRevSeq = static_cast<char*>(malloc(queryRevSeqLen));
             }
+            BatchDiagonalScorer diagonalScorer(fastMatrix.matrix, par.rescoreMode, par.seqIdMode, par.seqIdThr);
 #pragma omp for schedule(dynamic, 1)
             for (size_t id = start; id < (start + bucketSize); id++) {
                 progress.updateProgress();
 
-                char *data = resultReader.getData(id, thread_idx);
+                QueryMatcher::readPrefilterHits(resultReader, id, thread_idx, results);
                 size_t queryKey = resultReader.getDbKey(id);
 
                 char *querySeq = NULL;
                 std::string queryToWrap; // needed only for wrapped end-start scoring
                 unsigned int queryId = UINT_MAX;
                 int queryLen = -1, origQueryLen = -1;
-                if(*data !=  '\0'){
+                if(results.empty() == false){
                     queryId = qdbr->getId(queryKey);
                     querySeq = qdbr->getData(queryId, thread_idx);
                     queryLen = static_cast<int>(qdbr->getSeqLen(queryId));
@@ -185,7 +196,23 @@ int doRescorediagonal(Parameters &par,
                 // -2 because of \n\0 in sequenceDB
 //                }
 
-                std::vector<hit_t> results = QueryMatcher::parsePrefilterHits(data);
+                if (batchScoring) {
+                    diagonalScorer.clearTargets();
+                    for (size_t entryIdx = 0; entryIdx < results.size(); entryIdx++) {
+                        const char *querySeqToAlign = (reversePrefilterResult && results[entryIdx].prefScore < 0) ? queryRevSeq : querySeq;
+                        unsigned int targetId = targetStore.getId(results[entryIdx].seqId);
+                        int dbLen = static_cast<int>(tdbr->getSeqLen(targetId));
+                        if (Util::canBeCovered(par.covThr, par.covMode, static_cast<float>(origQueryLen), static_cast<float>(dbLen)) == false) {
+                            continue;
+                        }
+                        // self matches are always reported, their identity has to be computed to the end
+                        const bool isIdentity = (queryId == targetId && (par.includeIdentity || sameQTDB));
+                        diagonalScorer.addTarget(querySeqToAlign, queryLen, tdbr->getData(targetId, thread_idx), dbLen,
+                                                 results[entryIdx].diagonal, isIdentity == false, tdbr->isCompressed());
+                    }
+                    diagonalScorer.score();
+                }
+                size_t batchIdx = 0;
                 for (size_t entryIdx = 0; entryIdx < results.size(); entryIdx++) {
                     char *querySeqToAlign = querySeq;
                     bool isReverse = false;
@@ -196,9 +223,9 @@ int doRescorediagonal(Parameters &par,
                         }
                     }
 
-                    unsigned int targetId = tdbr->getId(results[entryIdx].seqId);
+                    unsigned int targetId = targetStore.getId(results[entryIdx].seqId);
                     const bool isIdentity = (queryId == targetId && (par.includeIdentity || sameQTDB)) ? true : false;
-                    char *targetSeq = tdbr->getData(targetId, thread_idx);
+                    char *targetSeq = (batchScoring) ? NULL : tdbr->getData(targetId, thread_idx);
                     int dbLen = static_cast<int>(tdbr->getSeqLen(targetId));
 
                     float queryLength = static_cast<float>(origQueryLen);
@@ -207,7 +234,9 @@ int doRescorediagonal(Parameters &par,
                         continue;
                     }
                     DistanceCalculator::LocalAlignment alignment;
-                    if (par.wrappedScoring) {
+                    if (batchScoring) {
+                        alignment = diagonalScorer.getResult(batchIdx++);
+                    } else if (par.wrappedScoring) {
                         if (dbLen > origQueryLen) {
                             Debug(Debug::WARNING) << "WARNING: target sequence " << targetId
                                                   << " is skipped, no valid wrapped scoring possible\n";
@@ -340,7 +369,7 @@ int doRescorediagonal(Parameters &par,
                     std::sort(shortResults.begin(), shortResults.end(), hit_t::compareHitsByScoreAndId);
                 }
                 for (size_t i = 0; i < shortResults.size(); ++i) {
-                    size_t len = QueryMatcher::prefilterHitToBuffer(buffer, shortResults[i]);
+                    size_t len = QueryMatcher::prefilterHitToBuffer(buffer, shortResults[i], binaryPrefilterResult);
                     resultBuffer.append(buffer, len);
                 }
 
@@ -348,6 +377,7 @@ int doRescorediagonal(Parameters &par,
                 resultBuffer.clear();
                 shortResults.clear();
                 alnResults.clear();
+                results.clear();
             }
             if (reversePrefilterResult == true) {
                 free(queryRevSeq);
@@ -384,7 +414,7 @@ int rescorediagonal(int argc, const char **argv, const Command &command) {
     }
 
 
-    DBReader<unsigned int> resultReader(par.db3.c_str(), par.db3Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    DBReader<unsigned int> resultReader(par.db3.c_str(), par.db3Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_BINARY);
     resultReader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
     int dbtype = resultReader.getDbtype(); // this is DBTYPE_PREFILTER_RES || DBTYPE_PREFILTER_REV_RES
     if(par.rescoreMode == Parameters::RESCORE_MODE_ALIGNMENT ||
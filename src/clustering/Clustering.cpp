@@ -8,8 +8,9 @@
 Clustering::Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                        const std::string &alnDB, const std::string &alnDBIndex,
                        const std::string &outDB, const std::string &outDBIndex,
-                       unsigned int maxIteration, int similarityScoreType, int threads, int compressed) : maxIteration(maxIteration),
+                       unsigned int maxIteration, int similarityScoreType, bool parallelSetCover, int threads, int compressed) : maxIteration(maxIteration),
                                                                similarityScoreType(similarityScoreType),
+                                                               parallelSetCover(parallelSetCover),
                                                                threads(threads),
                                                                compressed(compressed),
                                                                outDB(outDB),
@@ -47,7 +48,7 @@ void Clustering::run(int mode) {
         ret = algorithm->execute(4);
     } else if (mode == Parameters::SET_COVER) {
         Debug(Debug::INFO) << "Clustering mode: Set Cover\n";
-        ret = algorithm->execute(1);
+        ret = algorithm->execute(parallelSetCover ? 5 : 1);
     } else if (mode == Parameters::CONNECTED_COMPONENT) {
         Debug(Debug::INFO) << "Clustering mode: Connected Component\n";
         ret = algorithm->execute(3);
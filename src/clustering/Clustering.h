@@ -11,7 +11,7 @@ public:
     Clustering(const std::string &seqDB, const std::string &seqDBIndex,
                const std::string &alnResultsDB, const std::string &alnResultsDBIndex,
                const std::string &outDB, const std::string &outDBIndex,
-               unsigned int maxIteration, int similarityScoreType, int threads, int compressed);
+               unsigned int maxIteration, int similarityScoreType, bool parallelSetCover, int threads, int compressed);
 
     void run(int mode);
 
@@ -28,6 +28,7 @@ private:
     //values for affinity clustering
     unsigned int maxIteration;
     int similarityScoreType;
+    bool parallelSetCover;
 
     int threads;
     int compressed;
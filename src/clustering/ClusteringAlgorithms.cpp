@@ -3,6 +3,7 @@
 #include "Debug.h"
 #include "AlignmentSymmetry.h"
 #include "Timer.h"
+#include "omptl/omptl_algorithm"
 
 #include <queue>
 #include <algorithm>
@@ -44,7 +45,9 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
     //time
     if (mode==4 || mode==2) {
         greedyIncrementalLowMem(assignedcluster);
-    }else {
+    } else if (mode == 3 && connectedComponentUnionFind(assignedcluster)) {
+        // all members are within the depth limit of their representative, no scores or breadth first search needed
+    } else {
         size_t elementCount = 0;
 #pragma omp parallel reduction (+:elementCount)
         {
@@ -74,11 +77,17 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
         std::fill_n(bestscore, dbSize, SHRT_MIN);
 
         readInClusterData(elementLookupTable, elements, scoreLookupTable, score, elementOffsets, elementCount);
-        ClusteringAlgorithms::initClustersizes();
         if (mode == 1) {
+            ClusteringAlgorithms::initClustersizes();
             setCover(elementLookupTable, scoreLookupTable, assignedcluster, bestscore, elementOffsets);
+            delete [] sorted_clustersizes;
+            delete [] clusterid_to_arrayposition;
+            delete [] borders_of_set;
+        } else if (mode == 5) {
+            parallelSetCover(elementLookupTable, scoreLookupTable, assignedcluster, bestscore, elementOffsets);
         } else if (mode == 3) {
             Debug(Debug::INFO) << "connected component mode" << "\n";
+            ClusteringAlgorithms::initClustersizes();
             for (int cl_size = dbSize - 1; cl_size >= 0; cl_size--) {
                 unsigned int representative = sorted_clustersizes[cl_size];
                 if (assignedcluster[representative] == UINT_MAX) {
@@ -107,13 +116,11 @@ std::unordered_map<unsigned int, std::vector<unsigned int>>  ClusteringAlgorithm
 
                 }
             }
+            delete [] sorted_clustersizes;
+            delete [] clusterid_to_arrayposition;
+            delete [] borders_of_set;
         }
         //delete unnecessary datastructures
-        delete [] sorted_clustersizes;
-        delete [] clusterid_to_arrayposition;
-        delete [] borders_of_set;
-
-
         delete [] elementLookupTable;
         delete [] elements;
         delete [] elementOffsets;
@@ -270,6 +277,227 @@ void ClusteringAlgorithms::setCover(unsigned int **elementLookupTable, unsigned
     }
 }
 
+void ClusteringAlgorithms::parallelSetCover(unsigned int **elementLookupTable, unsigned short ** elementScoreLookupTable,
+                                            unsigned int *assignedcluster, short *bestscore, size_t *newElementOffsets) {
+    // The largest remaining set becomes a representative, ties are broken by the higher id.
+    // Every round takes a batch of the largest remaining sets and each of them reserves its elements with its (size, id) key.
+    // Sets that won all reservations do not share an element with a larger set, they are processed in parallel
+    // and give the same result as selecting one set after the other (the element lists are symmetric).
+    // The largest sets are kept in a heap, all other sets in buckets by size. Entries of sets that have shrunk are skipped.
+    std::vector<std::vector<unsigned int>> buckets(maxClustersize + 1);
+    for (unsigned int i = 0; i < dbSize; i++) {
+        buckets[clustersizes[i]].push_back(i);
+    }
+    uint64_t *reserved = new(std::nothrow) uint64_t[dbSize];
+    Util::checkAllocation(reserved, "Can not allocate reserved memory in ClusteringAlgorithms::setCover");
+    std::fill_n(reserved, dbSize, 0);
+    char *isCandidate = new(std::nothrow) char[dbSize];
+    Util::checkAllocation(isCandidate, "Can not allocate isCandidate memory in ClusteringAlgorithms::setCover");
+    std::fill_n(isCandidate, dbSize, 0);
+    char *shrunk = new(std::nothrow) char[dbSize];
+    Util::checkAllocation(shrunk, "Can not allocate shrunk memory in ClusteringAlgorithms::setCover");
+    std::fill_n(shrunk, dbSize, 0);
+
+    // the batch shrinks while large overlapping sets block each other and grows again afterwards
+    const size_t minBatchSize = 16;
+    const size_t maxBatchSize = 1024 * 1024;
+    size_t batchSize = minBatchSize;
+    std::priority_queue<uint64_t> heap;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> selected;
+    std::vector<unsigned int> shrunkSets;
+    // all sets in the buckets are smaller than minHeapSize
+    int minHeapSize = maxClustersize + 1;
+    int nextBucket = maxClustersize;
+    size_t rounds = 0;
+    while (true) {
+        candidates.clear();
+        while (candidates.size() < batchSize) {
+            if (heap.empty()) {
+                if (nextBucket < 0) {
+                    break;
+                }
+                for (size_t i = 0; i < buckets[nextBucket].size(); i++) {
+                    const unsigned int id = buckets[nextBucket][i];
+                    if (clustersizes[id] == nextBucket) {
+                        heap.push((static_cast<uint64_t>(nextBucket) << 32) | id);
+                    }
+                }
+                std::vector<unsigned int>().swap(buckets[nextBucket]);
+                minHeapSize = nextBucket;
+                nextBucket--;
+                continue;
+            }
+            const uint64_t key = heap.top();
+            heap.pop();
+            const unsigned int id = static_cast<unsigned int>(key & UINT_MAX);
+            if (clustersizes[id] == static_cast<int>(key >> 32) && isCandidate[id] == 0) {
+                isCandidate[id] = 1;
+                candidates.push_back(id);
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        rounds++;
+
+#pragma omp parallel for schedule(dynamic, 10)
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const unsigned int id = candidates[i];
+            const uint64_t key = (static_cast<uint64_t>(clustersizes[id]) << 32) | id;
+            const size_t elementSize = (newElementOffsets[id + 1] - newElementOffsets[id]);
+            for (size_t elementId = 0; elementId <= elementSize; elementId++) {
+                const unsigned int element = (elementId == elementSize) ? id : elementLookupTable[id][elementId];
+                uint64_t current;
+                __atomic_load(&reserved[element], &current, __ATOMIC_RELAXED);
+                do {
+                    if (current >= key) break;
+                } while (!__atomic_compare_exchange(&reserved[element], &current, &key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+            }
+        }
+
+        selected.clear();
+#pragma omp parallel
+        {
+            std::vector<unsigned int> threadSelected;
+#pragma omp for schedule(dynamic, 10) nowait
+            for (size_t i = 0; i < candidates.size(); i++) {
+                const unsigned int id = candidates[i];
+                const uint64_t key = (static_cast<uint64_t>(clustersizes[id]) << 32) | id;
+                const size_t elementSize = (newElementOffsets[id + 1] - newElementOffsets[id]);
+                bool won = reserved[id] == key;
+                for (size_t elementId = 0; won && elementId < elementSize; elementId++) {
+                    won = reserved[elementLookupTable[id][elementId]] == key;
+                }
+                if (won) {
+                    threadSelected.push_back(id);
+                }
+            }
+#pragma omp critical
+            selected.insert(selected.end(), threadSelected.begin(), threadSelected.end());
+        }
+
+#pragma omp parallel for schedule(dynamic, 10)
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const unsigned int id = candidates[i];
+            const size_t elementSize = (newElementOffsets[id + 1] - newElementOffsets[id]);
+            __atomic_store_n(&reserved[id], 0, __ATOMIC_RELAXED);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                __atomic_store_n(&reserved[elementLookupTable[id][elementId]], 0, __ATOMIC_RELAXED);
+            }
+        }
+
+        // selected sets do not share elements, their members are only touched by one thread
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < selected.size(); i++) {
+            const unsigned int representative = selected[i];
+            clustersizes[representative] = 0;
+            assignedcluster[representative] = representative;
+
+            //delete clusters of members;
+            const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+            for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                const unsigned int elementtodelete = elementLookupTable[representative][elementId];
+                const short seqId = elementScoreLookupTable[representative][elementId];
+                // becareful of this criteria
+                if (seqId > bestscore[elementtodelete]) {
+                    assignedcluster[elementtodelete] = representative;
+                    bestscore[elementtodelete] = seqId;
+                }
+                if (elementtodelete == representative) {
+                    continue;
+                }
+                if (clustersizes[elementtodelete] < 1) {
+                    continue;
+                }
+                clustersizes[elementtodelete] = 0;
+            }
+        }
+
+#pragma omp parallel
+        {
+            std::vector<unsigned int> threadShrunk;
+#pragma omp for schedule(dynamic, 1) nowait
+            for (size_t i = 0; i < selected.size(); i++) {
+                const unsigned int representative = selected[i];
+                const size_t elementSize = (newElementOffsets[representative + 1] - newElementOffsets[representative]);
+                for (size_t elementId = 0; elementId < elementSize; elementId++) {
+                    bool representativefound = false;
+                    const unsigned int elementtodelete = elementLookupTable[representative][elementId];
+                    const unsigned int currElementSize = (newElementOffsets[elementtodelete + 1] -
+                                                          newElementOffsets[elementtodelete]);
+                    if (elementtodelete == representative) {
+                        __atomic_store_n(&clustersizes[elementtodelete], -1, __ATOMIC_RELAXED);
+                        continue;
+                    }
+                    if (__atomic_load_n(&clustersizes[elementtodelete], __ATOMIC_RELAXED) < 0) {
+                        continue;
+                    }
+                    __atomic_store_n(&clustersizes[elementtodelete], -1, __ATOMIC_RELAXED);
+                    //decrease clustersize of sets that contain the element
+                    for (size_t elementId2 = 0; elementId2 < currElementSize; elementId2++) {
+                        const unsigned int elementtodecrease = elementLookupTable[elementtodelete][elementId2];
+                        if (representative == elementtodecrease) {
+                            representativefound = true;
+                        }
+                        int size;
+                        __atomic_load(&clustersizes[elementtodecrease], &size, __ATOMIC_RELAXED);
+                        do {
+                            if (size == 1) {
+                                Debug(Debug::ERROR) << "there must be an error: " << seqDbr->getDbKey(elementtodelete) <<
+                                                    " deleted from " << seqDbr->getDbKey(elementtodecrease) <<
+                                                    " that now is empty, but not assigned to a cluster\n";
+                                break;
+                            }
+                            if (size < 1) {
+                                break;
+                            }
+                        } while (!__atomic_compare_exchange_n(&clustersizes[elementtodecrease], &size, size - 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+                        if (size > 1 && __atomic_exchange_n(&shrunk[elementtodecrease], 1, __ATOMIC_RELAXED) == 0) {
+                            threadShrunk.push_back(elementtodecrease);
+                        }
+                    }
+                    if (!representativefound) {
+                        Debug(Debug::ERROR) << "error with cluster:\t" << seqDbr->getDbKey(representative) <<
+                                            "\tis not contained in set:\t" << seqDbr->getDbKey(elementtodelete) << ".\n";
+                    }
+                }
+            }
+#pragma omp critical
+            shrunkSets.insert(shrunkSets.end(), threadShrunk.begin(), threadShrunk.end());
+        }
+
+        if (selected.size() * 2 >= candidates.size()) {
+            batchSize = std::min(batchSize * 2, maxBatchSize);
+        } else if (selected.size() * 8 < candidates.size()) {
+            batchSize = std::max(batchSize / 2, minBatchSize);
+        }
+
+        // shrunk sets and candidates that were not selected are added again with their new size
+        for (size_t i = 0; i < shrunkSets.size(); i++) {
+            shrunk[shrunkSets[i]] = 0;
+            if (isCandidate[shrunkSets[i]] == 0) {
+                candidates.push_back(shrunkSets[i]);
+            }
+        }
+        shrunkSets.clear();
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const unsigned int id = candidates[i];
+            const int size = clustersizes[id];
+            isCandidate[id] = 0;
+            if (size >= minHeapSize) {
+                heap.push((static_cast<uint64_t>(size) << 32) | id);
+            } else if (size > 0) {
+                buckets[size].push_back(id);
+            }
+        }
+    }
+    delete[] shrunk;
+    delete[] isCandidate;
+    delete[] reserved;
+    Debug(Debug::INFO) << "Set cover rounds: " << rounds << "\n";
+}
+
 void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluster) {
     // two step clustering
     // 1.) we define the rep. sequences by minimizing the ids (smaller ID = longer sequence)
@@ -333,6 +561,224 @@ void ClusteringAlgorithms::greedyIncrementalLowMem( unsigned int *assignedcluste
 
 }
 
+static inline unsigned int unionFindRoot(unsigned int *parent, unsigned int id) {
+    // path halving, concurrent updates only ever move an element closer to its root
+    unsigned int currParent;
+    __atomic_load(&parent[id], &currParent, __ATOMIC_RELAXED);
+    while (currParent != id) {
+        unsigned int grandParent;
+        __atomic_load(&parent[currParent], &grandParent, __ATOMIC_RELAXED);
+        if (grandParent != currParent) {
+            __atomic_compare_exchange(&parent[id], &currParent, &grandParent, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+        id = grandParent;
+        __atomic_load(&parent[id], &currParent, __ATOMIC_RELAXED);
+    }
+    return id;
+}
+
+static inline void unionFindUnite(unsigned int *parent, unsigned int a, unsigned int b) {
+    while (true) {
+        a = unionFindRoot(parent, a);
+        b = unionFindRoot(parent, b);
+        if (a == b) {
+            return;
+        }
+        // always link the larger root below the smaller one, this can not create cycles
+        if (a < b) {
+            std::swap(a, b);
+        }
+        unsigned int expected = a;
+        if (__atomic_compare_exchange(&parent[a], &expected, &b, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+}
+
+bool ClusteringAlgorithms::connectedComponentUnionFind(unsigned int *assignedcluster) {
+    Timer timer;
+    unsigned int *parent = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(parent, "Can not allocate parent memory in ClusteringAlgorithms::connectedComponentUnionFind");
+    for (size_t i = 0; i < dbSize; i++) {
+        parent[i] = i;
+    }
+    size_t *offsets = new(std::nothrow) size_t[dbSize + 1];
+    Util::checkAllocation(offsets, "Can not allocate offsets memory in ClusteringAlgorithms::connectedComponentUnionFind");
+    offsets[dbSize] = 0;
+#pragma omp parallel
+    {
+        int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = omp_get_thread_num();
+#endif
+#pragma omp for schedule(dynamic, 1000)
+        for (size_t i = 0; i < dbSize; i++) {
+            const size_t alnId = alnDbr->getId(seqDbr->getDbKey(i));
+            const char *data = alnDbr->getData(alnId, thread_idx);
+            offsets[i] = (*data == '\0') ? 1 : Util::countLines(data, alnDbr->getEntryLen(alnId));
+        }
+    }
+    AlignmentSymmetry::computeOffsetFromCounts(offsets, dbSize);
+    const size_t lineCount = offsets[dbSize];
+
+    // every line is stored as undirected edge with the smaller id in the upper half,
+    // entries without hits are an edge to themselves like in readInClusterData
+    uint64_t *edges = new(std::nothrow) uint64_t[std::max(lineCount, static_cast<size_t>(1))];
+    Util::checkAllocation(edges, "Can not allocate edges memory in ClusteringAlgorithms::connectedComponentUnionFind");
+    Debug::Progress progress(dbSize);
+#pragma omp parallel
+    {
+        int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = omp_get_thread_num();
+#endif
+#pragma omp for schedule(dynamic, 1000)
+        for (size_t i = 0; i < dbSize; i++) {
+            progress.updateProgress();
+            const unsigned int clusterKey = seqDbr->getDbKey(i);
+            const size_t alnId = alnDbr->getId(clusterKey);
+            char *data = alnDbr->getData(alnId, thread_idx);
+            size_t pos = offsets[i];
+            if (*data == '\0') {
+                edges[pos] = (static_cast<uint64_t>(i) << 32) | static_cast<uint64_t>(i);
+                continue;
+            }
+            while (*data != '\0') {
+                char dbKey[255 + 1];
+                Util::parseKey(data, dbKey);
+                const unsigned int key = (unsigned int) strtoul(dbKey, NULL, 10);
+                const unsigned int currElement = seqDbr->getId(key);
+                if (currElement == UINT_MAX || currElement > seqDbr->getSize()) {
+                    Debug(Debug::ERROR) << "Element " << dbKey
+                                        << " contained in some alignment list, but not contained in the sequence database!\n";
+                    EXIT(EXIT_FAILURE);
+                }
+                const uint64_t low = std::min(static_cast<uint64_t>(i), static_cast<uint64_t>(currElement));
+                const uint64_t high = std::max(static_cast<uint64_t>(i), static_cast<uint64_t>(currElement));
+                edges[pos++] = (low << 32) | high;
+                unionFindUnite(parent, i, currElement);
+                data = Util::skipLine(data);
+            }
+        }
+    }
+
+    // the representative is picked by the size of the symmetric element list of the breadth first search,
+    // which is the number of distinct neighbours, so edges found in both directions only count once
+    omptl::sort(edges, edges + lineCount);
+    const size_t edgeCount = std::unique(edges, edges + lineCount) - edges;
+    unsigned int *degree = new(std::nothrow) unsigned int[dbSize];
+    Util::checkAllocation(degree, "Can not allocate degree memory in ClusteringAlgorithms::connectedComponentUnionFind");
+    std::fill_n(degree, dbSize, 0);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < edgeCount; i++) {
+        const unsigned int low = static_cast<unsigned int>(edges[i] >> 32);
+        const unsigned int high = static_cast<unsigned int>(edges[i] & UINT_MAX);
+        __sync_fetch_and_add(&degree[low], 1);
+        if (low != high) {
+            __sync_fetch_and_add(&degree[high], 1);
+        }
+    }
+
+    // ties are broken by the higher id like in the breadth first search
+    uint64_t *best = new(std::nothrow) uint64_t[dbSize];
+    Util::checkAllocation(best, "Can not allocate best memory in ClusteringAlgorithms::connectedComponentUnionFind");
+    std::fill_n(best, dbSize, 0);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        parent[i] = unionFindRoot(parent, i);
+        uint64_t candidate = (static_cast<uint64_t>(degree[i]) << 32) | static_cast<uint64_t>(i);
+        uint64_t current;
+        __atomic_load(&best[parent[i]], &current, __ATOMIC_RELAXED);
+        do {
+            if (current >= candidate) break;
+        } while (!__atomic_compare_exchange(&best[parent[i]], &current, &candidate, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    }
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < dbSize; i++) {
+        assignedcluster[i] = static_cast<unsigned int>(best[parent[i]] & UINT_MAX);
+    }
+    delete[] best;
+
+    // the breadth first search reaches all members up to maxiterations + 1 edges away from the representative,
+    // components with more members than that are searched from their representative to check the distance
+    const size_t depthLimit = static_cast<size_t>(std::max(maxiterations, 0)) + 1;
+    unsigned int *componentSize = parent;
+    std::fill_n(componentSize, dbSize, 0);
+    for (size_t i = 0; i < dbSize; i++) {
+        componentSize[assignedcluster[i]]++;
+    }
+    bool needsSearch = false;
+    for (size_t i = 0; i < dbSize && needsSearch == false; i++) {
+        needsSearch = componentSize[i] > depthLimit + 1;
+    }
+    bool depthLimited = false;
+    if (needsSearch) {
+        // symmetric neighbour lists, the degree becomes the fill position while they are written
+        offsets[0] = 0;
+        for (size_t i = 0; i < dbSize; i++) {
+            offsets[i + 1] = offsets[i] + degree[i];
+        }
+        unsigned int *neighbours = new(std::nothrow) unsigned int[std::max(offsets[dbSize], static_cast<size_t>(1))];
+        Util::checkAllocation(neighbours, "Can not allocate neighbours memory in ClusteringAlgorithms::connectedComponentUnionFind");
+        std::fill_n(degree, dbSize, 0);
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < edgeCount; i++) {
+            const unsigned int low = static_cast<unsigned int>(edges[i] >> 32);
+            const unsigned int high = static_cast<unsigned int>(edges[i] & UINT_MAX);
+            neighbours[offsets[low] + __sync_fetch_and_add(&degree[low], 1)] = high;
+            if (low != high) {
+                neighbours[offsets[high] + __sync_fetch_and_add(&degree[high], 1)] = low;
+            }
+        }
+        delete[] edges;
+        edges = NULL;
+
+        // components are disjoint, so every search only touches the distances of its own members
+        unsigned int *distance = degree;
+        std::fill_n(distance, dbSize, UINT_MAX);
+#pragma omp parallel
+        {
+            std::vector<unsigned int> queue;
+#pragma omp for schedule(dynamic, 1)
+            for (size_t i = 0; i < dbSize; i++) {
+                if (assignedcluster[i] != i || componentSize[i] <= depthLimit + 1 || __atomic_load_n(&depthLimited, __ATOMIC_RELAXED)) {
+                    continue;
+                }
+                queue.clear();
+                queue.push_back(i);
+                distance[i] = 0;
+                bool exceeded = false;
+                for (size_t pos = 0; pos < queue.size() && exceeded == false; pos++) {
+                    const unsigned int currElement = queue[pos];
+                    for (size_t j = offsets[currElement]; j < offsets[currElement + 1] && exceeded == false; j++) {
+                        const unsigned int element = neighbours[j];
+                        if (distance[element] == UINT_MAX) {
+                            distance[element] = distance[currElement] + 1;
+                            exceeded = distance[element] > depthLimit;
+                            queue.push_back(element);
+                        }
+                    }
+                }
+                if (exceeded) {
+                    __atomic_store_n(&depthLimited, true, __ATOMIC_RELAXED);
+                }
+            }
+        }
+        delete[] neighbours;
+    }
+    delete[] edges;
+    delete[] degree;
+    delete[] offsets;
+    delete[] parent;
+    if (depthLimited) {
+        std::fill_n(assignedcluster, dbSize, UINT_MAX);
+        Debug(Debug::INFO) << "Connected component exceeds --max-iterations, using breadth first search\n";
+        return false;
+    }
+    Debug(Debug::INFO) << "Time for union-find connected components: " << timer.lap() << "\n";
+    return true;
+}
+
 void ClusteringAlgorithms::readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
                                              unsigned short **scoreLookupTable, unsigned short *&scores,
                                              size_t *elementOffsets, size_t totalElementCount) {
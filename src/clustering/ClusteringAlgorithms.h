@@ -47,12 +47,22 @@ private:
     void setCover(unsigned int **elementLookup, unsigned short ** elementScoreLookupTable,
                   unsigned int *assignedcluster, short *bestscore, size_t *offsets);
 
+    // set cover that selects non-overlapping representatives in parallel rounds
+    // ties between sets of the same size are broken by the higher id, so clusters can differ from setCover
+    void parallelSetCover(unsigned int **elementLookup, unsigned short ** elementScoreLookupTable,
+                          unsigned int *assignedcluster, short *bestscore, size_t *offsets);
+
     void greedyIncremental(unsigned int **elementLookupTable, size_t *elementOffsets,
                            size_t n, unsigned int *assignedcluster) ;
 
 
     void greedyIncrementalLowMem(unsigned int *assignedcluster) ;
 
+    // connected components with a lock-free union-find over the edges streamed from alnDbr
+    // picks the same representatives as the breadth first search, returns false if a member is more than
+    // maxiterations + 1 edges away from its representative and the depth limit has to be enforced by the breadth first search
+    bool connectedComponentUnionFind(unsigned int *assignedcluster);
+
 
     void readInClusterData(unsigned int **elementLookupTable, unsigned int *&elements,
                            unsigned short **scoreLookupTable, unsigned short *&scores,
@@ -0,0 +1,61 @@
+#ifndef MMSEQS_BOUNDEDQUEUE_H
+#define MMSEQS_BOUNDEDQUEUE_H
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// Blocking FIFO queue with a fixed capacity to hand work from producer to consumer threads.
+// Producers block while the queue is full, consumers block while it is empty.
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) : capacity(capacity == 0 ? 1 : capacity), closed(false) {}
+
+    // moves the content of item into the queue (item is left in an unspecified state)
+    void push(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return queue.size() < capacity || closed; });
+        if (closed) {
+            return;
+        }
+        queue.emplace_back();
+        std::swap(queue.back(), item);
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    // returns false if the queue was closed and all items have been consumed
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return queue.empty() == false || closed; });
+        if (queue.empty()) {
+            return false;
+        }
+        std::swap(item, queue.front());
+        queue.pop_front();
+        lock.unlock();
+        notFull.notify_one();
+        return true;
+    }
+
+    // no more items will be pushed, wakes up all waiting consumers
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        lock.unlock();
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    bool closed;
+    std::deque<T> queue;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
+
+#endif
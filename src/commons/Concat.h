@@ -14,6 +14,8 @@
 #include <algorithm>
 #include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
+#include <vector>
 
 #include "Debug.h"
 #include "Util.h"
@@ -143,6 +145,81 @@ public:
         }
     }
 
+    // copies each file to its own offset of the output file in parallel, sizes holds the size of every input file
+    static void concatFilesParallel(const std::vector<FILE*> &files, const std::vector<size_t> &sizes, FILE *outFile) {
+        int output_desc = fileno(outFile);
+        std::vector<size_t> offsets(files.size() + 1, 0);
+        for (size_t fileIdx = 0; fileIdx < files.size(); fileIdx++) {
+            offsets[fileIdx + 1] = offsets[fileIdx] + sizes[fileIdx];
+        }
+        if (ftruncate(output_desc, offsets[files.size()]) != 0) {
+            Debug(Debug::ERROR) << "Can not resize output file. Error " << errno << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t fileIdx = 0; fileIdx < files.size(); fileIdx++) {
+            if (copyRange(fileno(files[fileIdx]), output_desc, offsets[fileIdx], sizes[fileIdx]) == false) {
+                Debug(Debug::ERROR) << "Can not copy input file " << fileIdx << ". Error " << errno << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+    }
+
+    // copies size bytes from the start of input_desc to out_offset of out_desc without moving the file positions
+    static bool copyRange(int input_desc, int out_desc, size_t out_offset, size_t size) {
+        off_t in_pos = 0;
+        off_t out_pos = out_offset;
+        size_t remaining = size;
+#ifdef HAVE_COPY_FILE_RANGE
+        // lets the file system copy or reflink the data, falls back to pread/pwrite if it can not
+        loff_t copy_in_pos = 0;
+        loff_t copy_out_pos = out_offset;
+        while (remaining > 0) {
+            ssize_t copied = copy_file_range(input_desc, &copy_in_pos, out_desc, &copy_out_pos, remaining, 0);
+            if (copied < 0 && errno == EINTR) {
+                continue;
+            }
+            if (copied <= 0) {
+                break;
+            }
+            remaining -= copied;
+        }
+        in_pos = copy_in_pos;
+        out_pos = copy_out_pos;
+#endif
+        if (remaining == 0) {
+            return true;
+        }
+        const size_t bufsize = 1024 * 1024;
+        char *buf = (char *) malloc(bufsize);
+        while (remaining > 0) {
+            ssize_t n_read = pread(input_desc, buf, std::min(bufsize, remaining), in_pos);
+            if (n_read < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n_read <= 0) {
+                free(buf);
+                return false;
+            }
+            ssize_t n_written = 0;
+            while (n_written < n_read) {
+                ssize_t cc = pwrite(out_desc, buf + n_written, n_read - n_written, out_pos + n_written);
+                if (cc < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (cc <= 0) {
+                    free(buf);
+                    return false;
+                }
+                n_written += cc;
+            }
+            in_pos += n_read;
+            out_pos += n_read;
+            remaining -= n_read;
+        }
+        free(buf);
+        return true;
+    }
 
     static bool doConcat(int input_desc, int out_desc, const char *buf, size_t bufsize) {
         while (true) {
@@ -48,7 +48,11 @@ public:
     bool HW_AVX512DQ = false;   //  AVX512 Doubleword + Quadword
     bool HW_AVX512IFMA = false; //  AVX512 Integer 52-bit Fused Multiply-Add
     bool HW_AVX512VBMI = false; //  AVX512 Vector Byte Manipulation Instructions
-    
+
+//  OS support: the OS has to save the vector registers on a context switch
+    bool OS_AVX = false;
+    bool OS_AVX512 = false;
+
     CpuInfo(){
         int info[4];
         cpuid(info, 0);
@@ -74,6 +78,13 @@ public:
             HW_FMA3   = (info[2] & ((int)1 << 12)) != 0;
 
             HW_RDRAND = (info[2] & ((int)1 << 30)) != 0;
+
+            bool osUsesXSAVE_XRSTORE = (info[2] & ((int)1 << 27)) != 0;
+            if (osUsesXSAVE_XRSTORE) {
+                unsigned long long xcrFeatureMask = xgetbv(0);
+                OS_AVX    = (xcrFeatureMask & 0x6) == 0x6;
+                OS_AVX512 = (xcrFeatureMask & 0xe6) == 0xe6;
+            }
         }
         if (nIds >= 0x00000007){
             cpuid(info,0x00000007);
@@ -109,5 +120,11 @@ public:
     void cpuid(int info[4], int InfoType){
         __cpuid_count(InfoType, 0, info[0], info[1], info[2], info[3]);
     }
+
+    unsigned long long xgetbv(unsigned int index){
+        unsigned int eax, edx;
+        __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+        return ((unsigned long long)edx << 32) | eax;
+    }
 };
 #endif //MMSEQS_CPU_H
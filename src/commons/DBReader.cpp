@@ -21,13 +21,16 @@
 #include <omp.h>
 #endif
 
+template <typename T>
+const char DBReader<T>::BINARY_INDEX_MAGIC[8] = { '\0', 'M', 'M', 'S', 'I', 'D', 'X', '\n' };
+
 template <typename T>
 DBReader<T>::DBReader(const char* dataFileName_, const char* indexFileName_, int threads, int dataMode) :
 threads(threads), dataMode(dataMode), dataFileName(strdup(dataFileName_)),
         indexFileName(strdup(indexFileName_)), size(0), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0),
         totalDataSize(0), dataSize(0), lastKey(T()), closed(1), dbtype(Parameters::DBTYPE_GENERIC_DB),
-        compressedBuffers(NULL), compressedBufferSizes(NULL), index(NULL), id2local(NULL), local2id(NULL),
-        dataMapped(false), accessType(0), externalData(false), didMlock(false)
+        compressedBuffers(NULL), compressedBufferSizes(NULL), ddict(NULL), index(NULL), id2local(NULL), local2id(NULL),
+        dataMapped(false), accessType(0), indexMapping(NULL), indexMappingSize(0), externalData(false), didMlock(false)
 {}
 
 template <typename T>
@@ -35,8 +38,8 @@ DBReader<T>::DBReader(DBReader<T>::Index *index, size_t size, size_t dataSize, T
         int dbType, unsigned int maxSeqLen, int threads) :
         threads(threads), dataMode(USE_INDEX), dataFileName(NULL), indexFileName(NULL),
         size(size), dataFiles(NULL), dataSizeOffset(NULL), dataFileCnt(0), totalDataSize(0), dataSize(dataSize), lastKey(lastKey),
-        maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), index(index), sortedByOffset(true),
-        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), externalData(true), didMlock(false)
+        maxSeqLen(maxSeqLen), closed(1), dbtype(dbType), compressedBuffers(NULL), compressedBufferSizes(NULL), ddict(NULL), index(index), sortedByOffset(true),
+        id2local(NULL), local2id(NULL), dataMapped(false), accessType(NOSORT), indexMapping(NULL), indexMappingSize(0), externalData(true), didMlock(false)
 {}
 
 template <typename T>
@@ -105,6 +108,12 @@ template <typename T> bool DBReader<T>::open(int accessType){
         dbtype = FileUtil::parseDbType(dataFileName);
     }
 
+    if ((dataMode & USE_DATA) && (dataMode & USE_BINARY) == 0 && isBinary(dbtype)) {
+        Debug(Debug::ERROR) << dataFileName << " contains binary prefilter results, which this module can not read.\n"
+                            << "Recreate it without --binary-prefilter.\n";
+        EXIT(EXIT_FAILURE);
+    }
+
     if (dataMode & USE_DATA) {
         dataFileNames = FileUtil::findDatafiles(dataFileName);
         if (dataFileNames.empty()) {
@@ -158,29 +167,38 @@ template <typename T> bool DBReader<T>::open(int accessType){
             Debug(Debug::ERROR) << "Can not open index file " << indexFileName << "!\n";
             EXIT(EXIT_FAILURE);
         }
-        MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
-        if (!indexData.isValid()){
-            Debug(Debug::ERROR) << "Can map open index file " << indexFileName << "\n";
-            EXIT(EXIT_FAILURE);
-        }
-        char* indexDataChar = (char *) indexData.getData();
-        size_t indexDataSize = indexData.size();
-        size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
+        bool isSortedById;
+        if (isBinaryIndexFile(indexFileName)) {
+            isSortedById = mapBinaryIndex();
+        } else {
+            MemoryMapped indexData(indexFileName, MemoryMapped::WholeFile, MemoryMapped::SequentialScan);
+            if (!indexData.isValid()){
+                Debug(Debug::ERROR) << "Can map open index file " << indexFileName << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            char* indexDataChar = (char *) indexData.getData();
+            size_t indexDataSize = indexData.size();
+            size = Util::ompCountLines(indexDataChar, indexDataSize, threads);
 
-        index = new(std::nothrow) Index[this->size];
-        Util::checkAllocation(index, "Can not allocate index memory in DBReader");
+            index = new(std::nothrow) Index[this->size];
+            Util::checkAllocation(index, "Can not allocate index memory in DBReader");
 
-        bool isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
-        indexData.close();
+            isSortedById = readIndex(indexDataChar, indexDataSize, index, dataSize);
+            indexData.close();
+        }
 
         // sortIndex also handles access modes that don't require sorting
         sortIndex(isSortedById);
 
-        size_t prevOffset = 0; // makes 0 or empty string
-        sortedByOffset = true;
-        for (size_t i = 0; i < size; i++) {
-            sortedByOffset = sortedByOffset && index[i].offset >= prevOffset;
-            prevOffset = index[i].offset;
+        // the sort state of a binary index is stored in its header and still valid if sortIndex kept the order
+        bool keptOrder = accessType != SORT_BY_OFFSET && (isSortedById || accessType == HARDNOSORT);
+        if (indexMapping == NULL || keptOrder == false) {
+            size_t prevOffset = 0; // makes 0 or empty string
+            sortedByOffset = true;
+            for (size_t i = 0; i < size; i++) {
+                sortedByOffset = sortedByOffset && index[i].offset >= prevOffset;
+                prevOffset = index[i].offset;
+            }
         }
     }
 
@@ -188,7 +206,7 @@ template <typename T> bool DBReader<T>::open(int accessType){
     if(compression == COMPRESSED){
         compressedBufferSizes = new size_t[threads];
         compressedBuffers = new char*[threads];
-        dstream = new ZSTD_DStream*[threads];
+        dctx = new ZSTD_DCtx*[threads];
         for(int i = 0; i < threads; i++){
             // allocated buffer
             compressedBufferSizes[i] = std::max(maxSeqLen+1, 1024u);
@@ -197,12 +215,21 @@ template <typename T> bool DBReader<T>::open(int accessType){
                 Debug(Debug::ERROR) << "Can not allocate compressedBuffer!\n";
                 EXIT(EXIT_FAILURE);
             }
-            dstream[i] = ZSTD_createDStream();
-            if (dstream==NULL) {
-                Debug(Debug::ERROR) << "ZSTD_createDStream() error \n";
+            dctx[i] = ZSTD_createDCtx();
+            if (dctx[i] == NULL) {
+                Debug(Debug::ERROR) << "ZSTD_createDCtx() error \n";
                 EXIT(EXIT_FAILURE);
             }
         }
+        std::string dictionaryFile = (dataMode & USE_DATA) ? getDictionaryFileName(dataFileName) : "";
+        if (dictionaryFile.empty() == false && FileUtil::fileExists(dictionaryFile.c_str())) {
+            FILE *file = FileUtil::openFileOrDie(dictionaryFile.c_str(), "r", true);
+            size_t dictionarySize;
+            char *dictionary = (char *) FileUtil::mmapFile(file, &dictionarySize);
+            fclose(file);
+            setDictionary(dictionary, dictionarySize);
+            FileUtil::munmapData(dictionary, dictionarySize);
+        }
     }
 
     closed = 0;
@@ -466,15 +493,26 @@ template <typename T> void DBReader<T>::close(){
 
     if(compressedBuffers){
         for(int i = 0; i < threads; i++){
-            ZSTD_freeDStream(dstream[i]);
+            ZSTD_freeDCtx(dctx[i]);
             free(compressedBuffers[i]);
         }
         delete [] compressedBuffers;
         delete [] compressedBufferSizes;
-        delete [] dstream;
+        delete [] dctx;
+    }
+    if (ddict != NULL) {
+        ZSTD_freeDDict(ddict);
+        ddict = NULL;
     }
 
-    if(externalData == false) {
+    if (indexMapping != NULL) {
+        if (munmap(indexMapping, indexMappingSize) < 0) {
+            Debug(Debug::ERROR) << "Failed to munmap index file " << indexFileName << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        indexMapping = NULL;
+        indexMappingSize = 0;
+    } else if (externalData == false) {
         delete[] index;
     }
     closed = 1;
@@ -492,21 +530,18 @@ template <typename T> char* DBReader<T>::getDataCompressed(size_t id, int thrIdx
 
     unsigned int cSize = *(reinterpret_cast<unsigned int *>(data));
 
-    size_t totalSize = 0;
     const void *cBuff = static_cast<void *>(data + sizeof(unsigned int));
     const char *dataStart = data + sizeof(unsigned int);
     bool isCompressed = (dataStart[cSize] == 0) ? true : false;
     if(isCompressed){
-        ZSTD_inBuffer input = {cBuff, cSize, 0};
-        while (input.pos < input.size) {
-            ZSTD_outBuffer output = {compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], 0};
-            // size of next compressed block
-            size_t toRead = ZSTD_decompressStream(dstream[thrIdx], &output, &input);
-            if (ZSTD_isError(toRead)) {
-                Debug(Debug::ERROR) << id << " ZSTD_decompressStream " << ZSTD_getErrorName(toRead) << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            totalSize += output.pos;
+        // leave space for the null byte
+        size_t capacity = compressedBufferSizes[thrIdx] - 1;
+        size_t totalSize = (ddict != NULL)
+                           ? ZSTD_decompress_usingDDict(dctx[thrIdx], compressedBuffers[thrIdx], capacity, cBuff, cSize, ddict)
+                           : ZSTD_decompressDCtx(dctx[thrIdx], compressedBuffers[thrIdx], capacity, cBuff, cSize);
+        if (ZSTD_isError(totalSize)) {
+            Debug(Debug::ERROR) << id << " ZSTD_decompress " << ZSTD_getErrorName(totalSize) << "\n";
+            EXIT(EXIT_FAILURE);
         }
         compressedBuffers[thrIdx][totalSize] = '\0';
     }else{
@@ -793,6 +828,80 @@ bool DBReader<T>::readIndex(char *data, size_t indexDataSize, Index *index, size
     return isSortedById;
 }
 
+template<typename T>
+bool DBReader<T>::isBinaryIndexFile(const char *indexFileName) {
+    FILE *file = fopen(indexFileName, "r");
+    if (file == NULL) {
+        return false;
+    }
+    char magic[sizeof(BINARY_INDEX_MAGIC)];
+    bool isBinary = fread(magic, sizeof(char), sizeof(magic), file) == sizeof(magic)
+                    && memcmp(magic, BINARY_INDEX_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return isBinary;
+}
+
+template<typename T>
+void DBReader<T>::requireTextIndex(const std::string &databaseName) {
+    if (isBinaryIndexFile((databaseName + ".index").c_str())) {
+        Debug(Debug::ERROR) << databaseName << " has a binary index, which this workflow can not read.\n"
+                            << "Convert it with: convertindex " << databaseName << " " << databaseName << " --binary-index 0\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+template<>
+bool DBReader<std::string>::mapBinaryIndex() {
+    Debug(Debug::ERROR) << "Binary index " << indexFileName << " can not be read with string keys\n";
+    EXIT(EXIT_FAILURE);
+}
+
+template<>
+bool DBReader<unsigned int>::mapBinaryIndex() {
+    FILE *file = fopen(indexFileName, "r");
+    if (file == NULL) {
+        Debug(Debug::ERROR) << "Can not open index file " << indexFileName << "!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    struct stat sb;
+    if (fstat(fileno(file), &sb) < 0) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Failed to fstat File=" << indexFileName << ". Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    indexMappingSize = sb.st_size;
+    if (indexMappingSize < sizeof(BinaryIndexHeader)) {
+        Debug(Debug::ERROR) << "Binary index " << indexFileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // private writable mapping, sortIndex reorders in place without touching the file
+    indexMapping = static_cast<char*>(mmap(NULL, indexMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0));
+    if (indexMapping == MAP_FAILED) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Failed to mmap index file " << indexFileName << ". Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    fclose(file);
+
+    static_assert(sizeof(BinaryIndexHeader) % alignof(Index) == 0, "Index records have to be aligned after the header");
+    const BinaryIndexHeader *header = reinterpret_cast<const BinaryIndexHeader*>(indexMapping);
+    if (header->version != BINARY_INDEX_VERSION) {
+        Debug(Debug::ERROR) << "Binary index " << indexFileName << " has unsupported version " << header->version << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (indexMappingSize != sizeof(BinaryIndexHeader) + header->size * sizeof(Index)) {
+        Debug(Debug::ERROR) << "Binary index " << indexFileName << " does not match its entry count " << header->size << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size = header->size;
+    dataSize = header->dataSize;
+    maxSeqLen = header->maxSeqLen;
+    lastKey = header->lastKey;
+    sortedByOffset = (header->flags & BINARY_INDEX_SORTED_BY_OFFSET) != 0;
+    index = reinterpret_cast<Index*>(indexMapping + sizeof(BinaryIndexHeader));
+    return (header->flags & BINARY_INDEX_SORTED_BY_ID) != 0;
+}
+
 template<typename T> T DBReader<T>::getLastKey() {
     return lastKey;
 }
@@ -905,6 +1014,19 @@ void DBReader<T>::setData(char *data, size_t dataSize) {
     }
 }
 
+template<typename T>
+void DBReader<T>::setDictionary(const char *dictionary, size_t dictionarySize) {
+    if (ddict != NULL) {
+        ZSTD_freeDDict(ddict);
+    }
+    // the dictionary is copied, the caller can release it afterwards
+    ddict = ZSTD_createDDict(dictionary, dictionarySize);
+    if (ddict == NULL) {
+        Debug(Debug::ERROR) << "Invalid compression dictionary\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
 template<typename T>
 void DBReader<T>::setMode(const int mode) {
     this->dataMode = mode;
@@ -1013,6 +1135,12 @@ void DBReader<T>::moveDb(const std::string &srcDbName, const std::string &dstDbN
     if (FileUtil::fileExists((srcDbName + ".lookup").c_str())) {
         FileUtil::move((srcDbName + ".lookup").c_str(), (dstDbName + ".lookup").c_str());
     }
+    if (FileUtil::fileExists(getDictionaryFileName(srcDbName).c_str())) {
+        FileUtil::move(getDictionaryFileName(srcDbName).c_str(), getDictionaryFileName(dstDbName).c_str());
+    } else if (FileUtil::fileExists(getDictionaryFileName(dstDbName).c_str())) {
+        // the dictionary of the replaced database would be used for the moved entries
+        FileUtil::remove(getDictionaryFileName(dstDbName).c_str());
+    }
 }
 
 template<typename T>
@@ -1037,6 +1165,10 @@ void DBReader<T>::removeDb(const std::string &databaseName){
     if (FileUtil::fileExists(lookupFile.c_str())) {
         FileUtil::remove(lookupFile.c_str());
     }
+    std::string dictionaryFile = getDictionaryFileName(databaseName);
+    if (FileUtil::fileExists(dictionaryFile.c_str())) {
+        FileUtil::remove(dictionaryFile.c_str());
+    }
 }
 
 template<typename T>
@@ -1067,17 +1199,21 @@ void DBReader<T>::softlinkDb(const std::string &databaseName, const std::string
     };
 
     const DBSuffix suffices[] = {
+        { DBFiles::DATA,          ".zdict"            },
         { DBFiles::DATA_INDEX,    ".index"            },
         { DBFiles::DATA_DBTYPE,   ".dbtype"           },
         { DBFiles::HEADER,        "_h"                },
+        { DBFiles::HEADER,        "_h.zdict"          },
         { DBFiles::HEADER_INDEX,  "_h.index"          },
         { DBFiles::HEADER_DBTYPE, "_h.dbtype"         },
         { DBFiles::LOOKUP,        ".lookup"           },
         { DBFiles::SOURCE,        ".source"           },
         { DBFiles::TAX_MAPPING,   "_mapping"          },
+        { DBFiles::TAX_MAPPING_BINARY, "_mapping.bin" },
         { DBFiles::TAX_NAMES,     "_names.dmp"        },
         { DBFiles::TAX_NODES,     "_nodes.dmp"        },
         { DBFiles::TAX_MERGED,    "_merged.dmp"       },
+        { DBFiles::TAX_BINARY,    "_taxonomy"         },
         { DBFiles::CA3M_DATA,     "_ca3m.ffdata"      },
         { DBFiles::CA3M_INDEX,    "_ca3m.ffindex"     },
         { DBFiles::CA3M_SEQ,      "_sequence.ffdata"  },
@@ -38,11 +38,13 @@ struct DBFiles {
         CA3M_SEQ_IDX      = (1ull << 15),
         CA3M_HDR          = (1ull << 16),
         CA3M_HDR_IDX      = (1ull << 17),
+        TAX_BINARY        = (1ull << 18),
+        TAX_MAPPING_BINARY= (1ull << 19),
 
 
         GENERIC           = DATA | DATA_INDEX | DATA_DBTYPE,
         HEADERS           = HEADER | HEADER_INDEX | HEADER_DBTYPE,
-        TAXONOMY          = TAX_MAPPING | TAX_NAMES | TAX_NODES | TAX_MERGED,
+        TAXONOMY          = TAX_MAPPING | TAX_NAMES | TAX_NODES | TAX_MERGED | TAX_BINARY | TAX_MAPPING_BINARY,
         SEQUENCE_DB       = GENERIC | HEADERS | TAXONOMY | LOOKUP | SOURCE,
         SEQUENCE_ANCILLARY= SEQUENCE_DB & (~GENERIC),
         SEQUENCE_NO_DATA_INDEX = SEQUENCE_DB & (~DATA_INDEX),
@@ -98,6 +100,18 @@ public:
         }
     };
 
+    // .index files that start with BINARY_INDEX_MAGIC hold this header followed by
+    // size Index records in native byte order, they are memory mapped instead of parsed
+    struct BinaryIndexHeader {
+        char magic[8];
+        unsigned int version;
+        unsigned int flags;
+        size_t size;
+        size_t dataSize;
+        unsigned int maxSeqLen;
+        unsigned int lastKey;
+    };
+
     struct LookupEntry {
         T id;
         std::string entryName;
@@ -245,6 +259,22 @@ public:
     static const unsigned int USE_FREAD      = 4;
     static const unsigned int USE_LOOKUP     = 8;
     static const unsigned int USE_LOOKUP_REV = 16;
+    // the caller reads binary result records (Parameters::DBTYPE_BINARY_FLAG), all other readers reject them
+    static const unsigned int USE_BINARY     = 32;
+
+    static const char BINARY_INDEX_MAGIC[8];
+    static const unsigned int BINARY_INDEX_VERSION = 1;
+    static const unsigned int BINARY_INDEX_SORTED_BY_ID     = 1;
+    static const unsigned int BINARY_INDEX_SORTED_BY_OFFSET = 2;
+
+    static bool isBinaryIndexFile(const char *indexFileName);
+    // workflow scripts read .index files with awk, sort and join, they need the text form
+    static void requireTextIndex(const std::string &databaseName);
+
+    // all compressed entries of a database share the zstd dictionary stored next to the data file
+    static std::string getDictionaryFileName(const std::string &dataFileName) {
+        return dataFileName + ".zdict";
+    }
 
 
     // compressed
@@ -287,6 +317,8 @@ public:
 
     void readIndexId(T* id, char * line, const char** cols);
 
+    bool mapBinaryIndex();
+
     void readMmapedDataInMemory();
 
     void mlock();
@@ -381,6 +413,9 @@ public:
 
     void setData(char *data, size_t dataSize);
 
+    // compression dictionary of readers whose data does not come from a data file (e.g. precomputed indices)
+    void setDictionary(const char *dictionary, size_t dictionarySize);
+
     void setMode(const int mode);
 
     size_t getOffset(size_t id);
@@ -393,6 +428,23 @@ public:
 
     static int isCompressed(int dbtype);
 
+    bool isBinary(){
+        return isBinary(dbtype);
+    }
+
+    static bool isBinary(int dbtype) {
+        return (dbtype & Parameters::DBTYPE_BINARY_FLAG) != 0;
+    }
+
+    // returns an entry of a binary database as array of fixed-width records
+    template <typename R>
+    std::pair<const R*, size_t> getRecords(size_t id, int thrIdx) {
+        const char *data = getData(id, thrIdx);
+        // the index length contains the null byte that terminates each entry
+        size_t length = getEntryLen(id);
+        return std::make_pair(reinterpret_cast<const R*>(data), (length == 0 ? 0 : length - 1) / sizeof(R));
+    }
+
     void setSequentialAdvice();
 
     void decomposeDomainByAminoAcid(size_t worldRank, size_t worldSize, size_t *startEntry, size_t *numEntries);
@@ -432,7 +484,8 @@ private:
     int compression;
     char ** compressedBuffers;
     size_t * compressedBufferSizes;
-    ZSTD_DStream ** dstream;
+    ZSTD_DCtx ** dctx;
+    ZSTD_DDict * ddict;
 
     Index * index;
     size_t lookupSize;
@@ -445,6 +498,10 @@ private:
     bool dataMapped;
     int accessType;
 
+    // memory mapped binary index, index points into it
+    char *indexMapping;
+    size_t indexMappingSize;
+
     bool externalData;
 
     bool didMlock;
@@ -8,10 +8,14 @@
 #include "Timer.h"
 #include "Parameters.h"
 
+#include <dictBuilder/zdict.h>
+
 #include <cstdlib>
 #include <cstdio>
 #include <sstream>
 #include <unistd.h>
+#include <climits>
+#include <sys/mman.h>
 
 #ifdef OPENMP
 #include <omp.h>
@@ -31,14 +35,16 @@ DBWriter::DBWriter(const char *dataFileName_, const char *indexFileName_, unsign
     indexFileNames = new char *[threads];
     compressedBuffers=NULL;
     compressedBufferSizes=NULL;
+    pendingEntries = NULL;
+    cdict = NULL;
     if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
         compressedBuffers = new char*[threads];
         compressedBufferSizes = new size_t[threads];
-        cstream = new ZSTD_CStream*[threads];
-        state = new int[threads];
+        cctx = new ZSTD_CCtx*[threads];
         threadBuffer = new char*[threads];
         threadBufferSize = new size_t[threads];
         threadBufferOffset = new size_t[threads];
+        pendingEntries = new std::vector<PendingEntry>[threads];
     }
 
     starts = new size_t[threads];
@@ -61,7 +67,7 @@ size_t DBWriter::addToThreadBuffer(const void *data, size_t itmesize, size_t nit
         size_t newBufferSize = std::max(threadBufferSize[threadIdx] + bytesToWrite, threadBufferSize[threadIdx] * 2 );
         threadBufferSize[threadIdx] = newBufferSize;
         threadBuffer[threadIdx] = (char*) realloc(threadBuffer[threadIdx], newBufferSize);
-        if(compressedBuffers[threadIdx] == NULL){
+        if(threadBuffer[threadIdx] == NULL){
             Debug(Debug::ERROR) << "Realloc of buffer for " << threadIdx << " failed. Buffer size = " << threadBufferSize[threadIdx] << "\n";
             EXIT(EXIT_FAILURE);
         }
@@ -87,8 +93,8 @@ DBWriter::~DBWriter() {
         delete [] threadBufferOffset;
         delete [] compressedBuffers;
         delete [] compressedBufferSizes;
-        delete [] cstream;
-        delete [] state;
+        delete [] cctx;
+        delete [] pendingEntries;
     }
 }
 
@@ -171,6 +177,11 @@ void DBWriter::open(size_t bufferSize) {
             bufferSize = 64ull * 1024 * 1024;
         }
     }
+    // a dictionary of a previous database with the same name is no longer valid
+    std::string dictionaryFile = DBReader<unsigned int>::getDictionaryFileName(dataFileName);
+    if (FileUtil::fileExists(dictionaryFile.c_str())) {
+        FileUtil::remove(dictionaryFile.c_str());
+    }
     for (unsigned int i = 0; i < threads; i++) {
         dataFileNames[i] = makeResultFilename(dataFileName, i);
         indexFileNames[i] = makeResultFilename(indexFileName, i);
@@ -216,12 +227,15 @@ void DBWriter::open(size_t bufferSize) {
         if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
             compressedBufferSizes[i] = 2097152;
             threadBufferSize[i] = 2097152;
-            state[i] = false;
             compressedBuffers[i] = (char*) malloc(compressedBufferSizes[i]);
             threadBuffer[i] = (char*) malloc(threadBufferSize[i]);
-            cstream[i] = ZSTD_createCStream();
+            cctx[i] = ZSTD_createCCtx();
         }
     }
+    if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
+        pendingSize = 0;
+        dictionaryReady = false;
+    }
 
     closed = false;
 }
@@ -244,6 +258,26 @@ void DBWriter::writeDbtypeFile(const char* path, int dbtype, bool isCompressed)
 
 
 void DBWriter::close(bool merge) {
+    if(compressedBuffers){
+        // databases smaller than the sample size are compressed only now
+        if (dictionaryReady == false) {
+            trainDictionary();
+        }
+#pragma omp parallel for schedule(dynamic, 1)
+        for (unsigned int i = 0; i < threads; i++) {
+            writePendingEntries(i);
+        }
+        if (dictionary.empty() == false) {
+            std::string dictionaryFile = DBReader<unsigned int>::getDictionaryFileName(dataFileName);
+            FILE *file = FileUtil::openAndDelete(dictionaryFile.c_str(), "wb");
+            if (fwrite(dictionary.data(), sizeof(char), dictionary.size(), file) != dictionary.size()) {
+                Debug(Debug::ERROR) << "Can not write to dictionary file " << dictionaryFile << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            fclose(file);
+        }
+    }
+
     // close all datafiles
     for (unsigned int i = 0; i < threads; i++) {
         fclose(dataFiles[i]);
@@ -254,12 +288,16 @@ void DBWriter::close(bool merge) {
         for (unsigned int i = 0; i < threads; i++) {
             free(compressedBuffers[i]);
             free(threadBuffer[i]);
-            ZSTD_freeCStream(cstream[i]);
+            ZSTD_freeCCtx(cctx[i]);
         }
+        ZSTD_freeCDict(cdict);
+        cdict = NULL;
+        dictionary.clear();
     }
 
     mergeResults(dataFileName, indexFileName, (const char **) dataFileNames, (const char **) indexFileNames,
-                 threads, merge, ((mode & Parameters::WRITER_LEXICOGRAPHIC_MODE) != 0));
+                 threads, merge, ((mode & Parameters::WRITER_LEXICOGRAPHIC_MODE) != 0),
+                 ((mode & Parameters::WRITER_BINARY_INDEX_MODE) != 0));
 
     writeDbtypeFile(dataFileName, dbtype, (mode & Parameters::WRITER_COMPRESSED_MODE) != 0);
 
@@ -279,15 +317,7 @@ void DBWriter::writeStart(unsigned int thrIdx) {
     }
     starts[thrIdx] = offsets[thrIdx];
     if((mode & Parameters::WRITER_COMPRESSED_MODE) != 0){
-        state[thrIdx] = INIT_STATE;
         threadBufferOffset[thrIdx]=0;
-        int cLevel = 3;
-        size_t const initResult = ZSTD_initCStream(cstream[thrIdx], cLevel);
-        if (ZSTD_isError(initResult)) {
-            Debug(Debug::ERROR) << "ZSTD_initCStream() error in thread " << thrIdx << ". Error "
-                                << ZSTD_getErrorName(initResult) << "\n";
-            EXIT(EXIT_FAILURE);
-        }
     }
 }
 
@@ -297,116 +327,166 @@ size_t DBWriter::writeAdd(const char* data, size_t dataSize, unsigned int thrIdx
         Debug(Debug::ERROR) << "Thread index " << thrIdx << " > maximum thread number " << threads << "\n";
         EXIT(EXIT_FAILURE);
     }
+    // compressed entries are collected and compressed as a whole in writeEnd
     bool isCompressedDB = (mode & Parameters::WRITER_COMPRESSED_MODE) != 0;
-    if(isCompressedDB && state[thrIdx] == INIT_STATE && dataSize < 60){
-        state[thrIdx] = NOTCOMPRESSED;
-    }
-    size_t totalWriten = 0;
-    if(isCompressedDB && (state[thrIdx] == INIT_STATE || state[thrIdx] == COMPRESSED) ) {
-        state[thrIdx] = COMPRESSED;
-        // zstd seems to have a hard time with elements < 60
-        ZSTD_inBuffer input = { data, dataSize, 0 };
-        while (input.pos < input.size) {
-            ZSTD_outBuffer output = {compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], 0};
-            size_t toRead = ZSTD_compressStream( cstream[thrIdx], &output, &input);   /* toRead is guaranteed to be <= ZSTD_CStreamInSize() */
-            if (ZSTD_isError(toRead)) {
-                Debug(Debug::ERROR) << "ZSTD_compressStream() error in thread " << thrIdx << ". Error "
-                                    << ZSTD_getErrorName(toRead) << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            size_t written = addToThreadBuffer(compressedBuffers[thrIdx], sizeof(char), output.pos, thrIdx);
-            if (written != output.pos) {
-                Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            offsets[thrIdx] += written;
-            totalWriten += written;
-        }
+    size_t written;
+    if(isCompressedDB){
+        written = addToThreadBuffer(data, sizeof(char), dataSize,  thrIdx);
     }else{
-        size_t written;
-        if(isCompressedDB){
-            written = addToThreadBuffer(data, sizeof(char), dataSize,  thrIdx);
-        }else{
-            written = fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
-        }
-        if (written != dataSize) {
-            Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
-            EXIT(EXIT_FAILURE);
-        }
+        written = fwrite(data, sizeof(char), dataSize, dataFiles[thrIdx]);
         offsets[thrIdx] += written;
     }
+    if (written != dataSize) {
+        Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
+        EXIT(EXIT_FAILURE);
+    }
 
-    return totalWriten;
+    return written;
 }
 
 void DBWriter::writeEnd(unsigned int key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
-    // close stream
     bool isCompressedDB = (mode & Parameters::WRITER_COMPRESSED_MODE) != 0;
-    if(isCompressedDB) {
-        size_t compressedLength = 0;
-        if(state[thrIdx] == COMPRESSED) {
-            ZSTD_outBuffer output = {compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], 0};
-            size_t remainingToFlush = ZSTD_endStream(cstream[thrIdx], &output); /* close frame */
-
-            //        std::cout << compressedLength << std::endl;
-            if (ZSTD_isError(remainingToFlush)) {
-                Debug(Debug::ERROR) << "ZSTD_endStream() error in thread " << thrIdx << ". Error "
-                                    << ZSTD_getErrorName(remainingToFlush) << "\n";
-                EXIT(EXIT_FAILURE);
-            }
-            if (remainingToFlush) {
-                Debug(Debug::ERROR) << "Stream not flushed\n";
-                EXIT(EXIT_FAILURE);
+    if (isCompressedDB) {
+        if (__atomic_load_n(&dictionaryReady, __ATOMIC_ACQUIRE) == false) {
+            bool isPending = false;
+#pragma omp critical(DBWriterDictionary)
+            {
+                if (dictionaryReady == false) {
+                    isPending = true;
+                    const char *data = threadBuffer[thrIdx];
+                    const size_t dataSize = threadBufferOffset[thrIdx];
+                    PendingEntry entry;
+                    entry.key = key;
+                    entry.addNullByte = addNullByte;
+                    entry.addIndexEntry = addIndexEntry;
+                    entry.data.assign(data, data + dataSize);
+                    pendingEntries[thrIdx].push_back(entry);
+                    pendingSize += dataSize;
+
+                    const size_t sampleSize = std::min(dataSize, MAX_SAMPLE_ENTRY_SIZE);
+                    if (sampleSize > 0) {
+                        dictionarySamples.insert(dictionarySamples.end(), data, data + sampleSize);
+                        dictionarySampleSizes.push_back(sampleSize);
+                    }
+                    if (dictionarySamples.size() >= DICTIONARY_SAMPLE_SIZE || pendingSize >= MAX_PENDING_SIZE) {
+                        trainDictionary();
+                    }
+                }
             }
-            size_t written = addToThreadBuffer(compressedBuffers[thrIdx], sizeof(char), output.pos, thrIdx);
-            compressedLength = threadBufferOffset[thrIdx];
-            offsets[thrIdx] += written;
-            if (written != output.pos) {
-                Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
-                EXIT(EXIT_FAILURE);
+            if (isPending) {
+                if (__atomic_load_n(&dictionaryReady, __ATOMIC_ACQUIRE) == true) {
+                    writePendingEntries(thrIdx);
+                }
+                return;
             }
-        }else {
-            compressedLength = offsets[thrIdx] - starts[thrIdx];
         }
-        unsigned int compressedLengthInt = static_cast<unsigned int>(compressedLength);
-        size_t written2 = fwrite(&compressedLengthInt, sizeof(unsigned int), 1, dataFiles[thrIdx]);
-        if (written2 != 1) {
-            Debug(Debug::ERROR) << "Can not write entry length to data file " << dataFileNames[thrIdx] << "\n";
-            EXIT(EXIT_FAILURE);
-        }
-        offsets[thrIdx] +=  sizeof(unsigned int);
-        writeThreadBuffer(thrIdx, compressedLength);
+        writePendingEntries(thrIdx);
+        compressEntry(threadBuffer[thrIdx], threadBufferOffset[thrIdx], key, thrIdx, addNullByte, addIndexEntry);
+        return;
     }
 
-
-    size_t totalWritten = 0;
 // entries are always separated by a null byte
     if (addNullByte == true) {
         char nullByte = '\0';
-        if(isCompressedDB && state[thrIdx]==NOTCOMPRESSED){
-            nullByte = static_cast<char>(0xFF);
-        }
         const size_t written = fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]);
         if (written != 1) {
             Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
             EXIT(EXIT_FAILURE);
         }
-        totalWritten += written;
         offsets[thrIdx] += 1;
     }
 
     if (addIndexEntry == true) {
         size_t length = offsets[thrIdx] - starts[thrIdx];
-// keep original size in index
-        if (isCompressedDB && state[thrIdx]==COMPRESSED) {
-            ZSTD_frameProgression progression = ZSTD_getFrameProgression(cstream[thrIdx]);
-            length = progression.consumed + totalWritten;
+        writeIndexEntry(key, starts[thrIdx], length, thrIdx);
+    }
+}
+
+void DBWriter::compressEntry(const char *data, size_t dataSize, unsigned int key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry) {
+    starts[thrIdx] = offsets[thrIdx];
+    const char *payload = data;
+    size_t payloadSize = dataSize;
+    if (dataSize >= MIN_COMPRESSED_SIZE) {
+        const size_t bound = ZSTD_compressBound(dataSize);
+        if (bound > compressedBufferSizes[thrIdx]) {
+            compressedBufferSizes[thrIdx] = bound;
+            compressedBuffers[thrIdx] = (char*) realloc(compressedBuffers[thrIdx], bound);
+            if (compressedBuffers[thrIdx] == NULL) {
+                Debug(Debug::ERROR) << "Realloc of compression buffer for " << thrIdx << " failed. Buffer size = " << bound << "\n";
+                EXIT(EXIT_FAILURE);
+            }
         }
-        if (isCompressedDB && state[thrIdx]==NOTCOMPRESSED) {
-            length -= sizeof(unsigned int);
+        const size_t compressedSize = (cdict != NULL)
+            ? ZSTD_compress_usingCDict(cctx[thrIdx], compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], data, dataSize, cdict)
+            : ZSTD_compressCCtx(cctx[thrIdx], compressedBuffers[thrIdx], compressedBufferSizes[thrIdx], data, dataSize, COMPRESSION_LEVEL);
+        if (ZSTD_isError(compressedSize)) {
+            Debug(Debug::ERROR) << "ZSTD_compress() error in thread " << thrIdx << ". Error "
+                                << ZSTD_getErrorName(compressedSize) << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        // entries that do not shrink are stored uncompressed
+        if (compressedSize < dataSize) {
+            payload = compressedBuffers[thrIdx];
+            payloadSize = compressedSize;
         }
-        writeIndexEntry(key, starts[thrIdx], length, thrIdx);
     }
+
+    // each entry starts with the stored length and is followed by a null byte for compressed
+    // or 0xFF for uncompressed entries
+    unsigned int payloadSizeInt = static_cast<unsigned int>(payloadSize);
+    if (fwrite(&payloadSizeInt, sizeof(unsigned int), 1, dataFiles[thrIdx]) != 1
+        || fwrite(payload, sizeof(char), payloadSize, dataFiles[thrIdx]) != payloadSize) {
+        Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    offsets[thrIdx] += sizeof(unsigned int) + payloadSize;
+
+    if (addNullByte == true) {
+        char nullByte = (payload == data) ? static_cast<char>(0xFF) : '\0';
+        if (fwrite(&nullByte, sizeof(char), 1, dataFiles[thrIdx]) != 1) {
+            Debug(Debug::ERROR) << "Can not write to data file " << dataFileNames[thrIdx] << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        offsets[thrIdx] += 1;
+    }
+
+    // keep original size in index
+    if (addIndexEntry == true) {
+        writeIndexEntry(key, starts[thrIdx], dataSize + (addNullByte ? 1 : 0), thrIdx);
+    }
+}
+
+void DBWriter::writePendingEntries(unsigned int thrIdx) {
+    std::vector<PendingEntry> &entries = pendingEntries[thrIdx];
+    for (size_t i = 0; i < entries.size(); i++) {
+        compressEntry(entries[i].data.data(), entries[i].data.size(), entries[i].key, thrIdx, entries[i].addNullByte, entries[i].addIndexEntry);
+    }
+    std::vector<PendingEntry>().swap(entries);
+}
+
+void DBWriter::trainDictionary() {
+    // zstd recommends about 100 times more sample data than the size of the dictionary
+    const size_t capacity = std::min(MAX_DICTIONARY_SIZE, dictionarySamples.size() / 100);
+    if (dictionarySampleSizes.size() >= MIN_DICTIONARY_SAMPLES && capacity >= MIN_DICTIONARY_SIZE) {
+        dictionary.resize(capacity);
+        size_t dictionarySize = ZDICT_trainFromBuffer(dictionary.data(), capacity, dictionarySamples.data(),
+                                                      dictionarySampleSizes.data(), dictionarySampleSizes.size());
+        // entries are compressed without dictionary if the samples are not sufficient
+        if (ZDICT_isError(dictionarySize)) {
+            dictionary.clear();
+        } else {
+            dictionary.resize(dictionarySize);
+            cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), COMPRESSION_LEVEL);
+            if (cdict == NULL) {
+                Debug(Debug::ERROR) << "ZSTD_createCDict() error\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+    }
+    std::vector<char>().swap(dictionarySamples);
+    std::vector<size_t>().swap(dictionarySampleSizes);
+    pendingSize = 0;
+    __atomic_store_n(&dictionaryReady, true, __ATOMIC_RELEASE);
 }
 
 void DBWriter::writeIndexEntry(unsigned int key, size_t offset, size_t length, unsigned int thrIdx){
@@ -464,6 +544,12 @@ void DBWriter::checkClosed() {
 void DBWriter::mergeResults(const std::string &outFileName, const std::string &outFileNameIndex,
                             const std::vector<std::pair<std::string, std::string >> &files,
                             const bool lexicographicOrder) {
+    for (size_t i = 0; i < files.size(); i++) {
+        if (FileUtil::fileExists(DBReader<unsigned int>::getDictionaryFileName(files[i].first).c_str())) {
+            recompressResults(outFileName, outFileNameIndex, files, lexicographicOrder);
+            return;
+        }
+    }
     const char **datafilesNames = new const char *[files.size()];
     const char **indexFilesNames = new const char *[files.size()];
     for (size_t i = 0; i < files.size(); i++) {
@@ -490,6 +576,46 @@ void DBWriter::mergeResults(const std::string &outFileName, const std::string &o
     }
 }
 
+// each split was compressed with its own dictionary, the entries are recompressed with a shared one
+void DBWriter::recompressResults(const std::string &outFileName, const std::string &outFileNameIndex,
+                                 const std::vector<std::pair<std::string, std::string>> &files,
+                                 const bool lexicographicOrder) {
+    unsigned int threads = 1;
+#ifdef OPENMP
+    threads = static_cast<unsigned int>(omp_get_max_threads());
+#endif
+    const int dbtype = FileUtil::parseDbType(files[0].first.c_str());
+    size_t mode = Parameters::WRITER_COMPRESSED_MODE;
+    if (lexicographicOrder) {
+        mode |= Parameters::WRITER_LEXICOGRAPHIC_MODE;
+    }
+    DBWriter writer(outFileName.c_str(), outFileNameIndex.c_str(), threads, mode, dbtype);
+    writer.open();
+    for (size_t i = 0; i < files.size(); i++) {
+        DBReader<unsigned int> reader(files[i].first.c_str(), files[i].second.c_str(), threads,
+                                      DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
+        reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
+#pragma omp parallel
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+#pragma omp for schedule(dynamic, 100)
+            for (size_t id = 0; id < reader.getSize(); id++) {
+                const size_t length = reader.getEntryLen(id);
+                writer.writeData(reader.getData(id, thread_idx), (length == 0) ? 0 : length - 1, reader.getDbKey(id), thread_idx);
+            }
+        }
+        reader.close();
+        DBReader<unsigned int>::removeDb(files[i].first);
+        if (files[i].second != (files[i].first + ".index") && FileUtil::fileExists(files[i].second.c_str())) {
+            FileUtil::remove(files[i].second.c_str());
+        }
+    }
+    writer.close();
+}
+
 template <>
 void DBWriter::writeIndexEntryToFile(FILE *outFile, char *buff1, DBReader<unsigned int>::Index &index){
     char * tmpBuff = Itoa::u32toa_sse2((uint32_t)index.id,buff1);
@@ -538,10 +664,70 @@ void DBWriter::writeIndex(FILE *outFile, size_t indexSize, DBReader<std::string>
     }
 }
 
+void DBWriter::writeBinaryIndex(FILE *outFile, size_t indexSize, DBReader<unsigned int>::Index *index) {
+    DBReader<unsigned int>::BinaryIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DBReader<unsigned int>::BINARY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = DBReader<unsigned int>::BINARY_INDEX_VERSION;
+    header.size = indexSize;
+    bool sortedById = true;
+    bool sortedByOffset = true;
+    for (size_t i = 0; i < indexSize; i++) {
+        if (i > 0) {
+            sortedById = sortedById && index[i].id >= index[i - 1].id;
+            sortedByOffset = sortedByOffset && index[i].offset >= index[i - 1].offset;
+        }
+        header.dataSize += index[i].length;
+        header.maxSeqLen = std::max(header.maxSeqLen, index[i].length);
+        header.lastKey = std::max(header.lastKey, index[i].id);
+    }
+    header.flags = (sortedById ? DBReader<unsigned int>::BINARY_INDEX_SORTED_BY_ID : 0)
+                   | (sortedByOffset ? DBReader<unsigned int>::BINARY_INDEX_SORTED_BY_OFFSET : 0);
+    if (fwrite(&header, sizeof(header), 1, outFile) != 1) {
+        Debug(Debug::ERROR) << "Can not write binary index header\n";
+        EXIT(EXIT_FAILURE);
+    }
+
+    // copy the records to clear the struct padding
+    const size_t bufferEntries = 1024;
+    DBReader<unsigned int>::Index buffer[bufferEntries];
+    for (size_t start = 0; start < indexSize; start += bufferEntries) {
+        const size_t entries = std::min(bufferEntries, indexSize - start);
+        memset(buffer, 0, entries * sizeof(DBReader<unsigned int>::Index));
+        for (size_t i = 0; i < entries; i++) {
+            buffer[i].id = index[start + i].id;
+            buffer[i].offset = index[start + i].offset;
+            buffer[i].length = index[start + i].length;
+        }
+        if (fwrite(buffer, sizeof(DBReader<unsigned int>::Index), entries, outFile) != entries) {
+            Debug(Debug::ERROR) << "Can not write binary index entries\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+}
+
+void DBWriter::convertIndex(const char *inFileNameIndex, const char *outFileNameIndex, bool binary) {
+    DBReader<unsigned int> reader(inFileNameIndex, inFileNameIndex, 1, DBReader<unsigned int>::USE_INDEX);
+    reader.open(DBReader<unsigned int>::HARDNOSORT);
+    // write to a temporary file first, input and output can be the same file
+    std::string indexTmp = std::string(outFileNameIndex) + "_tmp";
+    FILE *indexFile = FileUtil::openAndDelete(indexTmp.c_str(), "w");
+    if (binary) {
+        writeBinaryIndex(indexFile, reader.getSize(), reader.getIndex());
+    } else {
+        writeIndex(indexFile, reader.getSize(), reader.getIndex());
+    }
+    if (fclose(indexFile) != 0) {
+        Debug(Debug::ERROR) << "Can not close index file " << indexTmp << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    reader.close();
+    std::rename(indexTmp.c_str(), outFileNameIndex);
+}
 
 void DBWriter::mergeResults(const char *outFileName, const char *outFileNameIndex,
                             const char **dataFileNames, const char **indexFileNames,
-                            unsigned long fileCount, bool mergeDatafiles, bool lexicographicOrder) {
+                            unsigned long fileCount, bool mergeDatafiles, bool lexicographicOrder, bool binaryIndex) {
     Timer timer;
     std::vector<std::vector<std::string>> dataFilenames;
     for (unsigned int i = 0; i < fileCount; ++i) {
@@ -549,9 +735,10 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
     }
 
     // merge results into one result file
+    std::vector<size_t> mergedSizes;
     if (dataFilenames.size() > 1) {
         std::vector<FILE*> datafiles;
-        std::vector<size_t> mergedSizes;
+        std::vector<size_t> fileSizes;
         for (unsigned int i = 0; i < dataFilenames.size(); i++) {
             std::vector<std::string>& filenames = dataFilenames[i];
             size_t cumulativeSize = 0;
@@ -568,6 +755,7 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
                     EXIT(EXIT_FAILURE);
                 }
                 datafiles.emplace_back(fh);
+                fileSizes.emplace_back(sb.st_size);
                 cumulativeSize += sb.st_size;
             }
             mergedSizes.push_back(cumulativeSize);
@@ -575,7 +763,7 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
 
         if (mergeDatafiles) {
             FILE *outFh = FileUtil::openAndDelete(outFileName, "w");
-            Concat::concatFiles(datafiles, outFh);
+            Concat::concatFilesParallel(datafiles, fileSizes, outFh);
             fclose(outFh);
         }
 
@@ -591,9 +779,6 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
                 }
             }
         }
-
-        // merge index
-        mergeIndex(indexFileNames, dataFilenames.size(), mergedSizes);
     } else {
         std::vector<std::string>& filenames = dataFilenames[0];
         if (filenames.size() == 1) {
@@ -605,8 +790,15 @@ void DBWriter::mergeResults(const char *outFileName, const char *outFileNameInde
         }
     }
 
-    DBWriter::sortIndex(indexFileNames[0], outFileNameIndex, lexicographicOrder);
-    FileUtil::remove(indexFileNames[0]);
+    if (lexicographicOrder) {
+        if (dataFilenames.size() > 1) {
+            mergeIndex(indexFileNames, dataFilenames.size(), mergedSizes);
+        }
+        DBWriter::sortIndex(indexFileNames[0], outFileNameIndex, lexicographicOrder, binaryIndex);
+        FileUtil::remove(indexFileNames[0]);
+    } else {
+        mergeSortedIndex(indexFileNames, dataFilenames.size(), mergedSizes, outFileNameIndex, binaryIndex);
+    }
     Debug(Debug::INFO) << "Time for merging to " << FileUtil::baseName(outFileName) << ": " << timer.lap() << "\n";
 }
 
@@ -636,18 +828,300 @@ void DBWriter::mergeIndex(const char** indexFilenames, unsigned int fileCount, c
     fclose(index_file);
 }
 
-void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder){
+// number of entries in the runs [lo, hi) that are smaller than id (and offset if useOffset is set)
+static size_t countLessInRuns(const DBReader<unsigned int>::Index *index, const std::vector<size_t> &lo, const std::vector<size_t> &hi,
+                              uint64_t id, size_t offset, bool useOffset, std::vector<size_t> &cut) {
+    size_t count = 0;
+    for (size_t run = 0; run < lo.size(); run++) {
+        const DBReader<unsigned int>::Index *pos = std::partition_point(index + lo[run], index + hi[run],
+            [id, offset, useOffset](const DBReader<unsigned int>::Index &entry) {
+                return entry.id < id || (useOffset && entry.id == id && entry.offset < offset);
+            });
+        cut[run] = pos - index;
+        count += cut[run] - lo[run];
+    }
+    return count;
+}
+
+// finds the cut in every sorted run so that the entries before the cuts are the r smallest entries of all runs
+static void selectInRuns(const DBReader<unsigned int>::Index *index, const std::vector<size_t> &lo, const std::vector<size_t> &hi,
+                         size_t r, std::vector<size_t> &cut) {
+    cut.resize(lo.size());
+    // largest id with at most r smaller entries
+    uint64_t low = 0;
+    uint64_t high = static_cast<uint64_t>(UINT_MAX) + 1;
+    while (low < high) {
+        uint64_t mid = high - (high - low) / 2;
+        if (countLessInRuns(index, lo, hi, mid, 0, false, cut) <= r) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    size_t taken = countLessInRuns(index, lo, hi, low, 0, false, cut);
+    if (taken == r) {
+        return;
+    }
+    // the rest has the same id, continue on the offset
+    size_t lowOffset = 0;
+    size_t highOffset = SIZE_MAX;
+    while (lowOffset < highOffset) {
+        size_t mid = highOffset - (highOffset - lowOffset) / 2;
+        if (countLessInRuns(index, lo, hi, low, mid, true, cut) <= r) {
+            lowOffset = mid;
+        } else {
+            highOffset = mid - 1;
+        }
+    }
+    taken = countLessInRuns(index, lo, hi, low, lowOffset, true, cut);
+    // entries with the same id and offset are interchangeable
+    for (size_t run = 0; run < lo.size() && taken < r; run++) {
+        while (taken < r && cut[run] < hi[run] && index[cut[run]].id == low && index[cut[run]].offset == lowOffset) {
+            cut[run]++;
+            taken++;
+        }
+    }
+}
+
+void DBWriter::mergeSortedIndex(const char **indexFileNames, unsigned int fileCount, const std::vector<size_t> &dataSizes,
+                                const char *outFileNameIndex, bool binaryIndex) {
+    typedef DBReader<unsigned int>::Index Index;
+    // map all index files and count their entries
+    std::vector<char*> fileData(fileCount, NULL);
+    std::vector<size_t> fileSizes(fileCount, 0);
+    std::vector<char> isBinary(fileCount, false);
+    std::vector<size_t> lo(fileCount + 1, 0);
+    std::vector<size_t> globalOffsets(fileCount, 0);
+    for (unsigned int fileIdx = 1; fileIdx < fileCount; fileIdx++) {
+        globalOffsets[fileIdx] = globalOffsets[fileIdx - 1] + dataSizes[fileIdx - 1];
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (unsigned int fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        FILE *file = fopen(indexFileNames[fileIdx], "r");
+        if (file == NULL) {
+            Debug(Debug::ERROR) << "Can not open index file " << indexFileNames[fileIdx] << "!\n";
+            EXIT(EXIT_FAILURE);
+        }
+        struct stat sb;
+        if (fstat(fileno(file), &sb) < 0) {
+            Debug(Debug::ERROR) << "Failed to fstat file " << indexFileNames[fileIdx] << ". Error " << errno << ".\n";
+            EXIT(EXIT_FAILURE);
+        }
+        fileSizes[fileIdx] = sb.st_size;
+        if (fileSizes[fileIdx] > 0) {
+            fileData[fileIdx] = static_cast<char*>(mmap(NULL, fileSizes[fileIdx], PROT_READ, MAP_PRIVATE, fileno(file), 0));
+            if (fileData[fileIdx] == MAP_FAILED) {
+                Debug(Debug::ERROR) << "Failed to mmap index file " << indexFileNames[fileIdx] << ". Error " << errno << ".\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+        fclose(file);
+        isBinary[fileIdx] = fileSizes[fileIdx] >= sizeof(DBReader<unsigned int>::BinaryIndexHeader)
+                            && memcmp(fileData[fileIdx], DBReader<unsigned int>::BINARY_INDEX_MAGIC, sizeof(DBReader<unsigned int>::BINARY_INDEX_MAGIC)) == 0;
+        if (isBinary[fileIdx]) {
+            lo[fileIdx + 1] = reinterpret_cast<DBReader<unsigned int>::BinaryIndexHeader*>(fileData[fileIdx])->size;
+        } else {
+            lo[fileIdx + 1] = Util::ompCountLines(fileData[fileIdx], fileSizes[fileIdx], 1);
+        }
+    }
+    for (unsigned int fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        lo[fileIdx + 1] += lo[fileIdx];
+    }
+    const size_t totalSize = lo[fileCount];
+    lo.pop_back();
+    std::vector<size_t> hi(lo.begin() + 1, lo.end());
+    hi.push_back(totalSize);
+
+    // parse every file into its own run and sort the runs that are not sorted yet
+    Index *index = new(std::nothrow) Index[totalSize];
+    Util::checkAllocation(index, "Can not allocate index memory in DBWriter");
+    size_t dataSize = 0;
+    unsigned int maxSeqLen = 0;
+    unsigned int lastKey = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:dataSize) reduction(max:maxSeqLen, lastKey)
+    for (unsigned int fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        Index *run = index + lo[fileIdx];
+        const size_t runSize = hi[fileIdx] - lo[fileIdx];
+        if (isBinary[fileIdx]) {
+            const Index *records = reinterpret_cast<const Index*>(fileData[fileIdx] + sizeof(DBReader<unsigned int>::BinaryIndexHeader));
+            for (size_t i = 0; i < runSize; i++) {
+                run[i].id = records[i].id;
+                run[i].offset = records[i].offset + globalOffsets[fileIdx];
+                run[i].length = records[i].length;
+            }
+        } else {
+            char *data = fileData[fileIdx];
+            const char *cols[3];
+            for (size_t i = 0; i < runSize; i++) {
+                Util::getWordsOfLine(data, cols, 3);
+                run[i].id = Util::fast_atoi<unsigned int>(cols[0]);
+                run[i].offset = Util::fast_atoi<size_t>(cols[1]) + globalOffsets[fileIdx];
+                run[i].length = Util::fast_atoi<size_t>(cols[2]);
+                data = Util::skipLine(data);
+            }
+        }
+        if (fileData[fileIdx] != NULL) {
+            munmap(fileData[fileIdx], fileSizes[fileIdx]);
+        }
+        bool isSorted = true;
+        for (size_t i = 0; i < runSize; i++) {
+            isSorted = isSorted && (i == 0 || Index::compareById(run[i], run[i - 1]) == false);
+            dataSize += run[i].length;
+            maxSeqLen = std::max(maxSeqLen, run[i].length);
+            lastKey = std::max(lastKey, run[i].id);
+        }
+        if (isSorted == false) {
+            std::sort(run, run + runSize, Index::compareById);
+        }
+    }
+    for (unsigned int fileIdx = 0; fileIdx < fileCount; fileIdx++) {
+        FileUtil::remove(indexFileNames[fileIdx]);
+    }
+
+    FILE *outFile = FileUtil::openAndDelete(outFileNameIndex, "w");
+    DBReader<unsigned int>::BinaryIndexHeader header;
+    if (binaryIndex) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, DBReader<unsigned int>::BINARY_INDEX_MAGIC, sizeof(header.magic));
+        header.version = DBReader<unsigned int>::BINARY_INDEX_VERSION;
+        header.size = totalSize;
+        header.dataSize = dataSize;
+        header.maxSeqLen = maxSeqLen;
+        header.lastKey = lastKey;
+        // the flags are only known after the merge, the header is written again at the end
+        if (fwrite(&header, sizeof(header), 1, outFile) != 1) {
+            Debug(Debug::ERROR) << "Can not write to index file " << outFileNameIndex << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+
+    // multiway merge of the runs in blocks, each thread merges and formats a slice of the block
+    unsigned int threads = 1;
+#ifdef OPENMP
+    threads = static_cast<unsigned int>(omp_get_max_threads());
+#endif
+    const size_t entriesPerThread = 65536;
+    const size_t maxEntrySize = std::max(sizeof(Index), static_cast<size_t>(64));
+    std::vector<std::vector<size_t>> splits(threads + 1);
+    std::vector<std::vector<char>> buffers(threads);
+    std::vector<size_t> bufferSizes(threads, 0);
+    std::vector<size_t> firstOffsets(threads, 0);
+    std::vector<size_t> lastOffsets(threads, 0);
+    std::vector<char> sliceSortedByOffset(threads, true);
+    bool sortedByOffset = true;
+    size_t prevOffset = 0;
+    splits[0] = lo;
+    for (size_t done = 0; done < totalSize;) {
+        const size_t blockSize = std::min(totalSize - done, threads * entriesPerThread);
+#pragma omp parallel
+        {
+#pragma omp for schedule(static, 1)
+            for (unsigned int t = 1; t <= threads; t++) {
+                selectInRuns(index, splits[0], hi, (blockSize * t) / threads, splits[t]);
+            }
+
+#pragma omp for schedule(static, 1)
+            for (unsigned int t = 0; t < threads; t++) {
+                const std::vector<size_t> &end = splits[t + 1];
+                std::vector<size_t> cursor(splits[t]);
+                std::vector<size_t> heap;
+                for (size_t run = 0; run < cursor.size(); run++) {
+                    if (cursor[run] < end[run]) {
+                        heap.push_back(run);
+                    }
+                }
+                // min-heap on the current entry of every run
+                auto greater = [&](size_t a, size_t b) {
+                    return Index::compareById(index[cursor[b]], index[cursor[a]]);
+                };
+                std::make_heap(heap.begin(), heap.end(), greater);
+
+                const size_t sliceSize = (blockSize * (t + 1)) / threads - (blockSize * t) / threads;
+                buffers[t].resize(sliceSize * maxEntrySize);
+                char *out = buffers[t].data();
+                bool sliceSorted = true;
+                size_t entryCount = 0;
+                while (heap.empty() == false) {
+                    std::pop_heap(heap.begin(), heap.end(), greater);
+                    const size_t run = heap.back();
+                    const Index &entry = index[cursor[run]];
+                    if (binaryIndex) {
+                        Index record;
+                        memset(&record, 0, sizeof(record));
+                        record.id = entry.id;
+                        record.offset = entry.offset;
+                        record.length = entry.length;
+                        memcpy(out, &record, sizeof(record));
+                        out += sizeof(record);
+                    } else {
+                        out += indexToBuffer(out, entry.id, entry.offset, entry.length);
+                    }
+                    if (entryCount == 0) {
+                        firstOffsets[t] = entry.offset;
+                    } else {
+                        sliceSorted = sliceSorted && entry.offset >= lastOffsets[t];
+                    }
+                    lastOffsets[t] = entry.offset;
+                    entryCount++;
+                    cursor[run]++;
+                    if (cursor[run] < end[run]) {
+                        std::push_heap(heap.begin(), heap.end(), greater);
+                    } else {
+                        heap.pop_back();
+                    }
+                }
+                bufferSizes[t] = out - buffers[t].data();
+                sliceSortedByOffset[t] = sliceSorted;
+            }
+        }
+
+        for (unsigned int t = 0; t < threads; t++) {
+            if (bufferSizes[t] == 0) {
+                continue;
+            }
+            if (fwrite(buffers[t].data(), sizeof(char), bufferSizes[t], outFile) != bufferSizes[t]) {
+                Debug(Debug::ERROR) << "Can not write to index file " << outFileNameIndex << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+            sortedByOffset = sortedByOffset && sliceSortedByOffset[t] && firstOffsets[t] >= prevOffset;
+            prevOffset = lastOffsets[t];
+        }
+        splits[0] = splits[threads];
+        done += blockSize;
+    }
+    delete[] index;
+
+    if (binaryIndex) {
+        header.flags = DBReader<unsigned int>::BINARY_INDEX_SORTED_BY_ID
+                       | (sortedByOffset ? DBReader<unsigned int>::BINARY_INDEX_SORTED_BY_OFFSET : 0);
+        if (fseek(outFile, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, outFile) != 1) {
+            Debug(Debug::ERROR) << "Can not write to index file " << outFileNameIndex << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+    }
+    if (fclose(outFile) != 0) {
+        Debug(Debug::ERROR) << "Can not close index file " << outFileNameIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder, const bool binaryIndex){
     if (lexicographicOrder == false) {
         // sort the index
         DBReader<unsigned int> indexReader(inFileNameIndex, inFileNameIndex, 1, DBReader<unsigned int>::USE_INDEX);
         indexReader.open(DBReader<unsigned int>::NOSORT);
         DBReader<unsigned int>::Index *index = indexReader.getIndex();
         FILE *index_file  = FileUtil::openAndDelete(outFileNameIndex, "w");
-        writeIndex(index_file, indexReader.getSize(), index);
+        if (binaryIndex) {
+            writeBinaryIndex(index_file, indexReader.getSize(), index);
+        } else {
+            writeIndex(index_file, indexReader.getSize(), index);
+        }
         fclose(index_file);
         indexReader.close();
 
     } else {
+        // string keys can only be stored in the text index
         DBReader<std::string> indexReader(inFileNameIndex, inFileNameIndex, 1, DBReader<std::string>::USE_INDEX);
         indexReader.open(DBReader<std::string>::SORT_BY_ID);
         DBReader<std::string>::Index *index = indexReader.getIndex();
@@ -658,14 +1132,6 @@ void DBWriter::sortIndex(const char *inFileNameIndex, const char *outFileNameInd
     }
 }
 
-void DBWriter::writeThreadBuffer(unsigned int idx, size_t dataSize) {
-    size_t written = fwrite(threadBuffer[idx], 1, dataSize, dataFiles[idx]);
-    if (written != dataSize) {
-        Debug(Debug::ERROR) << "writeThreadBuffer: Could not write to data file " << dataFileNames[idx] << "\n";
-        EXIT(EXIT_FAILURE);
-    }
-}
-
 void DBWriter::createRenumberedDB(const std::string& dataFile, const std::string& indexFile, const std::string& origData, const std::string& origIndex, int sortMode) {
     DBReader<unsigned int>* lookupReader = NULL;
     FILE *sLookup = NULL;
@@ -675,6 +1141,8 @@ void DBWriter::createRenumberedDB(const std::string& dataFile, const std::string
         sLookup = FileUtil::openAndDelete((dataFile + ".lookup").c_str(), "w");
     }
 
+    // the renumbered index keeps the format of the input index
+    const bool binaryIndex = DBReader<unsigned int>::isBinaryIndexFile(indexFile.c_str());
     DBReader<unsigned int> reader(dataFile.c_str(), indexFile.c_str(), 1, DBReader<unsigned int>::USE_INDEX);
     reader.open(sortMode);
     std::string indexTmp = indexFile + "_tmp";
@@ -685,27 +1153,40 @@ void DBWriter::createRenumberedDB(const std::string& dataFile, const std::string
     if (lookupReader != NULL) {
         lookup = lookupReader->getLookup();
     }
+    std::vector<DBReader<unsigned int>::Index> renumbered;
+    if (binaryIndex) {
+        renumbered.resize(reader.getSize());
+    }
     for (size_t i = 0; i < reader.getSize(); i++) {
         DBReader<unsigned int>::Index *idx = (reader.getIndex(i));
-        size_t len = DBWriter::indexToBuffer(buffer, i, idx->offset, idx->length);
-        int written = fwrite(buffer, sizeof(char), len, sIndex);
-        if (written != (int) len) {
-            Debug(Debug::ERROR) << "Can not write to data file " << indexFile << "_tmp\n";
-            EXIT(EXIT_FAILURE);
+        if (binaryIndex) {
+            renumbered[i].id = i;
+            renumbered[i].offset = idx->offset;
+            renumbered[i].length = idx->length;
+        } else {
+            size_t len = DBWriter::indexToBuffer(buffer, i, idx->offset, idx->length);
+            int written = fwrite(buffer, sizeof(char), len, sIndex);
+            if (written != (int) len) {
+                Debug(Debug::ERROR) << "Can not write to data file " << indexFile << "_tmp\n";
+                EXIT(EXIT_FAILURE);
+            }
         }
         if (lookupReader != NULL) {
             size_t lookupId = lookupReader->getLookupIdByKey(idx->id);
             DBReader<unsigned int>::LookupEntry copy = lookup[lookupId];
             copy.id = i;
             copy.entryName = SSTR(idx->id);
-            len = lookupReader->lookupEntryToBuffer(buffer, copy);
-            written = fwrite(buffer, sizeof(char), len, sLookup);
+            size_t len = lookupReader->lookupEntryToBuffer(buffer, copy);
+            int written = fwrite(buffer, sizeof(char), len, sLookup);
             if (written != (int) len) {
                 Debug(Debug::ERROR) << "Could not write to lookup file " << indexFile << "_tmp\n";
                 EXIT(EXIT_FAILURE);
             }
         }
     }
+    if (binaryIndex) {
+        writeBinaryIndex(sIndex, renumbered.size(), renumbered.data());
+    }
     fclose(sIndex);
     reader.close();
     std::rename(indexTmp.c_str(), indexFile.c_str());
@@ -62,6 +62,12 @@ public:
     template <typename T>
     static void writeIndexEntryToFile(FILE *outFile, char *buff1, T &index);
 
+    // writes the index in the memory mappable binary format, see DBReader::BinaryIndexHeader
+    static void writeBinaryIndex(FILE *outFile, size_t indexSize, DBReader<unsigned int>::Index *index);
+
+    // rewrites a text or binary index in the requested format, keeping the order of the entries
+    static void convertIndex(const char *inFileNameIndex, const char *outFileNameIndex, bool binary);
+
     static void createRenumberedDB(const std::string& dataFile, const std::string& indexFile, const std::string& origData, const std::string& origIndex, int sortMode = DBReader<unsigned int>::SORT_BY_ID_OFFSET);
 
     bool isClosed(){
@@ -69,17 +75,35 @@ public:
     }
 private:
     size_t addToThreadBuffer(const void *data, size_t itmesize, size_t nitems, int threadIdx);
-    void writeThreadBuffer(unsigned int idx, size_t dataSize);
+
+    // compressed entries are held back until the shared dictionary is trained from the first entries
+    struct PendingEntry {
+        unsigned int key;
+        bool addNullByte;
+        bool addIndexEntry;
+        std::vector<char> data;
+    };
+
+    void compressEntry(const char *data, size_t dataSize, unsigned int key, unsigned int thrIdx, bool addNullByte, bool addIndexEntry);
+    void writePendingEntries(unsigned int thrIdx);
+    void trainDictionary();
+
+    static void recompressResults(const std::string &outFileName, const std::string &outFileNameIndex,
+                                  const std::vector<std::pair<std::string, std::string>> &files,
+                                  bool lexicographicOrder);
 
     void checkClosed();
 
     static void mergeResults(const char *outFileName, const char *outFileNameIndex,
                              const char **dataFileNames, const char **indexFileNames,
-                             unsigned long fileCount, bool mergeDatafiles, bool lexicographicOrder = false);
+                             unsigned long fileCount, bool mergeDatafiles, bool lexicographicOrder = false, bool binaryIndex = false);
 
     static void mergeIndex(const char** indexFilenames, unsigned int fileCount, const std::vector<size_t> &dataSizes);
 
-    static void sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder);
+    static void mergeSortedIndex(const char **indexFileNames, unsigned int fileCount, const std::vector<size_t> &dataSizes,
+                                 const char *outFileNameIndex, bool binaryIndex);
+
+    static void sortIndex(const char *inFileNameIndex, const char *outFileNameIndex, const bool lexicographicOrder, const bool binaryIndex);
 
     char* dataFileName;
     char* indexFileName;
@@ -99,12 +123,28 @@ private:
 
     size_t* starts;
     size_t* offsets;
-    int* state;
-    static const int INIT_STATE=0;
-    static const int NOTCOMPRESSED=1;
-    static const int COMPRESSED=2;
 
-    ZSTD_CStream** cstream;
+    ZSTD_CCtx** cctx;
+
+    std::vector<PendingEntry>* pendingEntries;
+    std::vector<char> dictionarySamples;
+    std::vector<size_t> dictionarySampleSizes;
+    size_t pendingSize;
+    bool dictionaryReady;
+    std::vector<char> dictionary;
+    ZSTD_CDict* cdict;
+
+    static const int COMPRESSION_LEVEL = 3;
+    // zstd has a hard time with entries shorter than 60 bytes, they are stored uncompressed
+    static const size_t MIN_COMPRESSED_SIZE = 60;
+    // dictionaries are trained from the first DICTIONARY_SAMPLE_SIZE bytes, at most MAX_SAMPLE_ENTRY_SIZE per entry
+    static const size_t DICTIONARY_SAMPLE_SIZE = 4 * 1024 * 1024;
+    static const size_t MAX_SAMPLE_ENTRY_SIZE = 128 * 1024;
+    // or as soon as too much data is held back
+    static const size_t MAX_PENDING_SIZE = 64 * 1024 * 1024;
+    static const size_t MAX_DICTIONARY_SIZE = 64 * 1024;
+    static const size_t MIN_DICTIONARY_SIZE = 1024;
+    static const size_t MIN_DICTIONARY_SAMPLES = 16;
 
     const unsigned int threads;
     const size_t mode;
@@ -272,6 +272,12 @@ size_t FileUtil::getFileSize(const std::string &fileName) {
     return rc == 0 ? stat_buf.st_size : -1;
 }
 
+long long FileUtil::getModificationTime(const std::string &fileName) {
+    struct stat stat_buf;
+    int rc = stat(fileName.c_str(), &stat_buf);
+    return rc == 0 ? static_cast<long long>(stat_buf.st_mtime) : -1;
+}
+
 
 bool FileUtil::symlinkExists(const std::string &path)  {
     struct stat buf;
@@ -47,6 +47,9 @@ public:
 
     static size_t getFileSize(const std::string &fileName);
 
+    // seconds since the epoch, -1 if the file does not exist
+    static long long getModificationTime(const std::string &fileName);
+
     static bool symlinkExists(const std::string &path);
 
     static void copyFile(const char *src, const char *dst);
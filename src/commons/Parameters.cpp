@@ -55,6 +55,8 @@ Parameters::Parameters():
         PARAM_PRELOAD_MODE(PARAM_PRELOAD_MODE_ID, "--db-load-mode", "Preload mode", "Database preload mode 0: auto, 1: fread, 2: mmap, 3: mmap+touch", typeid(int), (void *) &preloadMode, "[0-3]{1}", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
         PARAM_SPACED_KMER_PATTERN(PARAM_SPACED_KMER_PATTERN_ID, "--spaced-kmer-pattern", "Spaced k-mer pattern", "User-specified spaced k-mer pattern", typeid(std::string), (void *) &spacedKmerPattern, "^1[01]*1$", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         PARAM_LOCAL_TMP(PARAM_LOCAL_TMP_ID, "--local-tmp", "Local temporary path", "Path where some of the temporary files will be created", typeid(std::string), (void *) &localTmp, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_BINARY_PREFILTER(PARAM_BINARY_PREFILTER_ID, "--binary-prefilter", "Binary prefilter result", "Write prefilter results as fixed-width binary records instead of text", typeid(bool), (void *) &binaryPrefilter, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_INDEX_COMPRESSION(PARAM_INDEX_COMPRESSION_ID, "--index-compression", "Compressed index table", "Store the k-mer lists of the index table delta and varint encoded to reduce its memory footprint", typeid(bool), (void *) &indexCompression, "", MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_EXPERT),
         // alignment
         PARAM_ALIGNMENT_MODE(PARAM_ALIGNMENT_MODE_ID, "--alignment-mode", "Alignment mode", "How to compute the alignment:\n0: automatic\n1: only score and end_pos\n2: also start_pos and cov\n3: also seq.id\n4: only ungapped alignment", typeid(int), (void *) &alignmentMode, "^[0-4]{1}$", MMseqsParameter::COMMAND_ALIGN),
         PARAM_E(PARAM_E_ID, "-e", "E-value threshold", "List matches below this E-value (range 0.0-inf)", typeid(float), (void *) &evalThr, "^([-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?)|[0-9]*(\\.[0-9]+)?$", MMseqsParameter::COMMAND_ALIGN),
@@ -72,6 +74,7 @@ Parameters::Parameters():
         PARAM_GAP_OPEN(PARAM_GAP_OPEN_ID, "--gap-open", "Gap open cost", "Gap open cost", typeid(MultiParam<int>), (void *) &gapOpen, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
         PARAM_GAP_EXTEND(PARAM_GAP_EXTEND_ID, "--gap-extend", "Gap extension cost", "Gap extension cost", typeid(MultiParam<int>), (void *) &gapExtend, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
         PARAM_ZDROP(PARAM_ZDROP_ID, "--zdrop", "Zdrop", "Maximal allowed difference between score values before alignment is truncated  (nucleotide alignment only)", typeid(int), (void*) &zdrop, "^[0-9]{1}[0-9]*$", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_TARGET_SEQ_CACHE(PARAM_TARGET_SEQ_CACHE_ID, "--target-seq-cache", "Cache target sequences", "Keep target sequences encoded after their first use.\nUses up to one byte per residue of the target database, at most half of the memory not taken by the databases", typeid(bool), (void *) &targetSeqCache, "", MMseqsParameter::COMMAND_ALIGN | MMseqsParameter::COMMAND_EXPERT),
         // clustering
         PARAM_CLUSTER_MODE(PARAM_CLUSTER_MODE_ID, "--cluster-mode", "Cluster mode", "0: Set-Cover (greedy)\n1: Connected component (BLASTclust)\n2,3: Greedy clustering by sequence length (CDHIT)", typeid(int), (void *) &clusteringMode, "[0-3]{1}$", MMseqsParameter::COMMAND_CLUST),
         PARAM_CLUSTER_STEPS(PARAM_CLUSTER_STEPS_ID, "--cluster-steps", "Cascaded clustering steps", "Cascaded clustering steps from 1 to -s", typeid(int), (void *) &clusterSteps, "^[1-9]{1}$", MMseqsParameter::COMMAND_CLUST | MMseqsParameter::COMMAND_EXPERT),
@@ -80,6 +83,7 @@ Parameters::Parameters():
         // affinity clustering
         PARAM_MAXITERATIONS(PARAM_MAXITERATIONS_ID, "--max-iterations", "Max connected component depth", "Maximum depth of breadth first search in connected component clustering", typeid(int), (void *) &maxIteration, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUST | MMseqsParameter::COMMAND_EXPERT),
         PARAM_SIMILARITYSCORE(PARAM_SIMILARITYSCORE_ID, "--similarity-type", "Similarity type", "Type of score used for clustering. 1: alignment score 2: sequence identity", typeid(int), (void *) &similarityScoreType, "^[1-2]{1}$", MMseqsParameter::COMMAND_CLUST | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_PARALLEL_SET_COVER(PARAM_PARALLEL_SET_COVER_ID, "--parallel-set-cover", "Parallel set cover", "Select set cover representatives in parallel rounds.\nSets of equal size are ordered by their id, clusters can differ from the default set cover", typeid(bool), (void *) &parallelSetCover, "", MMseqsParameter::COMMAND_CLUST | MMseqsParameter::COMMAND_EXPERT),
         // logging
         PARAM_V(PARAM_V_ID, "-v", "Verbosity", "Verbosity level: 0: quiet, 1: +errors, 2: +warnings, 3: +info", typeid(int), (void *) &verbosity, "^[0-3]{1}$", MMseqsParameter::COMMAND_COMMON),
         // convertalignments
@@ -136,6 +140,7 @@ Parameters::Parameters():
         PARAM_PICK_N_SIMILAR(PARAM_PICK_N_SIMILAR_ID, "--pick-n-sim-kmer", "Add N similar to search", "Add N similar k-mers to search", typeid(int), (void *) &pickNbest, "^[1-9]{1}[0-9]*$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_ADJUST_KMER_LEN(PARAM_ADJUST_KMER_LEN_ID, "--adjust-kmer-len", "Adjust k-mer length", "Adjust k-mer length based on specificity (only for nucleotides)", typeid(bool), (void *) &adjustKmerLength, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
         PARAM_RESULT_DIRECTION(PARAM_RESULT_DIRECTION_ID, "--result-direction", "Result direction", "result is 0: query, 1: target centric", typeid(int), (void *) &resultDirection, "^[0-1]{1}$", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_KMER_TABLE(PARAM_KMER_TABLE_ID, "--kmer-table", "k-mer table file", "Store the sorted k-mer table in this file and reuse it in later runs on the same DB with the same k-mer parameters", typeid(std::string), (void *) &kmerTable, "", MMseqsParameter::COMMAND_CLUSTLINEAR | MMseqsParameter::COMMAND_EXPERT),
 
         // workflow
         PARAM_RUNNER(PARAM_RUNNER_ID, "--mpi-runner", "MPI runner", "Use MPI on compute cluster with this MPI command (e.g. \"mpirun -np 42\")", typeid(std::string), (void *) &runner, "", MMseqsParameter::COMMAND_COMMON | MMseqsParameter::COMMAND_EXPERT),
@@ -145,6 +150,7 @@ Parameters::Parameters():
         PARAM_START_SENS(PARAM_START_SENS_ID, "--start-sens", "Start sensitivity", "Start sensitivity", typeid(float), (void *) &startSens, "^[0-9]*(\\.[0-9]+)?$"),
         PARAM_SENS_STEPS(PARAM_SENS_STEPS_ID, "--sens-steps", "Search steps", "Number of search steps performed from --start-sens to -s", typeid(int), (void *) &sensSteps, "^[1-9]{1}$"),
         PARAM_SLICE_SEARCH(PARAM_SLICE_SEARCH_ID, "--slice-search", "Slice search mode", "For bigger profile DB, run iteratively the search by greedily swapping the search results", typeid(bool), (void *) &sliceSearch, "", MMseqsParameter::COMMAND_PROFILE | MMseqsParameter::COMMAND_EXPERT),
+        PARAM_STREAM_PREFILTER(PARAM_STREAM_PREFILTER_ID, "--stream-prefilter", "Stream prefilter results", "Pass prefilter hits in memory to the alignment while the prefilter is running instead of writing the prefilter database", typeid(bool), (void *) &streamPrefilter, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_STRAND(PARAM_STRAND_ID, "--strand", "Strand selection", "Strand selection only works for DNA/DNA search 0: reverse, 1: forward, 2: both", typeid(int), (void *) &strand, "^[0-2]{1}$", MMseqsParameter::COMMAND_EXPERT),
         // easysearch
         PARAM_GREEDY_BEST_HITS(PARAM_GREEDY_BEST_HITS_ID, "--greedy-best-hits", "Greedy best hits", "Choose the best hits greedily to cover the query", typeid(bool), (void *) &greedyBestHits, ""),
@@ -170,6 +176,7 @@ Parameters::Parameters():
         PARAM_CREATEDB_MODE(PARAM_CREATEDB_MODE_ID, "--createdb-mode", "Createdb mode", "Createdb mode 0: copy data, 1: soft link data and write new index (works only with single line fasta/q)", typeid(int), (void *) &createdbMode, "^[0-1]{1}$"),
         PARAM_SHUFFLE(PARAM_SHUFFLE_ID, "--shuffle", "Shuffle input database", "Shuffle input database", typeid(bool), (void *) &shuffleDatabase, ""),
         PARAM_WRITE_LOOKUP(PARAM_WRITE_LOOKUP_ID, "--write-lookup", "Write lookup file", "write .lookup file containing mapping from internal id, fasta id and file number", typeid(int), (void *) &writeLookup, "^[0-1]{1}", MMseqsParameter::COMMAND_EXPERT),
+        PARAM_BINARY_INDEX(PARAM_BINARY_INDEX_ID, "--binary-index", "Binary index", "Write the .index as fixed-width binary records that are memory mapped without parsing (use convertindex to get back a text index)", typeid(bool), (void *) &binaryIndex, "", MMseqsParameter::COMMAND_EXPERT),
         PARAM_USE_HEADER_FILE(PARAM_USE_HEADER_FILE_ID, "--use-header-file", "Use header DB", "use the sequence header DB instead of the body to map the entry keys", typeid(bool), (void *) &useHeaderFile, ""),
         // splitsequence
         PARAM_SEQUENCE_OVERLAP(PARAM_SEQUENCE_OVERLAP_ID, "--sequence-overlap", "Overlap between sequences", "Overlap between sequences", typeid(int), (void *) &sequenceOverlap, "^(0|[1-9]{1}[0-9]*)$"),
@@ -254,6 +261,8 @@ Parameters::Parameters():
         PARAM_TAX_OUTPUT_MODE(PARAM_TAX_OUTPUT_MODE_ID, "--tax-output-mode", "Taxonomy output mode", "0: output LCA, 1: output alignment", typeid(int), (void *) &taxonomyOutpuMode, "^[0-1]{1}$"),
         // createsubdb, filtertaxseqdb
         PARAM_SUBDB_MODE(PARAM_SUBDB_MODE_ID, "--subdb-mode", "Subdb mode", "Subdb mode 0: copy data 1: soft link data and write index", typeid(int), (void *) &subDbMode, "^[0-1]{1}$"),
+        // apply
+        PARAM_APPLY_MODE(PARAM_APPLY_MODE_ID, "--apply-mode", "Apply mode", "Apply mode 0: start the program for each entry 1: start the program once per worker and stream \\0 terminated entries through stdin/stdout", typeid(int), (void *) &applyMode, "^[0-1]{1}$"),
         PARAM_TAR_INCLUDE(PARAM_TAR_INCLUDE_ID, "--tar-include", "Tar Inclusion Regex", "Include file names based on this regex", typeid(std::string), (void *) &tarInclude, "^.*$"),
         PARAM_TAR_EXCLUDE(PARAM_TAR_EXCLUDE_ID, "--tar-exclude", "Tar Exclusion Regex", "Exclude file names based on this regex", typeid(std::string), (void *) &tarExclude, "^.*$"),
         // for modules that should handle -h themselves
@@ -336,6 +345,7 @@ Parameters::Parameters():
     align.push_back(&PARAM_GAP_OPEN);
     align.push_back(&PARAM_GAP_EXTEND);
     align.push_back(&PARAM_ZDROP);
+    align.push_back(&PARAM_TARGET_SEQ_CACHE);
     align.push_back(&PARAM_THREADS);
     align.push_back(&PARAM_COMPRESSED);
     align.push_back(&PARAM_V);
@@ -367,6 +377,8 @@ Parameters::Parameters():
     prefilter.push_back(&PARAM_PCB);
     prefilter.push_back(&PARAM_SPACED_KMER_PATTERN);
     prefilter.push_back(&PARAM_LOCAL_TMP);
+    prefilter.push_back(&PARAM_BINARY_PREFILTER);
+    prefilter.push_back(&PARAM_INDEX_COMPRESSION);
     prefilter.push_back(&PARAM_THREADS);
     prefilter.push_back(&PARAM_COMPRESSED);
     prefilter.push_back(&PARAM_V);
@@ -378,6 +390,7 @@ Parameters::Parameters():
     ungappedprefilter.push_back(&PARAM_COV_MODE);
     ungappedprefilter.push_back(&PARAM_NO_COMP_BIAS_CORR);
     ungappedprefilter.push_back(&PARAM_MIN_DIAG_SCORE);
+    ungappedprefilter.push_back(&PARAM_BINARY_PREFILTER);
     ungappedprefilter.push_back(&PARAM_THREADS);
     ungappedprefilter.push_back(&PARAM_COMPRESSED);
     ungappedprefilter.push_back(&PARAM_V);
@@ -386,6 +399,7 @@ Parameters::Parameters():
     clust.push_back(&PARAM_CLUSTER_MODE);
     clust.push_back(&PARAM_MAXITERATIONS);
     clust.push_back(&PARAM_SIMILARITYSCORE);
+    clust.push_back(&PARAM_PARALLEL_SET_COVER);
     clust.push_back(&PARAM_THREADS);
     clust.push_back(&PARAM_COMPRESSED);
     clust.push_back(&PARAM_V);
@@ -466,6 +480,7 @@ Parameters::Parameters():
     result2profile.push_back(&PARAM_PCB);
     result2profile.push_back(&PARAM_OMIT_CONSENSUS);
     result2profile.push_back(&PARAM_PRELOAD_MODE);
+    result2profile.push_back(&PARAM_TARGET_SEQ_CACHE);
     result2profile.push_back(&PARAM_GAP_OPEN);
     result2profile.push_back(&PARAM_GAP_EXTEND);
     result2profile.push_back(&PARAM_THREADS);
@@ -673,6 +688,7 @@ Parameters::Parameters():
     indexdb.push_back(&PARAM_SEARCH_TYPE);
     indexdb.push_back(&PARAM_SPLIT);
     indexdb.push_back(&PARAM_SPLIT_MEMORY_LIMIT);
+    indexdb.push_back(&PARAM_INDEX_COMPRESSION);
     indexdb.push_back(&PARAM_V);
     indexdb.push_back(&PARAM_THREADS);
 
@@ -703,9 +719,14 @@ Parameters::Parameters():
     createdb.push_back(&PARAM_CREATEDB_MODE);
     createdb.push_back(&PARAM_WRITE_LOOKUP);
     createdb.push_back(&PARAM_ID_OFFSET);
+    createdb.push_back(&PARAM_BINARY_INDEX);
     createdb.push_back(&PARAM_COMPRESSED);
     createdb.push_back(&PARAM_V);
 
+    // convertindex
+    convertindex.push_back(&PARAM_BINARY_INDEX);
+    convertindex.push_back(&PARAM_V);
+
     // convert2fasta
     convert2fasta.push_back(&PARAM_USE_HEADER_FILE);
     convert2fasta.push_back(&PARAM_V);
@@ -840,6 +861,7 @@ Parameters::Parameters():
     kmermatcher.push_back(&PARAM_SPLIT_MEMORY_LIMIT);
     kmermatcher.push_back(&PARAM_INCLUDE_ONLY_EXTENDABLE);
     kmermatcher.push_back(&PARAM_IGNORE_MULTI_KMER);
+    kmermatcher.push_back(&PARAM_KMER_TABLE);
     kmermatcher.push_back(&PARAM_THREADS);
     kmermatcher.push_back(&PARAM_COMPRESSED);
     kmermatcher.push_back(&PARAM_V);
@@ -1013,6 +1035,7 @@ Parameters::Parameters():
     expandaln.push_back(&PARAM_COV_MODE);
     expandaln.push_back(&PARAM_PCA);
     expandaln.push_back(&PARAM_PCB);
+    expandaln.push_back(&PARAM_TARGET_SEQ_CACHE);
     expandaln.push_back(&PARAM_THREADS);
     expandaln.push_back(&PARAM_V);
 
@@ -1020,6 +1043,8 @@ Parameters::Parameters():
     sortresult.push_back(&PARAM_THREADS);
     sortresult.push_back(&PARAM_V);
 
+    prefilteralign = combineList(prefilter, align);
+
     // WORKFLOWS
     searchworkflow = combineList(align, prefilter);
     searchworkflow = combineList(searchworkflow, rescorediagonal);
@@ -1033,6 +1058,7 @@ Parameters::Parameters():
     searchworkflow.push_back(&PARAM_START_SENS);
     searchworkflow.push_back(&PARAM_SENS_STEPS);
     searchworkflow.push_back(&PARAM_SLICE_SEARCH);
+    searchworkflow.push_back(&PARAM_STREAM_PREFILTER);
     searchworkflow.push_back(&PARAM_STRAND);
     searchworkflow.push_back(&PARAM_DISK_SPACE_LIMIT);
     searchworkflow.push_back(&PARAM_RUNNER);
@@ -1153,6 +1179,12 @@ Parameters::Parameters():
     tar2db.push_back(&PARAM_COMPRESSED);
     tar2db.push_back(&PARAM_V);
 
+    // apply
+    apply.push_back(&PARAM_APPLY_MODE);
+    apply.push_back(&PARAM_THREADS);
+    apply.push_back(&PARAM_COMPRESSED);
+    apply.push_back(&PARAM_V);
+
     //checkSaneEnvironment();
     setDefaults();
 }
@@ -1717,6 +1749,10 @@ void Parameters::checkIfTaxDbIsComplete(std::string & filename){
                                 << "The " << filename << "_mapping is missing.\n";
             EXIT(EXIT_FAILURE);
         }
+        // the binary taxonomy replaces the .dmp files
+        if (FileUtil::fileExists((filename + "_taxonomy").c_str())) {
+            return;
+        }
         if (FileUtil::fileExists((filename + "_nodes.dmp").c_str()) == false) {
             Debug(Debug::ERROR) << "Database " << filename << " need taxonomical information.\n"
                                 << "The " << filename << "_nodes.dmp is missing.\n";
@@ -1926,12 +1962,15 @@ void Parameters::setDefaults() {
     splitAA = false;
     spacedKmerPattern = "";
     localTmp = "";
+    binaryPrefilter = false;
+    indexCompression = false;
 
     // search workflow
     numIterations = 1;
     startSens = 4;
     sensSteps = 1;
     sliceSearch = false;
+    streamPrefilter = false;
     strand = 1;
 
     greedyBestHits = false;
@@ -1973,6 +2012,7 @@ void Parameters::setDefaults() {
     gapOpen = MultiParam<int>(11, 5);
     gapExtend = MultiParam<int>(1, 2);
     zdrop = 40;
+    targetSeqCache = true;
     addBacktrace = false;
     realign = false;
     clusteringMode = SET_COVER;
@@ -1985,6 +2025,7 @@ void Parameters::setDefaults() {
     // affinity clustering
     maxIteration=1000;
     similarityScoreType=APC_SEQID;
+    parallelSetCover = false;
 
     // workflow
     const char *runnerEnv = getenv("RUNNER");
@@ -2004,6 +2045,7 @@ void Parameters::setDefaults() {
     // createdb
     createdbMode = SEQUENCE_SPLIT_MODE_HARD;
     shuffleDatabase = true;
+    binaryIndex = false;
     writeLookup = true;
 
     // format alignment
@@ -2154,6 +2196,7 @@ void Parameters::setDefaults() {
     pickNbest = 1;
     adjustKmerLength = false;
     resultDirection = Parameters::PARAM_RESULT_DIRECTION_TARGET;
+    kmerTable = "";
     // result2stats
     stat = "";
 
@@ -2180,6 +2223,9 @@ void Parameters::setDefaults() {
     // createsubdb
     subDbMode = Parameters::SUBDB_MODE_HARD;
 
+    // apply
+    applyMode = Parameters::APPLY_MODE_ENTRY;
+
     // tar2db
     tarInclude = ".*";
     tarExclude = "^$";
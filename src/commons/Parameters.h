@@ -83,6 +83,8 @@ public:
     static const int DBTYPE_SEQTAXDB = 18; // needed for verification
     static const int DBTYPE_STDIN = 19; // needed for verification
 
+    // flag set in the dbtype of result databases that store fixed-width binary records instead of text
+    static const int DBTYPE_BINARY_FLAG = (1 << 30);
 
     // don't forget to add new database types to DBReader::getDbTypeName and Parameters::PARAM_OUTPUT_DBTYPE
 
@@ -110,6 +112,7 @@ public:
     static const unsigned int WRITER_ASCII_MODE = 0;
     static const unsigned int WRITER_COMPRESSED_MODE = 1;
     static const unsigned int WRITER_LEXICOGRAPHIC_MODE = 2;
+    static const unsigned int WRITER_BINARY_INDEX_MODE = 4;
 
     // convertalis alignment
     static const int FORMAT_ALIGNMENT_BLAST_TAB = 0;
@@ -253,6 +256,10 @@ public:
     static const int SUBDB_MODE_HARD = 0;
     static const int SUBDB_MODE_SOFT = 1;
 
+    // apply
+    static const int APPLY_MODE_ENTRY = 0;
+    static const int APPLY_MODE_STREAM = 1;
+
     // result direction
     static const int PARAM_RESULT_DIRECTION_QUERY  = 0;
     static const int PARAM_RESULT_DIRECTION_TARGET = 1;
@@ -349,6 +356,8 @@ public:
     float  scoreBias;                    // Add this bias to the score when computing the alignements
     std::string spacedKmerPattern;       // User-specified kmer pattern
     std::string localTmp;                // Local temporary path
+    bool   binaryPrefilter;              // Write prefilter results as binary records
+    bool   indexCompression;             // Store the k-mer lists of the index table compressed
 
     // ALIGNMENT
     int alignmentMode;                   // alignment mode 0=fastest on parameters,
@@ -368,6 +377,7 @@ public:
     MultiParam<int> gapOpen;             // gap open cost
     MultiParam<int> gapExtend;           // gap extension cost
     int    zdrop;                        // zdrop
+    bool   targetSeqCache;               // keep encoded target sequences after their first use
 
     // workflow
     std::string runner;
@@ -384,6 +394,7 @@ public:
     float startSens;
     int sensSteps;
     bool sliceSearch;
+    bool streamPrefilter;
     int strand;
 
     // easysearch
@@ -392,6 +403,7 @@ public:
     //CLUSTERING
     int maxIteration;                   // Maximum depth of breadth first search in connected component
     int similarityScoreType;            // Type of score to use for reassignment 1=alignment score. 2=coverage 3=sequence identity 4=E-value 5= Score per Column
+    bool parallelSetCover;              // Select set cover representatives in parallel rounds
 
     //extractorfs
     int orfMinLength;
@@ -469,6 +481,7 @@ public:
     int pickNbest;
     int adjustKmerLength;
     int resultDirection;
+    std::string kmerTable;
 
     // indexdb
     int checkCompatible;
@@ -479,6 +492,7 @@ public:
     int dbType;
     int createdbMode;
     bool shuffleDatabase;
+    bool binaryIndex;
 
     // splitsequence
     int sequenceOverlap;
@@ -595,6 +609,9 @@ public:
     // createsubdb
     int subDbMode;
 
+    // apply
+    int applyMode;
+
     // tar2db
     std::string tarInclude;
     std::string tarExclude;
@@ -655,6 +672,8 @@ public:
     PARAMETER(PARAM_PRELOAD_MODE)
     PARAMETER(PARAM_SPACED_KMER_PATTERN)
     PARAMETER(PARAM_LOCAL_TMP)
+    PARAMETER(PARAM_BINARY_PREFILTER)
+    PARAMETER(PARAM_INDEX_COMPRESSION)
     std::vector<MMseqsParameter*> prefilter;
     std::vector<MMseqsParameter*> ungappedprefilter;
 
@@ -675,6 +694,7 @@ public:
     PARAMETER(PARAM_GAP_OPEN)
     PARAMETER(PARAM_GAP_EXTEND)
     PARAMETER(PARAM_ZDROP)
+    PARAMETER(PARAM_TARGET_SEQ_CACHE)
 
     // clustering
     PARAMETER(PARAM_CLUSTER_MODE)
@@ -685,6 +705,7 @@ public:
     // affinity clustering
     PARAMETER(PARAM_MAXITERATIONS)
     PARAMETER(PARAM_SIMILARITYSCORE)
+    PARAMETER(PARAM_PARALLEL_SET_COVER)
 
     // logging
     PARAMETER(PARAM_V)
@@ -752,6 +773,7 @@ public:
     PARAMETER(PARAM_PICK_N_SIMILAR)
     PARAMETER(PARAM_ADJUST_KMER_LEN)
     PARAMETER(PARAM_RESULT_DIRECTION)
+    PARAMETER(PARAM_KMER_TABLE)
     // workflow
     PARAMETER(PARAM_RUNNER)
     PARAMETER(PARAM_REUSELATEST)
@@ -761,6 +783,7 @@ public:
     PARAMETER(PARAM_START_SENS)
     PARAMETER(PARAM_SENS_STEPS)
     PARAMETER(PARAM_SLICE_SEARCH)
+    PARAMETER(PARAM_STREAM_PREFILTER)
     PARAMETER(PARAM_STRAND)
 
 
@@ -791,6 +814,7 @@ public:
     PARAMETER(PARAM_CREATEDB_MODE)
     PARAMETER(PARAM_SHUFFLE)
     PARAMETER(PARAM_WRITE_LOOKUP)
+    PARAMETER(PARAM_BINARY_INDEX)
 
     // convert2fasta
     PARAMETER(PARAM_USE_HEADER_FILE)
@@ -905,6 +929,9 @@ public:
     // createsubdb
     PARAMETER(PARAM_SUBDB_MODE)
 
+    // apply
+    PARAMETER(PARAM_APPLY_MODE)
+
     // tar2db
     PARAMETER(PARAM_TAR_INCLUDE)
     PARAMETER(PARAM_TAR_EXCLUDE)
@@ -923,6 +950,7 @@ public:
 
     std::vector<MMseqsParameter*> alignall;
     std::vector<MMseqsParameter*> align;
+    std::vector<MMseqsParameter*> prefilteralign;
     std::vector<MMseqsParameter*> rescorediagonal;
     std::vector<MMseqsParameter*> alignbykmer;
     std::vector<MMseqsParameter*> createFasta;
@@ -948,6 +976,7 @@ public:
     std::vector<MMseqsParameter*> createlinindex;
     std::vector<MMseqsParameter*> convertalignments;
     std::vector<MMseqsParameter*> createdb;
+    std::vector<MMseqsParameter*> convertindex;
     std::vector<MMseqsParameter*> convert2fasta;
     std::vector<MMseqsParameter*> result2flat;
     std::vector<MMseqsParameter*> gff2db;
@@ -1008,6 +1037,7 @@ public:
     std::vector<MMseqsParameter*> enrichworkflow;
     std::vector<MMseqsParameter*> databases;
     std::vector<MMseqsParameter*> tar2db;
+    std::vector<MMseqsParameter*> apply;
 
     std::vector<MMseqsParameter*> combineList(const std::vector<MMseqsParameter*> &par1,
                                              const std::vector<MMseqsParameter*> &par2);
@@ -1025,7 +1055,7 @@ public:
     }
 
     static const char* getDbTypeName(int dbtype) {
-        switch (dbtype & 0x7FFFFFFF) {
+        switch (dbtype & 0x3FFFFFFF) {
             case DBTYPE_AMINO_ACIDS: return "Aminoacid";
             case DBTYPE_NUCLEOTIDES: return "Nucleotide";
             case DBTYPE_HMM_PROFILE: return "Profile";
@@ -0,0 +1,100 @@
+#include "TargetSequenceStore.h"
+#include "Parameters.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+TargetSequenceStore::TargetSequenceStore(DBReader<unsigned int> *reader, int seqType, size_t maxMemory)
+        : reader(reader), maxKey(0), ids(NULL), data(NULL), capacity(0), used(0), offsets(NULL), state(NULL) {
+    const size_t size = reader->getSize();
+    for (size_t i = 0; i < size; ++i) {
+        maxKey = std::max(maxKey, reader->getDbKey(i));
+    }
+    // a dense table needs at most twice the memory of the key array of the reader
+    if (size > 0 && maxKey <= 4 * size) {
+        ids = new(std::nothrow) unsigned int[static_cast<size_t>(maxKey) + 1];
+        Util::checkAllocation(ids, "Can not allocate ids memory in TargetSequenceStore");
+        memset(ids, 0xFF, (static_cast<size_t>(maxKey) + 1) * sizeof(unsigned int));
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < size; ++i) {
+            ids[reader->getDbKey(i)] = static_cast<unsigned int>(i);
+        }
+    }
+
+    if (Parameters::isEqualDbtype(seqType, Parameters::DBTYPE_AMINO_ACIDS) == false) {
+        return;
+    }
+    const size_t offsetsMemory = size * (sizeof(size_t) + sizeof(unsigned char));
+    if (maxMemory <= offsetsMemory) {
+        return;
+    }
+    size_t residues = 0;
+    for (size_t i = 0; i < size; ++i) {
+        residues += reader->getSeqLen(i);
+    }
+    capacity = std::min(residues, maxMemory - offsetsMemory);
+    if (capacity == 0) {
+        return;
+    }
+    // new/malloc/calloc do not touch the pages, the memory is only used once sequences are encoded
+    offsets = new(std::nothrow) size_t[size];
+    Util::checkAllocation(offsets, "Can not allocate offsets memory in TargetSequenceStore");
+    data = static_cast<unsigned char *>(malloc(capacity));
+    Util::checkAllocation(data, "Can not allocate data memory in TargetSequenceStore");
+    state = static_cast<unsigned char *>(calloc(size, sizeof(unsigned char)));
+    Util::checkAllocation(state, "Can not allocate state memory in TargetSequenceStore");
+}
+
+size_t TargetSequenceStore::getMemoryBudget(size_t usedMemory) {
+    const size_t totalMemory = Util::getTotalSystemMemory();
+    return (totalMemory > usedMemory) ? (totalMemory - usedMemory) / 2 : 0;
+}
+
+TargetSequenceStore::~TargetSequenceStore() {
+    delete[] ids;
+    delete[] offsets;
+    free(data);
+    free(state);
+}
+
+bool TargetSequenceStore::mapSequence(size_t id, unsigned int key, Sequence &seq, unsigned int thread_idx) {
+    unsigned char current = NOT_ENCODED;
+    if (data != NULL && id < reader->getSize()) {
+        current = __atomic_load_n(&state[id], __ATOMIC_ACQUIRE);
+        if (current == ENCODED) {
+            const unsigned int length = static_cast<unsigned int>(reader->getSeqLen(id));
+            seq.mapSequence(id, key, std::pair<const unsigned char *, const unsigned int>(data + offsets[id], length));
+            return true;
+        }
+    }
+
+    char *seqData = reader->getData(id, thread_idx);
+    if (seqData == NULL) {
+        return false;
+    }
+    const size_t length = reader->getSeqLen(id);
+    seq.mapSequence(id, key, seqData, length);
+    // only one thread encodes a sequence, the others keep mapping it from the reader until it is done
+    // sequences whose mapped length differs from the index length are never stored
+    if (data != NULL && current == NOT_ENCODED && static_cast<size_t>(seq.L) == length
+        && __atomic_compare_exchange_n(&state[id], &current, ENCODING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        size_t offset = __atomic_load_n(&used, __ATOMIC_RELAXED);
+        do {
+            if (offset + length > capacity) {
+                __atomic_store_n(&state[id], NOT_STORED, __ATOMIC_RELAXED);
+                return true;
+            }
+        } while (__atomic_compare_exchange_n(&used, &offset, offset + length, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false);
+        memcpy(data + offset, seq.numSequence, length);
+        offsets[id] = offset;
+        __atomic_store_n(&state[id], ENCODED, __ATOMIC_RELEASE);
+    }
+    return true;
+}
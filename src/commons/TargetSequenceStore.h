@@ -0,0 +1,65 @@
+#ifndef MMSEQS_TARGETSEQUENCESTORE_H
+#define MMSEQS_TARGETSEQUENCESTORE_H
+
+#include <climits>
+#include <cstddef>
+
+#include "DBReader.h"
+#include "Sequence.h"
+
+// Target sequences shared by all threads of tools that map the same targets over and over.
+// Keys are resolved with a dense key -> id table (like the DBR1 index of the precomputed index) if the keys
+// are dense enough, otherwise with DBReader::getId.
+// Amino acid sequences are encoded once, on their first use, and copied from the store afterwards, as long as
+// they fit into the memory budget of the store. Other sequences are mapped from the reader data every time,
+// e.g. the nucleotide aligner needs the ASCII sequence.
+class TargetSequenceStore {
+public:
+    // maxMemory bounds the encoded sequences (one byte per residue) and their offsets,
+    // with 0 only the key -> id table is built, e.g. for tools working on the ASCII sequences (--target-seq-cache 0)
+    TargetSequenceStore(DBReader<unsigned int> *reader, int seqType, size_t maxMemory);
+    ~TargetSequenceStore();
+
+    // half of the system memory that is not taken by the databases of the caller (usedMemory),
+    // the rest is left to the page cache and the per-thread buffers
+    static size_t getMemoryBudget(size_t usedMemory);
+
+    // UINT_MAX if the key is not contained
+    size_t getId(unsigned int key) const {
+        if (ids == NULL) {
+            return reader->getId(key);
+        }
+        return (key <= maxKey) ? ids[key] : UINT_MAX;
+    }
+
+    size_t getSeqLen(size_t id) const {
+        return reader->getSeqLen(id);
+    }
+
+    // maps the sequence with local id into seq, returns false if the reader has no data for it
+    bool mapSequence(size_t id, unsigned int key, Sequence &seq, unsigned int thread_idx);
+
+private:
+    enum {
+        NOT_ENCODED = 0,
+        ENCODING,
+        ENCODED,
+        // the store was full when the sequence was first used
+        NOT_STORED
+    };
+
+    DBReader<unsigned int> *reader;
+
+    unsigned int maxKey;
+    unsigned int *ids;
+
+    // encoded residues in the order the sequences were first used, pages are only touched once they are filled
+    unsigned char *data;
+    size_t capacity;
+    size_t used;
+    // offset of each encoded sequence in data, only valid once its state is ENCODED
+    size_t *offsets;
+    unsigned char *state;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef MMSEQS_KMERPOSITIONSORT_H
+#define MMSEQS_KMERPOSITIONSORT_H
+
+// Parallel LSD radix sort for KmerPosition arrays.
+// Produces the same order as omptl::sort with the KmerPosition::compareRepSequenceAndId* comparators.
+// Every field of the packed record is sorted digit wise starting with the least significant key (pos),
+// passes in which all elements share the same digit are skipped (e.g. the upper bits of the k-mer).
+// The sort needs a temporary buffer of the same size as the input, computeMemoryNeededLinearfilter counts it
+// for the --split-memory-limit. If it can not be allocated we fall back to omptl::sort.
+
+#include <cstring>
+#include <new>
+
+#include "kmermatcher.h"
+#include "Debug.h"
+#include "omptl/omptl_algorithm"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+namespace KmerPositionSort {
+    enum Field {
+        FIELD_POS,
+        FIELD_ID,
+        FIELD_SEQLEN,
+        FIELD_KMER
+    };
+
+    // 11 bit digits need fewer passes than bytes while the histograms still fit into the L1/L2 cache
+    const unsigned int RADIX_BITS = 11;
+    const size_t RADIX_SIZE = 1 << RADIX_BITS;
+    const size_t RADIX_MASK = RADIX_SIZE - 1;
+
+    // below this size the per pass overhead does not pay off
+    const size_t MIN_RADIX_SORT_SIZE = 1 << 16;
+
+    // maps a field to an unsigned key with the same ordering
+    // signed types (diagonals) get their sign bit flipped, seqLen is sorted descending
+    template <typename T, int FIELD, bool REVERSE>
+    inline size_t getKey(const KmerPosition<T> &entry) {
+        const size_t signBit = 1ULL << (sizeof(T) * 8 - 1);
+        const size_t mask = (sizeof(T) == 8) ? SIZE_MAX : ((1ULL << (sizeof(T) * 8)) - 1);
+        switch (FIELD) {
+            case FIELD_POS:
+                return (static_cast<size_t>(entry.pos) ^ signBit) & mask;
+            case FIELD_ID:
+                return entry.id;
+            case FIELD_SEQLEN:
+                return (~(static_cast<size_t>(entry.seqLen) ^ signBit)) & mask;
+            case FIELD_KMER:
+            default:
+                return (REVERSE) ? BIT_SET(entry.kmer, 63) : entry.kmer;
+        }
+    }
+
+    // stable counting sort of src into dst by the digit at shift, histograms holds threads * RADIX_SIZE counts
+    // returns false without touching dst if all elements have the same digit
+    template <typename T, int FIELD, bool REVERSE>
+    bool sortPass(const KmerPosition<T> *src, KmerPosition<T> *dst, size_t n, unsigned int shift,
+                  size_t *histograms, unsigned int threads) {
+        bool skipPass = false;
+#pragma omp parallel num_threads(threads)
+        {
+            unsigned int thread_idx = 0;
+            // the team can be smaller than requested (nested regions, OMP_DYNAMIC, thread limits),
+            // the chunks have to cover all elements with the threads that actually run
+            unsigned int teamSize = 1;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+            teamSize = static_cast<unsigned int>(omp_get_num_threads());
+#endif
+            const size_t chunkSize = (n + teamSize - 1) / teamSize;
+            size_t *histogram = histograms + thread_idx * RADIX_SIZE;
+            memset(histogram, 0, sizeof(size_t) * RADIX_SIZE);
+            const size_t start = std::min(n, thread_idx * chunkSize);
+            const size_t end = std::min(n, start + chunkSize);
+            for (size_t i = start; i < end; i++) {
+                histogram[(getKey<T, FIELD, REVERSE>(src[i]) >> shift) & RADIX_MASK]++;
+            }
+#pragma omp barrier
+#pragma omp single
+            {
+                // turn counts into bucket major, thread minor offsets to keep the sort stable
+                size_t offset = 0;
+                for (size_t bucket = 0; bucket < RADIX_SIZE; bucket++) {
+                    size_t bucketSize = 0;
+                    for (size_t thread = 0; thread < teamSize; thread++) {
+                        size_t count = histograms[thread * RADIX_SIZE + bucket];
+                        histograms[thread * RADIX_SIZE + bucket] = offset;
+                        offset += count;
+                        bucketSize += count;
+                    }
+                    if (bucketSize == n) {
+                        skipPass = true;
+                    }
+                }
+            }
+            if (skipPass == false) {
+                for (size_t i = start; i < end; i++) {
+                    const size_t bucket = (getKey<T, FIELD, REVERSE>(src[i]) >> shift) & RADIX_MASK;
+                    dst[histogram[bucket]++] = src[i];
+                }
+            }
+        }
+        return skipPass == false;
+    }
+
+    template <typename T, int FIELD, bool REVERSE>
+    void sortField(KmerPosition<T> *&src, KmerPosition<T> *&dst, size_t n, size_t *histograms, unsigned int threads) {
+        const unsigned int bits = 8 * ((FIELD == FIELD_KMER) ? sizeof(size_t)
+                                       : (FIELD == FIELD_ID) ? sizeof(unsigned int) : sizeof(T));
+        for (unsigned int shift = 0; shift < bits; shift += RADIX_BITS) {
+            if (sortPass<T, FIELD, REVERSE>(src, dst, n, shift, histograms, threads)) {
+                std::swap(src, dst);
+            }
+        }
+    }
+
+    template <typename T, bool REVERSE, bool SORT_BY_SEQLEN>
+    void radixSort(KmerPosition<T> *begin, KmerPosition<T> *end, bool (*fallback)(const KmerPosition<T> &, const KmerPosition<T> &)) {
+        const size_t n = end - begin;
+        if (n < MIN_RADIX_SORT_SIZE) {
+            omptl::sort(begin, end, fallback);
+            return;
+        }
+        KmerPosition<T> *buffer = new(std::nothrow) KmerPosition<T>[n];
+        if (buffer == NULL) {
+            Debug(Debug::WARNING) << "Can not allocate radix sort buffer. Falling back to comparison sort.\n";
+            omptl::sort(begin, end, fallback);
+            return;
+        }
+        unsigned int threads = 1;
+#ifdef OPENMP
+        threads = static_cast<unsigned int>(omp_get_max_threads());
+#endif
+        size_t *histograms = new size_t[threads * RADIX_SIZE];
+        KmerPosition<T> *src = begin;
+        KmerPosition<T> *dst = buffer;
+        sortField<T, FIELD_POS, REVERSE>(src, dst, n, histograms, threads);
+        sortField<T, FIELD_ID, REVERSE>(src, dst, n, histograms, threads);
+        if (SORT_BY_SEQLEN) {
+            sortField<T, FIELD_SEQLEN, REVERSE>(src, dst, n, histograms, threads);
+        }
+        sortField<T, FIELD_KMER, REVERSE>(src, dst, n, histograms, threads);
+        if (src != begin) {
+            const size_t chunkSize = (n + threads - 1) / threads;
+#pragma omp parallel for schedule(static) num_threads(threads)
+            for (size_t thread = 0; thread < threads; thread++) {
+                const size_t start = std::min(n, thread * chunkSize);
+                const size_t stop = std::min(n, start + chunkSize);
+                memcpy(begin + start, src + start, sizeof(KmerPosition<T>) * (stop - start));
+            }
+        }
+        delete[] histograms;
+        delete[] buffer;
+    }
+}
+
+// same order as omptl::sort with KmerPosition<T>::compareRepSequenceAndIdAndPos(Reverse)
+template <typename T, bool REVERSE>
+void radixSortRepSequenceAndIdAndPos(KmerPosition<T> *begin, KmerPosition<T> *end) {
+    KmerPositionSort::radixSort<T, REVERSE, true>(begin, end,
+        (REVERSE) ? KmerPosition<T>::compareRepSequenceAndIdAndPosReverse : KmerPosition<T>::compareRepSequenceAndIdAndPos);
+}
+
+// same order as omptl::sort with KmerPosition<T>::compareRepSequenceAndIdAndDiag(Reverse)
+template <typename T, bool REVERSE>
+void radixSortRepSequenceAndIdAndDiag(KmerPosition<T> *begin, KmerPosition<T> *end) {
+    KmerPositionSort::radixSort<T, REVERSE, false>(begin, end,
+        (REVERSE) ? KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse : KmerPosition<T>::compareRepSequenceAndIdAndDiag);
+}
+
+#endif
@@ -88,7 +88,7 @@ int kmerindexdb(int argc, const char **argv, const Command &command) {
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
-                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<short>))+1);
+                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/computeMemoryNeededLinearfilter<short>(1))+1);
     std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<short>(par, subMat, seqDbr, totalKmersPerSplit, splits);
 
     Debug(Debug::INFO) << "Process file into " << hashRanges.size() << " parts\n";
@@ -247,6 +247,8 @@ int kmerindexdb(int argc, const char **argv, const Command &command) {
         dbw.writeEnd( PrefilteringIndexReader::DBR1DATA, 0);
         dbw.alignToPageSize();
         free(data);
+        PrefilteringIndexReader::writeDictionary(dbw, &dbr1, PrefilteringIndexReader::DBR1DICT,
+                                                 (sameDB == true) ? PrefilteringIndexReader::DBR2DICT : UINT_MAX);
 
         if (sameDB == true) {
             dbw.writeIndexEntry(PrefilteringIndexReader::DBR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(dbr1)+1, 0);
@@ -268,6 +270,7 @@ int kmerindexdb(int argc, const char **argv, const Command &command) {
             dbw.writeEnd(PrefilteringIndexReader::DBR2DATA, 0);
             dbw.alignToPageSize();
             free(data);
+            PrefilteringIndexReader::writeDictionary(dbw, &dbr2, PrefilteringIndexReader::DBR2DICT);
             dbr2.close();
         }
 
@@ -289,6 +292,8 @@ int kmerindexdb(int argc, const char **argv, const Command &command) {
             dbw.writeEnd(PrefilteringIndexReader::HDR1DATA, 0);
             dbw.alignToPageSize();
             free(data);
+            PrefilteringIndexReader::writeDictionary(dbw, &hdbr1, PrefilteringIndexReader::HDR1DICT,
+                                                     (sameDB == true) ? PrefilteringIndexReader::HDR2DICT : UINT_MAX);
             if (sameDB == true) {
                 dbw.writeIndexEntry(PrefilteringIndexReader::HDR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(hdbr1)+1, 0);
                 dbw.writeIndexEntry(PrefilteringIndexReader::HDR2DATA,  offsetData, hdbr1.getTotalDataSize()+1, 0);
@@ -308,6 +313,7 @@ int kmerindexdb(int argc, const char **argv, const Command &command) {
                 }
                 dbw.writeEnd(PrefilteringIndexReader::HDR2DATA, 0);
                 dbw.alignToPageSize();
+                PrefilteringIndexReader::writeDictionary(dbw, &hdbr2, PrefilteringIndexReader::HDR2DICT);
                 hdbr2.close();
                 free(data);
             }
@@ -9,6 +9,7 @@
 #include "Debug.h"
 #include "DBReader.h"
 #include "omptl/omptl_algorithm"
+#include "KmerPositionSort.h"
 #include "MathUtil.h"
 #include "FileUtil.h"
 #include "NucleotideMatrix.h"
@@ -25,6 +26,9 @@
 #include <vector>
 #include <iomanip>
 #include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -375,32 +379,167 @@ std::pair<size_t, size_t> fillKmerPositionArray(KmerPosition<T> * kmerArray, siz
 }
 
 template <typename T>
-KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
-                                DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat) {
+KmerTable<T>::KmerTable(const std::string &file, const std::string &seqDbIndex, int dbtype, Parameters &par)
+        : file(file), data(NULL), dataSize(0) {
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, "MMSKMERT", sizeof(header.magic));
+    header.version = VERSION;
+    header.entrySize = sizeof(KmerPosition<T>);
+    header.dbtype = dbtype;
+
+    FILE *indexFile = FileUtil::openFileOrDie(seqDbIndex.c_str(), "r", true);
+    size_t indexSize = 0;
+    void *index = FileUtil::mmapFile(indexFile, &indexSize);
+    header.indexChecksum = XXH64(index, indexSize, 0);
+    FileUtil::munmapData(index, indexSize);
+    if (fclose(indexFile) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << seqDbIndex << "\n";
+        EXIT(EXIT_FAILURE);
+    }
 
-    KmerPosition<T> * hashSeqPair = initKmerPositionMemory<T>(totalKmers);
-    size_t elementsToSort;
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
-        elementsToSort = ret.first;
-        par.kmerSize = ret.second;
-        Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
-    }else{
-        std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
-        elementsToSort = ret.first;
+    // all parameters that change the k-mers extracted by fillKmerPositionArray
+    const bool isNucl = Parameters::isEqualDbtype(dbtype, Parameters::DBTYPE_NUCLEOTIDES);
+    std::ostringstream ss;
+    ss << par.kmerSize << " "
+       << (isNucl ? par.alphabetSize.nucleotides : par.alphabetSize.aminoacids) << " "
+       << (isNucl ? par.scoringMatrixFile.nucleotides : par.scoringMatrixFile.aminoacids) << " "
+       << par.kmersPerSequence << " "
+       << (isNucl ? par.kmersPerSequenceScale.nucleotides : par.kmersPerSequenceScale.aminoacids) << " "
+       << par.spacedKmer << " " << par.spacedKmerPattern << " "
+       << par.adjustKmerLength << " " << par.maskMode << " " << par.maskLowerCaseMode << " "
+       << par.maxSeqLen << " " << par.hashShift << " " << par.pickNbest << " " << par.ignoreMultiKmer;
+    const std::string parameters = ss.str();
+    header.parameterChecksum = XXH64(parameters.c_str(), parameters.size(), 0);
+}
+
+template <typename T>
+KmerTable<T>::~KmerTable() {
+    if (data != NULL) {
+        FileUtil::munmapData(data, dataSize);
+    }
+}
+
+template <typename T>
+KmerPosition<T> *KmerTable<T>::load(size_t *entries, int *kmerSize) {
+    if (FileUtil::fileExists(file.c_str()) == false) {
+        return NULL;
+    }
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Debug(Debug::WARNING) << "Cannot open k-mer table " << file << "\n";
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) < 0 || static_cast<size_t>(sb.st_size) < sizeof(Header)) {
+        Debug(Debug::WARNING) << "K-mer table " << file << " is invalid. Recompute k-mers\n";
+        close(fd);
+        return NULL;
     }
-    if(hashEndRange == SIZE_T_MAX){
-        seqDbr.unmapData();
+    dataSize = sb.st_size;
+    // private mapping since the rep. sequence assignment works in place on the table
+    void *ret = mmap(NULL, dataSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ret == MAP_FAILED) {
+        int errsv = errno;
+        Debug(Debug::ERROR) << "Failed to mmap k-mer table " << file << ". Error " << errsv << ".\n";
+        EXIT(EXIT_FAILURE);
+    }
+    data = static_cast<char *>(ret);
+
+    Header stored;
+    memcpy(&stored, data, sizeof(Header));
+    const char *reason = NULL;
+    if (memcmp(stored.magic, header.magic, sizeof(header.magic)) != 0 || stored.version != header.version
+        || stored.entrySize != header.entrySize) {
+        reason = "has an incompatible format";
+    } else if (stored.dbtype != header.dbtype || stored.indexChecksum != header.indexChecksum) {
+        reason = "was created for a different database";
+    } else if (stored.parameterChecksum != header.parameterChecksum) {
+        reason = "was created with different k-mer parameters";
+    } else if (dataSize != sizeof(Header) + (stored.entries + 1) * sizeof(KmerPosition<T>)) {
+        reason = "is truncated";
+    }
+    if (reason != NULL) {
+        Debug(Debug::WARNING) << "K-mer table " << file << " " << reason << ". Recompute k-mers\n";
+        FileUtil::munmapData(data, dataSize);
+        data = NULL;
+        dataSize = 0;
+        return NULL;
+    }
+    *entries = stored.entries;
+    *kmerSize = stored.kmerSize;
+    return reinterpret_cast<KmerPosition<T> *>(data + sizeof(Header));
+}
+
+template <typename T>
+void KmerTable<T>::write(KmerPosition<T> *kmers, size_t entries, int kmerSize) {
+    Header stored = header;
+    stored.kmerSize = kmerSize;
+    stored.entries = entries;
+    // write to a temporary file first, so no partially written table is picked up
+    std::string tmpFile = file + ".tmp";
+    FILE *handle = FileUtil::openAndDelete(tmpFile.c_str(), "wb");
+    if (fwrite(&stored, sizeof(Header), 1, handle) != 1
+        || fwrite(kmers, sizeof(KmerPosition<T>), entries + 1, handle) != entries + 1) {
+        Debug(Debug::ERROR) << "Cannot write k-mer table " << tmpFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Cannot close file " << tmpFile << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+        Debug(Debug::ERROR) << "Cannot move " << tmpFile << " to " << file << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+template <typename T>
+KmerPosition<T> * doComputation(size_t &totalKmers, size_t hashStartRange, size_t hashEndRange, std::string splitFile,
+                                DBReader<unsigned int> & seqDbr, Parameters & par, BaseMatrix  * subMat, KmerTable<T> *kmerTable) {
+    KmerPosition<T> * hashSeqPair = NULL;
+    size_t elementsToSort = 0;
+    if (kmerTable != NULL) {
+        hashSeqPair = kmerTable->load(&elementsToSort, &par.kmerSize);
+        if (hashSeqPair != NULL) {
+            Debug(Debug::INFO) << "Reuse " << elementsToSort << " sorted k-mers from k-mer table " << par.kmerTable << "\n";
+            // the table ends right after the extracted k-mers
+            totalKmers = elementsToSort;
+        }
     }
 
-    Debug(Debug::INFO) << "Sort kmer ";
     Timer timer;
-    if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-        omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPosReverse);
-    }else{
-        omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<T>::compareRepSequenceAndIdAndPos);
+    if (hashSeqPair == NULL) {
+        hashSeqPair = initKmerPositionMemory<T>(totalKmers);
+        if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
+            std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_NUCLEOTIDES, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
+            elementsToSort = ret.first;
+            par.kmerSize = ret.second;
+            Debug(Debug::INFO) << "\nAdjusted k-mer length " << par.kmerSize << "\n";
+        }else{
+            std::pair<size_t, size_t > ret = fillKmerPositionArray<Parameters::DBTYPE_AMINO_ACIDS, T>(hashSeqPair, totalKmers, seqDbr, par, subMat, true, hashStartRange, hashEndRange, NULL);
+            elementsToSort = ret.first;
+        }
+        if(hashEndRange == SIZE_T_MAX){
+            seqDbr.unmapData();
+        }
+
+        Debug(Debug::INFO) << "Sort kmer ";
+        timer.reset();
+        if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
+            radixSortRepSequenceAndIdAndPos<T, true>(hashSeqPair, hashSeqPair + elementsToSort);
+        }else{
+            radixSortRepSequenceAndIdAndPos<T, false>(hashSeqPair, hashSeqPair + elementsToSort);
+        }
+        Debug(Debug::INFO) << timer.lap() << "\n";
+
+        if (kmerTable != NULL) {
+            Debug(Debug::INFO) << "Write k-mer table " << par.kmerTable << " ";
+            timer.reset();
+            kmerTable->write(hashSeqPair, elementsToSort, par.kmerSize);
+            Debug(Debug::INFO) << timer.lap() << "\n";
+        }
     }
-    Debug(Debug::INFO) << timer.lap() << "\n";
 
     // assign rep. sequence to same kmer members
     // The longest sequence is the first since we sorted by kmer, seq.Len and id
@@ -415,11 +554,10 @@ KmerPosition<T> * doComputation(size_t totalKmers, size_t hashStartRange, size_t
     Debug(Debug::INFO) << "Sort by rep. sequence ";
     timer.reset();
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)){
-        omptl::sort(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiagReverse);
+        radixSortRepSequenceAndIdAndDiag<T, true>(hashSeqPair, hashSeqPair + writePos);
     }else{
-        omptl::sort(hashSeqPair, hashSeqPair + writePos, KmerPosition<T>::compareRepSequenceAndIdAndDiag);
+        radixSortRepSequenceAndIdAndDiag<T, false>(hashSeqPair, hashSeqPair + writePos);
     }
-    //kx::radix_sort(hashSeqPair, hashSeqPair + elementsToSort, SequenceComparision());
 //    for(size_t i = 0; i < writePos; i++){
 //        std::cout << BIT_CLEAR(hashSeqPair[i].kmer, 63) << "\t" << hashSeqPair[i].id << "\t" << hashSeqPair[i].pos << std::endl;
 //    }
@@ -576,7 +714,8 @@ size_t computeKmerCount(DBReader<unsigned int> &reader, size_t KMER_SIZE, size_t
 
 template <typename T>
 size_t computeMemoryNeededLinearfilter(size_t totalKmer) {
-    return sizeof(KmerPosition<T>) * totalKmer;
+    // the radix sort needs a second buffer of the same size as the k-mer array
+    return 2 * sizeof(KmerPosition<T>) * totalKmer;
 }
 
 
@@ -613,7 +752,7 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
-                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<T>))+1);
+                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/computeMemoryNeededLinearfilter<T>(1))+1);
 
     std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<T>(par, subMat, seqDbr, totalKmersPerSplit, splits);
     if(splits > 1){
@@ -621,9 +760,13 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     }
     std::vector<std::string> splitFiles;
     KmerPosition<T> *hashSeqPair = NULL;
+    KmerTable<T> *kmerTable = NULL;
 
     size_t mpiRank = 0;
 #ifdef HAVE_MPI
+    if (par.kmerTable.empty() == false) {
+        Debug(Debug::WARNING) << "K-mer table is not supported with MPI. Ignore --kmer-table\n";
+    }
     splits = std::max(static_cast<size_t>(MMseqsMPI::numProc), splits);
     size_t fromSplit = 0;
     size_t splitCount = 1;
@@ -646,7 +789,7 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
         int range=MathUtil::ceilIntDivision(USHRT_MAX+1, static_cast<int>(splits));
         size_t rangeFrom = split*range;
         size_t rangeTo = (splits == 1) ? SIZE_T_MAX : splits*range+range;
-        hashSeqPair = doComputation<T>(totalKmers, rangeFrom, rangeTo, splitFileName, seqDbr, par, subMat);
+        hashSeqPair = doComputation<T>(totalKmers, rangeFrom, rangeTo, splitFileName, seqDbr, par, subMat, NULL);
     }
     MPI_Barrier(MPI_COMM_WORLD);
     if(mpiRank == 0){
@@ -656,13 +799,20 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
         }
     }
 #else
+    if (par.kmerTable.empty() == false) {
+        if (hashRanges.size() == 1) {
+            kmerTable = new KmerTable<T>(par.kmerTable, par.db1Index, seqDbr.getDbtype(), par);
+        } else {
+            Debug(Debug::WARNING) << "K-mer table can not be used if the k-mers are processed in multiple parts. Ignore --kmer-table\n";
+        }
+    }
     for(size_t split = 0; split < hashRanges.size(); split++) {
         std::string splitFileName = par.db2 + "_split_" +SSTR(split);
         Debug(Debug::INFO) << "Generate k-mers list for " << (split+1) <<" split\n";
 
         std::string splitFileNameDone = splitFileName + ".done";
         if(FileUtil::fileExists(splitFileNameDone.c_str()) == false){
-            hashSeqPair = doComputation<T>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat);
+            hashSeqPair = doComputation<T>(totalKmersPerSplit, hashRanges[split].first, hashRanges[split].second, splitFileName, seqDbr, par, subMat, kmerTable);
         }
 
         splitFiles.push_back(splitFileName);
@@ -724,9 +874,16 @@ int kmermatcherInner(Parameters& par, DBReader<unsigned int>& seqDbr) {
     }
     // free memory
     delete subMat;
+    if(kmerTable != NULL && kmerTable->isLoaded()){
+        // hashSeqPair points into the mapped table
+        hashSeqPair = NULL;
+    }
     if(hashSeqPair){
         delete [] hashSeqPair;
     }
+    if(kmerTable != NULL){
+        delete kmerTable;
+    }
 
     return EXIT_SUCCESS;
 }
@@ -753,7 +910,7 @@ std::vector<std::pair<size_t, size_t>> setupKmerSplits(Parameters &par, BaseMatr
             }
         }
         if(maxBucketSize > totalKmers){
-            Debug(Debug::INFO) << "Not enough memory to run the kmermatcher. Minimum is at least " << maxBucketSize* sizeof(KmerPosition<T>) << " bytes\n";
+            Debug(Debug::INFO) << "Not enough memory to run the kmermatcher. Minimum is at least " << computeMemoryNeededLinearfilter<T>(maxBucketSize) << " bytes\n";
             EXIT(EXIT_FAILURE);
         }
         // define splits
@@ -1228,6 +1385,9 @@ template std::pair<size_t, size_t>  fillKmerPositionArray<1, int>(KmerPosition <
 template std::pair<size_t, size_t>  fillKmerPositionArray<2, int>(KmerPosition< int> * kmerArray, size_t kmerArraySize, DBReader<unsigned int> &seqDbr,
                                                                   Parameters & par, BaseMatrix * subMat, bool hashWholeSequence, size_t hashStartRange, size_t hashEndRange, size_t * hashDistribution);
 
+template class KmerTable<short>;
+template class KmerTable<int>;
+
 template KmerPosition<short> *initKmerPositionMemory(size_t size);
 template KmerPosition<int> *initKmerPositionMemory(size_t size);
 
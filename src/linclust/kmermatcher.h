@@ -192,6 +192,43 @@ public:
     }
 };
 
+// Sorted k-mer array of a sequence DB before the rep. sequence assignment, stored on disk.
+// Later kmermatcher runs on the same DB with the same k-mer parameters mmap it
+// instead of extracting and sorting the k-mers again.
+template <typename T>
+class KmerTable {
+public:
+    static const unsigned int VERSION = 1;
+
+    KmerTable(const std::string &file, const std::string &seqDbIndex, int dbtype, Parameters &par);
+    ~KmerTable();
+
+    // returns the table terminated by a SIZE_T_MAX k-mer, the entries can be modified (private mapping)
+    // returns NULL if the file does not exist or was created for a different DB or with different parameters
+    KmerPosition<T> *load(size_t *entries, int *kmerSize);
+    // kmers has to be terminated by a SIZE_T_MAX k-mer at position entries
+    void write(KmerPosition<T> *kmers, size_t entries, int kmerSize);
+    bool isLoaded() const {
+        return data != NULL;
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        unsigned int version;
+        unsigned int entrySize;
+        int dbtype;
+        int kmerSize;
+        size_t indexChecksum;
+        size_t parameterChecksum;
+        size_t entries;
+    };
+
+    std::string file;
+    Header header;
+    char *data;
+    size_t dataSize;
+};
 
 template  <int TYPE, typename T>
 size_t assignGroup(KmerPosition<T> *kmers, size_t splitKmerCount, bool includeOnlyExtendable, int covMode, float covThr);
@@ -16,6 +16,7 @@
 #include "FileUtil.h"
 
 #include "omptl/omptl_algorithm"
+#include "KmerPositionSort.h"
 
 #ifndef SIZE_T_MAX
 #define SIZE_T_MAX ((size_t) -1)
@@ -48,9 +49,9 @@ KmerSearch::ExtractKmerAndSortResult KmerSearch::extractKmerAndSort(size_t total
     Debug(Debug::INFO) << "Sort kmer ... ";
     timer.reset();
     if(Parameters::isEqualDbtype(seqDbr.getDbtype(), Parameters::DBTYPE_NUCLEOTIDES)) {
-        omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<short>::compareRepSequenceAndIdAndPosReverse);
+        radixSortRepSequenceAndIdAndPos<short, true>(hashSeqPair, hashSeqPair + elementsToSort);
     }else{
-        omptl::sort(hashSeqPair, hashSeqPair + elementsToSort, KmerPosition<short>::compareRepSequenceAndIdAndPos);
+        radixSortRepSequenceAndIdAndPos<short, false>(hashSeqPair, hashSeqPair + elementsToSort);
     }
 
 
@@ -216,7 +217,7 @@ int kmersearch(int argc, const char **argv, const Command &command) {
     // compute splits
     size_t splits = static_cast<size_t>(std::ceil(static_cast<float>(totalSizeNeeded) / memoryLimit));
     size_t totalKmersPerSplit = std::max(static_cast<size_t>(1024+1),
-                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/sizeof(KmerPosition<short>))+1);
+                                         static_cast<size_t>(std::min(totalSizeNeeded, memoryLimit)/computeMemoryNeededLinearfilter<short>(1))+1);
 
     std::vector<std::pair<size_t, size_t>> hashRanges = setupKmerSplits<short>(par, subMat, queryDbr, totalKmersPerSplit, splits);
 
@@ -425,9 +426,9 @@ std::pair<KmerPosition<short> *,size_t > KmerSearch::searchInIndex(KmerPosition<
     Debug(Debug::INFO) << "Time to find k-mers: " << timer.lap() << "\n";
     timer.reset();
     if(TYPE == Parameters::DBTYPE_NUCLEOTIDES) {
-        omptl::sort(kmers, kmers + writePos, KmerPosition<short>::compareRepSequenceAndIdAndDiagReverse);
+        radixSortRepSequenceAndIdAndDiag<short, true>(kmers, kmers + writePos);
     }else{
-        omptl::sort(kmers, kmers + writePos, KmerPosition<short>::compareRepSequenceAndIdAndDiag);
+        radixSortRepSequenceAndIdAndDiag<short, false>(kmers, kmers + writePos);
     }
 
     Debug(Debug::INFO) << "Time to sort: " << timer.lap() << "\n";
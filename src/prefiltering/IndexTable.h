@@ -66,7 +66,7 @@ public:
     IndexTable(int alphabetSize, int kmerSize, bool externalData)
             : tableSize(MathUtil::ipow<size_t>(alphabetSize, kmerSize)), alphabetSize(alphabetSize),
               kmerSize(kmerSize), externalData(externalData), tableEntriesNum(0), size(0),
-              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), offsets(NULL) {
+              indexer(new Indexer(alphabetSize, kmerSize)), entries(NULL), compressedEntries(NULL), compressedSize(0), offsets(NULL) {
         if (externalData == false) {
             offsets = new(std::nothrow) size_t[tableSize + 1];
             Util::checkAllocation(offsets, "Can not allocate entries memory in IndexTable");
@@ -85,6 +85,10 @@ public:
                 delete[] entries;
                 entries = NULL;
             }
+            if (compressedEntries != NULL) {
+                delete[] compressedEntries;
+                compressedEntries = NULL;
+            }
             if (offsets != NULL) {
                 delete[] offsets;
                 offsets = NULL;
@@ -175,6 +179,163 @@ public:
         return (entries + offsets[kmer]);
     }
 
+    // number of entries in the list of the k-mer, works for plain and compressed lists
+    inline size_t getDBSeqListSize(size_t kmer) {
+        const size_t listSize = offsets[kmer + 1] - offsets[kmer];
+        if (compressedEntries == NULL || listSize == 0) {
+            return listSize;
+        }
+        const unsigned char *data = compressedEntries + offsets[kmer];
+        return readVarint(data);
+    }
+
+    // copies (or decodes) the list of the k-mer to out, returns the number of entries
+    inline size_t copyDBSeqList(size_t kmer, IndexEntryLocal *out) {
+        const size_t listSize = offsets[kmer + 1] - offsets[kmer];
+        if (compressedEntries == NULL) {
+            memcpy(out, entries + offsets[kmer], sizeof(IndexEntryLocal) * listSize);
+            return listSize;
+        }
+        return (listSize == 0) ? 0 : decodeDBSeqList(compressedEntries + offsets[kmer], out);
+    }
+
+    // Compressed k-mer lists: each list starts with its number of entries, followed by the seqId
+    // difference to the previous entry and the position of each entry, all as LEB128 varints.
+    // The lists are sorted by seqId, so the differences are small for frequent k-mers.
+    // The offsets then point to the first byte of each list, empty lists have no bytes.
+    static inline size_t readVarint(const unsigned char *&data) {
+        size_t value = data[0] & 0x7F;
+        if (data[0] < 0x80) {
+            data += 1;
+            return value;
+        }
+        value |= static_cast<size_t>(data[1] & 0x7F) << 7;
+        if (data[1] < 0x80) {
+            data += 2;
+            return value;
+        }
+        unsigned int shift = 14;
+        data += 2;
+        while (*data >= 0x80) {
+            value |= static_cast<size_t>(*data & 0x7F) << shift;
+            shift += 7;
+            data++;
+        }
+        value |= static_cast<size_t>(*data) << shift;
+        data++;
+        return value;
+    }
+
+    static inline unsigned char *writeVarint(unsigned char *data, size_t value) {
+        while (value >= 0x80) {
+            *data = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+            data++;
+        }
+        *data = static_cast<unsigned char>(value);
+        return data + 1;
+    }
+
+    static inline size_t varintSize(size_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    // decodes the compressed list starting at data into out, returns the number of entries
+    static inline size_t decodeDBSeqList(const unsigned char *data, IndexEntryLocal *out) {
+        const size_t listSize = readVarint(data);
+        unsigned int seqId = 0;
+        for (size_t i = 0; i < listSize; i++) {
+            seqId += static_cast<unsigned int>(readVarint(data));
+            out[i].seqId = seqId;
+            out[i].position_j = static_cast<unsigned short>(readVarint(data));
+        }
+        return listSize;
+    }
+
+    // replaces the sorted k-mer lists by their compressed form, the offsets then refer to bytes
+    // the offsets are rewritten in place, chunk wise, to avoid a second offsets table
+    void compressEntries() {
+        if (externalData == true || compressedEntries != NULL) {
+            return;
+        }
+        const size_t chunkCount = std::min(tableSize, static_cast<size_t>(COMPRESSION_CHUNKS));
+        const size_t chunkSize = (tableSize + chunkCount - 1) / chunkCount;
+        // compressed bytes per chunk, prefix summed to the byte offset of each chunk
+        size_t *chunkOffsets = new size_t[chunkCount + 1];
+        // uncompressed offsets at the chunk boundaries, these get overwritten by the neighbouring chunk
+        size_t *chunkBoundaries = new size_t[chunkCount + 1];
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t start = std::min(tableSize, chunk * chunkSize);
+            const size_t end = std::min(tableSize, start + chunkSize);
+            size_t bytes = 0;
+            for (size_t i = start; i < end; i++) {
+                const size_t listSize = offsets[i + 1] - offsets[i];
+                if (listSize == 0) {
+                    continue;
+                }
+                const IndexEntryLocal *list = entries + offsets[i];
+                bytes += varintSize(listSize);
+                unsigned int prevSeqId = 0;
+                for (size_t j = 0; j < listSize; j++) {
+                    bytes += varintSize(list[j].seqId - prevSeqId) + varintSize(list[j].position_j);
+                    prevSeqId = list[j].seqId;
+                }
+            }
+            chunkOffsets[chunk] = bytes;
+            chunkBoundaries[chunk] = offsets[start];
+        }
+        chunkBoundaries[chunkCount] = offsets[tableSize];
+        size_t offset = 0;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t bytes = chunkOffsets[chunk];
+            chunkOffsets[chunk] = offset;
+            offset += bytes;
+        }
+        chunkOffsets[chunkCount] = offset;
+
+        compressedSize = offset;
+        compressedEntries = new(std::nothrow) unsigned char[std::max(compressedSize, static_cast<size_t>(1))];
+        Util::checkAllocation(compressedEntries, "Can not allocate " + SSTR(compressedSize) + " bytes for compressed entries in IndexTable::compressEntries");
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            const size_t start = std::min(tableSize, chunk * chunkSize);
+            const size_t end = std::min(tableSize, start + chunkSize);
+            unsigned char *data = compressedEntries + chunkOffsets[chunk];
+            size_t listStart = chunkBoundaries[chunk];
+            for (size_t i = start; i < end; i++) {
+                const size_t listEnd = (i + 1 == end) ? chunkBoundaries[chunk + 1] : offsets[i + 1];
+                offsets[i] = data - compressedEntries;
+                const size_t listSize = listEnd - listStart;
+                if (listSize > 0) {
+                    const IndexEntryLocal *list = entries + listStart;
+                    data = writeVarint(data, listSize);
+                    unsigned int prevSeqId = 0;
+                    for (size_t j = 0; j < listSize; j++) {
+                        data = writeVarint(data, list[j].seqId - prevSeqId);
+                        data = writeVarint(data, list[j].position_j);
+                        prevSeqId = list[j].seqId;
+                    }
+                }
+                listStart = listEnd;
+            }
+        }
+        offsets[tableSize] = compressedSize;
+        delete[] chunkBoundaries;
+        delete[] chunkOffsets;
+        delete[] entries;
+        entries = NULL;
+    }
+
+    bool isCompressed() {
+        return compressedEntries != NULL;
+    }
+
     void sortDBSeqLists() {
         #pragma omp parallel for
         for (size_t i = 0; i < tableSize; i++) {
@@ -184,11 +345,21 @@ public:
         }
     }
 
-    // get pointer to entries array
+    // get pointer to entries array, NULL if the lists are compressed
     IndexEntryLocal *getEntries() {
         return entries;
     }
 
+    // get pointer to the compressed lists, NULL if the lists are not compressed
+    unsigned char *getCompressedEntries() {
+        return compressedEntries;
+    }
+
+    // size in bytes of the stored lists
+    size_t getEntriesDataSize() {
+        return (compressedEntries != NULL) ? compressedSize : tableEntriesNum * sizeof(IndexEntryLocal);
+    }
+
     inline size_t getOffset(size_t kmer) {
         return offsets[kmer];
     }
@@ -244,6 +415,27 @@ public:
         memcpy(this->offsets, entryOffsets, (tableSize + 1) * sizeof(size_t));
     }
 
+    void initCompressedTableByExternalData(size_t sequenceCount, size_t tableEntriesNum, unsigned char *compressedEntries, size_t compressedSize, size_t *entryOffsets) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = sequenceCount;
+
+        this->compressedEntries = compressedEntries;
+        this->compressedSize = compressedSize;
+        this->offsets = entryOffsets;
+    }
+
+    void initCompressedTableByExternalDataCopy(size_t sequenceCount, size_t tableEntriesNum, unsigned char *compressedEntries, size_t compressedSize, size_t *entryOffsets) {
+        this->tableEntriesNum = tableEntriesNum;
+        this->size = sequenceCount;
+
+        this->compressedSize = compressedSize;
+        this->compressedEntries = new(std::nothrow) unsigned char[std::max(compressedSize, static_cast<size_t>(1))];
+        Util::checkAllocation(this->compressedEntries, "Can not allocate " + SSTR(compressedSize) + " bytes for compressed entries in IndexTable::initCompressedTableByExternalDataCopy");
+        memcpy(this->compressedEntries, compressedEntries, compressedSize);
+
+        memcpy(this->offsets, entryOffsets, (tableSize + 1) * sizeof(size_t));
+    }
+
     void revertPointer() {
         for (size_t i = tableSize; i > 0; i--) {
             offsets[i] = offsets[i - 1];
@@ -475,6 +667,11 @@ protected:
 
     // Index table entries: ids of sequences containing a certain k-mer, stored sequentially in the memory
     IndexEntryLocal *entries;
+    // the same lists compressed (see compressEntries), only one of both is set
+    unsigned char *compressedEntries;
+    size_t compressedSize;
+    // number of k-mer ranges compressEntries works on in parallel
+    static const unsigned int COMPRESSION_CHUNKS = 4096;
     size_t *offsets;
 
     // sequence lookup
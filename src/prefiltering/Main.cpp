@@ -1,4 +1,6 @@
 #include "Prefiltering.h"
+#include "Alignment.h"
+#include "BoundedQueue.h"
 #include "Util.h"
 #include "Parameters.h"
 #include "MMseqsMPI.h"
@@ -10,15 +12,9 @@
 #include <omp.h>
 #endif
 
-int prefilter(int argc, const char **argv, const Command& command) {
-    MMseqsMPI::init(argc, argv);
-
-    Parameters& par = Parameters::getInstance();
-    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
-
-    Timer timer;
-    int queryDbType = FileUtil::parseDbType(par.db1.c_str());
-    int targetDbType = FileUtil::parseDbType(par.db2.c_str());
+static bool getQueryTargetDbTypes(Parameters &par, int &queryDbType, int &targetDbType) {
+    queryDbType = FileUtil::parseDbType(par.db1.c_str());
+    targetDbType = FileUtil::parseDbType(par.db2.c_str());
     if(Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_INDEX_DB) == true) {
         DBReader<unsigned int> dbr(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX | DBReader<unsigned int>::USE_DATA);
         dbr.open(DBReader<unsigned int>::NOSORT);
@@ -28,27 +24,42 @@ int prefilter(int argc, const char **argv, const Command& command) {
     }
     if (queryDbType == -1 || targetDbType == -1) {
         Debug(Debug::ERROR) << "Please recreate your database or add a .dbtype file to your sequence/profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_HMM_PROFILE) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_HMM_PROFILE)) {
         Debug(Debug::ERROR) << "Only the query OR the target database can be a profile database.\n";
-        return EXIT_FAILURE;
+        return false;
     }
 
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_AMINO_ACIDS) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_NUCLEOTIDES)) {
         Debug(Debug::ERROR) << "The prefilter can not search amino acids against nucleotides. Something might got wrong while createdb or createindex.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_NUCLEOTIDES) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_AMINO_ACIDS)) {
         Debug(Debug::ERROR) << "The prefilter can not search nucleotides against amino acids. Something might got wrong while createdb or createindex.\n";
-        return EXIT_FAILURE;
+        return false;
     }
     if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_HMM_PROFILE) == false && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_PROFILE_STATE_SEQ)) {
         Debug(Debug::ERROR) << "The query has to be a profile when using a target profile state database.\n";
-        return EXIT_FAILURE;
+        return false;
     } else if (Parameters::isEqualDbtype(queryDbType, Parameters::DBTYPE_HMM_PROFILE) && Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_PROFILE_STATE_SEQ)) {
         queryDbType = Parameters::DBTYPE_PROFILE_STATE_PROFILE;
     }
+    return true;
+}
+
+int prefilter(int argc, const char **argv, const Command& command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER);
+
+    Timer timer;
+    int queryDbType;
+    int targetDbType;
+    if (getQueryTargetDbTypes(par, queryDbType, targetDbType) == false) {
+        return EXIT_FAILURE;
+    }
 
     Prefiltering pref(par.db1, par.db1Index, par.db2, par.db2Index, queryDbType, targetDbType, par);
 
@@ -66,3 +77,85 @@ int prefilter(int argc, const char **argv, const Command& command) {
 
     return EXIT_SUCCESS;
 }
+
+int prefilteralign(int argc, const char **argv, const Command& command) {
+    MMseqsMPI::init(argc, argv);
+
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, MMseqsParameter::COMMAND_PREFILTER | MMseqsParameter::COMMAND_ALIGN);
+
+#ifdef HAVE_MPI
+    if (MMseqsMPI::numProc > 1) {
+        Debug(Debug::ERROR) << "prefilteralign cannot be distributed with MPI. Use prefilter and align instead.\n";
+        return EXIT_FAILURE;
+    }
+#endif
+
+    int queryDbType;
+    int targetDbType;
+    if (getQueryTargetDbTypes(par, queryDbType, targetDbType) == false) {
+        return EXIT_FAILURE;
+    }
+
+    // prefilter and alignment run at the same time and share the available threads
+    const int threads = par.threads;
+    const int prefilterThreads = std::max(1, threads / 2);
+    const int alignmentThreads = std::max(1, threads - prefilterThreads);
+
+    // regions without an explicit thread count use the OpenMP default, keep it in sync with par.threads
+    par.threads = prefilterThreads;
+#ifdef OPENMP
+    omp_set_num_threads(prefilterThreads);
+#endif
+    Prefiltering pref(par.db1, par.db1Index, par.db2, par.db2Index, queryDbType, targetDbType, par);
+    if (pref.hasCompleteQueryResults() == false) {
+        // hits of a query are only complete once all target splits are merged
+        Debug(Debug::WARNING) << "Prefilter results cannot be streamed in target split mode. The prefilter result will be written before the alignment.\n";
+        std::pair<std::string, std::string> prefDb = Util::databaseNames(par.db3 + "_pref");
+        pref.runAllSplits(prefDb.first, prefDb.second);
+        par.threads = threads;
+#ifdef OPENMP
+        omp_set_num_threads(threads);
+#endif
+        {
+            Alignment aln(par.db1, par.db2, prefDb.first, prefDb.second, par.db3, par.db3Index, par);
+            Debug(Debug::INFO) << "Calculation of alignments\n";
+            aln.run(par.maxAccept, par.maxRejected, par.wrappedScoring);
+        }
+        DBReader<unsigned int>::removeDb(prefDb.first);
+        return EXIT_SUCCESS;
+    }
+
+    par.threads = alignmentThreads;
+    Alignment aln(par.db1, par.db2, "", "", par.db3, par.db3Index, par);
+    par.threads = threads;
+
+#ifdef OPENMP
+    // prefilter and alignment each open their own parallel region
+    omp_set_max_active_levels(2);
+    BoundedQueue<PrefilterQueryResult> queue(64 * static_cast<size_t>(alignmentThreads));
+#else
+    // without OpenMP the sections below run one after the other, so the queue has to hold all results
+    BoundedQueue<PrefilterQueryResult> queue(SIZE_MAX);
+#endif
+    Debug(Debug::INFO) << "Streaming prefilter results to the alignment\n";
+#pragma omp parallel sections num_threads(2)
+    {
+#pragma omp section
+        {
+#ifdef OPENMP
+            omp_set_num_threads(prefilterThreads);
+#endif
+            pref.runAllSplits(queue);
+        }
+#pragma omp section
+        {
+#ifdef OPENMP
+            omp_set_num_threads(alignmentThreads);
+#endif
+            aln.run(queue, par.maxAccept, par.maxRejected, par.wrappedScoring);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -49,7 +49,8 @@ Prefiltering::Prefiltering(const std::string &queryDB,
         aaBiasCorrection(par.compBiasCorrection != 0),
         covThr(par.covThr), covMode(par.covMode), includeIdentical(par.includeIdentity),
         preloadMode(par.preloadMode),
-        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed) {
+        threads(static_cast<unsigned int>(par.threads)), compressed(par.compressed), binaryResult(par.binaryPrefilter),
+        indexCompression(par.indexCompression), resultQueue(NULL) {
     sameQTDB = isSameQTDB();
 
     // init the substitution matrices
@@ -193,9 +194,11 @@ Prefiltering::Prefiltering(const std::string &queryDB,
     }
     Debug(Debug::INFO) << "Query database size: " << qdbr->getSize() << " type: " << Parameters::getDbTypeName(querySeqType) << "\n";
 
+    // a precomputed compressed index is loaded as is, without the plain lists needed while building it
+    const size_t entriesSize = templateDBIsIndex ? PrefilteringIndexReader::getCompressedEntriesSize(tidxdbr) : 0;
     setupSplit(*tdbr, alphabetSize - 1, querySeqType,
                threads, templateDBIsIndex, memoryLimit, qdbr->getSize(),
-               maxResListLen, kmerSize, splits, splitMode);
+               maxResListLen, kmerSize, splits, splitMode, entriesSize);
 
     if(Parameters::isEqualDbtype(targetSeqType, Parameters::DBTYPE_NUCLEOTIDES) == false){
         const bool isProfileSearch = Parameters::isEqualDbtype(querySeqType, Parameters::DBTYPE_HMM_PROFILE) ||
@@ -261,10 +264,10 @@ Prefiltering::~Prefiltering() {
 
 void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSize, const unsigned int querySeqTyp, const int threads,
                               const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize,
-                              size_t &maxResListLen, int &kmerSize, int &split, int &splitMode) {
+                              size_t &maxResListLen, int &kmerSize, int &split, int &splitMode, size_t entriesSize) {
     size_t memoryNeeded = estimateMemoryConsumption(1, tdbr.getSize(), tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize,
                                                     kmerSize == 0 ? // if auto detect kmerSize
-                                                    IndexTable::computeKmerSize(tdbr.getAminoAcidDBSize()) : kmerSize, querySeqTyp, threads);
+                                                    IndexTable::computeKmerSize(tdbr.getAminoAcidDBSize()) : kmerSize, querySeqTyp, threads, entriesSize);
 
     int optimalSplitMode = Parameters::TARGET_DB_SPLIT;
     if (memoryNeeded > 0.9 * memoryLimit) {
@@ -297,7 +300,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSi
     if (memoryNeeded > 0.9 * memoryLimit) {
         // memory is not enough to compute everything at once
         //TODO add PROFILE_STATE (just 6-mers)
-        std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &tdbr, alphabetSize, kmerSize, querySeqTyp, threads);
+        std::pair<int, int> splitSettings = Prefiltering::optimizeSplit(memoryLimit, &tdbr, alphabetSize, kmerSize, querySeqTyp, threads, entriesSize);
         if (splitSettings.second == -1) {
             Debug(Debug::ERROR) << "Cannot fit databased into " << ByteParser::format(memoryLimit) << ". Please use a computer with more main memory.\n";
             EXIT(EXIT_FAILURE);
@@ -354,7 +357,7 @@ void Prefiltering::setupSplit(DBReader<unsigned int>& tdbr, const int alphabetSi
     }
 
     size_t memoryNeededPerSplit = estimateMemoryConsumption((splitMode == Parameters::TARGET_DB_SPLIT) ? split : 1, tdbr.getSize(),
-                                                            tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, kmerSize, querySeqTyp, threads);
+                                                            tdbr.getAminoAcidDBSize(), maxResListLen, alphabetSize, kmerSize, querySeqTyp, threads, entriesSize);
     Debug(Debug::INFO) << "Estimated memory consumption: " << ByteParser::format(memoryNeededPerSplit) << "\n";
     if (memoryNeededPerSplit > 0.9 * memoryLimit) {
         Debug(Debug::WARNING) << "Process needs more than " << ByteParser::format(memoryLimit) << " main memory.\n" <<
@@ -402,11 +405,19 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     }
     reader1.setDataSize(totalSize);
 
+    const bool binary = reader1.isBinary();
     FILE ** files = new FILE*[fileNames.size()];
     char ** dataFile = new char*[fileNames.size()];
     size_t * dataFileSize = new size_t[fileNames.size()];
+    // binary records can contain null bytes, so entries are located through the index instead of scanning the data
+    DBReader<unsigned int> ** splitReaders = new DBReader<unsigned int>*[fileNames.size()];
     size_t globalIdOffset = 0;
     for (size_t i = 0; i < splits; ++i) {
+        if (binary) {
+            splitReaders[i] = new DBReader<unsigned int>(fileNames[i].first.c_str(), fileNames[i].second.c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_BINARY);
+            splitReaders[i]->open(DBReader<unsigned int>::LINEAR_ACCCESS);
+            continue;
+        }
         files[i] = FileUtil::openFileOrDie(fileNames[i].first.c_str(), "r", true);
         dataFile[i] = static_cast<char*>(FileUtil::mmapFile(files[i], &dataFileSize[i]));
 #ifdef HAVE_POSIX_MADVISE
@@ -419,7 +430,7 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     Debug(Debug::INFO) << "Preparing offsets for merging: " << timer.lap() << "\n";
     // merge target splits data files and sort the hits at the same time
     // TODO: compressed?
-    DBWriter writer(outDB.c_str(), outDBIndex.c_str(), threads, 0, Parameters::DBTYPE_PREFILTER_RES);
+    DBWriter writer(outDB.c_str(), outDBIndex.c_str(), threads, 0, reader1.getDbtype());
     writer.open();
 
     Debug::Progress progress(reader1.getSize());
@@ -441,6 +452,10 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
         while(currentId < reader1.getSize()){
             progress.updateProgress();
             for(size_t file = 0; file < splits; file++){
+                if (binary) {
+                    QueryMatcher::readPrefilterHits(*splitReaders[file], currentId, thread_idx, hits);
+                    continue;
+                }
                 size_t tmpId = prevId;
                 size_t pos;
                 for(pos = currentDataFileOffset[file]; pos < dataFileSize[file] && tmpId != currentId; pos++){
@@ -454,7 +469,7 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
                 std::sort(hits.begin(), hits.end(), hit_t::compareHitsByScoreAndId);
             }
             for (size_t i = 0; i < hits.size(); ++i) {
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, hits[i]);
+                int len = QueryMatcher::prefilterHitToBuffer(buffer, hits[i], binary);
                 result.append(buffer, len);
             }
             writer.writeData(result.c_str(), result.size(), reader1.getDbKey(currentId), thread_idx);
@@ -470,10 +485,16 @@ void Prefiltering::mergeTargetSplits(const std::string &outDB, const std::string
     reader1.close();
 
     for (size_t i = 0; i < splits; ++i) {
+        if (binary) {
+            splitReaders[i]->close();
+            delete splitReaders[i];
+        } else {
+            FileUtil::munmapData(dataFile[i], dataFileSize[i]);
+            fclose(files[i]);
+        }
         DBReader<unsigned int>::removeDb(fileNames[i].first);
-        FileUtil::munmapData(dataFile[i], dataFileSize[i]);
-        fclose(files[i]);
     }
+    delete [] splitReaders;
     delete [] dataFile;
     delete [] dataFileSize;
     delete [] files;
@@ -532,6 +553,12 @@ void Prefiltering::getIndexTable(int split, size_t dbFrom, size_t dbSize) {
         }
 
         indexTable->printStatistics(kmerSubMat->num2aa);
+        if (indexCompression) {
+            const size_t plainSize = indexTable->getEntriesDataSize();
+            indexTable->compressEntries();
+            Debug(Debug::INFO) << "Index table: compressed entries from " << ByteParser::format(plainSize)
+                               << " to " << ByteParser::format(indexTable->getEntriesDataSize()) << "\n";
+        }
         tdbr->remapData();
         Debug(Debug::INFO) << "Time for index table init: " << timer.lap() << "\n";
     }
@@ -556,6 +583,19 @@ void Prefiltering::runAllSplits(const std::string &resultDB, const std::string &
     runSplits(resultDB, resultDBIndex, 0, splits, false);
 }
 
+void Prefiltering::runAllSplits(BoundedQueue<PrefilterQueryResult> &queue) {
+    if (hasCompleteQueryResults() == false) {
+        Debug(Debug::ERROR) << "Prefilter results cannot be streamed in target split mode.\n";
+        EXIT(EXIT_FAILURE);
+    }
+    resultQueue = &queue;
+    for (int i = 0; i < splits; i++) {
+        runSplit("", "", i, false);
+    }
+    resultQueue = NULL;
+    queue.close();
+}
+
 #ifdef HAVE_MPI
 void Prefiltering::runMpiSplits(const std::string &resultDB, const std::string &resultDBIndex, const std::string &localTmpPath, const int runRandomId) {
     if(compressed == true && splitMode == Parameters::TARGET_DB_SPLIT){
@@ -683,7 +723,7 @@ int Prefiltering::runSplits(const std::string &resultDB, const std::string &resu
                 resultReader.open(DBReader<unsigned int>::NOSORT);
                 resultReader.readMmapedDataInMemory();
                 const std::pair<std::string, std::string> tempDb = Util::databaseNames(resultDB + "_tmp");
-                DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+                DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), threads, compressed, getResultDbType());
                 resultWriter.open();
                 resultWriter.sortDatafileByIdOrder(resultReader);
                 resultWriter.close(true);
@@ -738,6 +778,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     Debug(Debug::INFO) << "k-mer similarity threshold: " << kmerThr << "\n";
 
     double kmersPerPos = 0;
+    double indexLookupTime = 0;
     size_t dbMatches = 0;
     size_t doubleMatches = 0;
     size_t querySeqLenSum = 0;
@@ -752,8 +793,12 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
     localThreads = std::min((unsigned int)threads, (unsigned int)querySize);
 #endif
 
-    DBWriter tmpDbw(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
-    tmpDbw.open();
+    // no result database is written if the hits are streamed to the result queue
+    DBWriter *tmpDbw = NULL;
+    if (resultQueue == NULL) {
+        tmpDbw = new DBWriter(resultDB.c_str(), resultDBIndex.c_str(), localThreads, compressed, getResultDbType());
+        tmpDbw->open();
+    }
 
     // init all thread-specific data structures
     char *notEmpty = new char[querySize];
@@ -791,8 +836,9 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         char buffer[128];
         std::string result;
         result.reserve(1000000);
+        PrefilterQueryResult queueResult;
 
-#pragma omp for schedule(dynamic, 2) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter)
+#pragma omp for schedule(dynamic, 2) reduction (+: kmersPerPos, resSize, dbMatches, doubleMatches, querySeqLenSum, diagonalOverflow, trancatedCounter, indexLookupTime)
         for (size_t id = queryFrom; id < queryFrom + querySize; id++) {
             progress.updateProgress();
             // get query sequence
@@ -837,12 +883,22 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
                     }
                 }
 
+                if (resultQueue != NULL) {
+                    queueResult.hits.push_back(*res);
+                    continue;
+                }
                 // write prefiltering results to a string
-                int len = QueryMatcher::prefilterHitToBuffer(buffer, *res);
+                int len = QueryMatcher::prefilterHitToBuffer(buffer, *res, binaryResult);
                 result.append(buffer, len);
             }
-            tmpDbw.writeData(result.c_str(), result.length(), qKey, thread_idx);
-            result.clear();
+            if (resultQueue != NULL) {
+                queueResult.queryKey = qKey;
+                resultQueue->push(queueResult);
+                queueResult.hits.clear();
+            } else {
+                tmpDbw->writeData(result.c_str(), result.length(), qKey, thread_idx);
+                result.clear();
+            }
 
             // update statistics counters
             if (resultSize != 0) {
@@ -851,6 +907,7 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
 
             if (Debug::debugLevel >= Debug::INFO) {
                 kmersPerPos += matcher.getStatistics()->kmersPerPos;
+                indexLookupTime += matcher.getStatistics()->indexLookupTime;
                 dbMatches += matcher.getStatistics()->dbMatches;
                 doubleMatches += matcher.getStatistics()->doubleMatches;
                 querySeqLenSum += seq.L;
@@ -868,7 +925,8 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
                            dbMatches / totalQueryDBSize,
                            doubleMatches / totalQueryDBSize,
                            querySeqLenSum, diagonalOverflow,
-                           resSize / totalQueryDBSize, trancatedCounter);
+                           resSize / totalQueryDBSize, trancatedCounter,
+                           indexLookupTime / static_cast<double>(totalQueryDBSize));
 
         size_t empty = 0;
         for (size_t id = 0; id < querySize; id++) {
@@ -880,21 +938,23 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         printStatistics(stats, reslens, localThreads, empty, maxResListLen);
     }
 
-    if (splitMode == Parameters::TARGET_DB_SPLIT && splits == 1) {
+    if (tmpDbw != NULL) {
+        if (splitMode == Parameters::TARGET_DB_SPLIT && splits == 1) {
 #ifdef HAVE_MPI
-        // if a mpi rank processed a single split, it must have it merged before all ranks can be united
-        tmpDbw.close(true);
+            // if a mpi rank processed a single split, it must have it merged before all ranks can be united
+            tmpDbw->close(true);
 #else
-        tmpDbw.close(merge);
+            tmpDbw->close(merge);
 #endif
-    } else {
-        tmpDbw.close(merge);
+        } else {
+            tmpDbw->close(merge);
+        }
     }
 
     // sort by ids
     // needed to speed up merge later on
     // sorts this datafile according to the index file
-    if (splitMode == Parameters::TARGET_DB_SPLIT && splits > 1) {
+    if (tmpDbw != NULL && splitMode == Parameters::TARGET_DB_SPLIT && splits > 1) {
         // free memory early since the merge might need quite a bit of memory
         if (indexTable != NULL) {
             delete indexTable;
@@ -904,11 +964,11 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
             delete sequenceLookup;
             sequenceLookup = NULL;
         }
-        DBReader<unsigned int> resultReader(tmpDbw.getDataFileName(), tmpDbw.getIndexFileName(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+        DBReader<unsigned int> resultReader(tmpDbw->getDataFileName(), tmpDbw->getIndexFileName(), threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
         resultReader.open(DBReader<unsigned int>::NOSORT);
         resultReader.readMmapedDataInMemory();
         const std::pair<std::string, std::string> tempDb = Util::databaseNames((resultDB + "_tmp"));
-        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, Parameters::DBTYPE_PREFILTER_RES);
+        DBWriter resultWriter(tempDb.first.c_str(), tempDb.second.c_str(), localThreads, compressed, getResultDbType());
         resultWriter.open();
         resultWriter.sortDatafileByIdOrder(resultReader);
         resultWriter.close(true);
@@ -917,6 +977,10 @@ bool Prefiltering::runSplit(const std::string &resultDB, const std::string &resu
         DBReader<unsigned int>::moveDb(tempDb.first, resultDB);
     }
 
+    if (tmpDbw != NULL) {
+        delete tmpDbw;
+    }
+
     for (unsigned int i = 0; i < localThreads; i++) {
         reslens[i]->clear();
         delete reslens[i];
@@ -937,6 +1001,7 @@ void Prefiltering::printStatistics(const statistics_t &stats, std::list<int> **r
     }
     Debug(Debug::INFO) << "\n" << stats.kmersPerPos << " k-mers per position\n";
     Debug(Debug::INFO) << stats.dbMatches << " DB matches per sequence\n";
+    Debug(Debug::INFO) << stats.indexLookupTime * 1000.0 << " ms index table lookup per sequence\n";
     Debug(Debug::INFO) << stats.diagonalOverflow << " overflows\n";
     Debug(Debug::INFO) << stats.truncated << " queries produce too much hits (truncated result)\n";
     Debug(Debug::INFO) << stats.resultsPassedPrefPerSeq << " sequences passed prefiltering per query sequence";
@@ -1019,10 +1084,14 @@ int Prefiltering::getKmerThreshold(const float sensitivity, const bool isProfile
 size_t Prefiltering::estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                                size_t maxResListLen,
                                                int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                               int threads) {
+                                               int threads, size_t entriesSize) {
     // for each residue in the database we need 7 byte
     size_t dbSizeSplit = (dbSize) / split;
     size_t residueSize = (resSize / split * 7);
+    if (entriesSize > 0) {
+        // compressed k-mer lists replace the 6 byte entries, 1 byte per residue stays for the sequence lookup
+        residueSize = (resSize / split) + (entriesSize / split);
+    }
     // 21^7 * pointer size is needed for the index
     size_t indexTableSize = static_cast<size_t>(pow(alphabetSize, kmerSize)) * sizeof(size_t);
     // memory needed for the threads
@@ -1055,7 +1124,7 @@ size_t Prefiltering::estimateHDDMemoryConsumption(size_t dbSize, size_t maxResLi
 }
 
 std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr,
-                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads) {
+                                                int alphabetSize, int externalKmerSize, unsigned int querySeqType, unsigned int threads, size_t entriesSize) {
 
     int startKmerSize = (externalKmerSize == 0) ? 6 : externalKmerSize;
     int endKmerSize   = (externalKmerSize == 0) ? 7 : externalKmerSize;
@@ -1079,7 +1148,7 @@ std::pair<int, int> Prefiltering::optimizeSplit(size_t totalMemoryInByte, DBRead
                 size_t neededSize = estimateMemoryConsumption(optSplit, tdbr->getSize(),
                                                               tdbr->getAminoAcidDBSize(),
                                                               0, alphabetSize, optKmerSize, querySeqType,
-                                                              threads);
+                                                              threads, entriesSize);
                 if (neededSize < 0.9 * totalMemoryInByte) {
                     return std::make_pair(optKmerSize, optSplit);
                 }
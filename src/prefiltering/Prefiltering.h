@@ -8,6 +8,7 @@
 #include "ScoreMatrix.h"
 #include "PrefilteringIndexReader.h"
 #include "QueryMatcher.h"
+#include "BoundedQueue.h"
 
 #include <string>
 #include <list>
@@ -27,6 +28,15 @@ public:
 
     void runAllSplits(const std::string &resultDB, const std::string &resultDBIndex);
 
+    // pushes the hits of each query into the queue instead of writing a result database
+    // the queue is closed once all splits are done
+    void runAllSplits(BoundedQueue<PrefilterQueryResult> &queue);
+
+    // streaming results requires that every query is searched against the whole target database in one split
+    bool hasCompleteQueryResults() const {
+        return splits == 1 || splitMode == Parameters::QUERY_DB_SPLIT;
+    }
+
 #ifdef HAVE_MPI
     void runMpiSplits(const std::string &resultDB, const std::string &resultDBIndex, const std::string &localTmpPath, const int runRandomId);
 #endif
@@ -42,7 +52,7 @@ public:
 
     static void setupSplit(DBReader<unsigned int>& dbr, const int alphabetSize, const unsigned int querySeqType, const int threads,
                            const bool templateDBIsIndex, const size_t memoryLimit, const size_t qDbSize,
-                           size_t& maxResListLen, int& kmerSize, int& split, int& splitMode);
+                           size_t& maxResListLen, int& kmerSize, int& split, int& splitMode, size_t entriesSize = 0);
 
     static int getKmerThreshold(const float sensitivity, const bool isProfile, const int kmerScore, const int kmerSize);
 
@@ -97,18 +107,26 @@ private:
     int preloadMode;
     const unsigned int threads;
     int compressed;
+    const bool binaryResult;
+    const bool indexCompression;
+    BoundedQueue<PrefilterQueryResult> *resultQueue;
+
+    int getResultDbType() const {
+        return Parameters::DBTYPE_PREFILTER_RES | (binaryResult ? Parameters::DBTYPE_BINARY_FLAG : 0);
+    }
 
     bool runSplit(const std::string &resultDB, const std::string &resultDBIndex, size_t split, bool merge);
 
     // compute kmer size and split size for index table
     static std::pair<int, int> optimizeSplit(size_t totalMemoryInByte, DBReader<unsigned int> *tdbr, int alphabetSize, int kmerSize,
-                                             unsigned int querySeqType, unsigned int threads);
+                                             unsigned int querySeqType, unsigned int threads, size_t entriesSize);
 
     // estimates memory consumption while runtime
+    // entriesSize is the byte size of precomputed compressed k-mer lists, 0 if the lists are plain
     static size_t estimateMemoryConsumption(int split, size_t dbSize, size_t resSize,
                                             size_t maxHitsPerQuery,
                                             int alphabetSize, int kmerSize, unsigned int querySeqType,
-                                            int threads);
+                                            int threads, size_t entriesSize);
 
     static size_t estimateHDDMemoryConsumption(size_t dbSize, size_t maxResListLen);
 
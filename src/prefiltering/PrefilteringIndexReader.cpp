@@ -5,8 +5,9 @@
 #include "FileUtil.h"
 #include "IndexBuilder.h"
 #include "Parameters.h"
+#include "ByteParser.h"
 
-const char*  PrefilteringIndexReader::CURRENT_VERSION = "16";
+const char*  PrefilteringIndexReader::CURRENT_VERSION = "18";
 unsigned int PrefilteringIndexReader::VERSION = 0;
 unsigned int PrefilteringIndexReader::META = 1;
 unsigned int PrefilteringIndexReader::SCOREMATRIXNAME = 2;
@@ -30,6 +31,11 @@ unsigned int PrefilteringIndexReader::HDR2INDEX = 20;
 unsigned int PrefilteringIndexReader::HDR2DATA = 21;
 unsigned int PrefilteringIndexReader::GENERATOR = 22;
 unsigned int PrefilteringIndexReader::SPACEDPATTERN = 23;
+unsigned int PrefilteringIndexReader::ENTRIESENCODING = 24;
+unsigned int PrefilteringIndexReader::DBR1DICT = 25;
+unsigned int PrefilteringIndexReader::DBR2DICT = 26;
+unsigned int PrefilteringIndexReader::HDR1DICT = 27;
+unsigned int PrefilteringIndexReader::HDR2DICT = 28;
 
 extern const char* version;
 
@@ -53,7 +59,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                               BaseMatrix *subMat, int maxSeqLen,
                                               bool hasSpacedKmer, const std::string &spacedKmerPattern,
                                               bool compBiasCorrection, int alphabetSize, int kmerSize,
-                                              int maskMode, int maskLowerCase, int kmerThr, int splits) {
+                                              int maskMode, int maskLowerCase, int kmerThr, int splits, bool compressEntries) {
     DBWriter writer(outDB.c_str(), std::string(outDB).append(".index").c_str(), splits, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_INDEX_DB);
     writer.open();
 
@@ -124,6 +130,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     writer.writeEnd(DBR1DATA, 0);
     writer.alignToPageSize();
     free(data);
+    writeDictionary(writer, dbr1, DBR1DICT, (dbr2 == NULL) ? DBR2DICT : UINT_MAX);
 
     if (dbr2 == NULL) {
         writer.writeIndexEntry(DBR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(*dbr1)+1, 0);
@@ -141,6 +148,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         writer.writeEnd(DBR2DATA, 0);
         writer.alignToPageSize();
         free(data);
+        writeDictionary(writer, dbr2, DBR2DICT);
     }
 
     if (hdbr1 != NULL) {
@@ -159,6 +167,7 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         writer.writeEnd(HDR1DATA, 0);
         writer.alignToPageSize();
         free(data);
+        writeDictionary(writer, hdbr1, HDR1DICT, (hdbr2 == NULL) ? HDR2DICT : UINT_MAX);
         if (hdbr2 == NULL) {
             writer.writeIndexEntry(HDR2INDEX, offsetIndex, DBReader<unsigned int>::indexMemorySize(*hdbr1)+1, 0);
             writer.writeIndexEntry(HDR2DATA,  offsetData, hdbr1->getTotalDataSize()+1, 0);
@@ -177,11 +186,18 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         writer.writeEnd(HDR2DATA, 0);
         writer.alignToPageSize();
         free(data);
+        writeDictionary(writer, hdbr2, HDR2DICT);
     }
     Debug(Debug::INFO) << "Write GENERATOR (" << GENERATOR << ")\n";
     writer.writeData(version, strlen(version), GENERATOR, 0);
     writer.alignToPageSize();
 
+    // indices without this entry store plain k-mer lists
+    Debug(Debug::INFO) << "Write ENTRIESENCODING (" << ENTRIESENCODING << ")\n";
+    const int entriesEncoding = compressEntries ? ENTRIES_ENCODING_VARINT : ENTRIES_ENCODING_PLAIN;
+    writer.writeData((char *) &entriesEncoding, sizeof(int), ENTRIESENCODING, 0);
+    writer.alignToPageSize();
+
     Sequence seq(maxSeqLen, seqType, subMat, kmerSize, hasSpacedKmer, compBiasCorrection, true, spacedKmerPattern);
     // remove x (not needed in index)
     const int adjustAlphabetSize =
@@ -203,6 +219,12 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
                                    (maskMode == 0 ) ? &sequenceLookup : NULL,
                                    *subMat, &seq, dbr1, dbFrom, dbFrom + dbSize, kmerThr, maskMode, maskLowerCase);
         indexTable.printStatistics(subMat->num2aa);
+        if (compressEntries) {
+            const size_t plainSize = indexTable.getEntriesDataSize();
+            indexTable.compressEntries();
+            Debug(Debug::INFO) << "Index table: compressed entries from " << ByteParser::format(plainSize)
+                               << " to " << ByteParser::format(indexTable.getEntriesDataSize()) << "\n";
+        }
 
         if (sequenceLookup == NULL) {
             Debug(Debug::ERROR) << "Invalid mask mode. No sequence lookup created!\n";
@@ -212,8 +234,8 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
         // save the entries
         unsigned int keyOffset = 1000 * s;
         Debug(Debug::INFO) << "Write ENTRIES (" << (keyOffset + ENTRIES) << ")\n";
-        char *entries = (char *) indexTable.getEntries();
-        size_t entriesSize = indexTable.getTableEntriesNum() * indexTable.getSizeOfEntry();
+        char *entries = compressEntries ? (char *) indexTable.getCompressedEntries() : (char *) indexTable.getEntries();
+        size_t entriesSize = indexTable.getEntriesDataSize();
         writer.writeData(entries, entriesSize, (keyOffset + ENTRIES), s);
         writer.alignToPageSize(s);
 
@@ -260,6 +282,45 @@ void PrefilteringIndexReader::createIndexFile(const std::string &outDB,
     writer.close(false);
 }
 
+void PrefilteringIndexReader::writeDictionary(DBWriter &writer, DBReader<unsigned int> *dbr, unsigned int key, unsigned int aliasKey) {
+    // the data entries keep the compressed bytes, they can only be decompressed with the dictionary of their database
+    const std::string dictionaryFile = DBReader<unsigned int>::getDictionaryFileName(dbr->getDataFileName());
+    if (FileUtil::fileExists(dictionaryFile.c_str()) == false) {
+        return;
+    }
+    Debug(Debug::INFO) << "Write dictionary (" << key << ")\n";
+    FILE *file = FileUtil::openFileOrDie(dictionaryFile.c_str(), "r", true);
+    size_t dictionarySize;
+    char *dictionary = (char *) FileUtil::mmapFile(file, &dictionarySize);
+    fclose(file);
+    size_t offset = writer.getOffset(0);
+    writer.writeData(dictionary, dictionarySize, key, 0);
+    writer.alignToPageSize();
+    FileUtil::munmapData(dictionary, dictionarySize);
+    if (aliasKey != UINT_MAX) {
+        writer.writeIndexEntry(aliasKey, offset, dictionarySize + 1, 0);
+    }
+}
+
+void PrefilteringIndexReader::setDictionary(DBReader<unsigned int> *dbr, unsigned int dataIdx, DBReader<unsigned int> *reader) {
+    unsigned int key = UINT_MAX;
+    if (dataIdx == DBR1DATA) {
+        key = DBR1DICT;
+    } else if (dataIdx == DBR2DATA) {
+        key = DBR2DICT;
+    } else if (dataIdx == HDR1DATA) {
+        key = HDR1DICT;
+    } else if (dataIdx == HDR2DATA) {
+        key = HDR2DICT;
+    }
+    size_t id = (key == UINT_MAX) ? UINT_MAX : dbr->getId(key);
+    if (id == UINT_MAX) {
+        return;
+    }
+    // the entry length includes the null byte added by the writer
+    reader->setDictionary(dbr->getDataUncompressed(id), dbr->getEntryLen(id) - 1);
+}
+
 DBReader<unsigned int> *PrefilteringIndexReader::openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads,  bool touchIndex, bool touchData) {
     size_t indexId = dbr->getId(indexIdx);
     char *indexData = dbr->getData(indexId, 0);
@@ -282,6 +343,7 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewHeaderReader(DBReader<un
     reader->open(DBReader<unsigned int>::NOSORT);
     reader->setData(data, dataSize);
     reader->setMode(DBReader<unsigned int>::USE_DATA);
+    setDictionary(dbr, dataIdx, reader);
     return reader;
 }
 
@@ -308,6 +370,7 @@ DBReader<unsigned int> *PrefilteringIndexReader::openNewReader(DBReader<unsigned
         size_t dataSize = nextDataOffset-currDataOffset;
         reader->setData(dbr->getDataUncompressed(id), dataSize);
         reader->setMode(DBReader<unsigned int>::USE_DATA);
+        setDictionary(dbr, dataIdx, reader);
         return reader;
     }
 
@@ -383,8 +446,14 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
         adjustAlphabetSize = data.alphabetSize;
     }
 
+    const bool compressed = hasCompressedEntries(dbr);
+    const size_t entriesDataSize = dbr->getEntryLen(entriesDataId);
     if (preloadMode == Parameters::PRELOAD_MODE_FREAD) {
         IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, false);
+        if (compressed) {
+            table->initCompressedTableByExternalDataCopy(sequenceCount, entriesNum, (unsigned char*) entriesData, entriesDataSize, (size_t *)entriesOffsetsData);
+            return table;
+        }
         table->initTableByExternalDataCopy(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
         return table;
     }
@@ -397,6 +466,10 @@ IndexTable *PrefilteringIndexReader::getIndexTable(unsigned int split, DBReader<
     }
 
     IndexTable* table = new IndexTable(adjustAlphabetSize, data.kmerSize, true);
+    if (compressed) {
+        table->initCompressedTableByExternalData(sequenceCount, entriesNum, (unsigned char*) entriesData, entriesDataSize, (size_t *)entriesOffsetsData);
+        return table;
+    }
     table->initTableByExternalData(sequenceCount, entriesNum, (IndexEntryLocal*) entriesData, (size_t *)entriesOffsetsData);
     return table;
 }
@@ -491,6 +564,29 @@ std::string PrefilteringIndexReader::getSubstitutionMatrix(DBReader<unsigned int
     return std::string(dbr->getDataByDBKey(SCOREMATRIXNAME, 0));
 }
 
+bool PrefilteringIndexReader::hasCompressedEntries(DBReader<unsigned int> *dbr) {
+    size_t id = dbr->getId(ENTRIESENCODING);
+    if (id == UINT_MAX) {
+        return false;
+    }
+    return *((int *)dbr->getDataUncompressed(id)) == ENTRIES_ENCODING_VARINT;
+}
+
+size_t PrefilteringIndexReader::getCompressedEntriesSize(DBReader<unsigned int> *dbr) {
+    if (hasCompressedEntries(dbr) == false) {
+        return 0;
+    }
+    PrefilteringIndexData data = getMetadata(dbr);
+    size_t entriesSize = 0;
+    for (int split = 0; split < data.splits; split++) {
+        size_t id = dbr->getId(split * 1000 + ENTRIES);
+        if (id != UINT_MAX) {
+            entriesSize += dbr->getEntryLen(id);
+        }
+    }
+    return entriesSize;
+}
+
 std::string PrefilteringIndexReader::getSpacedPattern(DBReader<unsigned int> *dbr) {
     size_t id = dbr->getId(SPACEDPATTERN);
     if (id == UINT_MAX) {
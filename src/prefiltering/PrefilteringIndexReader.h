@@ -4,6 +4,8 @@
 #include "BaseMatrix.h"
 #include "IndexTable.h"
 #include "DBReader.h"
+#include "DBWriter.h"
+#include <climits>
 #include <string>
 
 struct PrefilteringIndexData {
@@ -49,6 +51,15 @@ public:
     static unsigned int HDR2DATA;
     static unsigned int GENERATOR;
     static unsigned int SPACEDPATTERN;
+    static unsigned int ENTRIESENCODING;
+    static unsigned int DBR1DICT;
+    static unsigned int DBR2DICT;
+    static unsigned int HDR1DICT;
+    static unsigned int HDR2DICT;
+
+    // encoding of the k-mer lists (see IndexTable::compressEntries)
+    static const int ENTRIES_ENCODING_PLAIN = 0;
+    static const int ENTRIES_ENCODING_VARINT = 1;
 
     static bool checkIfIndexFile(DBReader<unsigned int> *reader);
     static std::string indexName(const std::string &outDB);
@@ -57,7 +68,11 @@ public:
                                 DBReader<unsigned int> *dbr1, DBReader<unsigned int> *dbr2,
                                 DBReader<unsigned int> *hdbr1, DBReader<unsigned int> *hdbr2,
                                 BaseMatrix *seedSubMat, int maxSeqLen, bool spacedKmer, const std::string &spacedKmerPattern,
-                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, int kmerThr, int splits);
+                                bool compBiasCorrection, int alphabetSize, int kmerSize, int maskMode, int maskLowerCase, int kmerThr, int splits,
+                                bool compressEntries);
+
+    // copies the compression dictionary of dbr (if it has one) into the entry key, aliasKey points to the same entry
+    static void writeDictionary(DBWriter &writer, DBReader<unsigned int> *dbr, unsigned int key, unsigned int aliasKey = UINT_MAX);
 
     static DBReader<unsigned int> *openNewHeaderReader(DBReader<unsigned int>*dbr, unsigned int dataIdx, unsigned int indexIdx, int threads, bool touchIndex, bool touchData);
 
@@ -77,6 +92,11 @@ public:
 
     static std::string getSpacedPattern(DBReader<unsigned int> *dbr);
 
+    static bool hasCompressedEntries(DBReader<unsigned int> *dbr);
+
+    // byte size of the compressed k-mer lists of all splits, 0 if the lists are not compressed
+    static size_t getCompressedEntriesSize(DBReader<unsigned int> *dbr);
+
     static ScoreMatrix get2MerScoreMatrix(DBReader<unsigned int> *dbr, int preloadMode);
 
     static ScoreMatrix get3MerScoreMatrix(DBReader<unsigned int> *dbr, int preloadMode);
@@ -87,6 +107,8 @@ public:
 
 private:
     static void printMeta(int *meta);
+
+    static void setDictionary(DBReader<unsigned int> *dbr, unsigned int dataIdx, DBReader<unsigned int> *reader);
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "SubstitutionMatrix.h"
 #include "QueryMatcher.h"
 #include "Util.h"
+#include "Timer.h"
 
 #define FE_1(WHAT, X) WHAT(X)
 #define FE_2(WHAT, X, ...) WHAT(X)FE_1(WHAT, __VA_ARGS__)
@@ -63,6 +64,7 @@ QueryMatcher::QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLooku
         ungappedAlignment = new UngappedAlignment(maxSeqLen, ungappedAlignmentSubMat, sequenceLookup);
     }
     compositionBias = new float[maxSeqLen];
+    queryKmerStart = new unsigned int[maxSeqLen + 1];
 }
 
 QueryMatcher::~QueryMatcher(){
@@ -73,6 +75,7 @@ QueryMatcher::~QueryMatcher(){
     delete[] indexPointer;
     free(foundDiagonals);
     delete[] compositionBias;
+    delete[] queryKmerStart;
     if(ungappedAlignment != NULL){
         delete ungappedAlignment;
     }
@@ -154,29 +157,23 @@ std::pair<hit_t*, size_t> QueryMatcher::matchQuery(Sequence *querySeq, unsigned
 }
 
 size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
-    // go through the query sequence
+    // go through the query sequence and collect the similar k-mers of all positions
     size_t kmerListLen = 0;
-    size_t numMatches = 0;
-    size_t overflowNumMatches = 0;
-    size_t overflowHitCount = 0;
-    //size_t pos = 0;
+    size_t positions = 0;
     stats->diagonalOverflow = false;
-    IndexEntryLocal* sequenceHits = databaseHits;
-    size_t seqListSize;
-    unsigned short indexStart = 0;
-    unsigned short indexTo = 0;
+    queryKmers.clear();
     while (seq->hasNextKmer()) {
         const unsigned char *kmer = seq->nextKmer();
         const unsigned char *pos = seq->getAAPosInSpacedPattern();
         const unsigned short current_i = seq->getCurrentPosition();
+        queryKmerStart[current_i] = queryKmers.size();
+        positions = current_i + 1;
 
         float biasCorrection = 0;
         for (int i = 0; i < kmerSize; i++){
             biasCorrection += compositionBias[current_i + static_cast<short>(pos[i])];
         }
         if (seq->kmerContainsX()) {
-            indexTo = current_i;
-            indexPointer[current_i] = sequenceHits;
             continue;
         }
         // round bias to next higher or lower value
@@ -198,36 +195,180 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
             kmerElementSize = kmerList.second;
             index = kmerList.first;
         }
-        //std::cout << kmer << std::endl;
-        indexPointer[current_i] = sequenceHits;
-        // match the index table
-
-        //idx.printKmer(kmerList.index[0], kmerSize, m->num2aa);
-        //std::cout << "\t" << kmerMatchScore << std::endl;
         kmerListLen += kmerElementSize;
+        queryKmers.insert(queryKmers.end(), index, index + kmerElementSize);
+    }
+    queryKmerStart[positions] = queryKmers.size();
+
+    // match the index table
+    Timer timer;
+    size_t numMatches = 0;
+    size_t overflowNumMatches = 0;
+    size_t overflowHitCount = 0;
+    unsigned short indexStart = 0;
+    unsigned short indexTo = (positions > 0) ? static_cast<unsigned short>(positions - 1) : 0;
+    indexPointer[0] = databaseHits;
+    const bool fetched = indexTable->isCompressed() ? fetchCompressedKmerLists(positions, &numMatches)
+                                                    : fetchKmerLists(positions, &numMatches);
+    if (fetched == false) {
+        overflowHitCount = fetchKmerListsWithOverflow(positions, &numMatches, &overflowNumMatches, &indexStart, &indexTo);
+    }
+    stats->indexLookupTime = timer.getTimediff();
 
-        for (unsigned int kmerPos = 0; kmerPos < kmerElementSize; kmerPos++) {
-            const IndexEntryLocal *entries = indexTable->getDBSeqList(index[kmerPos], &seqListSize);
-            // DEBUG
-            //std::cout << seq->getDbKey() << std::endl;
-            //idx.printKmer(index[kmerPos], kmerSize, kmerSubMat->num2aa);
-            //std::cout << "\t" << current_i << "\t"<< index[kmerPos] << std::endl;
-            //for (size_t i = 0; i < seqListSize; i++) {
-            //    char diag = entries[i].position_j - current_i;
-            //    std::cout << "(" << entries[i].seqId << " " << (int) diag << ")\t";
-            //}
-            //std::cout << std::endl;
+    indexPointer[indexTo + 1] = databaseHits + numMatches;
+    // fill the output
+    size_t hitCount = findDuplicates(indexPointer, foundDiagonals + overflowHitCount,
+                                     foundDiagonalsSize - overflowHitCount, indexStart, indexTo, (diagonalScoring == false));
+    if (overflowHitCount != 0) {
+        // overflow occurred
+        hitCount = mergeElements(foundDiagonals, overflowHitCount + hitCount);
+    }
+    stats->doubleMatches = 0;
+    if (diagonalScoring == false) {
+        // remove double entries
+        updateScoreBins(foundDiagonals, hitCount);
+        stats->doubleMatches = getDoubleDiagonalMatches();
+    }
+    stats->kmersPerPos = ((double)kmerListLen/(double)seq->L);
+    stats->querySeqLen = seq->L;
+    stats->dbMatches   = overflowNumMatches + numMatches;
+
+    return hitCount;
+}
+
+bool QueryMatcher::fetchKmerLists(size_t positions, size_t *numMatches) {
+    const size_t kmerCount = queryKmers.size();
+    const size_t *offsets = indexTable->getOffsets();
+    const IndexEntryLocal *entries = indexTable->getEntries();
+    kmerListWritePos.resize(kmerCount + 1);
+    kmerLists.resize(LOOKUP_BLOCK_SIZE);
+
+    // the k-mers are processed in blocks of consecutive query k-mers
+    // first all list boundaries of a block are read, then the lists are copied
+    // both passes know their addresses ahead and prefetch them
+    size_t totalSize = 0;
+    for (size_t from = 0; from < kmerCount; from += LOOKUP_BLOCK_SIZE) {
+        const size_t to = std::min(kmerCount, from + LOOKUP_BLOCK_SIZE);
+        size_t listCount = 0;
+        for (size_t i = from; i < to; i++) {
+            if (i + PREFETCH_DISTANCE < to) {
+                __builtin_prefetch(offsets + queryKmers[i + PREFETCH_DISTANCE]);
+            }
+            const size_t kmer = queryKmers[i];
+            const size_t listSize = offsets[kmer + 1] - offsets[kmer];
+            kmerListWritePos[i] = totalSize;
+            if (listSize > 0) {
+                kmerLists[listCount].offset = offsets[kmer];
+                kmerLists[listCount].writePos = totalSize;
+                kmerLists[listCount].size = listSize;
+                listCount++;
+                totalSize += listSize;
+            }
+        }
+        if ((databaseHits + totalSize) >= lastSequenceHit) {
+            return false;
+        }
+        for (size_t i = 0; i < listCount; i++) {
+            if (i + PREFETCH_DISTANCE < listCount) {
+                __builtin_prefetch(entries + kmerLists[i + PREFETCH_DISTANCE].offset);
+            }
+            memcpy(databaseHits + kmerLists[i].writePos, entries + kmerLists[i].offset,
+                   sizeof(IndexEntryLocal) * kmerLists[i].size);
+        }
+    }
+    kmerListWritePos[kmerCount] = totalSize;
 
+    for (size_t i = 0; i < positions; i++) {
+        indexPointer[i] = databaseHits + kmerListWritePos[queryKmerStart[i]];
+    }
+    *numMatches = totalSize;
+    return true;
+}
+
+bool QueryMatcher::fetchCompressedKmerLists(size_t positions, size_t *numMatches) {
+    const size_t kmerCount = queryKmers.size();
+    const size_t *offsets = indexTable->getOffsets();
+    const unsigned char *compressedEntries = indexTable->getCompressedEntries();
+    kmerListWritePos.resize(kmerCount + 1);
+    kmerLists.resize(LOOKUP_BLOCK_SIZE);
+
+    // same blocking as fetchKmerLists, but the list sizes are only known after reading the
+    // first varint of each list, so there is an extra pass between finding and decoding the lists
+    size_t totalSize = 0;
+    for (size_t from = 0; from < kmerCount; from += LOOKUP_BLOCK_SIZE) {
+        const size_t to = std::min(kmerCount, from + LOOKUP_BLOCK_SIZE);
+        size_t listCount = 0;
+        for (size_t i = from; i < to; i++) {
+            if (i + PREFETCH_DISTANCE < to) {
+                __builtin_prefetch(offsets + queryKmers[i + PREFETCH_DISTANCE]);
+            }
+            const size_t kmer = queryKmers[i];
+            if (offsets[kmer + 1] > offsets[kmer]) {
+                kmerLists[listCount].offset = offsets[kmer];
+                // query k-mer index until the write position is known
+                kmerLists[listCount].writePos = i;
+                listCount++;
+            }
+        }
+        size_t next = from;
+        for (size_t i = 0; i < listCount; i++) {
+            if (i + PREFETCH_DISTANCE < listCount) {
+                __builtin_prefetch(compressedEntries + kmerLists[i + PREFETCH_DISTANCE].offset);
+            }
+            const unsigned char *data = compressedEntries + kmerLists[i].offset;
+            const size_t listSize = IndexTable::readVarint(data);
+            for (; next <= kmerLists[i].writePos; next++) {
+                kmerListWritePos[next] = totalSize;
+            }
+            kmerLists[i].writePos = totalSize;
+            kmerLists[i].size = listSize;
+            totalSize += listSize;
+        }
+        for (; next < to; next++) {
+            kmerListWritePos[next] = totalSize;
+        }
+        if ((databaseHits + totalSize) >= lastSequenceHit) {
+            return false;
+        }
+        for (size_t i = 0; i < listCount; i++) {
+            if (i + PREFETCH_DISTANCE < listCount) {
+                __builtin_prefetch(compressedEntries + kmerLists[i + PREFETCH_DISTANCE].offset);
+            }
+            IndexTable::decodeDBSeqList(compressedEntries + kmerLists[i].offset, databaseHits + kmerLists[i].writePos);
+        }
+    }
+    kmerListWritePos[kmerCount] = totalSize;
+
+    for (size_t i = 0; i < positions; i++) {
+        indexPointer[i] = databaseHits + kmerListWritePos[queryKmerStart[i]];
+    }
+    *numMatches = totalSize;
+    return true;
+}
+
+size_t QueryMatcher::fetchKmerListsWithOverflow(size_t positions, size_t *numMatches, size_t *overflowNumMatches,
+                                                unsigned short *indexStart, unsigned short *indexTo) {
+    IndexEntryLocal* sequenceHits = databaseHits;
+    size_t overflowHitCount = 0;
+    size_t seqListSize;
+    *numMatches = 0;
+    *overflowNumMatches = 0;
+    *indexStart = 0;
+    *indexTo = 0;
+    for (size_t i = 0; i < positions; i++) {
+        const unsigned short current_i = static_cast<unsigned short>(i);
+        indexPointer[current_i] = sequenceHits;
+        for (size_t kmerPos = queryKmerStart[i]; kmerPos < queryKmerStart[i + 1]; kmerPos++) {
+            seqListSize = indexTable->getDBSeqListSize(queryKmers[kmerPos]);
             // detected overflow while matching
             if ((sequenceHits + seqListSize) >= lastSequenceHit) {
                 stats->diagonalOverflow = true;
                 // last pointer
                 indexPointer[current_i + 1] = sequenceHits;
-                //std::cout << "Overflow in i=" << indexStart << std::endl;
                 const size_t hitCount = findDuplicates(indexPointer,
                                                        foundDiagonals + overflowHitCount,
                                                        foundDiagonalsSize - overflowHitCount,
-                                                       indexStart, current_i, (diagonalScoring == false));
+                                                       *indexStart, current_i, (diagonalScoring == false));
 
                 if (overflowHitCount != 0) {
                     // merge lists, hitCount is max. dbSize so there can be no overflow in mergeElements
@@ -238,40 +379,21 @@ size_t QueryMatcher::match(Sequence *seq, float *compositionBias) {
                 // reset pointer position
                 sequenceHits = databaseHits;
                 indexPointer[current_i] = sequenceHits;
-                indexStart = current_i;
-                overflowNumMatches += numMatches;
-                numMatches = 0;
+                *indexStart = current_i;
+                *overflowNumMatches += *numMatches;
+                *numMatches = 0;
                 // TODO might delete this?
                 if ((sequenceHits + seqListSize) >= lastSequenceHit){
-                    goto outer;
+                    return overflowHitCount;
                 }
             }
-            memcpy(sequenceHits, entries, sizeof(IndexEntryLocal) * seqListSize);
+            indexTable->copyDBSeqList(queryKmers[kmerPos], sequenceHits);
             sequenceHits += seqListSize;
-            numMatches += seqListSize;
+            *numMatches += seqListSize;
         }
-        indexTo = current_i;
+        *indexTo = current_i;
     }
-    outer:
-    indexPointer[indexTo + 1] = databaseHits + numMatches;
-    // fill the output
-    size_t hitCount = findDuplicates(indexPointer, foundDiagonals + overflowHitCount,
-                                     foundDiagonalsSize - overflowHitCount, indexStart, indexTo, (diagonalScoring == false));
-    if (overflowHitCount != 0) {
-        // overflow occurred
-        hitCount = mergeElements(foundDiagonals, overflowHitCount + hitCount);
-    }
-    stats->doubleMatches = 0;
-    if (diagonalScoring == false) {
-        // remove double entries
-        updateScoreBins(foundDiagonals, hitCount);
-        stats->doubleMatches = getDoubleDiagonalMatches();
-    }
-    stats->kmersPerPos = ((double)kmerListLen/(double)seq->L);
-    stats->querySeqLen = seq->L;
-    stats->dbMatches   = overflowNumMatches + numMatches;
-
-    return hitCount;
+    return overflowHitCount;
 }
 
 size_t QueryMatcher::getDoubleDiagonalMatches(){
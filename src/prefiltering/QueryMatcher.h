@@ -6,11 +6,14 @@
 #define MMSEQS_QUERYTEMPLATEMATCHEREXACTMATCH_H
 
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include "itoa.h"
 #include "EvalueComputation.h"
 #include "CacheFriendlyOperations.h"
 #include "UngappedAlignment.h"
 #include "KmerGenerator.h"
+#include "DBReader.h"
 
 
 struct statistics_t{
@@ -21,15 +24,19 @@ struct statistics_t{
     size_t diagonalOverflow;
     size_t resultsPassedPrefPerSeq;
     size_t truncated;
-    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0), truncated(0) {};
+    // seconds spent fetching the k-mer lists from the index table (bound by cache misses)
+    double indexLookupTime;
+    statistics_t() : kmersPerPos(0.0) , dbMatches(0) , doubleMatches(0), querySeqLen(0), diagonalOverflow(0), resultsPassedPrefPerSeq(0), truncated(0), indexLookupTime(0.0) {};
     statistics_t(double kmersPerPos, size_t dbMatches,
-                 size_t doubleMatches, size_t querySeqLen, size_t diagonalOverflow, size_t resultsPassedPrefPerSeq, size_t truncated) : kmersPerPos(kmersPerPos),
-                                                                                                                      dbMatches(dbMatches),
-                                                                                                                      doubleMatches(doubleMatches),
-                                                                                                                      querySeqLen(querySeqLen),
-                                                                                                                      diagonalOverflow(diagonalOverflow),
-                                                                                                                      resultsPassedPrefPerSeq(resultsPassedPrefPerSeq),
-                                                                                                                      truncated(truncated){};
+                 size_t doubleMatches, size_t querySeqLen, size_t diagonalOverflow, size_t resultsPassedPrefPerSeq, size_t truncated,
+                 double indexLookupTime = 0.0) : kmersPerPos(kmersPerPos),
+                                                 dbMatches(dbMatches),
+                                                 doubleMatches(doubleMatches),
+                                                 querySeqLen(querySeqLen),
+                                                 diagonalOverflow(diagonalOverflow),
+                                                 resultsPassedPrefPerSeq(resultsPassedPrefPerSeq),
+                                                 truncated(truncated),
+                                                 indexLookupTime(indexLookupTime){};
 };
 
 struct hit_t {
@@ -50,6 +57,21 @@ struct hit_t {
     }
 };
 
+// hits of one query handed from the prefilter to a consumer without writing a result database
+struct PrefilterQueryResult {
+    unsigned int queryKey;
+    std::vector<hit_t> hits;
+
+    PrefilterQueryResult() : queryKey(0) {}
+};
+
+// on-disk record of binary prefilter databases (see Parameters::DBTYPE_BINARY_FLAG)
+struct __attribute__((__packed__)) packed_hit_t {
+    unsigned int seqId;
+    int prefScore;
+    unsigned short diagonal;
+};
+
 class QueryMatcher {
 public:
     QueryMatcher(IndexTable *indexTable, SequenceLookup *sequenceLookup,
@@ -111,6 +133,39 @@ public:
         }
     }
 
+    static hit_t parsePrefilterHit(const packed_hit_t &record) {
+        hit_t result;
+        result.seqId = record.seqId;
+        result.prefScore = record.prefScore;
+        result.diagonal = record.diagonal;
+        return result;
+    }
+
+    // reads all hits of an entry independent of the prefilter database format
+    static void readPrefilterHits(DBReader<unsigned int> &reader, size_t id, int thrIdx, std::vector<hit_t> &entries) {
+        if (reader.isBinary()) {
+            std::pair<const packed_hit_t*, size_t> records = reader.getRecords<packed_hit_t>(id, thrIdx);
+            for (size_t i = 0; i < records.second; ++i) {
+                entries.push_back(parsePrefilterHit(records.first[i]));
+            }
+        } else {
+            parsePrefilterHits(reader.getData(id, thrIdx), entries);
+        }
+    }
+
+    static size_t prefilterHitToBinaryBuffer(char *buff1, const hit_t &h) {
+        packed_hit_t record;
+        record.seqId = h.seqId;
+        record.prefScore = h.prefScore;
+        record.diagonal = h.diagonal;
+        memcpy(buff1, &record, sizeof(packed_hit_t));
+        return sizeof(packed_hit_t);
+    }
+
+    static size_t prefilterHitToBuffer(char *buff1, hit_t &h, bool binary) {
+        return binary ? prefilterHitToBinaryBuffer(buff1, h) : prefilterHitToBuffer(buff1, h);
+    }
+
     static size_t prefilterHitToBuffer(char *buff1, hit_t &h) {
         char * basePos = buff1;
         char * tmpBuff = Itoa::u32toa_sse2((uint32_t) h.seqId, buff1);
@@ -170,6 +225,27 @@ protected:
     // keeps data in inner loop
     IndexEntryLocal *__restrict databaseHits;
 
+    // generated k-mers of the current query in query order
+    // and the index of the first k-mer of each query position
+    std::vector<size_t> queryKmers;
+    unsigned int *queryKmerStart;
+
+    // index table list of a query k-mer and its position in databaseHits
+    struct KmerList {
+        size_t offset;
+        size_t writePos;
+        size_t size;
+    };
+    // non-empty lists of the current block of query k-mers
+    std::vector<KmerList> kmerLists;
+    // per query k-mer: position of its list in databaseHits
+    std::vector<size_t> kmerListWritePos;
+
+    // distance in k-mers the prefetches are issued ahead of the reads
+    const static size_t PREFETCH_DISTANCE = 16;
+    // number of consecutive query k-mers whose lists are fetched together
+    const static size_t LOOKUP_BLOCK_SIZE = 4096;
+
     // evaluated bins
     CounterResult *foundDiagonals;
 
@@ -209,6 +285,18 @@ protected:
     // match sequence against the IndexTable
     size_t match(Sequence *seq, float *compositionBias);
 
+    // copies the k-mer lists of all queryKmers to databaseHits, prefetching the index table ahead
+    // returns false without copying if the lists do not fit into databaseHits
+    bool fetchKmerLists(size_t positions, size_t *numMatches);
+
+    // same as fetchKmerLists for an index table with compressed lists, decodes them into databaseHits
+    bool fetchCompressedKmerLists(size_t positions, size_t *numMatches);
+
+    // copies the k-mer lists of all queryKmers to databaseHits in query order and
+    // processes the hits found so far whenever databaseHits overflows
+    size_t fetchKmerListsWithOverflow(size_t positions, size_t *numMatches, size_t *overflowNumMatches,
+                                      unsigned short *indexStart, unsigned short *indexTo);
+
     // extract result from databaseHits
     template <int TYPE>
     std::pair<hit_t *, size_t> getResult(CounterResult * results,
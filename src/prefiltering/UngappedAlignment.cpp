@@ -2,17 +2,98 @@
 // Created by mad on 12/15/15.
 
 #include "UngappedAlignment.h"
+#include "Debug.h"
+#include "Util.h"
+
+// the SSE4.1, AVX2 and AVX-512BW kernels are compiled with target attributes, independent of the
+// instruction set of the rest of the binary, and picked at runtime based on the CPU features
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NEON) && !defined(WASM) && !defined(__ALTIVEC__)
+#define UNGAPPED_DISPATCH
+#include "CpuInfo.h"
+#include <immintrin.h>
+#endif
 
 UngappedAlignment::UngappedAlignment(const unsigned int maxSeqLen,
-                                     BaseMatrix *substitutionMatrix, SequenceLookup *sequenceLookup)
+                                     BaseMatrix *substitutionMatrix, SequenceLookup *sequenceLookup, int kernel)
         : subMatrix(substitutionMatrix), sequenceLookup(sequenceLookup) {
-    score_arr = new unsigned int[VECSIZE_INT*4];
+    if (kernel == KERNEL_AUTO) {
+        kernel = detectKernel();
+    }
+    if (isKernelSupported(kernel) == false) {
+        Debug(Debug::ERROR) << "Ungapped alignment kernel " << getKernelName(kernel) << " is not supported on this machine\n";
+        EXIT(EXIT_FAILURE);
+    }
+    this->kernel = kernel;
+    switch (kernel) {
+        case KERNEL_SSE41:
+            lanes = 16;
+            break;
+        case KERNEL_AVX2:
+            lanes = 32;
+            break;
+        case KERNEL_AVX512BW:
+            lanes = 64;
+            break;
+        default:
+            lanes = VECSIZE_INT * 4;
+            break;
+    }
+    score_arr = new unsigned int[MAX_LANES];
     diagonalCounter = new unsigned char[DIAGONALCOUNT];
-    vectorSequence = (unsigned char *) malloc_simd_int(VECSIZE_INT * 4 * maxSeqLen);
+    vectorSequence = (unsigned char *) malloc_simd_int(MAX_LANES * maxSeqLen);
     queryProfile   = (char *) malloc_simd_int(PROFILESIZE * maxSeqLen);
     memset(queryProfile, 0, PROFILESIZE * maxSeqLen);
     aaCorrectionScore = (char *) malloc_simd_int(maxSeqLen);
-    diagonalMatches = new CounterResult*[DIAGONALCOUNT * (VECSIZE_INT * 4)];
+    diagonalMatches = new unsigned int[DIAGONALCOUNT * lanes];
+}
+
+int UngappedAlignment::detectKernel() {
+    if (isKernelSupported(KERNEL_AVX512BW)) {
+        return KERNEL_AVX512BW;
+    }
+    if (isKernelSupported(KERNEL_AVX2)) {
+        return KERNEL_AVX2;
+    }
+    if (isKernelSupported(KERNEL_SSE41)) {
+        return KERNEL_SSE41;
+    }
+    return KERNEL_SIMD;
+}
+
+bool UngappedAlignment::isKernelSupported(int kernel) {
+    if (kernel == KERNEL_SIMD) {
+        return true;
+    }
+#ifdef UNGAPPED_DISPATCH
+    CpuInfo info;
+    switch (kernel) {
+        case KERNEL_SSE41:
+            return info.HW_SSE41;
+        case KERNEL_AVX2:
+            return info.HW_AVX2 && info.OS_AVX;
+        case KERNEL_AVX512BW:
+            return info.HW_AVX512F && info.HW_AVX512BW && info.OS_AVX512;
+        default:
+            return false;
+    }
+#else
+    return false;
+#endif
+}
+
+const char *UngappedAlignment::getKernelName(int kernel) {
+    switch (kernel) {
+        case KERNEL_SIMD:
+            return "SIMD";
+        case KERNEL_SSE41:
+            return "SSE4.1";
+        case KERNEL_AVX2:
+            return "AVX2";
+        case KERNEL_AVX512BW:
+            return "AVX-512BW";
+        default:
+            return "unknown";
+    }
 }
 
 UngappedAlignment::~UngappedAlignment() {
@@ -64,6 +145,113 @@ inline __m256i UngappedAlignment::Shuffle(const __m256i & value, const __m256i &
 }
 #endif
 
+#ifdef UNGAPPED_DISPATCH
+// same computation as vectorDiagonalScoring for 16, 32 and 64 db sequences
+// dbSeq holds the sequences interleaved with the lane count as stride
+__attribute__((target("sse4.1")))
+static void diagonalScoringSSE41(const char *profile, const char bias, const unsigned int seqLen,
+                                 const unsigned char *dbSeq, unsigned int *scores) {
+    __m128i vscore    = _mm_setzero_si128();
+    __m128i vMaxScore = _mm_setzero_si128();
+    const __m128i vBias   = _mm_set1_epi8(bias);
+    const __m128i sixten  = _mm_set1_epi8(16);
+    const __m128i fiveten = _mm_set1_epi8(15);
+    for (unsigned int pos = 0; pos < seqLen; pos++) {
+        const __m128i template01 = _mm_loadu_si128((const __m128i *)&dbSeq[pos * 16]);
+        const __m128i score_matrix_vec01 = _mm_load_si128((const __m128i *)&profile[pos * 32]);
+        const __m128i score_matrix_vec16 = _mm_load_si128((const __m128i *)&profile[pos * 32 + 16]);
+        __m128i score01 = _mm_shuffle_epi8(score_matrix_vec01, template01);
+        __m128i score16 = _mm_shuffle_epi8(score_matrix_vec16, template01);
+        score01 = _mm_and_si128(_mm_cmplt_epi8(template01, sixten), score01);
+        score16 = _mm_and_si128(_mm_cmplt_epi8(fiveten, template01), score16);
+        const __m128i score_vec_8bit = _mm_add_epi8(score01, score16);
+        vscore    = _mm_adds_epu8(vscore, score_vec_8bit);
+        vscore    = _mm_subs_epu8(vscore, vBias);
+        vMaxScore = _mm_max_epu8(vMaxScore, vscore);
+    }
+    unsigned char out[16];
+    _mm_storeu_si128((__m128i *)out, vMaxScore);
+    for (unsigned int i = 0; i < 16; i++) {
+        scores[i] = out[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static void diagonalScoringAVX2(const char *profile, const char bias, const unsigned int seqLen,
+                                const unsigned char *dbSeq, unsigned int *scores) {
+    // the shuffle only works within 128-bit lanes, so the lookup is done in both halves of the
+    // profile and the index of the wrong half is pushed out of range (high bit set => 0)
+    const __m256i K0 = _mm256_setr_epi64x(0x7070707070707070LL, 0x7070707070707070LL, 0xF0F0F0F0F0F0F0F0LL, 0xF0F0F0F0F0F0F0F0LL);
+    const __m256i K1 = _mm256_setr_epi64x(0xF0F0F0F0F0F0F0F0LL, 0xF0F0F0F0F0F0F0F0LL, 0x7070707070707070LL, 0x7070707070707070LL);
+    __m256i vscore    = _mm256_setzero_si256();
+    __m256i vMaxScore = _mm256_setzero_si256();
+    const __m256i vBias = _mm256_set1_epi8(bias);
+    for (unsigned int pos = 0; pos < seqLen; pos++) {
+        const __m256i template01 = _mm256_loadu_si256((const __m256i *)&dbSeq[pos * 32]);
+        const __m256i score_matrix_vec01 = _mm256_loadu_si256((const __m256i *)&profile[pos * 32]);
+        const __m256i score_vec_8bit = _mm256_or_si256(
+                _mm256_shuffle_epi8(score_matrix_vec01, _mm256_add_epi8(template01, K0)),
+                _mm256_shuffle_epi8(_mm256_permute4x64_epi64(score_matrix_vec01, 0x4E), _mm256_add_epi8(template01, K1)));
+        vscore    = _mm256_adds_epu8(vscore, score_vec_8bit);
+        vscore    = _mm256_subs_epu8(vscore, vBias);
+        vMaxScore = _mm256_max_epu8(vMaxScore, vscore);
+    }
+    unsigned char out[32];
+    _mm256_storeu_si256((__m256i *)out, vMaxScore);
+    for (unsigned int i = 0; i < 32; i++) {
+        scores[i] = out[i];
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void diagonalScoringAVX512BW(const char *profile, const char bias, const unsigned int seqLen,
+                                    const unsigned char *dbSeq, unsigned int *scores) {
+    // both 16 byte halves of the 32 byte profile row are broadcast to all 128-bit lanes,
+    // looked up in parallel and blended by whether the residue is below 16
+    __m512i vscore    = _mm512_setzero_si512();
+    __m512i vMaxScore = _mm512_setzero_si512();
+    const __m512i vBias  = _mm512_set1_epi8(bias);
+    const __m512i sixten = _mm512_set1_epi8(16);
+    for (unsigned int pos = 0; pos < seqLen; pos++) {
+        const __m512i template01 = _mm512_loadu_si512((const void *)&dbSeq[pos * 64]);
+        // the zero masked broadcast avoids a -Wmaybe-uninitialized false positive of _mm512_broadcast_i32x4 in GCC
+        const __m512i score_matrix_vec01 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *)&profile[pos * 32]));
+        const __m512i score_matrix_vec16 = _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128((const __m128i *)&profile[pos * 32 + 16]));
+        const __mmask64 lookup_mask16 = _mm512_cmpge_epu8_mask(template01, sixten);
+        const __m512i score_vec_8bit = _mm512_mask_blend_epi8(lookup_mask16,
+                                                              _mm512_shuffle_epi8(score_matrix_vec01, template01),
+                                                              _mm512_shuffle_epi8(score_matrix_vec16, template01));
+        vscore    = _mm512_adds_epu8(vscore, score_vec_8bit);
+        vscore    = _mm512_subs_epu8(vscore, vBias);
+        vMaxScore = _mm512_max_epu8(vMaxScore, vscore);
+    }
+    unsigned char out[64];
+    _mm512_storeu_si512((void *)out, vMaxScore);
+    for (unsigned int i = 0; i < 64; i++) {
+        scores[i] = out[i];
+    }
+}
+#endif
+
+void UngappedAlignment::scoreDiagonals(const char *profile, const char bias, const unsigned int seqLen, const unsigned char *dbSeq) {
+    switch (kernel) {
+#ifdef UNGAPPED_DISPATCH
+        case KERNEL_SSE41:
+            diagonalScoringSSE41(profile, bias, seqLen, dbSeq, score_arr);
+            return;
+        case KERNEL_AVX2:
+            diagonalScoringAVX2(profile, bias, seqLen, dbSeq, score_arr);
+            return;
+        case KERNEL_AVX512BW:
+            diagonalScoringAVX512BW(profile, bias, seqLen, dbSeq, score_arr);
+            return;
+#endif
+        default:
+            extractScores(score_arr, vectorDiagonalScoring(profile, bias, seqLen, dbSeq));
+            return;
+    }
+}
+
 simd_int UngappedAlignment::vectorDiagonalScoring(const char *profile,
                                                 const char bias,
                                                 const unsigned int seqLen,
@@ -129,12 +317,12 @@ std::pair<unsigned char *, unsigned int> UngappedAlignment::mapSequences(std::pa
     for(unsigned int seqIdx = 0; seqIdx < seqCount;  seqIdx++) {
         maxLen = std::max(seqs[seqIdx].second, maxLen);
     }
-    memset(vectorSequence, 21, maxLen * VECSIZE_INT * 4 * sizeof(unsigned char));
-    for(unsigned int seqIdx = 0; seqIdx < VECSIZE_INT*4;  seqIdx++){
+    memset(vectorSequence, 21, maxLen * lanes * sizeof(unsigned char));
+    for(unsigned int seqIdx = 0; seqIdx < lanes;  seqIdx++){
         const unsigned char * seq  = seqs[seqIdx].first;
         const unsigned int seqSize = seqs[seqIdx].second;
         for(unsigned int pos = 0; pos < seqSize;  pos++){
-            vectorSequence[pos * VECSIZE_INT * 4 + seqIdx] = seq[pos];
+            vectorSequence[pos * lanes + seqIdx] = seq[pos];
         }
     }
     return std::make_pair(vectorSequence, maxLen);
@@ -143,7 +331,8 @@ std::pair<unsigned char *, unsigned int> UngappedAlignment::mapSequences(std::pa
 void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
                                                  const unsigned int queryLen,
                                                  const short diagonal,
-                                                 CounterResult ** hits,
+                                                 CounterResult * results,
+                                                 const unsigned int * hits,
                                                  const unsigned int hitSize,
                                                  const short bias) {
     //    unsigned char minDistToDiagonal = distanceFromDiagonal(diagonal);
@@ -153,18 +342,18 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
 
     if(queryLen >= 32768){
         for (size_t hitIdx = 0; hitIdx < hitSize; hitIdx++) {
-            const unsigned int seqId = hits[hitIdx]->id;
-            std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(seqId);
+            CounterResult &hit = results[hits[hitIdx]];
+            std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(hit.id);
             int max = computeLongScore(queryProfile, queryLen, dbSeq, diagonal, bias);
-            hits[hitIdx]->count = static_cast<unsigned char>(std::min(255, max));
+            hit.count = static_cast<unsigned char>(std::min(255, max));
         }
         return;
     }
-    if (hitSize > (VECSIZE_INT * 4) / 16) {
-        std::pair<unsigned char *, unsigned int> seqs[VECSIZE_INT * 4];
+    if (hitSize > lanes / 16) {
+        std::pair<unsigned char *, unsigned int> seqs[MAX_LANES];
         for (unsigned int seqIdx = 0; seqIdx < hitSize; seqIdx++) {
             std::pair<const unsigned char *, const unsigned int> tmp = sequenceLookup->getSequence(
-                    hits[seqIdx]->id);
+                    results[hits[seqIdx]].id);
             if(tmp.second >= 32768){
                 // hack to avoid too long sequences
                 // this sequences will be processed by computeLongScore later
@@ -175,42 +364,40 @@ void UngappedAlignment::scoreDiagonalAndUpdateHits(const char * queryProfile,
         }
         std::pair<unsigned char *, unsigned int> seq = mapSequences(seqs, hitSize);
 
-        simd_int vMaxScore = simdi_setzero();
-
+        const char *profile = queryProfile;
+        const unsigned char *dbSeqs = seq.first;
+        unsigned int minSeqLen = 0;
         if (diagonal >= 0 && minDistToDiagonal < queryLen) {
-            unsigned int minSeqLen = std::min(seq.second, queryLen - minDistToDiagonal);
-            simd_int ret = vectorDiagonalScoring(queryProfile + (minDistToDiagonal * PROFILESIZE), bias, minSeqLen,
-                                                 seq.first);
-            vMaxScore = simdui8_max(ret, vMaxScore);
+            minSeqLen = std::min(seq.second, queryLen - minDistToDiagonal);
+            profile = queryProfile + (minDistToDiagonal * PROFILESIZE);
         } else if (diagonal < 0 && minDistToDiagonal < seq.second) {
-            unsigned int minSeqLen = std::min(seq.second - minDistToDiagonal, queryLen);
-            simd_int ret = vectorDiagonalScoring(queryProfile, bias, minSeqLen,
-                                                 seq.first + minDistToDiagonal * VECSIZE_INT * 4);
-            vMaxScore = simdui8_max(ret, vMaxScore);
+            minSeqLen = std::min(seq.second - minDistToDiagonal, queryLen);
+            dbSeqs = seq.first + minDistToDiagonal * lanes;
         }
-        extractScores(score_arr, vMaxScore);
+        scoreDiagonals(profile, bias, minSeqLen, dbSeqs);
         // update score
         for(size_t hitIdx = 0; hitIdx < hitSize; hitIdx++){
-            hits[hitIdx]->count = score_arr[hitIdx];
+            CounterResult &hit = results[hits[hitIdx]];
+            hit.count = score_arr[hitIdx];
             if(seqs[hitIdx].second == 1){
-                std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(hits[hitIdx]->id);
+                std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(hit.id);
                 if(dbSeq.second >= 32768){
                     int max = computeLongScore(queryProfile, queryLen, dbSeq, diagonal, bias);
-                    hits[hitIdx]->count = static_cast<unsigned char>(std::min(255-bias, max));
+                    hit.count = static_cast<unsigned char>(std::min(255-bias, max));
                 }
             }
         }
     }else {
         for (size_t hitIdx = 0; hitIdx < hitSize; hitIdx++) {
-            const unsigned int seqId = hits[hitIdx]->id;
-            std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(seqId);
+            CounterResult &hit = results[hits[hitIdx]];
+            std::pair<const unsigned char *, const unsigned int> dbSeq =  sequenceLookup->getSequence(hit.id);
             int max;
             if(dbSeq.second >= 32768){
                 max = computeLongScore(queryProfile, queryLen, dbSeq, diagonal, bias);
             }else{
                 max = computeSingelSequenceScores(queryProfile, queryLen, dbSeq, diagonal, minDistToDiagonal, bias);
             }
-            hits[hitIdx]->count = static_cast<unsigned char>(std::min(255-bias, max));
+            hit.count = static_cast<unsigned char>(std::min(255-bias, max));
         }
 
     }
@@ -247,19 +434,19 @@ void UngappedAlignment::computeScores(const char *queryProfile,
 //            continue;
 //        }
         const unsigned short currDiag = results[i].diagonal;
-        diagonalMatches[currDiag * (VECSIZE_INT * 4) + diagonalCounter[currDiag]] = &results[i];
+        diagonalMatches[currDiag * lanes + diagonalCounter[currDiag]] = static_cast<unsigned int>(i);
         diagonalCounter[currDiag]++;
-        if(diagonalCounter[currDiag] >= (VECSIZE_INT * 4) ) {
-            scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(currDiag),
-                                       &diagonalMatches[currDiag * (VECSIZE_INT * 4)], diagonalCounter[currDiag], bias);
+        if(diagonalCounter[currDiag] >= lanes) {
+            scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(currDiag), results,
+                                       &diagonalMatches[currDiag * lanes], diagonalCounter[currDiag], bias);
             diagonalCounter[currDiag] = 0;
         }
     }
     // process rest
     for(size_t i = 0; i < DIAGONALCOUNT; i++){
         if(diagonalCounter[i] > 0){
-            scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(i),
-                                       &diagonalMatches[i * (VECSIZE_INT * 4)], diagonalCounter[i], bias);
+            scoreDiagonalAndUpdateHits(queryProfile, queryLen, static_cast<short>(i), results,
+                                       &diagonalMatches[i * lanes], diagonalCounter[i], bias);
         }
         diagonalCounter[i] = 0;
     }
@@ -13,8 +13,19 @@ class UngappedAlignment {
 
 public:
 
+    // vector kernels for scoring many diagonals in parallel
+    // KERNEL_SIMD uses the instruction set the binary was compiled for (simd.h),
+    // the others are compiled for their instruction set on x86 and selected at runtime
+    enum Kernel {
+        KERNEL_AUTO = -1,
+        KERNEL_SIMD = 0,
+        KERNEL_SSE41,
+        KERNEL_AVX2,
+        KERNEL_AVX512BW
+    };
+
     UngappedAlignment(const unsigned int maxSeqLen, BaseMatrix *substitutionMatrix,
-                    SequenceLookup *sequenceLookup);
+                    SequenceLookup *sequenceLookup, int kernel = KERNEL_AUTO);
 
     ~UngappedAlignment();
 
@@ -33,22 +44,38 @@ public:
         return bias;
     }
 
+    // number of diagonals scored in parallel
+    inline unsigned int getLanes() {
+        return lanes;
+    }
+
+    // best kernel supported by the CPU
+    static int detectKernel();
+    static bool isKernelSupported(int kernel);
+    static const char *getKernelName(int kernel);
+
 private:
     const static unsigned int DIAGONALCOUNT = 0xFFFF + 1;
     const static unsigned int PROFILESIZE = 32;
+    // lanes of the widest kernel (AVX-512BW)
+    const static unsigned int MAX_LANES = 64;
+
+    int kernel;
+    unsigned int lanes;
 
     unsigned int *score_arr;
     unsigned char *vectorSequence;
     char *queryProfile;
     unsigned int queryLen;
     short bias;
-    CounterResult ** diagonalMatches;
+    // indices of the results binned by diagonal, lanes per diagonal
+    unsigned int * diagonalMatches;
     unsigned char * diagonalCounter;
     char * aaCorrectionScore;
     BaseMatrix *subMatrix;
     SequenceLookup *sequenceLookup;
 
-    // this function bins the hit_t by diagonals by distributing each hit in an array of 256 * 16(sse)/32(avx2)
+    // this function bins the hit_t by diagonals by distributing each hit in an array of 256 * 16(sse)/32(avx2)/64(avx512)
     // the function scoreDiagonalAndUpdateHits is called for each bin that reaches its maximum (16 or 32)
     void computeScores(const char *queryProfile,
                        const unsigned int queryLen,
@@ -65,13 +92,16 @@ private:
     simd_int vectorDiagonalScoring(const char *profile,
                                          const char bias, const unsigned int seqLen, const unsigned char *dbSeq);
 
+    // scores the diagonals of lanes db sequences with the selected kernel and writes the scores to score_arr
+    void scoreDiagonals(const char *profile, const char bias, const unsigned int seqLen, const unsigned char *dbSeq);
+
     std::pair<unsigned char *, unsigned int> mapSequences(std::pair<unsigned char *, unsigned int> * seqs, unsigned int seqCount);
 
     // calles vectorDiagonalScoring or scalarDiagonalScoring depending on the hitSize
     // and updates diagonalScore of the hit_t objects
     void scoreDiagonalAndUpdateHits(const char *queryProfile, const unsigned int queryLen,
-                                    const short diagonal, CounterResult **hits, const unsigned int hitSize,
-                                    const short bias);
+                                    const short diagonal, CounterResult *results, const unsigned int *hits,
+                                    const unsigned int hitSize, const short bias);
 
 #ifdef AVX2
     __m256i Shuffle(const __m256i &value, const __m256i &shuffle);
@@ -137,7 +137,7 @@ int doRescorealldiagonal(Parameters &par, DBReader<unsigned int> &qdbr, DBWriter
             std::sort(shortResults.begin(), shortResults.end(), hit_t::compareHitsByScoreAndId);
 
             for (size_t i = 0; i < shortResults.size(); ++i) {
-                size_t len = QueryMatcher::prefilterHitToBuffer(buffer, shortResults[i]);
+                size_t len = QueryMatcher::prefilterHitToBuffer(buffer, shortResults[i], par.binaryPrefilter);
                 resultBuffer.append(buffer, len);
             }
 
@@ -168,7 +168,10 @@ int ungappedprefilter(int argc, const char **argv, const Command &command) {
     if (par.preloadMode != Parameters::PRELOAD_MODE_MMAP) {
         qdbr.readMmapedDataInMemory();
     }
-
+    int outputDbType = Parameters::DBTYPE_PREFILTER_RES;
+    if (par.binaryPrefilter) {
+        outputDbType |= Parameters::DBTYPE_BINARY_FLAG;
+    }
 
 #ifdef HAVE_MPI
     size_t dbFrom = 0;
@@ -176,7 +179,7 @@ int ungappedprefilter(int argc, const char **argv, const Command &command) {
 
     qdbr.decomposeDomainByAminoAcid(MMseqsMPI::rank, MMseqsMPI::numProc, &dbFrom, &dbSize);
     std::pair<std::string, std::string> tmpOutput = Util::createTmpFileNames(par.db3, par.db3Index, MMseqsMPI::rank);
-    DBWriter resultWriter(tmpOutput.first.c_str(), tmpOutput.second.c_str(), par.threads,  par.compressed, Parameters::DBTYPE_PREFILTER_RES);
+    DBWriter resultWriter(tmpOutput.first.c_str(), tmpOutput.second.c_str(), par.threads,  par.compressed, outputDbType);
     resultWriter.open();
     int status = doRescorealldiagonal(par, qdbr, resultWriter, dbFrom, dbSize);
     resultWriter.close();
@@ -191,7 +194,7 @@ int ungappedprefilter(int argc, const char **argv, const Command &command) {
         DBWriter::mergeResults(par.db3, par.db3Index, splitFiles);
     }
 #else
-    DBWriter resultWriter(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_PREFILTER_RES);
+    DBWriter resultWriter(par.db3.c_str(), par.db3Index.c_str(), par.threads, par.compressed, outputDbType);
     resultWriter.open();
     int status = doRescorealldiagonal(par, qdbr, resultWriter, 0, qdbr.getSize());
     resultWriter.close();
@@ -0,0 +1,178 @@
+#include "MappingReader.h"
+#include "FileUtil.h"
+#include "Debug.h"
+#include "Util.h"
+
+#include <cstring>
+#include <stdint.h>
+
+const char MappingReader::BINARY_MAGIC[8] = {'M', 'M', 'S', 'T', 'A', 'X', 'M', 'P'};
+const unsigned int MappingReader::NOT_FOUND;
+
+static bool compareToFirst(const std::pair<unsigned int, unsigned int> &lhs, const std::pair<unsigned int, unsigned int> &rhs) {
+    return lhs.first < rhs.first;
+}
+
+static size_t alignedSize(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+static void writeAligned(FILE *handle, const void *data, size_t size, const std::string &fileName) {
+    const char padding[8] = {0};
+    if (size > 0 && fwrite(data, 1, size, handle) != size) {
+        Debug(Debug::ERROR) << "Can not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t paddingSize = alignedSize(size) - size;
+    if (paddingSize > 0 && fwrite(padding, 1, paddingSize, handle) != paddingSize) {
+        Debug(Debug::ERROR) << "Can not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+MappingReader::MappingReader(const std::string &mappingFile, bool allowBinary)
+        : dense(false), count(0), minKey(0), maxKey(0), sourceSize(0), sourceTime(0), keys(NULL), values(NULL),
+          mappedData(NULL), mappedSize(0) {
+    const bool hasText = FileUtil::fileExists(mappingFile.c_str());
+    const std::string binaryFile = mappingFile + ".bin";
+    if (allowBinary && FileUtil::fileExists(binaryFile.c_str())) {
+        if (openBinary(binaryFile, hasText ? &mappingFile : NULL)) {
+            return;
+        }
+        Debug(Debug::WARNING) << binaryFile << " was not created from the current " << mappingFile
+                              << ". Rerun createbintaxmapping to recreate it.\n";
+    }
+    if (hasText == false) {
+        Debug(Debug::ERROR) << mappingFile << " does not exist. Please create the taxonomy mapping!\n";
+        EXIT(EXIT_FAILURE);
+    }
+    readText(mappingFile);
+}
+
+MappingReader::~MappingReader() {
+    if (mappedData != NULL) {
+        FileUtil::munmapData(mappedData, mappedSize);
+    }
+}
+
+void MappingReader::readText(const std::string &fileName) {
+    std::vector<std::pair<unsigned int, unsigned int>> mapping;
+    bool isSorted = Util::readMapping(fileName, mapping);
+    if (isSorted == false) {
+        std::stable_sort(mapping.begin(), mapping.end(), compareToFirst);
+    }
+    sourceSize = FileUtil::getFileSize(fileName);
+    sourceTime = FileUtil::getModificationTime(fileName);
+
+    // keep the first entry of every key
+    size_t unique = 0;
+    for (size_t i = 0; i < mapping.size(); ++i) {
+        if (unique == 0 || mapping[unique - 1].first != mapping[i].first) {
+            mapping[unique++] = mapping[i];
+        }
+    }
+    mapping.resize(unique);
+    count = unique;
+    if (count == 0) {
+        return;
+    }
+
+    minKey = mapping.front().first;
+    maxKey = mapping.back().first;
+    const size_t range = static_cast<size_t>(maxKey) - minKey + 1;
+    // a dense array needs at most as much memory as the sorted key/taxid arrays
+    dense = range <= 2 * count;
+    if (dense) {
+        valueStorage.assign(range, NOT_FOUND);
+        for (size_t i = 0; i < count; ++i) {
+            valueStorage[mapping[i].first - minKey] = mapping[i].second;
+        }
+    } else {
+        keyStorage.resize(count);
+        valueStorage.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            keyStorage[i] = mapping[i].first;
+            valueStorage[i] = mapping[i].second;
+        }
+        keys = keyStorage.data();
+    }
+    values = valueStorage.data();
+}
+
+void MappingReader::writeBinary(const std::string &fileName) const {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(BinaryHeader));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.dense = dense;
+    header.count = count;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.minKey = minKey;
+    header.maxKey = maxKey;
+
+    FILE *handle = FileUtil::openFileOrDie(fileName.c_str(), "w", false);
+    writeAligned(handle, &header, sizeof(BinaryHeader), fileName);
+    if (dense) {
+        size_t range = (count == 0) ? 0 : static_cast<size_t>(maxKey) - minKey + 1;
+        writeAligned(handle, values, range * sizeof(unsigned int), fileName);
+    } else {
+        writeAligned(handle, keys, count * sizeof(unsigned int), fileName);
+        writeAligned(handle, values, count * sizeof(unsigned int), fileName);
+    }
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Can not close " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+bool MappingReader::openBinary(const std::string &fileName, const std::string *sourceFile) {
+    FILE *handle = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    size_t size;
+    char *data = (char *) FileUtil::mmapFile(handle, &size);
+    fclose(handle);
+
+    if (size < sizeof(BinaryHeader) || memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        Debug(Debug::ERROR) << fileName << " is not a binary taxonomy mapping\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const BinaryHeader *header = reinterpret_cast<const BinaryHeader *>(data);
+    if (header->version != BINARY_VERSION) {
+        Debug(Debug::ERROR) << "Binary taxonomy mapping " << fileName << " has version " << header->version
+                            << ", expected " << BINARY_VERSION << ". Please recreate it with createbintaxmapping\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t range = (header->count == 0) ? 0 : static_cast<size_t>(header->maxKey) - header->minKey + 1;
+    size_t expectedSize = alignedSize(sizeof(BinaryHeader))
+                          + (header->dense ? alignedSize(range * sizeof(unsigned int))
+                                           : 2 * alignedSize(header->count * sizeof(unsigned int)));
+    if (size != expectedSize) {
+        Debug(Debug::ERROR) << "Binary taxonomy mapping " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // without text mapping there is nothing to compare against
+    if (sourceFile != NULL && (header->sourceSize != FileUtil::getFileSize(*sourceFile)
+                               || header->sourceTime != FileUtil::getModificationTime(*sourceFile))) {
+        FileUtil::munmapData(data, size);
+        return false;
+    }
+
+    mappedData = data;
+    mappedSize = size;
+    dense = header->dense;
+    count = header->count;
+    sourceSize = header->sourceSize;
+    sourceTime = header->sourceTime;
+    minKey = header->minKey;
+    maxKey = header->maxKey;
+
+    size_t offset = alignedSize(sizeof(BinaryHeader));
+    if (dense) {
+        values = reinterpret_cast<const unsigned int *>(data + offset);
+    } else {
+        keys = reinterpret_cast<const unsigned int *>(data + offset);
+        offset += alignedSize(count * sizeof(unsigned int));
+        values = reinterpret_cast<const unsigned int *>(data + offset);
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef MMSEQS_MAPPINGREADER_H
+#define MMSEQS_MAPPINGREADER_H
+
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstddef>
+#include <algorithm>
+
+// Maps database keys to taxonomy identifiers.
+// The binary mapping (mappingFile + ".bin", written by createbintaxmapping) is memory mapped if it exists and
+// was created from the current text mapping, otherwise the text mapping is parsed.
+// Keys that cover most of their range are stored as taxid array indexed by key, other keys as sorted key/taxid arrays.
+// If a key appears multiple times, the first line of the text mapping wins.
+class MappingReader {
+public:
+    static const unsigned int NOT_FOUND = UINT_MAX;
+
+    MappingReader(const std::string &mappingFile, bool allowBinary = true);
+    ~MappingReader();
+
+    unsigned int lookup(unsigned int key) const {
+        if (dense) {
+            if (count == 0 || key < minKey || key > maxKey) {
+                return NOT_FOUND;
+            }
+            return values[key - minKey];
+        }
+        const unsigned int *it = std::lower_bound(keys, keys + count, key);
+        if (it == keys + count || *it != key) {
+            return NOT_FOUND;
+        }
+        return values[it - keys];
+    }
+
+    // number of distinct keys
+    size_t size() const {
+        return count;
+    }
+
+    void writeBinary(const std::string &fileName) const;
+
+private:
+    struct BinaryHeader {
+        char magic[8];
+        unsigned int version;
+        unsigned int dense;
+        size_t count;
+        // size and modification time of the text mapping the binary was created from, used to detect stale binary mappings
+        size_t sourceSize;
+        long long sourceTime;
+        unsigned int minKey;
+        unsigned int maxKey;
+    };
+    static const char BINARY_MAGIC[8];
+    static const unsigned int BINARY_VERSION = 2;
+
+    void readText(const std::string &fileName);
+    // sourceFile is the text mapping to compare against, NULL if it does not exist
+    bool openBinary(const std::string &fileName, const std::string *sourceFile);
+
+    bool dense;
+    size_t count;
+    unsigned int minKey;
+    unsigned int maxKey;
+    size_t sourceSize;
+    long long sourceTime;
+    const unsigned int *keys;
+    const unsigned int *values;
+
+    std::vector<unsigned int> keyStorage;
+    std::vector<unsigned int> valueStorage;
+    char *mappedData;
+    size_t mappedSize;
+};
+
+#endif
@@ -11,43 +11,35 @@
 #include <fstream>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 
-int **makeMatrix(size_t maxNodes) {
-    Debug(Debug::INFO) << "Making matrix ...";
-    size_t dimension = maxNodes * 2;
-    int **M = new int*[dimension];
-    int k = (int)(MathUtil::flog2(dimension)) + 1;
-    for (size_t i = 0; i < dimension; ++i) {
-        M[i] = new int[k]();
-    }
-    Debug(Debug::INFO) << " Done\n";
-    return M;
-}
-
-void deleteMatrix(int** M, size_t maxNodes) {
-    for (size_t i = 0; i < (maxNodes * 2); ++i) {
-        delete[] M[i];
-    }
-    delete[] M;
-}
-
+const char NcbiTaxonomy::BINARY_MAGIC[8] = {'M', 'M', 'S', 'T', 'A', 'X', 'D', 'B'};
 
 NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile,  const std::string &nodesFile,
-                           const std::string &mergedFile) {
+                           const std::string &mergedFile) : mappedData(NULL), mappedSize(0) {
+    const std::string sourceFiles[3] = { namesFile, nodesFile, mergedFile };
+    for (size_t i = 0; i < 3; ++i) {
+        sourceSize[i] = FileUtil::getFileSize(sourceFiles[i]);
+        sourceTime[i] = FileUtil::getModificationTime(sourceFiles[i]);
+    }
+    // offset 0 is the empty name of taxa without scientific name
+    stringPool.push_back('\0');
     loadNodes(nodesFile);
     loadMerged(mergedFile);
     loadNames(namesFile);
+    strings = stringPool.c_str();
+    stringPoolSize = stringPool.size();
 
-    maxNodes = taxonNodes.size();
+    maxNodes = nodeStorage.size();
 
     E.reserve(maxNodes * 2);
     L.reserve(maxNodes * 2);
 
-    H = new int[maxNodes];
-    std::fill(H, H + maxNodes, 0);
+    HStorage.assign(maxNodes, 0);
+    H = HStorage.data();
 
-    std::vector< std::vector<TaxID> > children(taxonNodes.size());
-    for (std::vector<TaxonNode>::iterator it = taxonNodes.begin(); it != taxonNodes.end(); ++it) {
+    std::vector< std::vector<TaxID> > children(maxNodes);
+    for (std::vector<TaxonNode>::iterator it = nodeStorage.begin(); it != nodeStorage.end(); ++it) {
         if (it->parentTaxId != it->taxId) {
             children[nodeId(it->parentTaxId)].push_back(it->taxId);
         }
@@ -56,14 +48,17 @@ NcbiTaxonomy::NcbiTaxonomy(const std::string &namesFile,  const std::string &nod
     elh(children, 1, 0);
     E.resize(maxNodes * 2, 0);
     L.resize(maxNodes * 2, 0);
+    tour = E.data();
+    tourLevel = L.data();
+    tourLength = maxNodes * 2;
 
-    M = makeMatrix(maxNodes);
     InitRangeMinimumQuery();
 }
 
 NcbiTaxonomy::~NcbiTaxonomy() {
-    delete[] H;
-    deleteMatrix(M, maxNodes);
+    if (mappedData != NULL) {
+        FileUtil::munmapData(mappedData, mappedSize);
+    }
 }
 
 std::vector<std::string> splitByDelimiter(const std::string &s, const std::string &delimiter, int maxCol) {
@@ -90,6 +85,7 @@ size_t NcbiTaxonomy::loadNodes(const std::string &nodesFile) {
     }
 
     std::map<TaxID, int> Dm; // temporary map TaxID -> internal ID;
+    std::map<std::string, size_t> rankIdx;
     int maxTaxID = 0;
     int currentId = 0;
     std::string line;
@@ -100,28 +96,42 @@ size_t NcbiTaxonomy::loadNodes(const std::string &nodesFile) {
         if (taxId > maxTaxID) {
             maxTaxID = taxId;
         }
-        taxonNodes.emplace_back(currentId, taxId, parentTaxId, result[2]);
+        std::map<std::string, size_t>::iterator rankIt = rankIdx.find(result[2]);
+        if (rankIt == rankIdx.end()) {
+            rankIt = rankIdx.emplace(result[2], addString(result[2])).first;
+        }
+        nodeStorage.emplace_back(currentId, taxId, parentTaxId, rankIt->second);
         Dm.emplace(taxId, currentId);
         ++currentId;
     }
+    taxonNodes = nodeStorage.data();
 
-    D.clear();
-    D.resize(maxTaxID + 1, -1);
+    DStorage.clear();
+    DStorage.resize(maxTaxID + 1, -1);
     for (std::map<TaxID, int>::iterator it = Dm.begin(); it != Dm.end(); ++it) {
         assert(it->first <= maxTaxID);
-        D[it->first] = it->second;
+        DStorage[it->first] = it->second;
     }
+    D = DStorage.data();
+    taxIdCount = DStorage.size();
 
     // Loop over taxonNodes and check all parents exist
-    for (std::vector<TaxonNode>::iterator it = taxonNodes.begin(); it != taxonNodes.end(); ++it) {
+    for (std::vector<TaxonNode>::iterator it = nodeStorage.begin(); it != nodeStorage.end(); ++it) {
         if (!nodeExists(it->parentTaxId)) {
             Debug(Debug::ERROR) << "Inconsistent nodes.dmp taxonomy file! Cannot find parent taxon with ID " << it->parentTaxId << "!\n";
             EXIT(EXIT_FAILURE);
         }
     }
 
-    Debug(Debug::INFO) << " Done, got " << taxonNodes.size() << " nodes\n";
-    return taxonNodes.size();
+    Debug(Debug::INFO) << " Done, got " << nodeStorage.size() << " nodes\n";
+    return nodeStorage.size();
+}
+
+size_t NcbiTaxonomy::addString(const std::string &str) {
+    size_t idx = stringPool.size();
+    stringPool.append(str);
+    stringPool.push_back('\0');
+    return idx;
 }
 
 std::pair<int, std::string> parseName(const std::string &line) {
@@ -152,7 +162,7 @@ void NcbiTaxonomy::loadNames(const std::string &namesFile) {
             Debug(Debug::ERROR) << "loadNames: Taxon " << entry.first << " not present in nodes file!\n";
             EXIT(EXIT_FAILURE);
         }
-        taxonNodes[nodeId(entry.first)].name = entry.second;
+        nodeStorage[nodeId(entry.first)].nameIdx = addString(entry.second);
     }
     Debug(Debug::INFO) << " Done\n";
 }
@@ -172,25 +182,30 @@ void NcbiTaxonomy::elh(std::vector< std::vector<TaxID> > const & children, TaxID
     for (std::vector<TaxID>::const_iterator child_it = children[id].begin(); child_it != children[id].end(); ++child_it) {
         elh(children, *child_it, level + 1);
     }
-    E.emplace_back(nodeId(taxonNodes[id].parentTaxId));
+    E.emplace_back(nodeId(nodeStorage[id].parentTaxId));
     L.emplace_back(level - 1);
 }
 
 void NcbiTaxonomy::InitRangeMinimumQuery() {
     Debug(Debug::INFO) << "Init RMQ ...";
-
-    for (unsigned int i = 0; i < (maxNodes * 2); ++i) {
-        M[i][0] = i;
-    }
-
-    for (unsigned int j = 1; (1ul << j) <= (maxNodes * 2); ++j) {
-        for (unsigned int i = 0; (i + (1ul << j) - 1) < (maxNodes * 2); ++i) {
-            int A = M[i][j - 1];
-            int B = M[i + (1ul << (j - 1))][j - 1];
-            if (L[A] < L[B]) {
-                M[i][j] = A;
+    levels = (unsigned int)(MathUtil::flog2(tourLength)) + 1;
+    MStorage.assign(levels * tourLength, 0);
+    M = MStorage.data();
+
+    for (unsigned int i = 0; i < tourLength; ++i) {
+        M[i] = i;
+    }
+
+    for (unsigned int j = 1; (1ul << j) <= tourLength; ++j) {
+        int *prevLevel = M + (j - 1) * tourLength;
+        int *level = M + j * tourLength;
+        for (unsigned int i = 0; (i + (1ul << j) - 1) < tourLength; ++i) {
+            int A = prevLevel[i];
+            int B = prevLevel[i + (1ul << (j - 1))];
+            if (tourLevel[A] < tourLevel[B]) {
+                level[i] = A;
             } else {
-                M[i][j] = B;
+                level[i] = B;
             }
         }
     }
@@ -200,9 +215,10 @@ void NcbiTaxonomy::InitRangeMinimumQuery() {
 int NcbiTaxonomy::RangeMinimumQuery(int i, int j) const {
     assert(j >= i);
     int k = (int)MathUtil::flog2(j - i + 1);
-    int A = M[i][k];
-    int B = M[j - MathUtil::ipow<int>(2, k) + 1][k];
-    if (L[A] <= L[B]) {
+    const int *level = M + k * tourLength;
+    int A = level[i];
+    int B = level[j - MathUtil::ipow<int>(2, k) + 1];
+    if (tourLevel[A] <= tourLevel[B]) {
         return A;
     }
     return B;
@@ -225,8 +241,8 @@ int NcbiTaxonomy::lcaHelper(int i, int j) const {
         v2 = tmp;
     }
     int rmq = RangeMinimumQuery(v1, v2);
-    assert(E[rmq] >= 0);
-    return E[rmq];
+    assert(tour[rmq] >= 0);
+    return tour[rmq];
 }
 
 bool NcbiTaxonomy::IsAncestor(TaxID ancestor, TaxID child) {
@@ -278,7 +294,7 @@ TaxonNode const * NcbiTaxonomy::LCA(const std::vector<TaxID>& taxa) const {
         }
     }
 
-    assert(red >= 0 && static_cast<unsigned int>(red) < taxonNodes.size());
+    assert(red >= 0 && static_cast<unsigned int>(red) < maxNodes);
 
     return &(taxonNodes[red]);
 }
@@ -289,8 +305,8 @@ std::vector<std::string> NcbiTaxonomy::AtRanks(TaxonNode const *node, const std:
     std::vector<std::string> result;
     std::map<std::string, std::string> allRanks = AllRanks(node);
     // map does not include "no rank" nor "no_rank"
-    int baseRankIndex = findRankIndex(node->rank);
-    std::string baseRank = "uc_" + node->name;
+    int baseRankIndex = findRankIndex(getString(node->rankIdx));
+    std::string baseRank = "uc_" + std::string(getString(node->nameIdx));
     for (std::vector<std::string>::const_iterator it = levels.begin(); it != levels.end(); ++it) {
         std::map<std::string, std::string>::iterator jt = allRanks.find(*it);
         if (jt != allRanks.end()) {
@@ -347,9 +363,9 @@ std::string NcbiTaxonomy::taxLineage(TaxonNode const *node) {
     } while (node->parentTaxId != node->taxId);
 
     for (int i = taxLineageVec.size() - 1; i >= 0; --i) {
-        taxLineage += findShortRank(taxLineageVec[i]->rank);
+        taxLineage += findShortRank(getString(taxLineageVec[i]->rankIdx));
         taxLineage += '_';
-        taxLineage += taxLineageVec[i]->name;
+        taxLineage += getString(taxLineageVec[i]->nameIdx);
         if (i > 0) {
             taxLineage += ";";
         }
@@ -366,7 +382,7 @@ int NcbiTaxonomy::nodeId(TaxID taxonId) const {
 }
 
 bool NcbiTaxonomy::nodeExists(TaxID taxonId) const {
-    return D[taxonId] != -1;
+    return taxonId >= 0 && static_cast<size_t>(taxonId) < taxIdCount && D[taxonId] != -1;
 }
 
 TaxonNode const * NcbiTaxonomy::taxonNode(TaxID taxonId, bool fail) const {
@@ -379,13 +395,14 @@ TaxonNode const * NcbiTaxonomy::taxonNode(TaxID taxonId, bool fail) const {
 std::map<std::string, std::string> NcbiTaxonomy::AllRanks(TaxonNode const *node) const {
     std::map<std::string, std::string> result;
     while (true) {
+        const char *rank = getString(node->rankIdx);
         if (node->taxId == 1) {
-            result.emplace(node->rank, node->name);
+            result.emplace(rank, getString(node->nameIdx));
             return result;
         }
 
-        if ((node->rank != "no_rank") && (node->rank != "no rank")) {
-            result.emplace(node->rank, node->name);
+        if (strcmp(rank, "no_rank") != 0 && strcmp(rank, "no rank") != 0) {
+            result.emplace(rank, getString(node->nameIdx));
         }
 
         node = taxonNode(node->parentTaxId);
@@ -412,7 +429,12 @@ size_t NcbiTaxonomy::loadMerged(const std::string &mergedFile) {
         unsigned int oldId = (unsigned int)strtoul(result[0].c_str(), NULL, 10);
         unsigned int mergedId = (unsigned int)strtoul(result[1].c_str(), NULL, 10);
         if (!nodeExists(oldId) && nodeExists(mergedId)) {
-            D[oldId] = D[mergedId];
+            if (oldId >= DStorage.size()) {
+                DStorage.resize(oldId + 1, -1);
+            }
+            DStorage[oldId] = DStorage[mergedId];
+            D = DStorage.data();
+            taxIdCount = DStorage.size();
             ++count;
         }
     }
@@ -420,26 +442,37 @@ size_t NcbiTaxonomy::loadMerged(const std::string &mergedFile) {
     return count;
 }
 
-std::unordered_map<TaxID, TaxonCounts> NcbiTaxonomy::getCladeCounts(std::unordered_map<TaxID, unsigned int>& taxonCounts) const {
+std::unordered_map<TaxID, TaxonCounts> NcbiTaxonomy::getCladeCounts(const std::vector<unsigned int>& nodeCounts, const std::unordered_map<TaxID, unsigned int>& otherCounts) const {
     Debug(Debug::INFO) << "Calculating clade counts ... ";
-    std::unordered_map<TaxID, TaxonCounts> cladeCounts;
+    // the Euler tour leaves every node towards its parent once its subtree is complete,
+    // the root is left towards itself at the end of the tour
+    std::vector<unsigned int> clade(nodeCounts);
+    for (size_t i = 0; i + 1 < tourLength; ++i) {
+        if (tourLevel[i + 1] < tourLevel[i] && tour[i + 1] != tour[i]) {
+            clade[tour[i + 1]] += clade[tour[i]];
+        }
+    }
 
-    for (std::unordered_map<TaxID, unsigned int>::const_iterator it = taxonCounts.begin(); it != taxonCounts.end(); ++it) {
+    std::unordered_map<TaxID, TaxonCounts> cladeCounts;
+    for (std::unordered_map<TaxID, unsigned int>::const_iterator it = otherCounts.begin(); it != otherCounts.end(); ++it) {
         cladeCounts[it->first].taxCount = it->second;
-        cladeCounts[it->first].cladeCount += it->second;
-        if (nodeExists(it->first)) {
-            TaxonNode const* taxon = taxonNode(it->first);
-            while (taxon->parentTaxId != taxon->taxId && nodeExists(taxon->parentTaxId)) {
-                taxon = taxonNode(taxon->parentTaxId);
-                cladeCounts[taxon->taxId].cladeCount += it->second;
-            }
+        cladeCounts[it->first].cladeCount = it->second;
+    }
+    for (size_t i = 0; i < maxNodes; ++i) {
+        if (clade[i] > 0) {
+            TaxonCounts& counts = cladeCounts[taxonNodes[i].taxId];
+            counts.taxCount = nodeCounts[i];
+            counts.cladeCount = clade[i];
         }
     }
 
-    for (const TaxonNode& tn : taxonNodes) {
-        if (tn.parentTaxId != tn.taxId && cladeCounts.count(tn.taxId)) {
+    for (size_t i = 0; i < maxNodes; ++i) {
+        const TaxonNode& tn = taxonNodes[i];
+        if (tn.parentTaxId != tn.taxId && clade[i] > 0) {
             std::unordered_map<TaxID, TaxonCounts>::iterator itp = cladeCounts.find(tn.parentTaxId);
-            itp->second.children.push_back(tn.taxId);
+            if (itp != cladeCounts.end()) {
+                itp->second.children.push_back(tn.taxId);
+            }
         }
     }
 
@@ -447,11 +480,138 @@ std::unordered_map<TaxID, TaxonCounts> NcbiTaxonomy::getCladeCounts(std::unorder
     return cladeCounts;
 }
 
+static size_t alignedSize(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+static void writeAligned(FILE *handle, const void *data, size_t size, const std::string &fileName) {
+    const char padding[8] = {0};
+    if (size > 0 && fwrite(data, 1, size, handle) != size) {
+        Debug(Debug::ERROR) << "Can not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t paddingSize = alignedSize(size) - size;
+    if (paddingSize > 0 && fwrite(padding, 1, paddingSize, handle) != paddingSize) {
+        Debug(Debug::ERROR) << "Can not write to " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+void NcbiTaxonomy::writeBinary(const std::string &fileName) const {
+    BinaryHeader header;
+    memset(&header, 0, sizeof(BinaryHeader));
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.levels = levels;
+    header.nodeCount = maxNodes;
+    header.taxIdCount = taxIdCount;
+    header.tourLength = tourLength;
+    header.stringPoolSize = stringPoolSize;
+    for (size_t i = 0; i < 3; ++i) {
+        header.sourceSize[i] = sourceSize[i];
+        header.sourceTime[i] = sourceTime[i];
+    }
+
+    FILE *handle = FileUtil::openFileOrDie(fileName.c_str(), "w", false);
+    writeAligned(handle, &header, sizeof(BinaryHeader), fileName);
+    writeAligned(handle, strings, stringPoolSize, fileName);
+    // copy the nodes to zero their padding bytes
+    std::vector<char> nodes(maxNodes * sizeof(TaxonNode), 0);
+    for (size_t i = 0; i < maxNodes; ++i) {
+        TaxonNode *node = reinterpret_cast<TaxonNode *>(nodes.data() + i * sizeof(TaxonNode));
+        node->id = taxonNodes[i].id;
+        node->taxId = taxonNodes[i].taxId;
+        node->parentTaxId = taxonNodes[i].parentTaxId;
+        node->rankIdx = taxonNodes[i].rankIdx;
+        node->nameIdx = taxonNodes[i].nameIdx;
+    }
+    writeAligned(handle, nodes.data(), nodes.size(), fileName);
+    writeAligned(handle, D, taxIdCount * sizeof(int), fileName);
+    writeAligned(handle, tour, tourLength * sizeof(int), fileName);
+    writeAligned(handle, tourLevel, tourLength * sizeof(int), fileName);
+    writeAligned(handle, H, maxNodes * sizeof(int), fileName);
+    writeAligned(handle, M, levels * tourLength * sizeof(int), fileName);
+    if (fclose(handle) != 0) {
+        Debug(Debug::ERROR) << "Can not close " << fileName << "\n";
+        EXIT(EXIT_FAILURE);
+    }
+}
+
+NcbiTaxonomy * NcbiTaxonomy::openBinary(const std::string &fileName, const std::string *sourceFiles) {
+    FILE *handle = FileUtil::openFileOrDie(fileName.c_str(), "r", true);
+    size_t size;
+    char *data = (char *) FileUtil::mmapFile(handle, &size);
+    fclose(handle);
+
+    if (size < sizeof(BinaryHeader) || memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        Debug(Debug::ERROR) << fileName << " is not a binary taxonomy\n";
+        EXIT(EXIT_FAILURE);
+    }
+    const BinaryHeader *header = reinterpret_cast<const BinaryHeader *>(data);
+    if (header->version != BINARY_VERSION) {
+        Debug(Debug::ERROR) << "Binary taxonomy " << fileName << " has version " << header->version
+                            << ", expected " << BINARY_VERSION << ". Please recreate it with createbintaxonomy\n";
+        EXIT(EXIT_FAILURE);
+    }
+    size_t expectedSize = alignedSize(sizeof(BinaryHeader))
+                          + alignedSize(header->stringPoolSize)
+                          + alignedSize(header->nodeCount * sizeof(TaxonNode))
+                          + alignedSize(header->taxIdCount * sizeof(int))
+                          + 2 * alignedSize(header->tourLength * sizeof(int))
+                          + alignedSize(header->nodeCount * sizeof(int))
+                          + alignedSize(header->levels * header->tourLength * sizeof(int));
+    if (size != expectedSize) {
+        Debug(Debug::ERROR) << "Binary taxonomy " << fileName << " is truncated\n";
+        EXIT(EXIT_FAILURE);
+    }
+    // without .dmp files there is nothing to compare against
+    if (sourceFiles != NULL) {
+        for (size_t i = 0; i < 3; ++i) {
+            if (header->sourceSize[i] != FileUtil::getFileSize(sourceFiles[i])
+                || header->sourceTime[i] != FileUtil::getModificationTime(sourceFiles[i])) {
+                FileUtil::munmapData(data, size);
+                return NULL;
+            }
+        }
+    }
+
+    NcbiTaxonomy *t = new NcbiTaxonomy();
+    t->mappedData = data;
+    t->mappedSize = size;
+    t->maxNodes = header->nodeCount;
+    t->taxIdCount = header->taxIdCount;
+    t->tourLength = header->tourLength;
+    t->levels = header->levels;
+    t->stringPoolSize = header->stringPoolSize;
+    for (size_t i = 0; i < 3; ++i) {
+        t->sourceSize[i] = header->sourceSize[i];
+        t->sourceTime[i] = header->sourceTime[i];
+    }
+
+    size_t offset = alignedSize(sizeof(BinaryHeader));
+    t->strings = data + offset;
+    offset += alignedSize(t->stringPoolSize);
+    t->taxonNodes = reinterpret_cast<TaxonNode *>(data + offset);
+    offset += alignedSize(t->maxNodes * sizeof(TaxonNode));
+    t->D = reinterpret_cast<int *>(data + offset);
+    offset += alignedSize(t->taxIdCount * sizeof(int));
+    t->tour = reinterpret_cast<int *>(data + offset);
+    offset += alignedSize(t->tourLength * sizeof(int));
+    t->tourLevel = reinterpret_cast<int *>(data + offset);
+    offset += alignedSize(t->tourLength * sizeof(int));
+    t->H = reinterpret_cast<int *>(data + offset);
+    offset += alignedSize(t->maxNodes * sizeof(int));
+    t->M = reinterpret_cast<int *>(data + offset);
+    return t;
+}
+
 NcbiTaxonomy * NcbiTaxonomy::openTaxonomy(std::string &database){
     Debug(Debug::INFO) << "Loading NCBI taxonomy\n";
+    std::string binaryFile = database + "_taxonomy";
     std::string nodesFile = database + "_nodes.dmp";
     std::string namesFile = database + "_names.dmp";
     std::string mergedFile = database + "_merged.dmp";
+    bool hasText = true;
     if (FileUtil::fileExists(nodesFile.c_str())
         && FileUtil::fileExists(namesFile.c_str())
         && FileUtil::fileExists(mergedFile.c_str())) {
@@ -462,6 +622,18 @@ NcbiTaxonomy * NcbiTaxonomy::openTaxonomy(std::string &database){
         namesFile = "names.dmp";
         mergedFile = "merged.dmp";
     } else {
+        hasText = false;
+    }
+    if (FileUtil::fileExists(binaryFile.c_str())) {
+        const std::string sourceFiles[3] = { namesFile, nodesFile, mergedFile };
+        NcbiTaxonomy *t = openBinary(binaryFile, hasText ? sourceFiles : NULL);
+        if (t != NULL) {
+            return t;
+        }
+        Debug(Debug::WARNING) << binaryFile << " was not created from the current " << namesFile << ", "
+                              << nodesFile << " and " << mergedFile << ". Rerun createbintaxonomy to recreate it.\n";
+    }
+    if (hasText == false) {
         Debug(Debug::ERROR) << "names.dmp, nodes.dmp, merged.dmp from NCBI taxdump could not be found!\n";
         EXIT(EXIT_FAILURE);
     }
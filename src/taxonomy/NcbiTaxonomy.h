@@ -13,15 +13,16 @@
 
 typedef int TaxID;
 
+// rank and name are offsets into the string pool, use NcbiTaxonomy::getString to resolve them
 struct TaxonNode {
     int id;
     TaxID taxId;
     TaxID parentTaxId;
-    std::string rank;
-    std::string name;
+    size_t rankIdx;
+    size_t nameIdx;
 
-    TaxonNode(int id, TaxID taxId, TaxID parentTaxId, const std::string& rank)
-            : id(id), taxId(taxId), parentTaxId(parentTaxId), rank(rank), name("") {};
+    TaxonNode(int id, TaxID taxId, TaxID parentTaxId, size_t rankIdx)
+            : id(id), taxId(taxId), parentTaxId(parentTaxId), rankIdx(rankIdx), nameIdx(0) {};
 };
 
 struct TaxonCounts {
@@ -75,6 +76,32 @@ public:
                  const std::string &mergedFile);
     ~NcbiTaxonomy();
 
+    // A _taxonomy file holds this header followed by the string pool, the nodes, the taxID to node ID map,
+    // the Euler tour, its levels, the first occurrence of every node and the sparse table for the range minimum query.
+    // Every array starts at an 8 byte aligned offset. The file is memory mapped and used without parsing.
+    struct BinaryHeader {
+        char magic[8];
+        unsigned int version;
+        unsigned int levels;
+        size_t nodeCount;
+        size_t taxIdCount;
+        size_t tourLength;
+        size_t stringPoolSize;
+        // size and modification time of the names, nodes and merged .dmp files the taxonomy was created from
+        size_t sourceSize[3];
+        long long sourceTime[3];
+    };
+    static const char BINARY_MAGIC[8];
+    static const unsigned int BINARY_VERSION = 2;
+
+    const char *getString(size_t idx) const {
+        return strings + idx;
+    }
+
+    void writeBinary(const std::string &fileName) const;
+    // returns NULL if sourceFiles (names, nodes and merged .dmp file) are given and differ from the ones the file was created from
+    static NcbiTaxonomy * openBinary(const std::string &fileName, const std::string *sourceFiles = NULL);
+
     TaxonNode const * LCA(const std::vector<TaxID>& taxa) const;
     TaxID LCA(TaxID taxonA, TaxID taxonB) const;
     std::vector<std::string> AtRanks(TaxonNode const * node, const std::vector<std::string> &levels) const;
@@ -87,14 +114,19 @@ public:
 
     bool IsAncestor(TaxID ancestor, TaxID child);
     TaxonNode const* taxonNode(TaxID taxonId, bool fail = true) const;
-    //std::unordered_map<TaxID, unsigned int> getCladeCounts(std::unordered_map<TaxID, unsigned int>& taxonCounts, TaxID taxon = 1) const;
-    std::unordered_map<TaxID, TaxonCounts> getCladeCounts(std::unordered_map<TaxID, unsigned int>& taxonCounts) const;
+    size_t getNodeCount() const {
+        return maxNodes;
+    }
+    // nodeCounts holds the number of reads per TaxonNode::id, otherCounts the reads of taxa outside of the taxonomy (e.g. 0 for unclassified)
+    std::unordered_map<TaxID, TaxonCounts> getCladeCounts(const std::vector<unsigned int>& nodeCounts, const std::unordered_map<TaxID, unsigned int>& otherCounts) const;
 
     static NcbiTaxonomy * openTaxonomy(std::string & database);
 private:
+    NcbiTaxonomy() {};
     size_t loadNodes(const std::string &nodesFile);
     size_t loadMerged(const std::string &mergedFile);
     void loadNames(const std::string &namesFile);
+    size_t addString(const std::string &str);
     void elh(std::vector< std::vector<TaxID> > const & children, int node, int level);
     void InitRangeMinimumQuery();
     int nodeId(TaxID taxId) const;
@@ -103,14 +135,33 @@ private:
     int RangeMinimumQuery(int i, int j) const;
     int lcaHelper(int i, int j) const;
 
-    std::vector<TaxonNode> taxonNodes;
-    std::vector<int> D; // maps from taxID to node ID in taxonNodes
+    std::vector<TaxonNode> nodeStorage;
+    std::vector<int> DStorage;
     std::vector<int> E; // for Euler tour sequence (size 2N-1)
     std::vector<int> L; // Level of nodes in tour sequence (size 2N-1)
-    int* H;
-    int **M;
+    std::vector<int> HStorage;
+    std::vector<int> MStorage;
+    std::string stringPool;
+
+    // point either into the storage vectors or into the memory mapped _taxonomy file
+    TaxonNode *taxonNodes;
+    int *D; // maps from taxID to node ID in taxonNodes
+    size_t taxIdCount;
+    int *tour;
+    int *tourLevel;
+    int *H; // first occurrence of a node in the tour
+    int *M; // sparse table, level j starts at j * tourLength
+    size_t tourLength;
+    unsigned int levels;
+    const char *strings;
+    size_t stringPoolSize;
     size_t maxNodes;
 
+    char *mappedData;
+    size_t mappedSize;
+
+    size_t sourceSize[3];
+    long long sourceTime[3];
 };
 
 #endif
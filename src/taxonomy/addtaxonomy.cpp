@@ -1,4 +1,5 @@
 #include "NcbiTaxonomy.h"
+#include "MappingReader.h"
 #include "Parameters.h"
 #include "DBWriter.h"
 #include "FileUtil.h"
@@ -11,23 +12,11 @@
 #endif
 
 
-static bool compareToFirstInt(const std::pair<unsigned int, unsigned int> &lhs, const std::pair<unsigned int, unsigned int> &rhs) {
-    return (lhs.first <= rhs.first);
-}
-
 int addtaxonomy(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
 
-    std::vector<std::pair<unsigned int, unsigned int>> mapping;
-    if (FileUtil::fileExists((par.db1 + "_mapping").c_str()) == false) {
-        Debug(Debug::ERROR) << par.db1 << "_mapping does not exist. Run createtaxdb to create taxonomy mapping.\n";
-        EXIT(EXIT_FAILURE);
-    }
-    const bool isSorted = Util::readMapping(par.db1 + "_mapping", mapping);
-    if (isSorted == false) {
-        std::stable_sort(mapping.begin(), mapping.end(), compareToFirstInt);
-    }
+    MappingReader mapping(par.db1 + "_mapping");
     if (mapping.size() == 0) {
         Debug(Debug::ERROR) << par.db1 << "_mapping is empty. Rerun createtaxdb to recreate taxonomy mapping.\n";
         EXIT(EXIT_FAILURE);
@@ -65,15 +54,13 @@ int addtaxonomy(int argc, const char **argv, const Command &command) {
             if (length == 1) {
                 continue;
             }
-            std::pair<unsigned int, unsigned int> val;
-            std::vector<std::pair<unsigned int, unsigned int> >::iterator mappingIt;
+            unsigned int taxon = MappingReader::NOT_FOUND;
             if (par.pickIdFrom == Parameters::EXTRACT_QUERY) {
-                val.first = key;
-                mappingIt = std::upper_bound(mapping.begin(), mapping.end(), val, compareToFirstInt);
-            }
-            if (mappingIt == mapping.end() || mappingIt->first != val.first) {
-                taxonNotFound++;
-                continue;
+                taxon = mapping.lookup(key);
+                if (taxon == MappingReader::NOT_FOUND) {
+                    taxonNotFound++;
+                    continue;
+                }
             }
 
             while (*data != '\0') {
@@ -85,15 +72,13 @@ int addtaxonomy(int argc, const char **argv, const Command &command) {
                 }
                 if (par.pickIdFrom == Parameters::EXTRACT_TARGET) {
                     unsigned int id = Util::fast_atoi<unsigned int>(entry[0]);
-                    val.first = id;
-                    mappingIt = std::upper_bound(mapping.begin(), mapping.end(), val, compareToFirstInt);
+                    taxon = mapping.lookup(id);
                 }
-                if (mappingIt == mapping.end() || mappingIt->first != val.first) {
+                if (taxon == MappingReader::NOT_FOUND) {
                     taxonNotFound++;
                     data = Util::skipLine(data);
                     continue;
                 }
-                unsigned int taxon = mappingIt->second;
                 TaxonNode const *node = t->taxonNode(taxon, false);
                 if (node == NULL) {
                     deletedNodes++;
@@ -103,7 +88,7 @@ int addtaxonomy(int argc, const char **argv, const Command &command) {
                 char *nextData = Util::skipLine(data);
                 size_t dataSize = nextData - data;
                 result.append(data, dataSize - 1);
-                result += '\t' + SSTR(node->taxId) + '\t' + node->rank + '\t' + node->name;
+                result += '\t' + SSTR(node->taxId) + '\t' + t->getString(node->rankIdx) + '\t' + t->getString(node->nameIdx);
                 if (!ranks.empty()) {
                     std::string lcaRanks = Util::implode(t->AtRanks(node, ranks), ';');
                     result += '\t' + lcaRanks;
@@ -60,7 +60,7 @@ TaxID selectTaxForSet (const std::vector<TaxID> &setTaxa, NcbiTaxonomy const *ta
         if (currPercent >= majorityCutoff) {
             TaxID currTaxId = it->first;
             TaxonNode const * node = taxonomy->taxonNode(currTaxId, false);
-            int currRankInd = NcbiTaxonomy::findRankIndex(node->rank);
+            int currRankInd = NcbiTaxonomy::findRankIndex(taxonomy->getString(node->rankIdx));
             if (currRankInd > 0) {
                 if ((currRankInd < minRank) || ((currRankInd == minRank) && (currPercent > selectedPercent))) {
                     selctedTaxon = currTaxId;
@@ -143,7 +143,7 @@ int aggregatetax(int argc, const char **argv, const Command& command) {
                     setTaxStr += '\t';
                 }
             } else {
-                setTaxStr = SSTR(node->taxId) + '\t' + node->rank + '\t' + node->name;
+                setTaxStr = SSTR(node->taxId) + '\t' + t->getString(node->rankIdx) + '\t' + t->getString(node->nameIdx);
                 if (!ranks.empty()) {
                     std::string lcaRanks = Util::implode(t->AtRanks(node, ranks), ';');
                     setTaxStr += '\t' + lcaRanks;
@@ -0,0 +1,14 @@
+#include "MappingReader.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+
+int createbintaxmapping(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    MappingReader mapping(par.db1, false);
+    mapping.writeBinary(par.db2);
+    Debug(Debug::INFO) << "Wrote binary taxonomy mapping with " << mapping.size() << " keys to " << par.db2 << "\n";
+    return EXIT_SUCCESS;
+}
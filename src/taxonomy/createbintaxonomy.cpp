@@ -0,0 +1,14 @@
+#include "NcbiTaxonomy.h"
+#include "Parameters.h"
+#include "Debug.h"
+#include "Util.h"
+
+int createbintaxonomy(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    NcbiTaxonomy taxonomy(par.db1, par.db2, par.db3);
+    taxonomy.writeBinary(par.db4);
+    Debug(Debug::INFO) << "Wrote binary taxonomy to " << par.db4 << "\n";
+    return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include "NcbiTaxonomy.h"
+#include "MappingReader.h"
 #include "Parameters.h"
 #include "DBWriter.h"
 #include "FileUtil.h"
@@ -12,24 +13,12 @@
 #include <omp.h>
 #endif
 
-static bool compareToFirstInt(const std::pair<unsigned int, unsigned int>& lhs, const std::pair<unsigned int, unsigned int>& rhs){
-    return (lhs.first <= rhs.first);
-}
-
 int filtertaxseqdb(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
     
     // open mapping (dbKey to taxid)
-    std::vector<std::pair<unsigned int, unsigned int>> mapping;
-    if (FileUtil::fileExists(std::string(par.db1 + "_mapping").c_str()) == false) {
-        Debug(Debug::ERROR) << par.db1 + "_mapping" << " does not exist. Please create the taxonomy mapping!\n";
-        EXIT(EXIT_FAILURE);
-    }
-    bool isSorted = Util::readMapping(par.db1 + "_mapping", mapping);
-    if (isSorted == false) {
-        std::stable_sort(mapping.begin(), mapping.end(), compareToFirstInt);
-    }
+    MappingReader mapping(par.db1 + "_mapping");
 
     // open taxonomy - evolutionary relationships amongst taxa
     NcbiTaxonomy * t = NcbiTaxonomy::openTaxonomy(par.db1);
@@ -61,17 +50,11 @@ int filtertaxseqdb(int argc, const char **argv, const Command& command) {
             unsigned int key = reader.getDbKey(i);
             size_t offset = reader.getOffset(i);
             size_t length = reader.getEntryLen(i);
-            unsigned int taxon = 0;
 
             // match dbKey to its taxon based on mapping
-            std::pair<unsigned int, unsigned int> val;
-            val.first = key;
-            std::vector<std::pair<unsigned int, unsigned int>>::iterator mappingIt;
-            mappingIt = std::upper_bound(mapping.begin(), mapping.end(), val, compareToFirstInt);
-            if (mappingIt == mapping.end() || mappingIt->first != val.first) {
+            unsigned int taxon = mapping.lookup(key);
+            if (taxon == MappingReader::NOT_FOUND) {
                 taxon = 0;
-            } else {
-                taxon = mappingIt->second;
             }
 
             // if taxon is an ancestor of the requested taxid, it will be retained
@@ -101,6 +84,11 @@ int filtertaxseqdb(int argc, const char **argv, const Command& command) {
     if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
         DBReader<unsigned int>::softlinkDb(par.db1, par.db2, DBFiles::SEQUENCE_NO_DATA_INDEX);
     } else {
+        // the copied entries are still compressed with the dictionary of the input
+        std::string dictionaryFile = DBReader<unsigned int>::getDictionaryFileName(par.db1);
+        if (isCompressed && FileUtil::fileExists(dictionaryFile.c_str())) {
+            FileUtil::copyFile(dictionaryFile.c_str(), DBReader<unsigned int>::getDictionaryFileName(par.db2).c_str());
+        }
         DBWriter::writeDbtypeFile(par.db2.c_str(), reader.getDbtype(), isCompressed);
         DBReader<unsigned int>::softlinkDb(par.db1, par.db2, DBFiles::SEQUENCE_ANCILLARY);
     }
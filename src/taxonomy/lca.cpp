@@ -1,4 +1,5 @@
 #include "NcbiTaxonomy.h"
+#include "MappingReader.h"
 #include "Parameters.h"
 #include "DBWriter.h"
 #include "FileUtil.h"
@@ -10,24 +11,12 @@
 #include <omp.h>
 #endif
 
-static bool compareToFirstInt(const std::pair<unsigned int, unsigned int>& lhs, const std::pair<unsigned int, unsigned int>&  rhs){
-    return (lhs.first <= rhs.first);
-}
-
 int lca(int argc, const char **argv, const Command& command) {
     Parameters& par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
     NcbiTaxonomy * t = NcbiTaxonomy::openTaxonomy(par.db1);
 
-    std::vector<std::pair<unsigned int, unsigned int>> mapping;
-    if(FileUtil::fileExists(std::string(par.db1 + "_mapping").c_str()) == false){
-        Debug(Debug::ERROR) << par.db1 + "_mapping" << " does not exist. Please create the taxonomy mapping!\n";
-        EXIT(EXIT_FAILURE);
-    }
-    bool isSorted = Util::readMapping( par.db1 + "_mapping", mapping);
-    if(isSorted == false){
-        std::stable_sort(mapping.begin(), mapping.end(), compareToFirstInt);
-    }
+    MappingReader mapping(par.db1 + "_mapping");
 
     DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
@@ -84,8 +73,6 @@ int lca(int argc, const char **argv, const Command& command) {
             while (*data != '\0') {
                 TaxID taxon;
                 unsigned int id;
-                std::pair<unsigned int, unsigned int> val;
-                std::vector<std::pair<unsigned int, unsigned int>>::iterator mappingIt;
                 const size_t columns = Util::getWordsOfLine(data, entry, 255);
                 data = Util::skipLine(data);
                 if (columns == 0) {
@@ -94,16 +81,14 @@ int lca(int argc, const char **argv, const Command& command) {
                 }
 
                 id = Util::fast_atoi<unsigned int>(entry[0]);
-                val.first = id;
-                mappingIt = std::upper_bound(mapping.begin(), mapping.end(), val, compareToFirstInt);
-
-                if (mappingIt == mapping.end() || mappingIt->first != val.first) {
+                unsigned int mappedTaxon = mapping.lookup(id);
+                if (mappedTaxon == MappingReader::NOT_FOUND) {
                     // TODO: Check which taxa were not found
                     taxonNotFound += 1;
                     continue;
                 }
                 found++;
-                taxon = mappingIt->second;
+                taxon = mappedTaxon;
 
                 // remove blacklisted taxa
                 bool isBlacklisted = false;
@@ -132,7 +117,7 @@ int lca(int argc, const char **argv, const Command& command) {
                 continue;
             }
 
-            resultData = SSTR(node->taxId) + '\t' + node->rank + '\t' + node->name;
+            resultData = SSTR(node->taxId) + '\t' + t->getString(node->rankIdx) + '\t' + t->getString(node->nameIdx);
             if (!ranks.empty()) {
                 std::string lcaRanks = Util::implode(t->AtRanks(node, ranks), ';');
                 resultData += '\t' + lcaRanks;
@@ -13,10 +13,6 @@
 #include <omp.h>
 #endif
 
-static bool compareToFirstInt(const std::pair<unsigned int, unsigned int>& lhs, const std::pair<unsigned int, unsigned int>&  rhs){
-    return (lhs.first <= rhs.first);
-}
-
 template<typename K, typename V>
 V at(const std::unordered_map<K, V>& map, K key, V default_value = V()) {
     typename std::unordered_map<K, V>::const_iterator it = map.find(key);
@@ -55,7 +51,7 @@ void taxReport(FILE* FP, const NcbiTaxonomy& taxDB, const std::unordered_map<Tax
         const TaxonNode* taxon = taxDB.taxonNode(taxID);
         fprintf(FP, "%.4f\t%i\t%i\t%s\t%i\t%s%s\n",
                 100*cladeCount/double(totalReads), cladeCount, taxCount,
-                taxon->rank.c_str(), taxID, std::string(2*depth, ' ').c_str(), taxon->name.c_str());
+                taxDB.getString(taxon->rankIdx), taxID, std::string(2*depth, ' ').c_str(), taxDB.getString(taxon->nameIdx));
 
         std::vector<TaxID> children = it->second.children;
         std::sort(children.begin(), children.end(), [&](int a, int b) { return cladeCountVal(cladeCounts, a) > cladeCountVal(cladeCounts,b); });
@@ -114,7 +110,7 @@ void kronaReport(FILE* FP, const NcbiTaxonomy& taxDB, const std::unordered_map<T
             return;
         }
         const TaxonNode* taxon = taxDB.taxonNode(taxID);
-        std::string escapedName = escapeAttribute(taxon->name);
+        std::string escapedName = escapeAttribute(taxDB.getString(taxon->nameIdx));
         fprintf(FP, "<node name=\"%s\"><magnitude><val>%d</val></magnitude>", escapedName.c_str(), cladeCount);
         std::vector<TaxID> children = it->second.children;
         std::sort(children.begin(), children.end(), [&](int a, int b) { return cladeCountVal(cladeCounts, a) > cladeCountVal(cladeCounts,b); });
@@ -136,17 +132,7 @@ int taxonomyreport(int argc, const char **argv, const Command& command) {
     // 1. Read taxonomy
     NcbiTaxonomy * taxDB = NcbiTaxonomy::openTaxonomy(par.db1);
 
-    std::vector<std::pair<unsigned int, unsigned int>> mapping;
-    if(FileUtil::fileExists(std::string(par.db1 + "_mapping").c_str()) == false){
-        Debug(Debug::ERROR) << par.db1 + "_mapping" << " does not exist. Please create the taxonomy mapping!\n";
-        EXIT(EXIT_FAILURE);
-    }
-    bool isSorted = Util::readMapping( par.db1 + "_mapping", mapping);
-    if(isSorted == false){
-        std::stable_sort(mapping.begin(), mapping.end(), compareToFirstInt);
-    }
-
-    DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), 1, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), par.threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
     // TODO: Better way to get file specified by param3?
@@ -157,20 +143,20 @@ int taxonomyreport(int argc, const char **argv, const Command& command) {
     Debug::Progress progress(reader.getSize());
     Debug(Debug::INFO) << "Reading LCA results\n";
 
-
-    std::unordered_map<TaxID, unsigned int> taxCounts;
-
-//  Currentlly not parallel
-//    #pragma omp parallel
+    // reads per TaxonNode::id, taxa outside of the taxonomy are counted separately
+    std::vector<unsigned int> nodeCounts(taxDB->getNodeCount(), 0);
+    std::unordered_map<TaxID, unsigned int> otherCounts;
+#pragma omp parallel
     {
         const char *entry[255];
-        //char buffer[1024];
         unsigned int thread_idx = 0;
 #ifdef OPENMP
         thread_idx = (unsigned int) omp_get_thread_num();
 #endif
+        std::vector<unsigned int> localNodeCounts(taxDB->getNodeCount(), 0);
+        std::unordered_map<TaxID, unsigned int> localOtherCounts;
 
-//        #pragma omp for schedule(dynamic, 10) reduction (+:taxonNotFound, found)
+#pragma omp for schedule(dynamic, 100)
         for (size_t i = 0; i < reader.getSize(); ++i) {
             progress.updateProgress();
 
@@ -180,18 +166,36 @@ int taxonomyreport(int argc, const char **argv, const Command& command) {
             if (columns == 0) {
                 Debug(Debug::WARNING) << "Empty entry: " << i << "!";
             } else {
-                int taxon = Util::fast_atoi<int>(entry[0]);
-                ++taxCounts[taxon];
-                //__sync_fetch_and_add(&(offsets[kmerIdx]), 1);
+                TaxID taxon = Util::fast_atoi<int>(entry[0]);
+                const TaxonNode *node = taxDB->taxonNode(taxon, false);
+                if (node == NULL) {
+                    ++localOtherCounts[taxon];
+                } else {
+                    ++localNodeCounts[node->id];
+                }
+            }
+        }
+
+#pragma omp critical
+        {
+            for (size_t j = 0; j < localNodeCounts.size(); ++j) {
+                nodeCounts[j] += localNodeCounts[j];
+            }
+            for (std::unordered_map<TaxID, unsigned int>::const_iterator it = localOtherCounts.begin(); it != localOtherCounts.end(); ++it) {
+                otherCounts[it->first] += it->second;
             }
         }
     };
     Debug(Debug::INFO) << "\n";
-    Debug(Debug::INFO) << "Found " << taxCounts.size() << " different taxa for " << reader.getSize() << " different reads.\n";
-    unsigned int unknownCnt = (taxCounts.find(0) != taxCounts.end()) ? taxCounts.at(0) : 0;
+    size_t taxaCount = otherCounts.size();
+    for (size_t j = 0; j < nodeCounts.size(); ++j) {
+        taxaCount += (nodeCounts[j] > 0);
+    }
+    Debug(Debug::INFO) << "Found " << taxaCount << " different taxa for " << reader.getSize() << " different reads.\n";
+    unsigned int unknownCnt = (otherCounts.find(0) != otherCounts.end()) ? otherCounts.at(0) : 0;
     Debug(Debug::INFO) << unknownCnt << " reads are unclassified.\n";
 
-    std::unordered_map<TaxID, TaxonCounts> cladeCounts = taxDB->getCladeCounts(taxCounts);
+    std::unordered_map<TaxID, TaxonCounts> cladeCounts = taxDB->getCladeCounts(nodeCounts, otherCounts);
     if (par.reportMode == 0) {
         taxReport(resultFP, *taxDB, cladeCounts, reader.getSize());
     } else {
@@ -11,6 +11,7 @@
 #include <cstring>
 #include <vector>
 #include <iostream>
+#include <random>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -22,6 +23,7 @@
 #include "ExtendedSubstitutionMatrix.h"
 #include "SubstitutionMatrix.h"
 #include "StripedSmithWaterman.h"
+#include "Timer.h"
 
 const char* binary_name = "test_alignmentperformance";
 
@@ -51,7 +53,76 @@ std::vector<std::string> readData(std::string fasta_filename){
     fclose(fasta_file);
     return retVec;
 }
-int main (int, const char**) {
+std::string randomSequence(std::mt19937 &rng, size_t length) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::uniform_int_distribution<int> aaDist(0, 19);
+    std::string seq(length, 'A');
+    for (size_t i = 0; i < length; i++) {
+        seq[i] = aa[aaDist(rng)];
+    }
+    return seq;
+}
+
+// copy of seq with the given fraction of substituted residues
+std::string mutateSequence(std::mt19937 &rng, const std::string &seq, double mutationRate) {
+    std::string mutated = randomSequence(rng, seq.size());
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    for (size_t i = 0; i < seq.size(); i++) {
+        if (dist(rng) >= mutationRate) {
+            mutated[i] = seq[i];
+        }
+    }
+    return mutated;
+}
+
+// Benchmark of the score width escalation of ssw_align: unrelated pairs stay in the byte kernel,
+// related pairs continue in the word kernel and long near identical pairs in the 32 bit kernel.
+void benchmarkScoreWidths(SubstitutionMatrix &subMat, int8_t *tinySubMat, int gap_open, int gap_extend) {
+    struct ScoreClass {
+        const char *name;
+        size_t length;
+        double mutationRate;
+        size_t pairs;
+    };
+    const ScoreClass classes[] = {
+        {"unrelated (8 bit)", 400, 1.0, 400},
+        {"related (8 -> 16 bit)", 400, 0.4, 400},
+        {"long related (8 -> 16 bit)", 4000, 0.4, 8},
+        {"long identical (8 -> 16 -> 32 bit)", 12000, 0.05, 2}
+    };
+    std::mt19937 rng(42);
+    const size_t maxLen = 12000;
+    Sequence query(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 6, false, false);
+    Sequence dbSeq(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 6, false, false);
+    SmithWaterman aligner(maxLen, subMat.alphabetSize, false);
+    EvalueComputation evalueComputation(100000, &subMat, gap_open, gap_extend);
+    for (size_t c = 0; c < sizeof(classes) / sizeof(classes[0]); c++) {
+        const ScoreClass &scoreClass = classes[c];
+        const std::string queryString = randomSequence(rng, scoreClass.length);
+        std::vector<std::string> targets;
+        for (size_t i = 0; i < scoreClass.pairs; i++) {
+            targets.push_back(mutateSequence(rng, queryString, scoreClass.mutationRate));
+        }
+        query.mapSequence(0, 0, queryString.c_str(), queryString.size());
+        aligner.ssw_init(&query, tinySubMat, &subMat, 2);
+
+        size_t cells = 0;
+        uint32_t minScore = UINT_MAX;
+        uint32_t maxScore = 0;
+        Timer timer;
+        for (size_t i = 0; i < targets.size(); i++) {
+            dbSeq.mapSequence(i, i, targets[i].c_str(), targets[i].size());
+            s_align alignment = aligner.ssw_align(dbSeq.numSequence, dbSeq.L, gap_open, gap_extend, 1, 10000, &evalueComputation, 0, 0.0, query.L / 2);
+            cells += query.L * dbSeq.L;
+            minScore = std::min(minScore, alignment.score1);
+            maxScore = std::max(maxScore, alignment.score1);
+        }
+        std::cout << scoreClass.name << ": scores " << minScore << "-" << maxScore << ", "
+                  << cells << " cells, " << timer.lap() << "\n";
+    }
+}
+
+int main (int argc, const char** argv) {
     const size_t kmer_size=6;
 
     Parameters& par = Parameters::getInstance();
@@ -83,7 +154,9 @@ int main (int, const char**) {
     int gap_extend = 1;
     int mode = 0;
     size_t cells = 0;
-    std::vector<std::string> sequences = readData("/Users/mad/Documents/databases/rfam/Rfam.fasta");
+    benchmarkScoreWidths(subMat, tinySubMat, gap_open, gap_extend);
+
+    std::vector<std::string> sequences = readData(argc > 1 ? argv[1] : "/Users/mad/Documents/databases/rfam/Rfam.fasta");
     for(size_t seq_i = 0; seq_i < sequences.size(); seq_i++){
         query->mapSequence(1,1,sequences[seq_i].c_str(), sequences[seq_i].size());
         aligner.ssw_init(query, tinySubMat, &subMat, 2);
@@ -0,0 +1,106 @@
+// Compares the scores and alignment positions of ssw_align, which starts with the 8 bit kernel and continues
+// with 16 and 32 bit scores, against a run that computes everything with the 32 bit kernel (score_size 3).
+// The pairs range from unrelated sequences that stay at 8 bit to long near identical ones that need 32 bit.
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Parameters.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "StripedSmithWaterman.h"
+#include "EvalueComputation.h"
+
+const char* binary_name = "test_alignmentscorewidth";
+
+std::string randomSequence(std::mt19937 &rng, const SubstitutionMatrix &subMat, size_t length) {
+    std::string sequence;
+    for (size_t i = 0; i < length; i++) {
+        sequence.push_back(subMat.num2aa[rng() % 20]);
+    }
+    return sequence;
+}
+
+// substitutions, insertions and deletions at rate
+std::string mutateSequence(std::mt19937 &rng, const SubstitutionMatrix &subMat, const std::string &sequence, double rate) {
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::string mutated;
+    for (size_t i = 0; i < sequence.size(); i++) {
+        const double event = dist(rng);
+        if (event < rate * 0.8) {
+            mutated += randomSequence(rng, subMat, 1);
+        } else if (event < rate * 0.9) {
+            mutated += sequence[i];
+            mutated += randomSequence(rng, subMat, 1 + rng() % 5);
+        } else if (event >= rate) {
+            mutated += sequence[i];
+        }
+    }
+    return mutated.empty() ? sequence : mutated;
+}
+
+int main (int, const char**) {
+    const size_t maxLength = 12000;
+    const int gapOpen = 11;
+    const int gapExtend = 1;
+    Parameters &par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, -0.2f);
+    int8_t *tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = static_cast<int8_t>(subMat.subMatrix[i][j]);
+        }
+    }
+    EvalueComputation evaluer(100000, &subMat, gapOpen, gapExtend);
+
+    Sequence query(maxLength * 2, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, false);
+    Sequence target(maxLength * 2, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, false);
+    SmithWaterman aligner(maxLength * 2, subMat.alphabetSize, true);
+    SmithWaterman alignerInt(maxLength * 2, subMat.alphabetSize, true);
+
+    std::mt19937 rng(42);
+    size_t compared = 0;
+    size_t errors = 0;
+    size_t scoreWidth[3] = {0, 0, 0};
+    for (size_t round = 0; round < 60; round++) {
+        // every tenth query is long enough to overflow 16 bit scores against its close mutants
+        const size_t queryLength = (round % 10 == 9) ? 8000 + rng() % 4000 : 10 + rng() % 1500;
+        const std::string querySequence = randomSequence(rng, subMat, queryLength);
+        query.mapSequence(round, round, querySequence.c_str(), querySequence.size());
+        aligner.ssw_init(&query, tinySubMat, &subMat, 2);
+        alignerInt.ssw_init(&query, tinySubMat, &subMat, 3);
+
+        for (size_t i = 0; i < 6; i++) {
+            std::string targetSequence;
+            if (i == 0) {
+                targetSequence = randomSequence(rng, subMat, 1 + rng() % maxLength / 4);
+            } else {
+                targetSequence = mutateSequence(rng, subMat, querySequence, 0.05 * (i - 1) + 0.01 * (rng() % 5));
+            }
+            target.mapSequence(i, i, targetSequence.c_str(), targetSequence.size());
+            // mode 1 also runs the reverse pass that finds the start positions
+            s_align alignment = aligner.ssw_align(target.numSequence, target.L, gapOpen, gapExtend, 1,
+                                                  10000, &evaluer, 0, 0.0, query.L / 2);
+            s_align alignmentInt = alignerInt.ssw_align(target.numSequence, target.L, gapOpen, gapExtend, 1,
+                                                        10000, &evaluer, 0, 0.0, query.L / 2);
+            compared++;
+            scoreWidth[(alignment.score1 < 255 - 20) ? 0 : (alignment.score1 < 32767 - 20) ? 1 : 2]++;
+            if (alignment.score1 != alignmentInt.score1 || alignment.score2 != alignmentInt.score2
+                || alignment.qStartPos1 != alignmentInt.qStartPos1 || alignment.qEndPos1 != alignmentInt.qEndPos1
+                || alignment.dbStartPos1 != alignmentInt.dbStartPos1 || alignment.dbEndPos1 != alignmentInt.dbEndPos1) {
+                std::cout << "Query " << round << " (length " << query.L << ") target " << i << " (length " << target.L << "): "
+                          << "score " << alignment.score1 << " vs. " << alignmentInt.score1 << ", "
+                          << "query " << alignment.qStartPos1 << "-" << alignment.qEndPos1 << " vs. " << alignmentInt.qStartPos1 << "-" << alignmentInt.qEndPos1 << ", "
+                          << "target " << alignment.dbStartPos1 << "-" << alignment.dbEndPos1 << " vs. " << alignmentInt.dbStartPos1 << "-" << alignmentInt.dbEndPos1 << std::endl;
+                errors++;
+            }
+        }
+    }
+    delete[] tinySubMat;
+
+    std::cout << compared << " pairs compared (" << scoreWidth[0] << " 8 bit, " << scoreWidth[1] << " 16 bit, "
+              << scoreWidth[2] << " 32 bit scores), " << errors << " differences" << std::endl;
+    // every score width has to be covered
+    return (errors == 0 && scoreWidth[0] > 0 && scoreWidth[1] > 0 && scoreWidth[2] > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,157 @@
+// Compares the diagonals scored by BatchDiagonalScorer with DistanceCalculator::computeUngappedAlignment.
+// The sequences contain lower case letters and letters outside of the profile columns, the number of diagonals
+// per query is not a multiple of the lanes, some queries have too few diagonals for the query profile.
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BatchDiagonalScorer.h"
+#include "DistanceCalculator.h"
+#include "NucleotideMatrix.h"
+#include "Parameters.h"
+#include "SubstitutionMatrix.h"
+
+const char* binary_name = "test_batchdiagonalscorer";
+
+std::string randomSequence(std::mt19937 &rng, const std::string &letters, size_t length) {
+    std::string sequence;
+    for (size_t i = 0; i < length; i++) {
+        sequence.push_back(letters[rng() % letters.size()]);
+    }
+    return sequence;
+}
+
+// mostly diagonals that overlap both sequences, some random ones that might not
+unsigned short randomDiagonal(std::mt19937 &rng, size_t queryLength, size_t targetLength) {
+    if (rng() % 10 == 0) {
+        return static_cast<unsigned short>(rng());
+    }
+    const int diagonal = static_cast<int>(rng() % (queryLength + targetLength - 1)) - static_cast<int>(targetLength - 1);
+    return static_cast<unsigned short>(diagonal);
+}
+
+size_t compareBatches(std::mt19937 &rng, const char **fastMatrix, int rescoreMode, const std::string &letters,
+                      size_t rounds, size_t &compared) {
+    const unsigned int lanes = BatchDiagonalScorer::LANES;
+    BatchDiagonalScorer scorer(fastMatrix, rescoreMode, 0, 0.0f);
+    size_t errors = 0;
+    for (size_t round = 0; round < rounds; round++) {
+        // a batch holds the targets of several queries
+        std::vector<std::string> queries;
+        std::vector<std::string> targets;
+        std::vector<size_t> targetQuery;
+        std::vector<unsigned short> diagonals;
+        const size_t queryCount = 1 + rng() % 3;
+        for (size_t q = 0; q < queryCount; q++) {
+            queries.push_back(randomSequence(rng, letters, 1 + rng() % 600));
+            size_t targetCount;
+            switch (rng() % 3) {
+                case 0:
+                    // too few diagonals for the query profile
+                    targetCount = 1 + rng() % (lanes / 2 - 1);
+                    break;
+                case 1:
+                    targetCount = lanes + 1 + rng() % (lanes - 1);
+                    break;
+                default:
+                    targetCount = lanes * (2 + rng() % 3) + 1 + rng() % (lanes - 1);
+                    break;
+            }
+            for (size_t i = 0; i < targetCount; i++) {
+                std::string target;
+                if (rng() % 2 == 0) {
+                    target = randomSequence(rng, letters, 1 + rng() % 800);
+                } else {
+                    // a copy of a part of the query with a few substitutions scores positive on its diagonal
+                    const std::string &query = queries[q];
+                    const size_t start = rng() % query.size();
+                    target = randomSequence(rng, letters, rng() % 50) + query.substr(start, 1 + rng() % (query.size() - start));
+                    for (size_t j = 0; j < target.size() / 5; j++) {
+                        target[rng() % target.size()] = letters[rng() % letters.size()];
+                    }
+                }
+                targets.push_back(target);
+                targetQuery.push_back(q);
+            }
+        }
+        // targets longer than 32768 can have more than one diagonal
+        if (round % 10 == 0) {
+            targets.push_back(randomSequence(rng, letters, 32768 + rng() % 40000));
+            targetQuery.push_back(0);
+        }
+
+        scorer.clearTargets();
+        for (size_t i = 0; i < targets.size(); i++) {
+            const std::string &query = queries[targetQuery[i]];
+            diagonals.push_back(randomDiagonal(rng, query.size(), targets[i].size()));
+            scorer.addTarget(query.c_str(), query.size(), targets[i].c_str(), targets[i].size(), diagonals[i], false, i % 2 == 0);
+        }
+        scorer.score();
+
+        for (size_t i = 0; i < targets.size(); i++) {
+            const std::string &query = queries[targetQuery[i]];
+            DistanceCalculator::LocalAlignment expected = DistanceCalculator::computeUngappedAlignment(
+                    query.c_str(), query.size(), targets[i].c_str(), targets[i].size(), diagonals[i], fastMatrix, rescoreMode);
+            const DistanceCalculator::LocalAlignment &result = scorer.getResult(i);
+            compared++;
+            // diagonals without a positive score are not set by either of them
+            if (result.score != expected.score || (expected.score > 0 && (result.diagonalLen != expected.diagonalLen
+                || result.distToDiagonal != expected.distToDiagonal || result.diagonal != expected.diagonal))) {
+                std::cout << "Mode " << rescoreMode << " round " << round << " target " << i << " (query length "
+                          << query.size() << ", target length " << targets[i].size() << ", diagonal " << diagonals[i] << "): "
+                          << "score " << result.score << " vs. " << expected.score << ", "
+                          << "diagonal " << result.diagonal << " vs. " << expected.diagonal << ", "
+                          << "length " << result.diagonalLen << " vs. " << expected.diagonalLen << std::endl;
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+int main (int, const char**) {
+    Parameters &par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, -0.2f);
+    NucleotideMatrix nuclMat(par.scoringMatrixFile.nucleotides, 1.0, 0.0f);
+    const int modes[] = { Parameters::RESCORE_MODE_SUBSTITUTION, Parameters::RESCORE_MODE_HAMMING };
+
+    // '*', '-' and digits are below the profile columns, lower case letters are above them if they do not
+    // score like their upper case letters
+    const std::string aminoAcids = "ACDEFGHIKLMNPQRSTVWYACDEFGHIKLMNPQRSTVWYXBZJUO";
+    const std::string aminoAcidLetters = aminoAcids + "acdefghiklmnpqrstvwyx*-0[`";
+    const std::string nucleotideLetters = "ACGTACGTACGTNacgtn*-";
+
+    std::mt19937 rng(42);
+    size_t compared = 0;
+    size_t errors = 0;
+
+    SubstitutionMatrix::FastMatrix fastMatrix = SubstitutionMatrix::createAsciiSubMat(subMat);
+    for (size_t i = 0; i < 2; i++) {
+        errors += compareBatches(rng, fastMatrix.matrix, modes[i], aminoAcidLetters, 30, compared);
+    }
+    // lower case letters use their own scores, so they can not share the columns of the upper case letters
+    char *lowerCaseData = new char[('z' + 1) * ('z' + 1)];
+    const char **lowerCaseMatrix = new const char *['z' + 1];
+    for (int i = 0; i <= 'z'; i++) {
+        lowerCaseMatrix[i] = lowerCaseData + i * ('z' + 1);
+        for (int j = 0; j <= 'z'; j++) {
+            lowerCaseData[i * ('z' + 1) + j] = fastMatrix.matrix[i][j] - ((i >= 'a') + (j >= 'a'));
+        }
+    }
+    errors += compareBatches(rng, lowerCaseMatrix, Parameters::RESCORE_MODE_SUBSTITUTION, aminoAcidLetters, 30, compared);
+    delete[] lowerCaseMatrix;
+    delete[] lowerCaseData;
+    delete[] fastMatrix.matrix;
+    delete[] fastMatrix.matrixData;
+
+    SubstitutionMatrix::FastMatrix nuclFastMatrix = SubstitutionMatrix::createAsciiSubMat(nuclMat);
+    for (size_t i = 0; i < 2; i++) {
+        errors += compareBatches(rng, nuclFastMatrix.matrix, modes[i], nucleotideLetters, 20, compared);
+    }
+    delete[] nuclFastMatrix.matrix;
+    delete[] nuclFastMatrix.matrixData;
+
+    std::cout << compared << " diagonals compared, " << errors << " differences" << std::endl;
+    return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Command.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+#include "Parameters.h"
+#include "QueryMatcher.h"
+#include "Util.h"
+
+const char* binary_name = "test_binaryprefilterdb";
+
+extern std::vector<Command> baseCommands;
+extern int filterdb(int argc, const char **argv, const Command& command);
+
+int main (int, const char**) {
+    DBWriter writer("dataBinaryPref", "dataBinaryPref.index", 1, Parameters::WRITER_ASCII_MODE,
+                    Parameters::DBTYPE_PREFILTER_RES | Parameters::DBTYPE_BINARY_FLAG);
+    writer.open();
+    std::vector<hit_t> written;
+    char buffer[1024];
+    for (unsigned int key = 0; key < 10; key++) {
+        writer.writeStart(0);
+        for (unsigned int i = 0; i < 5; i++) {
+            hit_t hit;
+            hit.seqId = key * 10 + i;
+            // null bytes and newlines inside the records must not matter
+            hit.prefScore = (i == 0) ? 0 : static_cast<int>('\n');
+            hit.diagonal = static_cast<unsigned short>(key * i);
+            written.push_back(hit);
+            size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hit, true);
+            writer.writeAdd(buffer, len, 0);
+        }
+        writer.writeEnd(key, 0);
+    }
+    writer.close();
+
+    // modules that understand binary records read them back unchanged
+    DBReader<unsigned int> reader("dataBinaryPref", "dataBinaryPref.index", 1,
+                                  DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_BINARY);
+    reader.open(DBReader<unsigned int>::NOSORT);
+    std::vector<hit_t> read;
+    for (size_t i = 0; i < reader.getSize(); i++) {
+        QueryMatcher::readPrefilterHits(reader, i, 0, read);
+    }
+    reader.close();
+    if (read.size() != written.size()) {
+        std::cout << "Read " << read.size() << " hits, expected " << written.size() << std::endl;
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < read.size(); i++) {
+        if (read[i].seqId != written[i].seqId || read[i].prefScore != written[i].prefScore || read[i].diagonal != written[i].diagonal) {
+            std::cout << "Hit " << i << " differs" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "Read " << read.size() << " binary hits" << std::endl;
+
+    // text-only modules have to refuse the database instead of parsing the records as text
+    const Command *command = NULL;
+    for (size_t i = 0; i < baseCommands.size(); i++) {
+        if (strcmp(baseCommands[i].cmd, "filterdb") == 0) {
+            command = &baseCommands[i];
+        }
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        const char *argv[] = { "dataBinaryPref", "dataBinaryPrefFiltered", "--extract-lines", "1" };
+        filterdb(4, argv, *command);
+        _exit(EXIT_SUCCESS);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFEXITED(status) == false || WEXITSTATUS(status) == EXIT_SUCCESS) {
+        std::cout << "filterdb accepted a binary prefilter database" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "filterdb refused the binary prefilter database" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+// Compares the union-find connected component clustering with a breadth first search that follows the
+// original cluster mode 3 on asymmetric alignment results: hits that are only found in one direction,
+// entries without a hit to themselves and entries without any hit. Small --max-iterations values cut
+// long chains, so the clustering has to fall back to the breadth first search.
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <set>
+#include <queue>
+#include <algorithm>
+#include <string>
+
+#include "ClusteringAlgorithms.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+#include "Util.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_connectedcomponent";
+
+typedef std::vector<std::vector<unsigned int>> Graph;
+
+void writeGraph(const Graph &hits, const std::string &name) {
+    DBWriter seqWriter((name + "Seq").c_str(), (name + "Seq.index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_GENERIC_DB);
+    seqWriter.open();
+    DBWriter alnWriter((name + "Aln").c_str(), (name + "Aln.index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_ALIGNMENT_RES);
+    alnWriter.open();
+    std::string result;
+    char buffer[256];
+    for (size_t i = 0; i < hits.size(); i++) {
+        seqWriter.writeData("", 0, i, 0);
+        result.clear();
+        for (size_t j = 0; j < hits[i].size(); j++) {
+            snprintf(buffer, sizeof(buffer), "%u\t100\t0.900\t0\n", hits[i][j]);
+            result.append(buffer);
+        }
+        alnWriter.writeData(result.c_str(), result.size(), i, 0);
+    }
+    alnWriter.close();
+    seqWriter.close();
+}
+
+std::vector<unsigned int> cluster(const std::string &name, int maxIterations) {
+    int threads = 1;
+#ifdef OPENMP
+    threads = omp_get_max_threads();
+#endif
+    DBReader<unsigned int> seqDbr((name + "Seq").c_str(), (name + "Seq.index").c_str(), threads, DBReader<unsigned int>::USE_INDEX);
+    seqDbr.open(DBReader<unsigned int>::NOSORT);
+    DBReader<unsigned int> alnDbr((name + "Aln").c_str(), (name + "Aln.index").c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    alnDbr.open(DBReader<unsigned int>::NOSORT);
+    ClusteringAlgorithms algorithm(&seqDbr, &alnDbr, threads, Parameters::APC_SEQID, maxIterations);
+    std::unordered_map<unsigned int, std::vector<unsigned int>> clusters = algorithm.execute(3);
+    std::vector<unsigned int> assignment(seqDbr.getSize(), UINT_MAX);
+    for (std::unordered_map<unsigned int, std::vector<unsigned int>>::const_iterator it = clusters.begin(); it != clusters.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            assignment[it->second[i]] = it->first;
+        }
+    }
+    alnDbr.close();
+    seqDbr.close();
+    return assignment;
+}
+
+// symmetric element lists, largest list first with ties going to the higher id, and a depth limited search
+std::vector<unsigned int> breadthFirstSearch(const Graph &hits, int maxIterations) {
+    const size_t size = hits.size();
+    std::vector<std::set<unsigned int>> elements(size);
+    for (unsigned int i = 0; i < size; i++) {
+        if (hits[i].empty()) {
+            elements[i].insert(i);
+        }
+        for (size_t j = 0; j < hits[i].size(); j++) {
+            elements[i].insert(hits[i][j]);
+            elements[hits[i][j]].insert(i);
+        }
+    }
+    std::vector<std::pair<size_t, unsigned int>> order;
+    for (unsigned int i = 0; i < size; i++) {
+        order.push_back(std::make_pair(elements[i].size(), i));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    std::vector<unsigned int> assignment(size, UINT_MAX);
+    for (size_t i = 0; i < order.size(); i++) {
+        const unsigned int representative = order[i].second;
+        if (assignment[representative] != UINT_MAX) {
+            continue;
+        }
+        assignment[representative] = representative;
+        std::queue<std::pair<unsigned int, int>> queue;
+        queue.push(std::make_pair(representative, 0));
+        while (queue.empty() == false) {
+            const std::pair<unsigned int, int> curr = queue.front();
+            queue.pop();
+            assignment[curr.first] = representative;
+            for (std::set<unsigned int>::const_iterator it = elements[curr.first].begin(); it != elements[curr.first].end(); ++it) {
+                if (assignment[*it] == UINT_MAX && curr.second < maxIterations) {
+                    queue.push(std::make_pair(*it, curr.second + 1));
+                }
+                assignment[*it] = representative;
+            }
+        }
+    }
+    return assignment;
+}
+
+size_t compare(const Graph &hits, const std::string &description, int maxIterations) {
+    writeGraph(hits, "connectedComponent");
+    const std::vector<unsigned int> result = cluster("connectedComponent", maxIterations);
+    const std::vector<unsigned int> expected = breadthFirstSearch(hits, maxIterations);
+    size_t differences = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+        differences += (result[i] != expected[i]);
+    }
+    std::cout << description << " (--max-iterations " << maxIterations << "): " << differences << " differences" << std::endl;
+    return differences;
+}
+
+// random hits, most of them only in one direction
+Graph randomGraph(std::mt19937 &rng, unsigned int size, unsigned int hitsPerEntry) {
+    Graph hits(size);
+    for (unsigned int i = 0; i < size; i++) {
+        if (rng() % 10 == 0) {
+            continue;
+        }
+        std::set<unsigned int> targets;
+        if (rng() % 4 != 0) {
+            targets.insert(i);
+        }
+        const unsigned int count = rng() % (hitsPerEntry + 1);
+        for (unsigned int j = 0; j < count; j++) {
+            const unsigned int target = rng() % size;
+            targets.insert(target);
+            if (rng() % 3 == 0) {
+                hits[target].push_back(i);
+            }
+        }
+        hits[i].insert(hits[i].end(), targets.begin(), targets.end());
+    }
+    for (unsigned int i = 0; i < size; i++) {
+        std::sort(hits[i].begin(), hits[i].end());
+        hits[i].erase(std::unique(hits[i].begin(), hits[i].end()), hits[i].end());
+    }
+    return hits;
+}
+
+// chains whose hits only point to the next member, with a star in the middle that has the most hits
+Graph chainGraph(unsigned int chains, unsigned int length, unsigned int leaves) {
+    Graph hits;
+    for (unsigned int c = 0; c < chains; c++) {
+        const unsigned int start = hits.size();
+        hits.resize(start + length + leaves);
+        for (unsigned int i = start; i + 1 < start + length; i++) {
+            hits[i].push_back(i + 1);
+        }
+        const unsigned int center = start + length / 2;
+        for (unsigned int i = start + length; i < start + length + leaves; i++) {
+            hits[i].push_back(center);
+        }
+    }
+    return hits;
+}
+
+int main (int, const char**) {
+    std::mt19937 rng(42);
+    size_t differences = 0;
+    for (unsigned int round = 0; round < 10; round++) {
+        const Graph hits = randomGraph(rng, 500 + rng() % 5000, 1 + round % 4);
+        differences += compare(hits, "Random graph " + SSTR(round), 1000);
+        differences += compare(hits, "Random graph " + SSTR(round), 2);
+    }
+    const Graph sparse = randomGraph(rng, 20000, 1);
+    differences += compare(sparse, "Sparse random graph", 1000);
+    differences += compare(sparse, "Sparse random graph", 5);
+
+    const Graph chains = chainGraph(20, 41, 30);
+    differences += compare(chains, "Chains", 1000);
+    differences += compare(chains, "Chains", 20);
+    differences += compare(chains, "Chains", 19);
+    differences += compare(chains, "Chains", 18);
+    differences += compare(chains, "Chains", 3);
+    differences += compare(chains, "Chains", 0);
+
+    std::cout << differences << " differences" << std::endl;
+    return (differences == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
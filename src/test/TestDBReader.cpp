@@ -55,4 +55,19 @@ int main (int, const char**) {
     std::cout << reader3.getId(3) << "\t" <<  reader3.getDataByDBKey(3,0);
     std::cout << reader3.getId(4) << "\t" <<  reader3.getDataByDBKey(4,0);
     std::cout << reader3.getId(5) << "\t" <<   reader3.getDataByDBKey(5,0);
+    size_t textSize = reader3.getSize();
+    reader3.close();
+    // binary index has to give the same entries as the text index
+    DBWriter::convertIndex("dataGap.index", "dataGapBinary.index", true);
+    std::cout << "Check binary index: " << DBReader<unsigned int>::isBinaryIndexFile("dataGapBinary.index") << std::endl;
+    DBReader<unsigned int> reader4("dataGap", "dataGapBinary.index", 1, 0);
+    reader4.open(DBReader<unsigned int>::SORT_BY_LENGTH);
+    std::cout << "Check binary size: " << (reader4.getSize() == textSize) << std::endl;
+    for(size_t i = 0; i < reader4.getSize(); i++){
+        std::cout << reader4.getDbKey(i) <<  "\t" << reader4.getSeqLen(i) << "\t" << reader4.getData(i, 0);
+    }
+    std::cout << "Check binary getId: " << reader4.getId(111) << "\t" << reader4.getDataByDBKey(111,0);
+    reader4.close();
+    DBWriter::convertIndex("dataGapBinary.index", "dataGapText.index", false);
+    std::cout << "Check text index: " << (DBReader<unsigned int>::isBinaryIndexFile("dataGapText.index") == false) << std::endl;
 }
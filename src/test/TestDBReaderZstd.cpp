@@ -10,6 +10,8 @@
 #include "DBReader.h"
 #include "DBWriter.h"
 #include "Parameters.h"
+#include "FileUtil.h"
+#include "Util.h"
 
 const char* binary_name = "test_dbreader_zlib";
 
@@ -127,7 +129,7 @@ int main (int, const char**) {
 
     writer.writeData((char*)data,strlen(data), 1,0);
     writer.close();
-    DBReader<unsigned int> reader("dataLinear", "dataLinear.index", 1, 0);
+    DBReader<unsigned int> reader("dataLinear", "dataLinear.index", 1, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
     reader.open(0);
     reader.readMmapedDataInMemory();
     reader.printMagicNumber();
@@ -138,4 +140,26 @@ int main (int, const char**) {
     }
     reader.close();
 
+    // enough similar entries to train a shared dictionary
+    DBWriter dictWriter("dataDict", "dataDict.index", 1, Parameters::WRITER_COMPRESSED_MODE, Parameters::DBTYPE_GENERIC_DB);
+    dictWriter.open();
+    std::vector<std::string> entries;
+    for (size_t i = 0; i < 5000; i++) {
+        std::string entry = "sp|P" + SSTR(10000 + i * 7) + "|PROT" + SSTR(i % 97) + "_HUMAN Protein " + SSTR(i * 31 % 1009)
+                            + " OS=Homo sapiens OX=9606 GN=G" + SSTR(i % 13) + " PE=1 SV=" + SSTR(i % 3);
+        entries.push_back(entry);
+        dictWriter.writeData(entry.c_str(), entry.size(), i, 0);
+    }
+    dictWriter.close();
+    std::cout << "Dictionary " << FileUtil::fileExists(DBReader<unsigned int>::getDictionaryFileName("dataDict").c_str()) << std::endl;
+    DBReader<unsigned int> dictReader("dataDict", "dataDict.index", 1, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    dictReader.open(DBReader<unsigned int>::NOSORT);
+    for (size_t i = 0; i < dictReader.getSize(); i++) {
+        if (entries[dictReader.getDbKey(i)] != dictReader.getData(i, 0)) {
+            std::cout << "Entry " << dictReader.getDbKey(i) << " differs" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << dictReader.getSize() << " entries, " << FileUtil::getFileSize("dataDict") << " bytes" << std::endl;
+    dictReader.close();
 }
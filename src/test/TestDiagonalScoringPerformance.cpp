@@ -1,124 +1,115 @@
+// Benchmark of the UngappedAlignment diagonal scoring kernels on random sequences.
+// Every kernel supported by the machine scores the same hits, reports scored cells per second
+// and is checked against the scores of the portable SIMD kernel.
 #include <iostream>
-#include <list>
-#include <algorithm>
-#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
 
 #include "SequenceLookup.h"
 #include "SubstitutionMatrix.h"
 #include "UngappedAlignment.h"
-#include "ExtendedSubstitutionMatrix.h"
-#include "FileUtil.h"
-
-#include "kseq.h"
-#include <unistd.h> // read
-
-KSEQ_INIT(int, read)
-
-#include "Clustering.h"
-#include "DBReader.h"
-#include "DBWriter.h"
 #include "Parameters.h"
+#include "Timer.h"
 
 const char* binary_name = "test_diagonalscoringperformance";
 
-int main (int, const char**) {
-    size_t kmer_size = 6;
-    Parameters& par = Parameters::getInstance();
-    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 8.0, 0.0);
-    SubstitutionMatrix::print(subMat.subMatrix,subMat.num2aa,subMat.alphabetSize);
-
-    std::string S1 = "AYIAKQRQISFVKSHFSRQLEERLGLIEVQAPILSRVGDGTQDNLSGAEKAVQVKVKALPDAQFEVVHSLAKWKRQTLGQHDFSAGEGLYTHMKALRPDEDRLSPLHSVYVDQWDWERVMGDGERQFSTLKSTVEAIWAGIKATEAAVSEEFGLAPFLPDQIHFVHSQELLSRYPDLDAKGRERAIAKDLGAVFLVGIGGKLSDGHRHDVRAPDYDDWSTPSELGHAGLNGDILVWNPVLEDAFELSSMGIRVDADTLKHQLALTGDEDRLELEWHQALLRGEMPQTIGGGIGQSRLTMLLLQLPHIGQVQAGVWPAAVRESVPSLL";
-    const char* S1char = S1.c_str();
-//    std::cout << S1char << "\n\n";
-    Sequence s1(10000,  0, &subMat, kmer_size, true, false);
-    s1.mapSequence(0,0,S1char, S1.size());
-
-    std::string S2 = "MLKIRYSSAFKKDLKPFQHDKSAISVINTVLKLLATGKPLPREYKEHSLKGDYIGYLECHGKPDLLLIYKRTEQEVFLYRVGSHAKLF";
-    const char* S2char = S2.c_str();
-//    std::cout << S2char << "\n\n";
-    Sequence s2(10000,  0, &subMat, kmer_size, true, false);
-    s2.mapSequence(0,0,S2char, S2.size());
-
-    FILE *fasta_file = FileUtil::openFileOrDie("/Users/mad/Documents/databases/mmseqs_benchmark/benchmarks/clustering_benchmark/db/db_full.fas", "r", true);
-    kseq_t *seq = kseq_init(fileno(fasta_file));
-    size_t dbEntrySize = 0;
-    size_t dbCnt = 0;
-    while (kseq_read(seq) >= 0) {
-        dbEntrySize += seq->seq.l;
-        dbCnt += 1;
+std::string randomSequence(std::mt19937 &rng, size_t length) {
+    const char *aa = "ACDEFGHIKLMNPQRSTVWY";
+    std::uniform_int_distribution<int> aaDist(0, 19);
+    std::string seq(length, 'A');
+    for (size_t i = 0; i < length; i++) {
+        seq[i] = aa[aaDist(rng)];
     }
-    SequenceLookup lookup(dbCnt*10, dbEntrySize*10);
-    //kseq_destroy(seq);
-    Sequence dbSeq(40000,  0, &subMat, kmer_size, true, false);
-    size_t id = 0;
-    size_t maxLen = 0;
-    for(size_t i = 0; i < 10; i++){
-        fclose(fasta_file);
-        fasta_file = FileUtil::openFileOrDie("/Users/mad/Documents/databases/mmseqs_benchmark/benchmarks/clustering_benchmark/db/db_full.fas", "r", true);
-        kseq_rewind(seq);
-        while (kseq_read(seq) >= 0) {
-            dbSeq.mapSequence(id,id,seq->seq.s, seq->seq.l);
-            maxLen = std::max(seq->seq.l, maxLen);
-//        if(id == 202423){
-//            std::cout << seq->seq.s << std::endl;
-//        }
-            lookup.addSequence(&dbSeq);
+    return seq;
+}
 
-            id += 1;
-        }
+int main (int argc, const char** argv) {
+    size_t hitCount = 100000;
+    size_t repeats = 20;
+    if (argc > 1) {
+        hitCount = strtoull(argv[1], NULL, 10);
     }
-    kseq_destroy(seq);
-    std::cout << maxLen << std::endl;
-    UngappedAlignment matcher(maxLen, &subMat, &lookup);
-    CounterResult hits[16000];
-    hits[0].id =142424;
-    hits[0].diagonal = 50;
-    hits[1].id = 191382;
-    hits[1].diagonal = 4;
-    hits[2].id = 135950;
-    hits[2].diagonal = 4;
-    hits[3].id = 63969;
-    hits[3].diagonal = 4;
-    hits[4].id = 244188;
-    hits[4].diagonal = 4;
-
-    for(size_t i = 5; i < 16; i++) {
-        hits[i].id = 159147;
-        hits[i].diagonal = 31;
+    if (argc > 2) {
+        repeats = strtoull(argv[2], NULL, 10);
     }
+    const size_t dbCount = 20000;
+    const size_t queryLen = 350;
 
-    float * compositionBias = new float[s1.L];
-    SubstitutionMatrix::calcLocalAaBiasCorrection(&subMat, s1.numSequence, s1.L, compositionBias);
-
-
-
-    matcher.processQuery(&s1,compositionBias, hits, 16);
-    std::cout << (int)hits[0].count << " ";
-    std::cout << (int)hits[1].count << " ";
-    std::cout << (int)hits[2].count << " ";
-    std::cout << (int)hits[3].count << std::endl;
+    Parameters& par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, 0.0);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> lenDist(50, 600);
+    std::vector<std::string> dbSeqs;
+    size_t dbResidues = 0;
+    size_t maxLen = queryLen;
+    for (size_t i = 0; i < dbCount; i++) {
+        dbSeqs.push_back(randomSequence(rng, lenDist(rng)));
+        dbResidues += dbSeqs.back().size();
+        maxLen = std::max(maxLen, dbSeqs.back().size());
+    }
+    SequenceLookup lookup(dbCount, dbResidues);
+    Sequence dbSeq(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 6, false, false);
+    for (size_t i = 0; i < dbCount; i++) {
+        dbSeq.mapSequence(i, i, dbSeqs[i].c_str(), dbSeqs[i].size());
+        lookup.addSequence(&dbSeq);
+    }
 
-    matcher.processQuery(&s1, compositionBias, hits, 1);
-    matcher.processQuery(&s1, compositionBias, hits + 1, 1);
-    matcher.processQuery(&s1, compositionBias, hits + 2, 1);
-    matcher.processQuery(&s1, compositionBias, hits + 3, 1);
+    std::string queryString = randomSequence(rng, queryLen);
+    Sequence query(maxLen, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 6, false, false);
+    query.mapSequence(0, 0, queryString.c_str(), queryString.size());
+    float *compositionBias = new float[query.L];
+    SubstitutionMatrix::calcLocalAaBiasCorrection(&subMat, query.numSequence, query.L, compositionBias);
+
+    // diagonals that overlap the query, cells are the number of residue pairs on the diagonal
+    std::vector<CounterResult> hits(hitCount);
+    size_t cells = 0;
+    for (size_t i = 0; i < hitCount; i++) {
+        hits[i].id = static_cast<unsigned int>(rng() % dbCount);
+        const int targetLen = static_cast<int>(dbSeqs[hits[i].id].size());
+        const int diagonal = static_cast<int>(rng() % (queryLen + targetLen - 1)) - (targetLen - 1);
+        hits[i].diagonal = static_cast<unsigned short>(diagonal);
+        hits[i].count = 0;
+        cells += (diagonal >= 0) ? std::min(static_cast<int>(queryLen) - diagonal, targetLen)
+                                 : std::min(targetLen + diagonal, static_cast<int>(queryLen));
+    }
 
-    std::cout << (int)hits[0].count<< " ";
-    std::cout << (int)hits[1].count<< " ";
-    std::cout << (int)hits[2].count<< " ";
-    std::cout << (int)hits[3].count<< std::endl;
-    for(size_t i = 0; i < 10000; i++){
-        for(int j = 1; j < 16000; j++){
-            hits[j].id = rand()%dbCnt;
-            hits[j].diagonal =  rand()%s1.L;
+    const int kernels[] = { UngappedAlignment::KERNEL_SIMD, UngappedAlignment::KERNEL_SSE41,
+                            UngappedAlignment::KERNEL_AVX2, UngappedAlignment::KERNEL_AVX512BW };
+    std::vector<CounterResult> reference;
+    bool ok = true;
+    std::cout << "Scoring " << hitCount << " hits " << repeats << " times, " << cells << " cells per run\n";
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (UngappedAlignment::isKernelSupported(kernels[k]) == false) {
+            std::cout << UngappedAlignment::getKernelName(kernels[k]) << "\tnot supported\n";
+            continue;
         }
-        //   std::reverse(hits, hits+1000);
-        matcher.processQuery(&s1, compositionBias, hits, 16000);
-    }
-//    std::cout << ExtendedSubstitutionMatrix::calcScore(s1.sequence, s1.sequence,s1.L, subMat.subMatrix) << " " << (int)hits[0].diagonalScore <<  std::endl;
-//    std::cout << (int)hits[0].diagonalScore <<  std::endl;
-    for(int i = 0; i < 1000; i++){
-        std::cout << hits[i].id << "\t" << (int) hits[i].diagonal  << "\t" << (int)hits[i].count <<  std::endl;
+        UngappedAlignment matcher(maxLen, &subMat, &lookup, kernels[k]);
+        std::vector<CounterResult> results;
+        Timer timer;
+        for (size_t r = 0; r < repeats; r++) {
+            results = hits;
+            matcher.processQuery(&query, compositionBias, results.data(), results.size());
+        }
+        const double seconds = timer.getTimediff();
+        bool equal = true;
+        if (reference.empty()) {
+            reference = results;
+        } else {
+            for (size_t i = 0; i < hitCount; i++) {
+                if (reference[i].count != results[i].count) {
+                    std::cout << "Mismatch at hit " << i << ": " << (int) reference[i].count << " != " << (int) results[i].count << "\n";
+                    equal = false;
+                    break;
+                }
+            }
+        }
+        ok &= equal;
+        std::cout << UngappedAlignment::getKernelName(kernels[k]) << "\tlanes: " << matcher.getLanes()
+                  << "\ttime: " << seconds << "s\tGCells/s: " << (cells * repeats) / seconds / 1e9
+                  << "\t" << (equal ? "OK" : "FAILED") << "\n";
     }
-    delete [] compositionBias;
+    delete[] compositionBias;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
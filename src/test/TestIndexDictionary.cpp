@@ -0,0 +1,109 @@
+// Builds a precomputed index over a sequence and header database that are compressed with a shared zstd
+// dictionary and checks that the readers opened from the index return the original entries.
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "FileUtil.h"
+#include "Parameters.h"
+#include "PrefilteringIndexReader.h"
+#include "SubstitutionMatrix.h"
+#include "Util.h"
+
+const char* binary_name = "test_indexdictionary";
+
+bool compareEntries(const char *name, DBReader<unsigned int> *reader, const std::vector<std::string> &entries) {
+    if (reader == NULL || reader->getSize() != entries.size()) {
+        std::cout << name << ": wrong number of entries" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < reader->getSize(); i++) {
+        const unsigned int key = reader->getDbKey(i);
+        if (entries[key] != reader->getData(i, 0)) {
+            std::cout << name << ": entry " << key << " differs" << std::endl;
+            return false;
+        }
+    }
+    std::cout << name << ": " << entries.size() << " entries OK" << std::endl;
+    return true;
+}
+
+int main (int, const char**) {
+    Parameters &par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, -0.2f);
+
+    // mutated copies of a few seed sequences compress well enough to train a dictionary
+    std::mt19937 rng(42);
+    std::vector<std::string> seeds;
+    for (size_t i = 0; i < 20; i++) {
+        std::string seed;
+        for (size_t j = 0; j < 200 + rng() % 200; j++) {
+            seed.push_back(subMat.num2aa[rng() % 20]);
+        }
+        seeds.push_back(seed);
+    }
+    std::vector<std::string> sequences;
+    std::vector<std::string> headers;
+    DBWriter seqWriter("dataIndexDict", "dataIndexDict.index", 1, Parameters::WRITER_COMPRESSED_MODE, Parameters::DBTYPE_AMINO_ACIDS);
+    seqWriter.open();
+    DBWriter headerWriter("dataIndexDict_h", "dataIndexDict_h.index", 1, Parameters::WRITER_COMPRESSED_MODE, Parameters::DBTYPE_GENERIC_DB);
+    headerWriter.open();
+    for (unsigned int key = 0; key < 5000; key++) {
+        std::string sequence = seeds[key % seeds.size()];
+        for (size_t j = 0; j < sequence.size() / 10; j++) {
+            sequence[rng() % sequence.size()] = subMat.num2aa[rng() % 20];
+        }
+        sequence.push_back('\n');
+        sequences.push_back(sequence);
+        seqWriter.writeData(sequence.c_str(), sequence.size(), key, 0);
+        std::string header = "sp|P" + SSTR(10000 + key * 7) + "|PROT" + SSTR(key % 97) + "_HUMAN Protein " + SSTR(key * 31 % 1009)
+                             + " OS=Homo sapiens OX=9606 GN=G" + SSTR(key % 13) + " PE=1 SV=" + SSTR(key % 3) + "\n";
+        headers.push_back(header);
+        headerWriter.writeData(header.c_str(), header.size(), key, 0);
+    }
+    seqWriter.close(true);
+    headerWriter.close(true);
+    if (FileUtil::fileExists(DBReader<unsigned int>::getDictionaryFileName("dataIndexDict").c_str()) == false
+        || FileUtil::fileExists(DBReader<unsigned int>::getDictionaryFileName("dataIndexDict_h").c_str()) == false) {
+        std::cout << "No dictionary was trained" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    DBReader<unsigned int> dbr("dataIndexDict", "dataIndexDict.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    dbr.open(DBReader<unsigned int>::NOSORT);
+    DBReader<unsigned int> hdbr("dataIndexDict_h", "dataIndexDict_h.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    hdbr.open(DBReader<unsigned int>::NOSORT);
+    PrefilteringIndexReader::createIndexFile("dataIndexDict.idx", &dbr, NULL, &hdbr, NULL, &subMat, par.maxSeqLen,
+                                             false, "", true, subMat.alphabetSize, 6, 0, 0, 0, 1, false);
+    hdbr.close();
+    dbr.close();
+    // the index has to work without the dictionary files next to the databases
+    FileUtil::remove(DBReader<unsigned int>::getDictionaryFileName("dataIndexDict").c_str());
+    FileUtil::remove(DBReader<unsigned int>::getDictionaryFileName("dataIndexDict_h").c_str());
+
+    DBReader<unsigned int> index("dataIndexDict.idx", "dataIndexDict.idx.index", 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    index.open(DBReader<unsigned int>::NOSORT);
+    bool ok = PrefilteringIndexReader::checkIfIndexFile(&index);
+    DBReader<unsigned int> *seqReader = PrefilteringIndexReader::openNewReader(&index, PrefilteringIndexReader::DBR1DATA,
+                                                                               PrefilteringIndexReader::DBR1INDEX, true, 1, false, false);
+    ok &= compareEntries("DBR1", seqReader, sequences);
+    // without a second database DBR2 and HDR2 point to the entries of the first one
+    DBReader<unsigned int> *srcReader = PrefilteringIndexReader::openNewReader(&index, PrefilteringIndexReader::DBR2DATA,
+                                                                               PrefilteringIndexReader::DBR2INDEX, true, 1, false, false);
+    ok &= compareEntries("DBR2", srcReader, sequences);
+    DBReader<unsigned int> *headerReader = PrefilteringIndexReader::openNewHeaderReader(&index, PrefilteringIndexReader::HDR1DATA,
+                                                                                        PrefilteringIndexReader::HDR1INDEX, 1, false, false);
+    ok &= compareEntries("HDR1", headerReader, headers);
+    DBReader<unsigned int> *srcHeaderReader = PrefilteringIndexReader::openNewHeaderReader(&index, PrefilteringIndexReader::HDR2DATA,
+                                                                                           PrefilteringIndexReader::HDR2INDEX, 1, false, false);
+    ok &= compareEntries("HDR2", srcHeaderReader, headers);
+    delete seqReader;
+    delete srcReader;
+    delete headerReader;
+    delete srcHeaderReader;
+    index.close();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
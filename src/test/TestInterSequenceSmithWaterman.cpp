@@ -0,0 +1,122 @@
+// Compares the scores of the inter-sequence kernel with the striped SmithWaterman::ssw_align on random pairs.
+// Every batch mixes targets of different lengths, unrelated targets and mutated copies of the query.
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "InterSequenceSmithWaterman.h"
+#include "StripedSmithWaterman.h"
+#include "SubstitutionMatrix.h"
+#include "EvalueComputation.h"
+#include "Sequence.h"
+#include "Parameters.h"
+
+const char* binary_name = "test_intersequencesmithwaterman";
+
+std::string randomSequence(std::mt19937 &rng, const SubstitutionMatrix &subMat, size_t length) {
+    std::uniform_int_distribution<int> letterDist(0, 19);
+    std::string sequence;
+    for (size_t i = 0; i < length; i++) {
+        sequence.push_back(subMat.num2aa[letterDist(rng)]);
+    }
+    return sequence;
+}
+
+// substitutions, insertions and deletions at rate
+std::string mutateSequence(std::mt19937 &rng, const SubstitutionMatrix &subMat, const std::string &sequence, double rate) {
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::string mutated;
+    for (size_t i = 0; i < sequence.size(); i++) {
+        const double event = dist(rng);
+        if (event < rate * 0.8) {
+            mutated += randomSequence(rng, subMat, 1);
+        } else if (event < rate * 0.9) {
+            mutated += sequence[i];
+            mutated += randomSequence(rng, subMat, 1 + rng() % 5);
+        } else if (event >= rate) {
+            mutated += sequence[i];
+        }
+    }
+    return mutated.empty() ? sequence : mutated;
+}
+
+int main (int, const char**) {
+    const size_t maxLength = 2000;
+    const int gapOpen = 11;
+    const int gapExtend = 1;
+    SubstitutionMatrix subMat("blosum62.out", 2.0, -0.2f);
+    int8_t *tinySubMat = new int8_t[subMat.alphabetSize * subMat.alphabetSize];
+    for (int i = 0; i < subMat.alphabetSize; i++) {
+        for (int j = 0; j < subMat.alphabetSize; j++) {
+            tinySubMat[i * subMat.alphabetSize + j] = static_cast<int8_t>(subMat.subMatrix[i][j]);
+        }
+    }
+    EvalueComputation evaluer(100000, &subMat, gapOpen, gapExtend);
+
+    Sequence query(maxLength * 2, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, false);
+    std::vector<Sequence *> targets;
+    SmithWaterman aligner(maxLength * 2, subMat.alphabetSize, true);
+    InterSequenceSmithWaterman batchAligner(maxLength * 2, subMat.alphabetSize);
+
+    std::mt19937 rng(42);
+    size_t compared = 0;
+    size_t overflows = 0;
+    size_t errors = 0;
+    for (size_t round = 0; round < 40; round++) {
+        const std::string querySequence = randomSequence(rng, subMat, 10 + rng() % (round < 20 ? 300 : maxLength));
+        query.mapSequence(round, round, querySequence.c_str(), querySequence.size());
+        aligner.ssw_init(&query, tinySubMat, &subMat, 2);
+        if (batchAligner.initQuery(&query, tinySubMat, aligner.getCompositionBias()) == false) {
+            std::cout << "Query " << round << " not supported" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // the target count is not a multiple of the lanes, so the last vector is only partially filled
+        batchAligner.clearTargets();
+        const size_t targetCount = InterSequenceSmithWaterman::LANES * 2 + 1 + rng() % InterSequenceSmithWaterman::LANES;
+        for (size_t i = 0; i < targetCount; i++) {
+            std::string targetSequence;
+            switch (i % 3) {
+                case 0:
+                    targetSequence = randomSequence(rng, subMat, 1 + rng() % maxLength);
+                    break;
+                case 1:
+                    targetSequence = mutateSequence(rng, subMat, querySequence, 0.6);
+                    break;
+                default:
+                    targetSequence = mutateSequence(rng, subMat, querySequence, 0.1 * (rng() % 5));
+                    break;
+            }
+            if (targets.size() <= i) {
+                targets.push_back(new Sequence(maxLength * 2, Parameters::DBTYPE_AMINO_ACIDS, &subMat, 0, false, false));
+            }
+            targets[i]->mapSequence(i, i, targetSequence.c_str(), targetSequence.size());
+            batchAligner.addTarget(targets[i]->numSequence, targets[i]->L);
+        }
+        batchAligner.align(gapOpen, gapExtend);
+
+        for (size_t i = 0; i < targetCount; i++) {
+            const InterSequenceSmithWaterman::result_t &batchResult = batchAligner.getResult(i);
+            if (batchResult.overflow) {
+                overflows++;
+                continue;
+            }
+            s_align alignment = aligner.ssw_align(targets[i]->numSequence, targets[i]->L, gapOpen, gapExtend, 0,
+                                                  10000, &evaluer, 0, 0.0, query.L / 2);
+            compared++;
+            if (static_cast<int32_t>(alignment.score1) != batchResult.score) {
+                std::cout << "Query " << round << " target " << i << " (length " << targets[i]->L << "): ssw_align "
+                          << alignment.score1 << ", inter-sequence " << batchResult.score << std::endl;
+                errors++;
+            }
+        }
+    }
+    for (size_t i = 0; i < targets.size(); i++) {
+        delete targets[i];
+    }
+    delete[] tinySubMat;
+
+    std::cout << compared << " scores compared, " << overflows << " overflows, " << errors << " differences" << std::endl;
+    return (errors == 0 && compared > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+// Benchmark of the KmerPosition radix sort against omptl::sort on synthetic k-mer arrays.
+// Also checks that both sorts produce the same order.
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+#include "kmermatcher.h"
+#include "KmerPositionSort.h"
+#include "Timer.h"
+#include "omptl/omptl_algorithm"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_kmerpositionsort";
+
+// k-mers are drawn from kmerRange, with reverse set half of them carry the strand bit 63
+// the diagonal sorts use (negative) diagonals as pos like after the rep. sequence assignment
+// KmerPosition<int> is used for sequences longer than SHRT_MAX, so its lengths and positions exceed the short range
+template <typename T>
+void fillKmerPositions(KmerPosition<T> *kmers, size_t size, size_t kmerRange, bool reverse, bool diagonal) {
+    std::mt19937_64 rng(42);
+    const int maxLen = (sizeof(T) == sizeof(short)) ? 2000 : 100000;
+    std::uniform_int_distribution<size_t> kmerDist(0, kmerRange - 1);
+    std::uniform_int_distribution<unsigned int> idDist(0, 1000000);
+    std::uniform_int_distribution<int> lenDist(10, maxLen);
+    for (size_t i = 0; i < size; i++) {
+        kmers[i].kmer = kmerDist(rng);
+        if (reverse && (rng() & 1)) {
+            kmers[i].kmer = BIT_SET(kmers[i].kmer, 63);
+        }
+        kmers[i].id = idDist(rng);
+        kmers[i].seqLen = static_cast<T>(lenDist(rng));
+        kmers[i].pos = static_cast<T>(diagonal ? lenDist(rng) - maxLen / 2 : lenDist(rng) - 10);
+    }
+}
+
+// with nested = true the radix sort is called from inside a parallel region, so it gets fewer threads than it requests
+template <typename T>
+bool benchmark(const char *name, size_t size, size_t kmerRange, bool reverse, bool diagonal,
+               bool (*comparator)(const KmerPosition<T> &, const KmerPosition<T> &),
+               void (*sorter)(KmerPosition<T> *, KmerPosition<T> *), bool nested = false) {
+    KmerPosition<T> *omptlKmers = new KmerPosition<T>[size];
+    KmerPosition<T> *radixKmers = new KmerPosition<T>[size];
+    fillKmerPositions<T>(omptlKmers, size, kmerRange, reverse, diagonal);
+    memcpy(radixKmers, omptlKmers, sizeof(KmerPosition<T>) * size);
+
+    Timer timer;
+    omptl::sort(omptlKmers, omptlKmers + size, comparator);
+    std::string omptlTime = timer.lap();
+    timer.reset();
+    if (nested) {
+#pragma omp parallel num_threads(2)
+        {
+#pragma omp single
+            sorter(radixKmers, radixKmers + size);
+        }
+    } else {
+        sorter(radixKmers, radixKmers + size);
+    }
+    std::string radixTime = timer.lap();
+
+    bool equal = true;
+    for (size_t i = 0; i < size; i++) {
+        if (comparator(omptlKmers[i], radixKmers[i]) || comparator(radixKmers[i], omptlKmers[i])) {
+            std::cout << "Mismatch at " << i << "\n";
+            equal = false;
+            break;
+        }
+    }
+    std::cout << name << "\tomptl: " << omptlTime << "\tradix: " << radixTime << "\t" << (equal ? "OK" : "FAILED") << "\n";
+    delete[] omptlKmers;
+    delete[] radixKmers;
+    return equal;
+}
+
+int main (int argc, const char** argv) {
+    size_t size = 10000000;
+    if (argc > 1) {
+        size = strtoull(argv[1], NULL, 10);
+    }
+    // 21^6 amino acid k-mers or the id range of the representative sequences
+    const size_t kmerRange = 85766121;
+    std::cout << "Sorting " << size << " k-mers\n";
+    bool ok = true;
+    ok &= benchmark("IdAndPos", size, kmerRange, false, false,
+                    KmerPosition<short>::compareRepSequenceAndIdAndPos, radixSortRepSequenceAndIdAndPos<short, false>);
+    ok &= benchmark("IdAndPosReverse", size, kmerRange, true, false,
+                    KmerPosition<short>::compareRepSequenceAndIdAndPosReverse, radixSortRepSequenceAndIdAndPos<short, true>);
+    ok &= benchmark("IdAndDiag", size, 1000000, false, true,
+                    KmerPosition<short>::compareRepSequenceAndIdAndDiag, radixSortRepSequenceAndIdAndDiag<short, false>);
+    ok &= benchmark("IdAndDiagReverse", size, 1000000, true, true,
+                    KmerPosition<short>::compareRepSequenceAndIdAndDiagReverse, radixSortRepSequenceAndIdAndDiag<short, true>);
+    ok &= benchmark("IdAndPosInt", size, kmerRange, false, false,
+                    KmerPosition<int>::compareRepSequenceAndIdAndPos, radixSortRepSequenceAndIdAndPos<int, false>);
+    ok &= benchmark("IdAndPosReverseInt", size, kmerRange, true, false,
+                    KmerPosition<int>::compareRepSequenceAndIdAndPosReverse, radixSortRepSequenceAndIdAndPos<int, true>);
+    ok &= benchmark("IdAndDiagInt", size, 1000000, false, true,
+                    KmerPosition<int>::compareRepSequenceAndIdAndDiag, radixSortRepSequenceAndIdAndDiag<int, false>);
+    ok &= benchmark("IdAndDiagReverseInt", size, 1000000, true, true,
+                    KmerPosition<int>::compareRepSequenceAndIdAndDiagReverse, radixSortRepSequenceAndIdAndDiag<int, true>);
+#ifdef OPENMP
+    // nested regions are disabled, the sort inside of the outer region runs with a single thread
+    omp_set_max_active_levels(1);
+    omp_set_num_threads(std::max(omp_get_max_threads(), 4));
+#endif
+    ok &= benchmark("IdAndPosNested", size, kmerRange, false, false,
+                    KmerPosition<short>::compareRepSequenceAndIdAndPos, radixSortRepSequenceAndIdAndPos<short, false>, true);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
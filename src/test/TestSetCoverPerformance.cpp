@@ -0,0 +1,194 @@
+// Benchmark of the set cover clustering on a synthetic power-law similarity graph (Chung-Lu model).
+// The graph is written as symmetric alignment result DB and clustered by the serial set cover and by the parallel
+// set cover with an increasing number of threads, every parallel run has to produce the same clustering.
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include "ClusteringAlgorithms.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+#include "Util.h"
+#include "Timer.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_setcoverperformance";
+
+typedef std::vector<std::vector<std::pair<unsigned int, int>>> Graph;
+typedef std::vector<std::pair<unsigned int, unsigned int>> Assignment;
+
+// writes the graph as symmetric alignment result DB, every node is a member of its own set
+size_t writeGraph(Graph &edges, const std::string &name) {
+    DBWriter seqWriter((name + "Seq").c_str(), (name + "Seq.index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_GENERIC_DB);
+    seqWriter.open();
+    DBWriter alnWriter((name + "Aln").c_str(), (name + "Aln.index").c_str(), 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_ALIGNMENT_RES);
+    alnWriter.open();
+    size_t maxDegree = 0;
+    std::string result;
+    char buffer[256];
+    for (size_t i = 0; i < edges.size(); i++) {
+        seqWriter.writeData("", 0, i, 0);
+        std::sort(edges[i].begin(), edges[i].end());
+        edges[i].erase(std::unique(edges[i].begin(), edges[i].end(),
+                                   [](const std::pair<unsigned int, int> &a, const std::pair<unsigned int, int> &b) { return a.first == b.first; }),
+                       edges[i].end());
+        maxDegree = std::max(maxDegree, edges[i].size());
+        result.clear();
+        snprintf(buffer, sizeof(buffer), "%zu\t1000\t1.000\t0\n", i);
+        result.append(buffer);
+        for (size_t j = 0; j < edges[i].size(); j++) {
+            snprintf(buffer, sizeof(buffer), "%u\t%d\t%.3f\t0\n", edges[i][j].first, edges[i][j].second, edges[i][j].second / 1000.0);
+            result.append(buffer);
+        }
+        alnWriter.writeData(result.c_str(), result.size(), i, 0);
+    }
+    alnWriter.close();
+    seqWriter.close();
+    return maxDegree;
+}
+
+// mode 1 is the serial set cover, mode 5 the parallel one
+Assignment cluster(const std::string &name, int mode, int threads, size_t &clusterCount, std::string &time) {
+#ifdef OPENMP
+    omp_set_num_threads(threads);
+#endif
+    DBReader<unsigned int> seqDbr((name + "Seq").c_str(), (name + "Seq.index").c_str(), threads, DBReader<unsigned int>::USE_INDEX);
+    seqDbr.open(DBReader<unsigned int>::NOSORT);
+    DBReader<unsigned int> alnDbr((name + "Aln").c_str(), (name + "Aln.index").c_str(), threads, DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_INDEX);
+    alnDbr.open(DBReader<unsigned int>::NOSORT);
+    ClusteringAlgorithms algorithm(&seqDbr, &alnDbr, threads, Parameters::APC_SEQID, 0);
+    Timer timer;
+    std::unordered_map<unsigned int, std::vector<unsigned int>> clusters = algorithm.execute(mode);
+    time = timer.lap();
+    clusterCount = clusters.size();
+
+    Assignment assignment;
+    for (std::unordered_map<unsigned int, std::vector<unsigned int>>::const_iterator it = clusters.begin(); it != clusters.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            assignment.push_back(std::make_pair(it->second[i], it->first));
+        }
+    }
+    std::sort(assignment.begin(), assignment.end());
+    alnDbr.close();
+    seqDbr.close();
+    return assignment;
+}
+
+// every node has to be assigned exactly once, to itself or to a neighbour that is a representative
+bool isSetCover(const Graph &edges, const Assignment &assignment) {
+    if (assignment.size() != edges.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < assignment.size(); i++) {
+        const unsigned int node = assignment[i].first;
+        const unsigned int representative = assignment[i].second;
+        if (node != i || assignment[representative].second != representative) {
+            return false;
+        }
+        if (node != representative && std::find_if(edges[node].begin(), edges[node].end(),
+                                                    [representative](const std::pair<unsigned int, int> &e) { return e.first == representative; }) == edges[node].end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main (int argc, const char** argv) {
+    size_t nodeCount = 200000;
+    size_t averageDegree = 20;
+    int maxThreads = 1;
+#ifdef OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+    if (argc > 1) {
+        nodeCount = strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        averageDegree = strtoull(argv[2], NULL, 10);
+    }
+    if (argc > 3) {
+        maxThreads = atoi(argv[3]);
+    }
+
+    // node weights follow a power law with exponent 2.5
+    std::vector<double> cumulativeWeight(nodeCount);
+    double weightSum = 0.0;
+    for (size_t i = 0; i < nodeCount; i++) {
+        weightSum += pow(static_cast<double>(i + 1), -1.0 / 1.5);
+        cumulativeWeight[i] = weightSum;
+    }
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> weightDist(0.0, weightSum);
+    std::uniform_int_distribution<int> seqIdDist(300, 1000);
+    Graph edges(nodeCount);
+    const size_t edgeCount = nodeCount * averageDegree / 2;
+    for (size_t i = 0; i < edgeCount; i++) {
+        const unsigned int u = std::lower_bound(cumulativeWeight.begin(), cumulativeWeight.end(), weightDist(rng)) - cumulativeWeight.begin();
+        const unsigned int v = std::lower_bound(cumulativeWeight.begin(), cumulativeWeight.end(), weightDist(rng)) - cumulativeWeight.begin();
+        if (u == v || u >= nodeCount || v >= nodeCount) {
+            continue;
+        }
+        const int seqId = seqIdDist(rng);
+        edges[u].push_back(std::make_pair(v, seqId));
+        edges[v].push_back(std::make_pair(u, seqId));
+    }
+
+    size_t maxDegree = writeGraph(edges, "setCover");
+    std::cout << "Nodes: " << nodeCount << " edges: " << edgeCount << " max degree: " << maxDegree << std::endl;
+
+    size_t clusterCount;
+    std::string time;
+    const Assignment serial = cluster("setCover", 1, maxThreads, clusterCount, time);
+    std::cout << "Serial set cover\tclusters: " << clusterCount << "\ttime: " << time << std::endl;
+    if (isSetCover(edges, serial) == false) {
+        std::cout << "Serial set cover is not a valid clustering" << std::endl;
+        EXIT(EXIT_FAILURE);
+    }
+
+    // the parallel set cover breaks ties by id, it has to be valid and independent of the number of threads
+    Assignment reference;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const Assignment assignment = cluster("setCover", 5, threads, clusterCount, time);
+        if (reference.empty()) {
+            reference = assignment;
+        }
+        size_t sameRepresentative = 0;
+        for (size_t i = 0; i < assignment.size() && i < serial.size(); i++) {
+            sameRepresentative += (assignment[i].second == serial[i].second);
+        }
+        std::cout << "Threads: " << threads << "\tclusters: " << clusterCount << "\ttime: " << time
+                  << "\tsame representative as serial: " << sameRepresentative
+                  << "\t" << ((assignment == reference) ? "identical" : "DIFFERENT") << std::endl;
+        if (assignment != reference || isSetCover(edges, assignment) == false) {
+            EXIT(EXIT_FAILURE);
+        }
+    }
+
+    // without ties both implementations have to select the same representatives:
+    // disjoint stars with distinct numbers of leaves, every center is larger than all remaining sets
+    Graph stars;
+    for (unsigned int leaves = 2; leaves <= 64; leaves++) {
+        const unsigned int center = stars.size();
+        stars.resize(center + leaves + 1);
+        for (unsigned int i = center + 1; i <= center + leaves; i++) {
+            stars[center].push_back(std::make_pair(i, 900));
+            stars[i].push_back(std::make_pair(center, 900));
+        }
+    }
+    writeGraph(stars, "setCoverStars");
+    const Assignment serialStars = cluster("setCoverStars", 1, maxThreads, clusterCount, time);
+    const Assignment parallelStars = cluster("setCoverStars", 5, maxThreads, clusterCount, time);
+    std::cout << "Stars\tclusters: " << clusterCount << "\t"
+              << ((serialStars == parallelStars) ? "identical" : "DIFFERENT") << std::endl;
+    if (serialStars != parallelStars || isSetCover(stars, serialStars) == false) {
+        EXIT(EXIT_FAILURE);
+    }
+    return EXIT_SUCCESS;
+}
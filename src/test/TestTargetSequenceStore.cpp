@@ -0,0 +1,94 @@
+// Maps every target through TargetSequenceStore twice, the first time the sequence is encoded into the store,
+// the second time it is copied from the store. Both have to be equal to Sequence::mapSequence on the reader data.
+// With a small memory budget only the first used sequences are stored, the others are mapped from the reader.
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Parameters.h"
+#include "Sequence.h"
+#include "SubstitutionMatrix.h"
+#include "TargetSequenceStore.h"
+
+#ifdef OPENMP
+#include <omp.h>
+#endif
+
+const char* binary_name = "test_targetsequencestore";
+
+int main (int, const char**) {
+    Parameters &par = Parameters::getInstance();
+    SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, -0.2f);
+
+    // lower case and unknown letters have to be mapped like the reader data
+    // the keys are too sparse for the dense key -> id table, so DBReader::getId is used
+    const std::string letters = "ACDEFGHIKLMNPQRSTVWYXBZJUOacdefghiklmnpqrstvwyx*";
+    std::mt19937 rng(42);
+    DBWriter writer("dataTargetStore", "dataTargetStore.index", 1, Parameters::WRITER_ASCII_MODE, Parameters::DBTYPE_AMINO_ACIDS);
+    writer.open();
+    unsigned int key = 0;
+    for (size_t i = 0; i < 2000; i++) {
+        std::string sequence;
+        const size_t length = (i % 100 == 0) ? 0 : 1 + rng() % 500;
+        for (size_t j = 0; j < length; j++) {
+            sequence.push_back(letters[rng() % letters.size()]);
+        }
+        sequence.push_back('\n');
+        writer.writeData(sequence.c_str(), sequence.size(), key, 0);
+        key += (i < 1000) ? 1 : 1 + rng() % 20;
+    }
+    writer.close(true);
+
+    int threads = 1;
+#ifdef OPENMP
+    threads = omp_get_max_threads();
+#endif
+    DBReader<unsigned int> reader("dataTargetStore", "dataTargetStore.index", threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    reader.open(DBReader<unsigned int>::NOSORT);
+
+    size_t errors = 0;
+    // no encoded sequences, room for about a tenth of the residues, room for all of them
+    const size_t budgets[] = { 0, reader.getSize() * (sizeof(size_t) + 1) + reader.getAminoAcidDBSize() / 10, SIZE_MAX };
+    const char *budgetNames[] = { "Not encoded", "Partially encoded", "Encoded" };
+    for (int budget = 0; budget < 3; budget++) {
+        TargetSequenceStore store(&reader, reader.getDbtype(), budgets[budget]);
+#pragma omp parallel num_threads(threads) reduction(+:errors)
+        {
+            unsigned int thread_idx = 0;
+#ifdef OPENMP
+            thread_idx = static_cast<unsigned int>(omp_get_thread_num());
+#endif
+            Sequence expected(par.maxSeqLen, reader.getDbtype(), &subMat, 0, false, false);
+            Sequence stored(par.maxSeqLen, reader.getDbtype(), &subMat, 0, false, false);
+            for (size_t pass = 0; pass < 2; pass++) {
+#pragma omp for schedule(dynamic, 10)
+                for (size_t i = 0; i < reader.getSize(); i++) {
+                    const unsigned int dbKey = reader.getDbKey(i);
+                    const size_t id = store.getId(dbKey);
+                    if (id != i || store.getSeqLen(id) != reader.getSeqLen(i)) {
+                        errors++;
+                        continue;
+                    }
+                    expected.mapSequence(i, dbKey, reader.getData(i, thread_idx), reader.getSeqLen(i));
+                    if (store.mapSequence(id, dbKey, stored, thread_idx) == false
+                        || stored.L != expected.L || stored.getDbKey() != dbKey
+                        || memcmp(stored.numSequence, expected.numSequence, expected.L) != 0) {
+                        errors++;
+                    }
+                }
+            }
+        }
+        if (store.getId(key) != UINT_MAX) {
+            errors++;
+        }
+        std::cout << budgetNames[budget] << ": " << errors << " differences" << std::endl;
+    }
+    reader.close();
+    return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
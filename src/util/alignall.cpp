@@ -56,6 +56,8 @@ int alignall(int argc, const char **argv, const Command &command) {
     EvalueComputation evaluer(tdbr.getAminoAcidDBSize(), subMat, gapOpen, gapExtend);
     const size_t flushSize = 100000000;
     size_t iterations = static_cast<int>(ceil(static_cast<double>(dbr_res.getSize()) / static_cast<double>(flushSize)));
+    // members of overlapping result sets are aligned as query in every set
+    QueryProfileCache profileCache;
 
     for (size_t i = 0; i < iterations; i++) {
         size_t start = (i * flushSize);
@@ -69,6 +71,7 @@ int alignall(int argc, const char **argv, const Command &command) {
 #endif
 
             Matcher matcher(targetSeqType, par.maxSeqLen, subMat, &evaluer, par.compBiasCorrection, gapOpen, gapExtend, par.zdrop);
+            matcher.setQueryProfileCache(&profileCache);
 
             Sequence query(par.maxSeqLen, targetSeqType, subMat, 0, false, par.compBiasCorrection);
             Sequence target(par.maxSeqLen, targetSeqType, subMat, 0, false, par.compBiasCorrection);
@@ -130,6 +133,7 @@ int alignall(int argc, const char **argv, const Command &command) {
         }
         dbr_res.remapData();
     }
+    profileCache.printStatistics();
     resultWriter.close();
     dbr_res.close();
     delete subMat;
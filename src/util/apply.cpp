@@ -10,6 +10,7 @@ int apply(int argc, const char **argv, const Command& command) {
     EXIT(EXIT_FAILURE);
 }
 #else
+#include <algorithm>
 #include <climits>
 #include <unistd.h>
 #include <fcntl.h>
@@ -238,6 +239,155 @@ int apply_by_entry(char* data, size_t size, unsigned int key, DBWriter& writer,
     return WEXITSTATUS(status);
 }
 
+// Starts the program once and streams all given entries through it. Each entry is written to stdin
+// terminated by '\0' and the program has to answer every entry with exactly one '\0' terminated result.
+int apply_stream(DBReader<unsigned int>& reader, const std::vector<size_t>& entries, DBWriter& writer, unsigned int thread,
+                 const char* program_name, char ** program_argv, char **environ, Debug::Progress& progress, size_t progressStride) {
+    // only works with the environ we construct ourselves
+    // local_environment() leaves the first element free to use for ourselves
+    snprintf(environ[0], 64, "MMSEQS_APPLY_MODE=%d", Parameters::APPLY_MODE_STREAM);
+
+    int fd[2];
+    pid_t child_pid;
+    if ((child_pid = create_pipe(program_name, program_argv, environ, fd)) == -1) {
+        perror("create_pipe");
+        return -1;
+    }
+
+    // entry currently written and bytes of it (including its '\0') already written
+    size_t nextWrite = 0;
+    size_t written = 0;
+    const char *data = NULL;
+    size_t size = 0;
+    // entry the next result belongs to
+    size_t nextRead = 0;
+    bool write_closed = false;
+    int error = 0;
+
+    std::string result;
+    char buffer[PIPE_BUF];
+    struct pollfd plist[2];
+    while (nextRead < entries.size()) {
+        if (write_closed == false && nextWrite == entries.size()) {
+            if (close(fd[1]) == -1) {
+                perror("close error");
+                error = errno;
+                break;
+            }
+            write_closed = true;
+        }
+
+        plist[0].fd = write_closed == false ? fd[1] : -1;
+        plist[0].events = POLLOUT;
+        plist[0].revents = 0;
+
+        plist[1].fd = fd[0];
+        plist[1].events = POLLIN;
+        plist[1].revents = 0;
+
+        if (poll(plist, 2, -1) == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            error = errno;
+            break;
+        }
+
+        if (plist[0].revents & POLLOUT) {
+            if (written == 0) {
+                data = reader.getData(entries[nextWrite], thread);
+                size = reader.getEntryLen(entries[nextWrite]);
+            }
+            // POLLOUT guarantees that PIPE_BUF bytes can be written without blocking
+            size_t batch_size = std::min(size - written, static_cast<size_t>(PIPE_BUF));
+            ssize_t w = write(fd[1], data + written, batch_size);
+            if (w < 0) {
+                if (errno != EAGAIN && errno != EINTR) {
+                    perror("write stdin");
+                    error = errno;
+                    break;
+                }
+            } else {
+                written += w;
+                if (written == size) {
+                    nextWrite++;
+                    written = 0;
+                }
+            }
+        } else if (plist[0].revents & (POLLERR | POLLHUP)) {
+            // the program closed its stdin, collect the results it still writes
+            close(fd[1]);
+            write_closed = true;
+            nextWrite = entries.size();
+        }
+
+        if (plist[1].revents & (POLLIN | POLLHUP)) {
+            ssize_t bytes_read = read(fd[0], buffer, sizeof(buffer));
+            if (bytes_read > 0) {
+                const char *pos = buffer;
+                const char *end = buffer + bytes_read;
+                while (pos < end && nextRead < entries.size()) {
+                    const char *terminator = (const char *) memchr(pos, '\0', end - pos);
+                    if (terminator == NULL) {
+                        result.append(pos, end - pos);
+                        break;
+                    }
+                    result.append(pos, terminator - pos);
+                    writer.writeData(result.c_str(), result.size(), reader.getDbKey(entries[nextRead]), 0);
+                    result.clear();
+                    nextRead++;
+                    // progress is only printed by the first worker, count the entries of the other workers too
+                    for (size_t i = 0; i < progressStride; ++i) {
+                        progress.updateProgress();
+                    }
+                    pos = terminator + 1;
+                }
+            } else if (bytes_read == 0) {
+                break;
+            } else if (errno != EAGAIN && errno != EINTR) {
+                perror("read stdout");
+                error = errno;
+                break;
+            }
+        }
+    }
+
+    // a last result without terminating '\0' is still accepted, entries without result stay empty
+    if (result.empty() == false && nextRead < entries.size()) {
+        writer.writeData(result.c_str(), result.size(), reader.getDbKey(entries[nextRead]), 0);
+        nextRead++;
+    }
+    if (nextRead < entries.size()) {
+        Debug(Debug::WARNING) << "Program ended without result for " << (entries.size() - nextRead) << " entries!\n";
+        for (size_t i = nextRead; i < entries.size(); ++i) {
+            writer.writeData(NULL, 0, reader.getDbKey(entries[i]), 0);
+        }
+    }
+
+    if (write_closed == false) {
+        close(fd[1]);
+    }
+
+    if (close(fd[0]) == -1) {
+        perror("close stdout");
+        error = errno;
+    }
+
+    int status = 0;
+    while (waitpid(child_pid, &status, 0) == -1) {
+        if (errno == EINTR) {
+            continue;
+        }
+        perror("waitpid");
+        error = errno;
+        break;
+    }
+
+    errno = error;
+    return WEXITSTATUS(status);
+}
+
 void ignore_signal(int signal) {
     struct sigaction handler;
     handler.sa_handler = SIG_IGN;
@@ -339,28 +489,50 @@ int apply(int argc, const char **argv, const Command& command) {
                 char **local_environ = local_environment();
 
                 ignore_signal(SIGPIPE);
-                for (size_t i = 0; i < reader.getSize(); ++i) {
-                    progress.updateProgress();
-                    if (static_cast<ssize_t>(i) % (mpiProcs * par.threads) != (thread * mpiProcs + mpiRank)) {
-                        continue;
-                    }
-
-                    unsigned int key = reader.getDbKey(i);
-                    char *data = reader.getData(i, thread);
-                    if (*data == '\0') {
-                        writer.writeData(NULL, 0, key, 0);
-                        continue;
+                if (par.applyMode == Parameters::APPLY_MODE_STREAM) {
+                    std::vector<size_t> entries;
+                    for (size_t i = 0; i < reader.getSize(); ++i) {
+                        if (static_cast<ssize_t>(i) % (mpiProcs * par.threads) != (thread * mpiProcs + mpiRank)) {
+                            continue;
+                        }
+                        char *data = reader.getData(i, thread);
+                        if (*data == '\0') {
+                            writer.writeData(NULL, 0, reader.getDbKey(i), 0);
+                            continue;
+                        }
+                        entries.push_back(i);
                     }
-
-                    size_t size = reader.getEntryLen(i) - 1;
-                    int status = apply_by_entry(data, size, key, writer, par.restArgv[0], const_cast<char**>(par.restArgv), local_environ, 0);
+                    int status = apply_stream(reader, entries, writer, thread, par.restArgv[0], const_cast<char**>(par.restArgv),
+                                              local_environ, progress, mpiProcs * par.threads);
                     if (status == -1) {
-                        Debug(Debug::WARNING) << "Entry " << key << " system error number " << errno << "!\n";
-                        continue;
+                        Debug(Debug::WARNING) << "Worker " << thread << " system error number " << errno << "!\n";
+                    } else if (status > 0) {
+                        Debug(Debug::WARNING) << "Worker " << thread << " program exited with error code " << status << "!\n";
                     }
-                    if (status > 0) {
-                        Debug(Debug::WARNING) << "Entry " << key << " exited with error code " << status << "!\n";
-                        continue;
+                } else {
+                    for (size_t i = 0; i < reader.getSize(); ++i) {
+                        progress.updateProgress();
+                        if (static_cast<ssize_t>(i) % (mpiProcs * par.threads) != (thread * mpiProcs + mpiRank)) {
+                            continue;
+                        }
+
+                        unsigned int key = reader.getDbKey(i);
+                        char *data = reader.getData(i, thread);
+                        if (*data == '\0') {
+                            writer.writeData(NULL, 0, key, 0);
+                            continue;
+                        }
+
+                        size_t size = reader.getEntryLen(i) - 1;
+                        int status = apply_by_entry(data, size, key, writer, par.restArgv[0], const_cast<char**>(par.restArgv), local_environ, 0);
+                        if (status == -1) {
+                            Debug(Debug::WARNING) << "Entry " << key << " system error number " << errno << "!\n";
+                            continue;
+                        }
+                        if (status > 0) {
+                            Debug(Debug::WARNING) << "Entry " << key << " exited with error code " << status << "!\n";
+                            continue;
+                        }
                     }
                 }
 
@@ -0,0 +1,20 @@
+#include "Util.h"
+#include "Parameters.h"
+#include "DBReader.h"
+#include "DBWriter.h"
+#include "Debug.h"
+
+int convertindex(int argc, const char **argv, const Command& command) {
+    Parameters& par = Parameters::getInstance();
+    par.parseParameters(argc, argv, command, true, 0, 0);
+
+    const bool isBinary = DBReader<unsigned int>::isBinaryIndexFile(par.db1Index.c_str());
+    Debug(Debug::INFO) << "Converting " << (isBinary ? "binary" : "text") << " index to "
+                       << (par.binaryIndex ? "binary" : "text") << " index\n";
+    DBWriter::convertIndex(par.db1Index.c_str(), par.db2Index.c_str(), par.binaryIndex);
+
+    if (par.db1 != par.db2) {
+        DBReader<unsigned int>::softlinkDb(par.db1, par.db2, (DBFiles::Files) (DBFiles::ALL & ~DBFiles::DATA_INDEX));
+    }
+    return EXIT_SUCCESS;
+}
@@ -12,8 +12,15 @@ int createsubdb(int argc, const char **argv, const Command& command) {
     par.parseParameters(argc, argv, command, true, 0, 0);
 
     FILE *orderFile = NULL;
+    // the keys of a binary index can not be read as lines of text
+    DBReader<unsigned int> *orderReader = NULL;
     if (FileUtil::fileExists(par.db1Index.c_str())) {
-        orderFile = fopen(par.db1Index.c_str(), "r");
+        if (DBReader<unsigned int>::isBinaryIndexFile(par.db1Index.c_str())) {
+            orderReader = new DBReader<unsigned int>(par.db1.c_str(), par.db1Index.c_str(), 1, DBReader<unsigned int>::USE_INDEX);
+            orderReader->open(DBReader<unsigned int>::NOSORT);
+        } else {
+            orderFile = fopen(par.db1Index.c_str(), "r");
+        }
     } else {
         if(FileUtil::fileExists(par.db1.c_str())){
             orderFile = fopen(par.db1.c_str(), "r");
@@ -23,7 +30,8 @@ int createsubdb(int argc, const char **argv, const Command& command) {
         }
     }
 
-    DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    // entries are copied as they are, so binary results stay readable
+    DBReader<unsigned int> reader(par.db2.c_str(), par.db2Index.c_str(), 1, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_BINARY);
     reader.open(DBReader<unsigned int>::NOSORT);
     const bool isCompressed = reader.isCompressed();
 
@@ -33,12 +41,24 @@ int createsubdb(int argc, const char **argv, const Command& command) {
     char *line = NULL;
     size_t len = 0;
     char dbKey[256];
-    while (getline(&line, &len, orderFile) != -1) {
-        Util::parseKey(line, dbKey);
-        const unsigned int key = Util::fast_atoi<unsigned int>(dbKey);
+    size_t orderIdx = 0;
+    while (true) {
+        unsigned int key;
+        if (orderReader != NULL) {
+            if (orderIdx >= orderReader->getSize()) {
+                break;
+            }
+            key = orderReader->getDbKey(orderIdx++);
+        } else {
+            if (getline(&line, &len, orderFile) == -1) {
+                break;
+            }
+            Util::parseKey(line, dbKey);
+            key = Util::fast_atoi<unsigned int>(dbKey);
+        }
         const size_t id = reader.getId(key);
         if (id >= UINT_MAX) {
-            Debug(Debug::WARNING) << "Key " << dbKey << " not found in database\n";
+            Debug(Debug::WARNING) << "Key " << key << " not found in database\n";
             continue;
         }
         if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
@@ -68,13 +88,24 @@ int createsubdb(int argc, const char **argv, const Command& command) {
     writer.close(shouldMerge);
     if (par.subDbMode == Parameters::SUBDB_MODE_SOFT) {
         DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::DATA);
+    } else {
+        // the copied entries are still compressed with the dictionary of the input
+        std::string dictionaryFile = DBReader<unsigned int>::getDictionaryFileName(par.db2);
+        if (isCompressed && FileUtil::fileExists(dictionaryFile.c_str())) {
+            FileUtil::copyFile(dictionaryFile.c_str(), DBReader<unsigned int>::getDictionaryFileName(par.db3).c_str());
+        }
     }
     DBWriter::writeDbtypeFile(par.db3.c_str(), reader.getDbtype(), isCompressed);
     DBReader<unsigned int>::softlinkDb(par.db2, par.db3, DBFiles::SEQUENCE_ANCILLARY);
 
     free(line);
     reader.close();
-    fclose(orderFile);
+    if (orderReader != NULL) {
+        orderReader->close();
+        delete orderReader;
+    } else {
+        fclose(orderFile);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -10,6 +10,7 @@
 #include "Sequence.h"
 #include "Alignment.h"
 #include "SubstitutionMatrix.h"
+#include "TargetSequenceStore.h"
 
 #include <cassert>
 
@@ -134,6 +135,10 @@ int expandaln(int argc, const char **argv, const Command& command) {
     DBWriter writer(par.db5.c_str(), par.db5Index.c_str(), par.threads, par.compressed, Parameters::DBTYPE_ALIGNMENT_RES);
     writer.open();
 
+    // the encoded targets share the memory with the query, target and expansion data
+    size_t usedMemory = queryReader.getTotalDataSize() + targetReader.getTotalDataSize() + expansionReader.getTotalDataSize();
+    TargetSequenceStore targetStore(&targetReader, targetDbType, par.targetSeqCache ? TargetSequenceStore::getMemoryBudget(usedMemory) : 0);
+
     BacktraceTranslator translator;
     SubstitutionMatrix subMat(par.scoringMatrixFile.aminoacids, 2.0, par.scoreBias);
     EvalueComputation evaluer(targetReader.getAminoAcidDBSize(), &subMat, par.gapOpen.aminoacids, par.gapExtend.aminoacids);
@@ -187,9 +192,8 @@ int expandaln(int argc, const char **argv, const Command& command) {
 
                 unsigned int targetKey = resultAB.dbKey;
                 size_t targetId = expansionReader.getId(targetKey);
-                size_t targetSeqId = targetReader.getId(targetKey);
-                tSeq.mapSequence(targetSeqId, targetKey, targetReader.getData(targetSeqId, thread_idx),
-                                 targetReader.getSeqLen(targetSeqId));
+                size_t targetSeqId = targetStore.getId(targetKey);
+                targetStore.mapSequence(targetSeqId, targetKey, tSeq, thread_idx);
 
                 if (ca3mSequenceReader != NULL) {
                     unsigned int key;
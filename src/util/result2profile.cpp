@@ -8,6 +8,7 @@
 #include "FileUtil.h"
 #include "tantan.h"
 #include "IndexReader.h"
+#include "TargetSequenceStore.h"
 
 #include <algorithm>
 #include <utility>
@@ -95,6 +96,10 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
     Debug(Debug::INFO) << "Query database size: " << qDbr->getSize() << " type: " << qDbr->getDbTypeName() << "\n";
     Debug(Debug::INFO) << "Target database size: " << tDbr->getSize() << " type: " << Parameters::getDbTypeName(targetSeqType) << "\n";
 
+    // the encoded targets share the memory with the query and target data
+    size_t usedMemory = tDbr->getTotalDataSize() + (sameDatabase ? 0 : qDbr->getTotalDataSize());
+    TargetSequenceStore targetStore(tDbr, targetSeqType, par.targetSeqCache ? TargetSequenceStore::getMemoryBudget(usedMemory) : 0);
+
     const bool isFiltering = par.filterMsa != 0;
     int xAmioAcid = subMat.aa2num[static_cast<int>('X')];
     Debug::Progress progress(dbSize);
@@ -155,13 +160,13 @@ int result2profile(DBReader<unsigned int> &resultReader, Parameters &par, const
                     alnResults.push_back(res);
                 }
                 if (hasInclusionEval) {
-                    const size_t edgeId = tDbr->getId(key);
+                    const size_t edgeId = targetStore.getId(key);
                     if (edgeId == UINT_MAX) {
                         Debug(Debug::ERROR) << "Sequence " << queryKey << " is not contained in the target sequence database\n";
                         EXIT(EXIT_FAILURE);
                     }
-                    Sequence *edgeSequence = new Sequence(tDbr->getSeqLen(edgeId), targetSeqType, &subMat, 0, false, false);
-                    edgeSequence->mapSequence(0, key, tDbr->getData(edgeId, thread_idx), tDbr->getSeqLen(edgeId));
+                    Sequence *edgeSequence = new Sequence(targetStore.getSeqLen(edgeId), targetSeqType, &subMat, 0, false, false);
+                    targetStore.mapSequence(edgeId, key, *edgeSequence, thread_idx);
                     seqSet.push_back(edgeSequence);
                 }
                 data = Util::skipLine(data);
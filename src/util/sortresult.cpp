@@ -14,12 +14,13 @@ int sortresult(int argc, const char **argv, const Command &command) {
     Parameters &par = Parameters::getInstance();
     par.parseParameters(argc, argv, command, true, 0, 0);
 
-    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    DBReader<unsigned int> reader(par.db1.c_str(), par.db1Index.c_str(), par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_BINARY);
     reader.open(DBReader<unsigned int>::LINEAR_ACCCESS);
 
     DBWriter writer(par.db2.c_str(), par.db2Index.c_str(), par.threads, par.compressed, reader.getDbtype());
     writer.open();
     Debug::Progress progress(reader.getSize());
+    const bool binary = reader.isBinary();
 
    #pragma omp parallel
     {
@@ -41,9 +42,13 @@ int sortresult(int argc, const char **argv, const Command &command) {
             progress.updateProgress();
 
             unsigned int key = reader.getDbKey(i);
-            char *data = reader.getData(i, thread_idx);
-
             int format = -1;
+            if (binary) {
+                QueryMatcher::readPrefilterHits(reader, i, thread_idx, prefResults);
+                format = 2;
+            }
+
+            char *data = binary ? (char *) "" : reader.getData(i, thread_idx);
             while (*data != '\0') {
                 const size_t columns = Util::getWordsOfLine(data, entry, 255);
                 if (columns >= Matcher::ALN_RES_WITH_OUT_BT_COL_CNT) {
@@ -69,7 +74,7 @@ int sortresult(int argc, const char **argv, const Command &command) {
             } else if (format == 2) {
                 std::sort(prefResults.begin(), prefResults.end(), hit_t::compareHitsByScoreAndId);
                 for (size_t i = 0; i < prefResults.size(); ++i) {
-                    size_t length = QueryMatcher::prefilterHitToBuffer(buffer, prefResults[i]);
+                    size_t length = QueryMatcher::prefilterHitToBuffer(buffer, prefResults[i], binary);
                     writer.writeAdd(buffer, length, thread_idx);
                 }
             }
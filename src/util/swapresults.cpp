@@ -9,11 +9,169 @@
 #include "AlignmentSymmetry.h"
 #include "PrefilteringIndexReader.h"
 #include "IndexReader.h"
+#include "FileUtil.h"
+
+#include <queue>
+#include <omptl/omptl_algorithm>
 
 #ifdef OPENMP
 #include <omp.h>
 #endif
 
+// a swapped result line (or binary prefilter record) of the parse pass or a block of lines of a spilled run
+struct SwapRecord {
+    unsigned int target;
+    // buffer holding the data
+    unsigned int buffer;
+    // position of the result entry (or run), keeps the input order of lines with the same target
+    unsigned int entry;
+    size_t offset;
+    size_t length;
+
+    static bool compare(const SwapRecord &first, const SwapRecord &second) {
+        if (first.target != second.target) {
+            return first.target < second.target;
+        }
+        if (first.entry != second.entry) {
+            return first.entry < second.entry;
+        }
+        return first.offset < second.offset;
+    }
+};
+
+// header of every target block in a spilled run
+struct SwapRunBlock {
+    unsigned int target;
+    size_t size;
+};
+
+struct SwapRun {
+    FILE *file;
+    SwapRunBlock block;
+
+    bool next() {
+        return fread(&block, sizeof(SwapRunBlock), 1, file) == 1;
+    }
+};
+
+struct SwapContext {
+    bool isGeneralMode;
+    bool binary;
+    bool isAlignmentResult;
+    bool hasBacktrace;
+    double evalThr;
+    EvalueComputation *evaluer;
+    char *targetElementExists;
+    unsigned int maxTargetId;
+    DBWriter *writer;
+};
+
+// writes the entry of one target, all records have this target and are in input order
+static void writeSwappedTarget(const SwapContext &ctx, const SwapRecord *records, size_t recordCount, char **buffers,
+                               std::vector<Matcher::result_t> &curRes, std::string &ss, char *buffer, unsigned int thread_idx) {
+    const unsigned int key = records[0].target;
+    if (ctx.targetElementExists != NULL && key <= ctx.maxTargetId) {
+        // mark as written
+        ctx.targetElementExists[key] = 2;
+    }
+
+    if (ctx.isGeneralMode) {
+        ctx.writer->writeStart(thread_idx);
+        for (size_t i = 0; i < recordCount; ++i) {
+            ctx.writer->writeAdd(buffers[records[i].buffer] + records[i].offset, records[i].length, thread_idx);
+        }
+        ctx.writer->writeEnd(key, thread_idx);
+        return;
+    }
+
+    for (size_t i = 0; i < recordCount; ++i) {
+        char *data = buffers[records[i].buffer] + records[i].offset;
+        size_t dataSize = records[i].length;
+        while (dataSize > 0) {
+            if (ctx.binary) {
+                packed_hit_t record;
+                memcpy(&record, data, sizeof(packed_hit_t));
+                hit_t hit = QueryMatcher::parsePrefilterHit(record);
+                hit.diagonal = static_cast<unsigned short>(static_cast<short>(hit.diagonal) * -1);
+                curRes.emplace_back(hit.seqId, hit.prefScore, 0, 0, 0, -static_cast<float>(hit.prefScore), hit.diagonal, 0, 0, 0, 0, 0, 0, "");
+                dataSize -= sizeof(packed_hit_t);
+                data += sizeof(packed_hit_t);
+                continue;
+            }
+            if (ctx.isAlignmentResult) {
+                Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
+                Matcher::result_t::swapResult(res, *ctx.evaluer, ctx.hasBacktrace);
+                if (res.eval <= ctx.evalThr) {
+                    curRes.emplace_back(std::move(res));
+                }
+            } else {
+                hit_t hit = QueryMatcher::parsePrefilterHit(data);
+                hit.diagonal = static_cast<unsigned short>(static_cast<short>(hit.diagonal) * -1);
+                curRes.emplace_back(hit.seqId, hit.prefScore, 0, 0, 0, -static_cast<float>(hit.prefScore), hit.diagonal, 0, 0, 0, 0, 0, 0, "");
+            }
+            char *nextLine = Util::skipLine(data);
+            size_t lineLen = nextLine - data;
+            dataSize -= lineLen;
+            data = nextLine;
+        }
+    }
+
+    if (curRes.size() > 1) {
+        std::sort(curRes.begin(), curRes.end(), Matcher::compareHits);
+    }
+    for (size_t j = 0; j < curRes.size(); j++) {
+        const Matcher::result_t &res = curRes[j];
+        if (ctx.isAlignmentResult) {
+            size_t len = Matcher::resultToBuffer(buffer, res, ctx.hasBacktrace, false);
+            ss.append(buffer, len);
+        } else {
+            hit_t hit;
+            hit.seqId = res.dbKey;
+            hit.prefScore = res.score;
+            hit.diagonal = res.alnLength;
+            size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hit, ctx.binary);
+            ss.append(buffer, len);
+        }
+    }
+    // targets whose hits are all above the e-value threshold get an empty entry
+    ctx.writer->writeData(ss.c_str(), ss.size(), key, thread_idx);
+    ss.clear();
+    curRes.clear();
+}
+
+// writes all targets of the sorted records in parallel
+static void writeSwappedRecords(const SwapContext &ctx, const std::vector<SwapRecord> &records, char **buffers) {
+    std::vector<size_t> groupStarts;
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (i == 0 || records[i].target != records[i - 1].target) {
+            groupStarts.push_back(i);
+        }
+    }
+    groupStarts.push_back(records.size());
+
+#pragma omp parallel
+    {
+        unsigned int thread_idx = 0;
+#ifdef OPENMP
+        thread_idx = (unsigned int) omp_get_thread_num();
+#endif
+        // we are reusing this vector also for the prefiltering results
+        // qcov is used for pScore because its the first float value
+        // and alnLength for diagonal because its the first int value after
+        std::vector<Matcher::result_t> curRes;
+        curRes.reserve(300);
+        char buffer[1024 + 32768];
+        std::string ss;
+        ss.reserve(100000);
+
+#pragma omp for schedule(dynamic, 100)
+        for (size_t i = 0; i < groupStarts.size() - 1; ++i) {
+            writeSwappedTarget(ctx, records.data() + groupStarts[i], groupStarts[i + 1] - groupStarts[i], buffers,
+                               curRes, ss, buffer, thread_idx);
+        }
+    }
+}
+
 int doswap(Parameters& par, bool isGeneralMode) {
     const char * parResultDb;
     const char * parResultDbIndex;
@@ -32,44 +190,14 @@ int doswap(Parameters& par, bool isGeneralMode) {
         parOutDb = par.db4.c_str();
         parOutDbIndex = par.db4Index.c_str();
     }
-    std::string parResultDbStr(parResultDb);
-    std::string parResultDbIndexStr(parResultDbIndex);
-
     std::string parOutDbStr(parOutDb);
-    std::string parOutDbIndexStr(parOutDbIndex);
 
     BaseMatrix *subMat = NULL;
     EvalueComputation *evaluer = NULL;
     size_t aaResSize = 0;
     unsigned int maxTargetId = 0;
     char *targetElementExists = NULL;
-    if (isGeneralMode) {
-        DBReader<unsigned int> resultReader(parResultDb, parResultDbIndex, par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
-        resultReader.open(DBReader<unsigned int>::SORT_BY_OFFSET);
-        //search for the maxTargetId (value of first column) in parallel
-        Debug::Progress progress(resultReader.getSize());
-
-#pragma omp parallel
-        {
-            int thread_idx = 0;
-#ifdef OPENMP
-            thread_idx = omp_get_thread_num();
-#endif
-            char key[255];
-#pragma omp for schedule(dynamic, 100) reduction(max:maxTargetId)
-            for (size_t i = 0; i < resultReader.getSize(); ++i) {
-                progress.updateProgress();
-                char *data = resultReader.getData(i, thread_idx);
-                while (*data != '\0') {
-                    Util::parseKey(data, key);
-                    unsigned int dbKey = std::strtoul(key, NULL, 10);
-                    maxTargetId = std::max(maxTargetId, dbKey);
-                    data = Util::skipLine(data);
-                }
-            }
-        };
-        resultReader.close();
-    } else {
+    if (isGeneralMode == false) {
         bool touch = (par.preloadMode != Parameters::PRELOAD_MODE_MMAP);
         IndexReader query(par.db1, par.threads, IndexReader::SEQUENCES, (touch) ? IndexReader::PRELOAD_INDEX : 0);
         aaResSize = query.sequenceReader->getAminoAcidDBSize();
@@ -98,45 +226,27 @@ int doswap(Parameters& par, bool isGeneralMode) {
         evaluer = new EvalueComputation(aaResSize, subMat, gapOpen, gapExtend);
     }
 
-    DBReader<unsigned int> resultDbr(parResultDb, parResultDbIndex, par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA);
+    DBReader<unsigned int> resultDbr(parResultDb, parResultDbIndex, par.threads, DBReader<unsigned int>::USE_INDEX|DBReader<unsigned int>::USE_DATA|DBReader<unsigned int>::USE_BINARY);
     resultDbr.open(DBReader<unsigned int>::SORT_BY_OFFSET);
+    // binary prefilter results are swapped record by record
+    const bool binary = resultDbr.isBinary();
+    if (binary && isGeneralMode) {
+        Debug(Debug::ERROR) << "Binary result databases are not supported by swapdb. Use swapresults instead.\n";
+        EXIT(EXIT_FAILURE);
+    }
 
-    const size_t resultSize = resultDbr.getSize();
-    Debug(Debug::INFO) << "Computing offsets.\n";
-    size_t *targetElementSize = new size_t[maxTargetId + 2]; // extra element for offset + 1 index id
-    memset(targetElementSize, 0, sizeof(size_t) * (maxTargetId + 2));
-    {
-        Debug::Progress progress(resultSize);
-
-#pragma omp parallel
-        {
-            int thread_idx = 0;
-#ifdef OPENMP
-            thread_idx = omp_get_thread_num();
-#endif
-#pragma omp  for schedule(dynamic, 100)
-            for (size_t i = 0; i < resultSize; ++i) {
-                progress.updateProgress();
-                const unsigned int resultId = resultDbr.getDbKey(i);
-                char queryKeyStr[1024];
-                char *tmpBuff = Itoa::u32toa_sse2((uint32_t) resultId, queryKeyStr);
-                *(tmpBuff) = '\0';
-                size_t queryKeyLen = strlen(queryKeyStr);
-                char *data = resultDbr.getData(i, thread_idx);
-                char dbKeyBuffer[255 + 1];
-                while (*data != '\0') {
-                    Util::parseKey(data, dbKeyBuffer);
-                    size_t targetKeyLen = strlen(dbKeyBuffer);
-                    const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
-                    char *nextLine = Util::skipLine(data);
-                    size_t lineLen = nextLine - data;
-                    lineLen -= targetKeyLen;
-                    lineLen += queryKeyLen;
-                    __sync_fetch_and_add(&(targetElementSize[dbKey]), lineLen);
-                    data = nextLine;
-                }
-            }
+    bool isAlignmentResult = false;
+    bool hasBacktrace = false;
+    const char *entry[255];
+    for (size_t i = 0; i < resultDbr.getSize() && binary == false; i++){
+        char *data = resultDbr.getData(i, 0);
+        if (*data == '\0'){
+            continue;
         }
+        const size_t columns = Util::getWordsOfLine(data, entry, 255);
+        isAlignmentResult = columns >= Matcher::ALN_RES_WITH_OUT_BT_COL_CNT;
+        hasBacktrace = columns >= Matcher::ALN_RES_WITH_BT_COL_CNT;
+        break;
     }
 
     // memoryLimit in bytes
@@ -146,194 +256,219 @@ int doswap(Parameters& par, bool isGeneralMode) {
     } else {
         memoryLimit = static_cast<size_t>(Util::getTotalSystemMemory() * 0.9);
     }
-    size_t bytesForTargetElements = sizeof(size_t) * (maxTargetId + 2);
+    size_t bytesForTargetElements = (targetElementExists != NULL) ? (maxTargetId + 1) : 0;
     memoryLimit = (memoryLimit > bytesForTargetElements) ? (memoryLimit - bytesForTargetElements) : 0;
 
-    // compute splits
-    std::vector<std::pair<unsigned int, size_t > > splits;
-    std::vector<std::pair<std::string , std::string > > splitFileNames;
-    size_t bytesToWrite = 0;
-    for (size_t i = 0; i <= maxTargetId; i++) {
-        bytesToWrite += targetElementSize[i];
-        if (bytesToWrite > memoryLimit){
-            splits.push_back(std::make_pair(i-1, bytesToWrite-targetElementSize[i]));
-            bytesToWrite = targetElementSize[i];
+    DBWriter resultWriter(parOutDb, parOutDbIndex, par.threads, par.compressed, resultDbr.getDbtype());
+    resultWriter.open();
+
+    SwapContext ctx;
+    ctx.isGeneralMode = isGeneralMode;
+    ctx.binary = binary;
+    ctx.isAlignmentResult = isAlignmentResult;
+    ctx.hasBacktrace = hasBacktrace;
+    ctx.evalThr = par.evalThr;
+    ctx.evaluer = evaluer;
+    ctx.targetElementExists = targetElementExists;
+    ctx.maxTargetId = maxTargetId;
+    ctx.writer = &resultWriter;
+
+    // single parse pass: every result line is swapped into a per thread buffer, whenever the buffered lines
+    // exceed the memory limit they are sorted by target and spilled to a run file
+    const size_t resultSize = resultDbr.getSize();
+    std::vector<std::vector<char> > threadData(par.threads);
+    std::vector<std::vector<SwapRecord> > threadRecords(par.threads);
+    std::vector<std::string> runFiles;
+    std::vector<SwapRecord> records;
+    std::vector<char *> buffers(par.threads);
+
+    Debug(Debug::INFO) << "Reading results.\n";
+    Debug::Progress progress(resultSize);
+    // parse in chunks, the memory limit is checked after each chunk
+    const size_t chunkBytes = std::max(memoryLimit / 16, static_cast<size_t>(1));
+    size_t lastChunkGrowth = 0;
+    size_t chunkStart = 0;
+    while (chunkStart < resultSize) {
+        size_t chunkEnd = chunkStart;
+        size_t bytes = 0;
+        while (chunkEnd < resultSize && (chunkEnd == chunkStart || bytes < chunkBytes)) {
+            bytes += resultDbr.getEntryLen(chunkEnd);
+            chunkEnd++;
         }
-    }
-    splits.push_back(std::make_pair(maxTargetId, bytesToWrite));
-    AlignmentSymmetry::computeOffsetFromCounts(targetElementSize, maxTargetId + 1);
-
-    const char empty = '\0';
-
-    unsigned int prevDbKeyToWrite = 0;
-    size_t prevBytesToWrite = 0;
-    for (size_t split = 0; split < splits.size(); split++) {
-        unsigned int dbKeyToWrite = splits[split].first;
-        size_t bytesToWrite = splits[split].second;
-        char *tmpData = new char[bytesToWrite];
-        Util::checkAllocation(tmpData, "Can not allocate tmpData memory in doswap");
-        Debug(Debug::INFO) << "\nReading results.\n";
-        Debug::Progress progress(resultSize);
+
+        size_t usedBefore = 0;
+        for (int thread = 0; thread < par.threads; ++thread) {
+            usedBefore += threadData[thread].capacity() + threadRecords[thread].capacity() * sizeof(SwapRecord);
+        }
+
 #pragma omp parallel
         {
-            int thread_idx = 0;
+            unsigned int thread_idx = 0;
 #ifdef OPENMP
-            thread_idx = omp_get_thread_num();
+            thread_idx = (unsigned int) omp_get_thread_num();
 #endif
+            std::vector<char> &swapped = threadData[thread_idx];
+            std::vector<SwapRecord> &swappedRecords = threadRecords[thread_idx];
+            char queryKeyStr[1024];
+            char dbKeyBuffer[255 + 1];
 
 #pragma omp for schedule(dynamic, 10)
-            for (size_t i = 0; i < resultSize; ++i) {
+            for (size_t i = chunkStart; i < chunkEnd; ++i) {
                 progress.updateProgress();
-                char *data = resultDbr.getData(i, thread_idx);
-                unsigned int queryKey = resultDbr.getDbKey(i);
-                char queryKeyStr[1024];
+                const unsigned int queryKey = resultDbr.getDbKey(i);
+                SwapRecord record;
+                record.buffer = thread_idx;
+                record.entry = i;
+                if (binary) {
+                    std::pair<const packed_hit_t*, size_t> hits = resultDbr.getRecords<packed_hit_t>(i, thread_idx);
+                    for (size_t j = 0; j < hits.second; ++j) {
+                        packed_hit_t hit = hits.first[j];
+                        record.target = hit.seqId;
+                        record.offset = swapped.size();
+                        record.length = sizeof(packed_hit_t);
+                        hit.seqId = queryKey;
+                        swapped.insert(swapped.end(), (char *) &hit, ((char *) &hit) + sizeof(packed_hit_t));
+                        swappedRecords.push_back(record);
+                    }
+                    continue;
+                }
                 char *tmpBuff = Itoa::u32toa_sse2((uint32_t) queryKey, queryKeyStr);
                 *(tmpBuff) = '\0';
                 size_t queryKeyLen = strlen(queryKeyStr);
-                char dbKeyBuffer[255 + 1];
+                char *data = resultDbr.getData(i, thread_idx);
                 while (*data != '\0') {
                     Util::parseKey(data, dbKeyBuffer);
                     size_t targetKeyLen = strlen(dbKeyBuffer);
                     char *nextLine = Util::skipLine(data);
                     size_t oldLineLen = nextLine - data;
-                    size_t newLineLen = oldLineLen;
-                    newLineLen -= targetKeyLen;
-                    newLineLen += queryKeyLen;
-                    const unsigned int dbKey = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
-                    // update offset but do not copy memory
-                    size_t offset = __sync_fetch_and_add(&(targetElementSize[dbKey]), newLineLen) - prevBytesToWrite;
-                    if(dbKey >= prevDbKeyToWrite && dbKey <=  dbKeyToWrite){
-                        memcpy(&tmpData[offset], queryKeyStr, queryKeyLen);
-                        memcpy(&tmpData[offset + queryKeyLen], data + targetKeyLen, oldLineLen - targetKeyLen);
-                    }
+                    record.target = (unsigned int) strtoul(dbKeyBuffer, NULL, 10);
+                    record.offset = swapped.size();
+                    record.length = oldLineLen - targetKeyLen + queryKeyLen;
+                    swapped.insert(swapped.end(), queryKeyStr, queryKeyStr + queryKeyLen);
+                    swapped.insert(swapped.end(), data + targetKeyLen, nextLine);
+                    swappedRecords.push_back(record);
                     data = nextLine;
                 }
             }
         }
-        //revert offsets
-        for (unsigned int i = maxTargetId + 1; i > 0; i--) {
-            targetElementSize[i] = targetElementSize[i - 1];
+        chunkStart = chunkEnd;
+
+        size_t used = 0;
+        for (int thread = 0; thread < par.threads; ++thread) {
+            used += threadData[thread].capacity() + threadRecords[thread].capacity() * sizeof(SwapRecord);
         }
-        targetElementSize[0] = 0;
-
-        Debug(Debug::INFO) << "\nOutput database: " << parOutDbStr << "\n";
-        bool isAlignmentResult = false;
-        bool hasBacktrace = false;
-        const char *entry[255];
-        for (size_t i = 0; i < resultDbr.getSize(); i++){
-            char *data = resultDbr.getData(i, 0);
-            if (*data == '\0'){
-                continue;
-            }
-            const size_t columns = Util::getWordsOfLine(data, entry, 255);
-            isAlignmentResult = columns >= Matcher::ALN_RES_WITH_OUT_BT_COL_CNT;
-            hasBacktrace = columns >= Matcher::ALN_RES_WITH_BT_COL_CNT;
-            break;
+        lastChunkGrowth = std::max(lastChunkGrowth, used - std::min(used, usedBefore));
+        const bool isLast = chunkStart == resultSize;
+        if (isLast == false && used + lastChunkGrowth <= memoryLimit) {
+            continue;
         }
 
-        std::string splitDbw = parOutDbStr + "_" + SSTR(split);
-        std::pair<std::string, std::string> splitNamePair = (splits.size() > 1) ? std::make_pair(splitDbw, splitDbw + ".index") :
-                                                            std::make_pair(parOutDb, parOutDbIndex) ;
-        splitFileNames.push_back(splitNamePair);
-        Debug::Progress progress2(dbKeyToWrite - prevDbKeyToWrite  + 1);
-
-        DBWriter resultWriter(splitNamePair.first.c_str(), splitNamePair.second.c_str(), par.threads, par.compressed, resultDbr.getDbtype());
-        resultWriter.open();
-#pragma omp parallel
-        {
-            unsigned int thread_idx = 0;
-#ifdef OPENMP
-            thread_idx = (unsigned int) omp_get_thread_num();
-#endif
-            // we are reusing this vector also for the prefiltering results
-            // qcov is used for pScore because its the first float value
-            // and alnLength for diagonal because its the first int value after
-            std::vector<Matcher::result_t> curRes;
-            curRes.reserve(300);
-
-            char buffer[1024+32768];
-            std::string ss;
-            ss.reserve(100000);
-
-#pragma omp for schedule(dynamic, 100)
-            for (size_t i = prevDbKeyToWrite; i <= dbKeyToWrite; ++i) {
-                progress2.updateProgress();
-
-                char *data = &tmpData[targetElementSize[i] - prevBytesToWrite];
-                size_t dataSize = targetElementSize[i + 1] - targetElementSize[i];
+        // the records of all threads are sorted together, they point into the thread buffers
+        records.clear();
+        for (int thread = 0; thread < par.threads; ++thread) {
+            records.insert(records.end(), threadRecords[thread].begin(), threadRecords[thread].end());
+            std::vector<SwapRecord>().swap(threadRecords[thread]);
+            buffers[thread] = threadData[thread].data();
+        }
+        omptl::sort(records.begin(), records.end(), SwapRecord::compare);
 
-                if (isGeneralMode) {
-                    if (dataSize > 0) {
-                        resultWriter.writeData(data, dataSize, i, thread_idx);
-                    }
-                    continue;
-                }
+        if (isLast && runFiles.empty()) {
+            // everything fitted into memory, no need to spill
+            break;
+        }
 
-                bool evalBreak = false;
-                while (dataSize > 0) {
-                    if (isAlignmentResult) {
-                        Matcher::result_t res = Matcher::parseAlignmentRecord(data, true);
-                        Matcher::result_t::swapResult(res, *evaluer, hasBacktrace);
-                        if (res.eval > par.evalThr) {
-                            evalBreak = true;
-                            goto outer;
-                        }
-                        curRes.emplace_back(res);
-                    } else {
-                        hit_t hit = QueryMatcher::parsePrefilterHit(data);
-                        hit.diagonal = static_cast<unsigned short>(static_cast<short>(hit.diagonal) * -1);
-                        curRes.emplace_back(hit.seqId, hit.prefScore, 0, 0, 0, -static_cast<float>(hit.prefScore), hit.diagonal, 0, 0, 0, 0, 0, 0, "");
-                    }
-                    outer:
-                    char *nextLine = Util::skipLine(data);
-                    size_t lineLen = nextLine - data;
-                    dataSize -= lineLen;
-                    data = nextLine;
-                }
+        std::string runFile = parOutDbStr + "_" + SSTR(runFiles.size());
+        FILE *handle = FileUtil::openFileOrDie(runFile.c_str(), "w", false);
+        for (size_t i = 0; i < records.size();) {
+            SwapRunBlock block;
+            memset(&block, 0, sizeof(SwapRunBlock));
+            block.target = records[i].target;
+            size_t end = i;
+            while (end < records.size() && records[end].target == block.target) {
+                block.size += records[end].length;
+                end++;
+            }
+            bool success = fwrite(&block, sizeof(SwapRunBlock), 1, handle) == 1;
+            for (; i < end; ++i) {
+                success = success && fwrite(buffers[records[i].buffer] + records[i].offset, sizeof(char), records[i].length, handle) == records[i].length;
+            }
+            if (success == false) {
+                Debug(Debug::ERROR) << "Can not write to " << runFile << "\n";
+                EXIT(EXIT_FAILURE);
+            }
+        }
+        if (fclose(handle) != 0) {
+            Debug(Debug::ERROR) << "Can not close " << runFile << "\n";
+            EXIT(EXIT_FAILURE);
+        }
+        runFiles.push_back(runFile);
+        std::vector<SwapRecord>().swap(records);
+        for (int thread = 0; thread < par.threads; ++thread) {
+            std::vector<char>().swap(threadData[thread]);
+        }
+    }
+    Debug(Debug::INFO) << "\n";
 
-                if (curRes.empty() == false) {
-                    if (curRes.size() > 1) {
-                        std::sort(curRes.begin(), curRes.end(), Matcher::compareHits);
+    Debug(Debug::INFO) << "Output database: " << parOutDbStr << "\n";
+    if (runFiles.empty()) {
+        writeSwappedRecords(ctx, records, buffers.data());
+    } else {
+        // k-way merge of the runs, the blocks of one target are concatenated in run order (= input order)
+        Debug(Debug::INFO) << "Merging " << runFiles.size() << " runs\n";
+        std::vector<SwapRun> runs(runFiles.size());
+        std::priority_queue<std::pair<unsigned int, unsigned int>, std::vector<std::pair<unsigned int, unsigned int> >,
+                std::greater<std::pair<unsigned int, unsigned int> > > queue;
+        for (size_t i = 0; i < runFiles.size(); ++i) {
+            runs[i].file = FileUtil::openFileOrDie(runFiles[i].c_str(), "r", true);
+            if (runs[i].next()) {
+                queue.push(std::make_pair(runs[i].block.target, i));
+            }
+        }
+        std::vector<char> arena;
+        while (queue.empty() == false) {
+            // collect blocks until the memory limit is reached, a single target is always read completely
+            arena.clear();
+            records.clear();
+            while (queue.empty() == false && (records.empty() || arena.size() < memoryLimit)) {
+                const unsigned int target = queue.top().first;
+                while (queue.empty() == false && queue.top().first == target) {
+                    unsigned int run = queue.top().second;
+                    queue.pop();
+                    SwapRecord record;
+                    record.target = target;
+                    record.buffer = 0;
+                    record.entry = run;
+                    record.offset = arena.size();
+                    record.length = runs[run].block.size;
+                    arena.resize(arena.size() + record.length);
+                    if (fread(arena.data() + record.offset, sizeof(char), record.length, runs[run].file) != record.length) {
+                        Debug(Debug::ERROR) << "Can not read from " << runFiles[run] << "\n";
+                        EXIT(EXIT_FAILURE);
                     }
-
-                    for (size_t j = 0; j < curRes.size(); j++) {
-                        const Matcher::result_t &res = curRes[j];
-                        if (isAlignmentResult) {
-                            size_t len = Matcher::resultToBuffer(buffer, res, hasBacktrace, false);
-                            ss.append(buffer, len);
-                        } else {
-                            hit_t hit;
-                            hit.seqId = res.dbKey;
-                            hit.prefScore = res.score;
-                            hit.diagonal = res.alnLength;
-                            size_t len = QueryMatcher::prefilterHitToBuffer(buffer, hit);
-                            ss.append(buffer, len);
-                        }
+                    records.push_back(record);
+                    if (runs[run].next()) {
+                        queue.push(std::make_pair(runs[run].block.target, run));
                     }
-
-                    resultWriter.writeData(ss.c_str(), ss.size(), i, thread_idx);
-                    ss.clear();
-
-                    curRes.clear();
-                } else if (evalBreak == true || targetElementExists[i] == 1) {
-                    resultWriter.writeData(&empty, 0, i, thread_idx);
                 }
             }
-        };
-        Debug(Debug::INFO) << "\n";
-        if(splits.size() > 1){
-            resultWriter.close(true);
-        }else{
-            resultWriter.close();
+            char *arenaData = arena.data();
+            writeSwappedRecords(ctx, records, &arenaData);
+        }
+        for (size_t i = 0; i < runFiles.size(); ++i) {
+            fclose(runs[i].file);
+            FileUtil::remove(runFiles[i].c_str());
         }
-
-        prevDbKeyToWrite = dbKeyToWrite + 1;
-        prevBytesToWrite += bytesToWrite;
-        delete[] tmpData;
     }
-    if(splits.size() > 1){
-        DBWriter::mergeResults(parOutDbStr, parOutDbIndexStr, splitFileNames);
+
+    // targets without any hit get an empty entry
+    if (targetElementExists != NULL) {
+        for (unsigned int i = 0; i <= maxTargetId; ++i) {
+            if (targetElementExists[i] == 1) {
+                resultWriter.writeData(NULL, 0, i, 0);
+            }
+        }
     }
+    resultWriter.close();
 
     if (evaluer != NULL) {
         delete evaluer;
@@ -347,7 +482,6 @@ int doswap(Parameters& par, bool isGeneralMode) {
     if (targetElementExists != NULL) {
         delete[] targetElementExists;
     }
-    delete[] targetElementSize;
     return EXIT_SUCCESS;
 }
 
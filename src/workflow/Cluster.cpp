@@ -1,5 +1,6 @@
 #include "Parameters.h"
 #include "Util.h"
+#include "DBReader.h"
 #include "DBWriter.h"
 #include "CommandCaller.h"
 #include "Debug.h"
@@ -234,6 +235,8 @@ int clusteringworkflow(int argc, const char **argv, const Command& command) {
         cmd.addVariable("STEPS", SSTR(par.clusterSteps).c_str());
         // correct for cascading clustering errors
         if(par.clusterReassignment){
+            // the reassignment lists the input keys with awk
+            DBReader<unsigned int>::requireTextIndex(par.db1);
             cmd.addVariable("REASSIGN","TRUE");
         }
         cmd.addVariable("THREADSANDCOMPRESS", par.createParameterString(par.threadsandcompression).c_str());
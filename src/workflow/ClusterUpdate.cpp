@@ -1,5 +1,6 @@
 #include <cassert>
 
+#include "DBReader.h"
 #include "Debug.h"
 #include "Util.h"
 #include "Parameters.h"
@@ -38,6 +39,12 @@ int clusterupdate(int argc, const char **argv, const Command& command) {
 
     par.parseParameters(argc, argv, command, true, 0, 0);
 
+    // the keys of the sequence and header databases are remapped with sort and join
+    DBReader<unsigned int>::requireTextIndex(par.db1);
+    DBReader<unsigned int>::requireTextIndex(par.db1 + "_h");
+    DBReader<unsigned int>::requireTextIndex(par.db2);
+    DBReader<unsigned int>::requireTextIndex(par.db2 + "_h");
+
     CommandCaller cmd;
     cmd.addVariable("REMOVE_TMP", par.removeTmpFiles ? "TRUE" : NULL);
     cmd.addVariable("RECOVER_DELETED", par.recoverDeleted ? "TRUE" : NULL);
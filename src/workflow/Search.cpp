@@ -301,11 +301,19 @@ int search(int argc, const char **argv, const Command& command) {
     cmd.addVariable("RUNNER", par.runner.c_str());
 //    cmd.addVariable("ALIGNMENT_DB_EXT", Parameters::isEqualDbtype(targetDbType, Parameters::DBTYPE_PROFILE_STATE_SEQ) ? ".255" : "");
     par.filenames[1] = targetDB;
+    // only blastp.sh passes the prefilter hits in memory to the alignment
+    if (par.streamPrefilter && (par.sliceSearch == true || (searchMode & Parameters::SEARCH_MODE_FLAG_TARGET_PROFILE) || par.numIterations > 1)) {
+        Debug(Debug::WARNING) << "--stream-prefilter is not supported for sliced, target profile or iterative searches and will be ignored.\n";
+    }
     if (par.sliceSearch == true) {
 
         // By default (0), diskSpaceLimit (in bytes) will be set in the workflow to use as much as possible
         cmd.addVariable("AVAIL_DISK", SSTR(static_cast<size_t>(par.diskSpaceLimit)).c_str());
 
+        // the sliced search counts and slices the index files directly
+        DBReader<unsigned int>::requireTextIndex(par.db1);
+        DBReader<unsigned int>::requireTextIndex(par.db2);
+
         // correct Eval threshold for inverted search
         const size_t queryDbSize = FileUtil::countLines(par.db1Index.c_str());
         const size_t targetDbSize = FileUtil::countLines(par.db2Index.c_str());
@@ -425,6 +433,18 @@ int search(int argc, const char **argv, const Command& command) {
         } else {
             cmd.addVariable("ALIGNMENT_PAR", par.createParameterString(par.align).c_str());
         }
+        if (par.streamPrefilter && (isUngappedMode || par.runner.empty() == false)) {
+            Debug(Debug::WARNING) << "--stream-prefilter is not supported for ungapped alignment or with a --mpi-runner and will be ignored.\n";
+        } else if (par.streamPrefilter) {
+            std::vector<MMseqsParameter*> prefilterAlignWithoutS;
+            for (size_t i = 0; i < par.prefilteralign.size(); i++) {
+                if (par.prefilteralign[i]->uniqid != par.PARAM_S.uniqid) {
+                    prefilterAlignWithoutS.push_back(par.prefilteralign[i]);
+                }
+            }
+            cmd.addVariable("STREAM_PREFILTER", "TRUE");
+            cmd.addVariable("PREFILTERALIGN_PAR", par.createParameterString(prefilterAlignWithoutS).c_str());
+        }
         FileUtil::writeFile(tmpDir + "/blastp.sh", blastp_sh, blastp_sh_len);
         program = std::string(tmpDir + "/blastp.sh");
     }